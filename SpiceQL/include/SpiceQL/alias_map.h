@@ -2,6 +2,8 @@
 #include <string>
 #include <unordered_map>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
 #include <nlohmann/json.hpp>
 
 namespace SpiceQL {
@@ -52,6 +54,16 @@ namespace SpiceQL {
        */
       void setAliasMap(const nlohmann::json& newAliasMap);
 
+      /**
+       * @brief Counter bumped every time the lookup table changes
+       *
+       * Lets callers that derive data from the aliases tell when to rebuild it
+       * without taking the lock.
+       *
+       * @return The current generation of the lookup table
+       */
+      uint64_t generation() const { return m_generation.load(std::memory_order_acquire); }
+
     private:
       AliasMap() = default; // Prevents others from making new instances
 
@@ -71,6 +83,7 @@ namespace SpiceQL {
       std::unordered_map<std::string, std::string> m_lookupTable;
       std::mutex m_mutex;
       bool m_initialized = false;
+      std::atomic<uint64_t> m_generation{0};
   };
 
   /**
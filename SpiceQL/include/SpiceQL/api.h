@@ -6,6 +6,12 @@
 
 namespace SpiceQL {
 
+    /**
+     * Key of the kernel JSON returned by the frame translation functions telling
+     * whether the kernels were furnished to answer (false if the DB's frame map answered)
+     */
+    extern std::string KERNELS_FURNISHED_KEY;
+
     /**
      * @brief Translates a given name using the aliasMap and checks if the name is in the frameList.
      * 
@@ -111,6 +117,34 @@ namespace SpiceQL {
         int limitSpk=1,
         std::vector<std::string> kernelList={});
 
+    /**
+     * @brief Gives the positions and velocities for a given set of ephemeris times in one contiguous array
+     *
+     * Same as getTargetStates, but the states are returned as a single N×7 row major
+     * array instead of a vector per time, which avoids an allocation per time for
+     * large requests. Use getTargetStatesInto to write into a buffer of your own.
+     *
+     * @see SpiceQL::getTargetStates
+     * @see SpiceQL::getTargetStatesInto
+     *
+     * @return A vector of N×7 values, row i holds x,y,z,vx,vy,vz and the light time at ets[i].
+     **/
+    std::pair<std::vector<double>, nlohmann::json> getTargetStatesArray(
+        std::vector<double> ets,
+        std::string target,
+        std::string observer,
+        std::string frame,
+        std::string abcorr,
+        std::string mission="",
+        std::vector<std::string> ckQualities={"smithed", "reconstructed"},
+        std::vector<std::string> spkQualities={"smithed", "reconstructed"},
+        bool useWeb=false,
+        bool searchKernels=true,
+        bool fullKernelPath=false,
+        int limitCk=-1, 
+        int limitSpk=1,
+        std::vector<std::string> kernelList={});
+
     /**
      * @brief Gives the positions and velocities for a given start and stop ephemeris times and number of records
      *
@@ -413,6 +447,9 @@ namespace SpiceQL {
      *
      * See <a href="https://naif.jpl.nasa.gov/pub/naif/toolkit_docs/C/req/naif_ids.html">NAIF's Docs on frame codes</a> for more information
      *
+     * The returned kernel JSON's "furnished" key tells whether the kernels were
+     * furnished, as in translateNamesToCodes.
+     *
      * @param frame String frame name to translate to a NAIF code
      * @param mission Mission name as it relates to the config files
      * @param searchKernels bool Whether to search the kernels for the user
@@ -438,6 +475,9 @@ namespace SpiceQL {
      *
      * See <a href="https://naif.jpl.nasa.gov/pub/naif/toolkit_docs/C/req/naif_ids.html">NAIF's Docs on frame codes</a> for more information
      *
+     * The returned kernel JSON's "furnished" key tells whether the kernels were
+     * furnished, as in translateCodesToNames.
+     *
      * @param frame int NAIF frame code to translate
      * @param searchKernels bool Whether to search the kernels for the user
      * @param mission Mission name as it relates to the config files
@@ -458,6 +498,60 @@ namespace SpiceQL {
         int limitSpk=1,
         std::vector<std::string> kernelList={});
 
+    /**
+     * @brief Translate several NAIF frame names to integer frame codes
+     *
+     * Names are answered from the DB's frame map when searching for kernels. The
+     * kernels are furnished once for the names it lacks, and the returned kernel
+     * JSON's "furnished" key tells whether that happened.
+     *
+     * @param frames String frame names to translate to NAIF codes
+     * @param mission Mission name as it relates to the config files
+     * @param searchKernels bool Whether to search the kernels for the user
+     * @param fullKernelPath bool if true returns full kernel paths, default returns relative paths
+     * @param limitCk int number of cks to limit to, default is -1 to retrieve all
+     * @param limitSpk int number of spks to limit to, default is 1 to retrieve only one
+     * @param kernelList vector<string> vector of additional kernels to load 
+     *
+     * @return vector of Naif frame codes, in the order of frames
+     **/
+    std::pair<std::vector<int>, nlohmann::json> translateNamesToCodes(
+        std::vector<std::string> frames, 
+        std::string mission="", 
+        bool useWeb=false, 
+        bool searchKernels=true, 
+        bool fullKernelPath=false, 
+        int limitCk=-1, 
+        int limitSpk=1, 
+        std::vector<std::string> kernelList={});
+
+    /**
+     * @brief Translate several NAIF frame codes to string frame names
+     *
+     * Codes are answered from the DB's frame map when searching for kernels. The
+     * kernels are furnished once for the codes it lacks, and the returned kernel
+     * JSON's "furnished" key tells whether that happened.
+     *
+     * @param frames int NAIF frame codes to translate
+     * @param mission Mission name as it relates to the config files
+     * @param searchKernels bool Whether to search the kernels for the user
+     * @param fullKernelPath bool if true returns full kernel paths, default returns relative paths
+     * @param limitCk int number of cks to limit to, default is -1 to retrieve all
+     * @param limitSpk int number of spks to limit to, default is 1 to retrieve only one
+     * @param kernelList vector<string> vector of additional kernels to load 
+     *
+     * @return vector of Naif frame names, in the order of frames
+     **/
+    std::pair<std::vector<std::string>, nlohmann::json> translateCodesToNames(
+        std::vector<int> frames, 
+        std::string mission="", 
+        bool useWeb=false, 
+        bool searchKernels=true, 
+        bool fullKernelPath=false, 
+        int limitCk=-1, 
+        int limitSpk=1,
+        std::vector<std::string> kernelList={});
+
     /**
      * @brief Get the center, class id, and class of a given frame
      *
@@ -602,7 +696,10 @@ namespace SpiceQL {
      *
      * Given an observation start and observation end, extract all times assocaited
      * with segments in a CK file. The times returned are all times assocaited with
-     * concrete CK segment times with no interpolation. This function is limited to 
+     * concrete CK segment times with no interpolation. When the kernels are
+     * searched and the database has a CK record index for them, the times are
+     * looked up in the index without furnishing, and multiple CKs are resolved
+     * by load priority. Otherwise the CK is read directly, which is limited to 
      * loading one CK file at a time, if a time window covers multiple CK files, 
      * the function will throw an error. For this reason, limitCK is set to 1 by default.
      *
@@ -0,0 +1,153 @@
+#pragma once
+/**
+ * @file
+ *
+ * Thread safe evaluation of frame orientations from the furnished CKs
+ *
+ **/
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace SpiceQL {
+
+  extern std::string NATIVE_CK_ENV_VAR;
+
+  class DafFile;
+
+
+  /**
+   * @brief Evaluates orientations of one frame relative to another without CSPICE.
+   *
+   * getTargetOrientations evaluates the transformation between two frames at
+   * every epoch through CSPICE, which cannot be called from more than one
+   * thread. When the frames are linked through inertial, TK and CK frames,
+   * and the CKs the links need are of types 2 and 3, this evaluates the same
+   * orientations from memory mapped CKs on all cores.
+   *
+   * The frame graph is built once per request. Constant rotations of
+   * inertial and TK frames are looked up then, and the epochs are converted
+   * to the ticks of each CK's SCLK. After that, each epoch only reads CK
+   * segments. They are chosen as CSPICE chooses them: the last loaded CK and
+   * its last segment with angular velocity that has pointing at the epoch.
+   * Frames with any other class, such as PCK and dynamic frames, are left to
+   * CSPICE. Each CK's segments are parsed once and kept with the mapped file,
+   * a request only collects those of the instruments its frames use.
+   *
+   * Quaternions and angular velocities agree with CSPICE to within 1e-12.
+   *
+   * Evaluation is on by default and turned off with setEnabled or by setting
+   * SPICEQL_NATIVE_CK to false.
+   */
+  class CkEvaluator {
+    public:
+    /**
+     * @brief Minimum number of epochs getTargetOrientationsInto evaluates natively, fewer are left to CSPICE.
+     */
+    static constexpr size_t MIN_EPOCHS = 1024;
+
+    /**
+     * @brief Builds an evaluator of toFrame relative to refFrame at the given epochs.
+     *
+     * Must be called on the thread that furnished the kernels.
+     *
+     * @param toFrame NAIF ID of the frame whose orientation is evaluated
+     * @param refFrame NAIF ID of the frame it is relative to
+     * @param ets ephemeris times
+     * @param count number of ephemeris times
+     * @return the evaluator, or nullptr if evaluation is off, a frame between the two
+     *         is not supported, or a furnished CK cannot be read natively
+     */
+    static std::unique_ptr<CkEvaluator> create(int toFrame, int refFrame, const double *ets, size_t count);
+
+    /**
+     * @brief Evaluates the orientations at the epochs given to create.
+     *
+     * Thread safe. Epochs are split across all cores when there are enough of them.
+     *
+     * @param orientations count x 8 row major buffer, each row is the quaternion,
+     *                     the angular velocity and 1, as getTargetOrientationsInto
+     * @return false if any epoch has no pointing in a supported segment, in which
+     *         case the orientations are incomplete and should be evaluated with CSPICE
+     */
+    bool evaluate(double *orientations) const;
+
+    /**
+     * @brief Turns native evaluation on or off.
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * @brief Whether native evaluation is on.
+     */
+    static bool isEnabled();
+
+    /**
+     * @brief Returns the evaluator's counters.
+     *
+     * @return json object with "enabled", the requests and "orientations" evaluated
+     *         natively, and the requests left to CSPICE as "unsupported"
+     */
+    static nlohmann::json stats();
+
+    ~CkEvaluator();
+
+    private:
+    struct Segment {
+      //! frame the segment's pointing is relative to
+      int reference;
+      int type;
+      bool has_av;
+      double start;
+      double stop;
+      //! first double of the segment
+      const double *data;
+      //! number of pointing instances or records
+      size_t records;
+      //! number of interpolation intervals of type 3
+      size_t intervals;
+    };
+
+    // Segments with angular velocity of each instrument in one CK, highest
+    // priority first, parsed once and kept with the file
+    using FileSegments = std::map<int, std::vector<Segment>>;
+
+    // Parses the segments of a CK
+    static FileSegments parseSegments(const DafFile &file);
+
+    struct Frame {
+      int frame_class;
+      //! parent of inertial and TK frames
+      int parent;
+      //! parent to frame rotation of inertial and TK frames, row major
+      double rotation[9];
+      //! CK instrument and its SCLK for CK frames
+      int instrument;
+      int sclk;
+    };
+
+    CkEvaluator() = default;
+
+    // Evaluates epochs [begin, end) on the calling thread
+    bool evaluateRange(size_t begin, size_t end, double *orientations) const;
+
+    // Rotation from the parent of frame to frame and angular velocity of frame
+    // relative to its parent in the parent's coordinates, at epoch index i
+    bool link(int frame, size_t i, int &parent, double *rotation, double *av) const;
+
+    int m_to = 0;
+    int m_ref = 0;
+    std::vector<double> m_ets;
+    //! epochs in the ticks of each SCLK the CK frames use
+    std::map<int, std::vector<double>> m_ticks;
+    std::map<int, Frame> m_frames;
+    //! CKs the segments point into, kept mapped while the evaluator lives
+    std::vector<std::shared_ptr<const DafFile>> m_files;
+    //! segments with angular velocity of the CK frames' instruments, highest priority first, owned by m_files
+    std::map<int, std::vector<const Segment *>> m_segments;
+  };
+}
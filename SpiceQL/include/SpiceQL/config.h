@@ -20,6 +20,15 @@ namespace SpiceQL {
    */
   std::vector<std::string> frameList();
 
+  /**
+   * @brief Get a number that changes whenever the config files are reparsed
+   *
+   * Reparses the config files first if one was added, removed or modified.
+   *
+   * @return uint64_t the generation of the parsed config
+   */
+  uint64_t configGeneration();
+
   /**
    * @brief Object for interacting with SpiceQL target configs
    * 
@@ -0,0 +1,105 @@
+#pragma once
+/**
+ * @file
+ *
+ * Read only access to the segments of binary SPKs and CKs in memory
+ *
+ **/
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SpiceQL {
+
+  /**
+   * @brief A binary SPK or CK, memory mapped so its segments can be read from any thread.
+   *
+   * CSPICE reads DAFs through one set of file handles and buffers shared by
+   * the whole process. The native evaluators read the segments of the
+   * furnished SPKs and CKs from here instead. Files are mapped once and kept
+   * until they change on disk, or are read whole where memory maps are not
+   * available. Only DAFs in the host's byte order, with the 2 double and
+   * 6 integer summaries of SPKs and CKs, are read.
+   *
+   * The evaluators keep the segments they parse from a file in its table, so
+   * a file's segments are parsed once while it is mapped instead of on every
+   * request.
+   */
+  class DafFile {
+    public:
+    struct Segment {
+      //! the summary's doubles, start and stop times
+      double dc[2];
+      //! the summary's integers, the last two are the data's first and last addresses
+      int ic[6];
+      //! first double of the segment's data
+      const double *data;
+      //! number of doubles in the segment's data
+      size_t size;
+    };
+
+    /**
+     * @brief Returns the mapped DAF at path.
+     *
+     * @param path path to the DAF
+     * @param idword the ID word files must start with, e.g. "DAF/SPK"
+     * @return the DAF, or nullptr if it cannot be read natively
+     */
+    static std::shared_ptr<const DafFile> get(const std::string &path, const std::string &idword);
+
+    /**
+     * @brief Returns the DAFs of a kind furnished in CSPICE, in load order.
+     *
+     * Must be called on the thread that furnished the kernels.
+     *
+     * @param kind kind of kernel as in kdata_c, "SPK" or "CK"
+     * @param idword the ID word files of the kind start with
+     * @param files set to the DAFs
+     * @return false if any of them cannot be read natively
+     */
+    static bool furnished(const std::string &kind, const std::string &idword, std::vector<std::shared_ptr<const DafFile>> &files);
+
+    /**
+     * @brief Number of DAFs mapped.
+     */
+    static size_t mapped();
+
+    /**
+     * @brief The file's segments, in the order they are stored.
+     */
+    const std::vector<Segment> &segments() const { return m_segments; }
+
+    /**
+     * @brief The file's segments parsed by build, built on first use and kept with the file.
+     *
+     * Thread safe. Files are only read with one ID word, and each kind of DAF
+     * is parsed by one evaluator, so a file keeps a single table.
+     *
+     * @param build called once with the file, returns the table
+     * @return the table, valid while the file is
+     */
+    template <typename T, typename Build>
+    const T &table(Build build) const {
+      std::call_once(m_table_once, [&]() { m_table = std::make_shared<const T>(build(*this)); });
+      return *std::static_pointer_cast<const T>(m_table);
+    }
+
+    ~DafFile();
+
+    private:
+    DafFile() = default;
+    bool load(const std::string &path, size_t size);
+    bool parse(const std::string &path, const std::string &idword);
+
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+    std::vector<double> m_buffer;
+    std::vector<Segment> m_segments;
+    std::string m_idword;
+    mutable std::once_flag m_table_once;
+    mutable std::shared_ptr<const void> m_table;
+  };
+}
@@ -0,0 +1,101 @@
+#pragma once
+/**
+ * @file
+ *
+ * Evaluation of large epoch arrays on forked worker processes
+ *
+ **/
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace SpiceQL {
+
+  extern std::string EVALUATION_PROCESSES_ENV_VAR;
+
+
+  /**
+   * @brief Splits SPICE evaluations of many epochs across worker processes.
+   *
+   * CSPICE is single threaded and its state is global to the process, so
+   * a long array of epochs is evaluated on one core. The pool forks worker
+   * processes once the kernels for a request are furnished, so each worker
+   * starts with the same kernel set already loaded. Every worker evaluates
+   * a contiguous shard of the epochs and writes its rows into a shared
+   * memory buffer, which is copied into the caller's buffer in epoch order.
+   * Workers make the same SPICE calls as a serial evaluation, so the
+   * results are bit for bit the same.
+   *
+   * Workers reopen the binary kernels the evaluation reads before evaluating
+   * so they do not share file offsets with each other or the calling process.
+   * Text kernels are already in the kernel pool and are kept. Reopening costs
+   * every worker the same time however few epochs it has, so the more kernels
+   * are reopened the fewer workers a request is split across, and a request
+   * too small for two workers is left to the caller.
+   *
+   * The pool is off unless turned on with setProcesses or by setting
+   * SPICEQL_EVAL_PROCESSES to a number of processes. It is never used in
+   * the WASM or Windows builds.
+   */
+  class EvaluationPool {
+    public:
+    /**
+     * @brief Evaluates rows [begin, end) into rows, which points at row begin.
+     *
+     * Runs in a forked worker, so it must only call CSPICE routines and must not
+     * throw, log or take locks. Returns false if SPICE failed.
+     */
+    using Shard = std::function<bool(size_t begin, size_t end, double *rows)>;
+
+    /**
+     * @brief Minimum number of epochs given to each worker.
+     */
+    static constexpr size_t MIN_SHARD_SIZE = 10000;
+
+    /**
+     * @brief Minimum number of epochs given to each worker per binary kernel it reopens.
+     */
+    static constexpr size_t MIN_EPOCHS_PER_KERNEL = 1000;
+
+    /**
+     * @brief Sets the number of worker processes, 0 or 1 turns the pool off.
+     */
+    static void setProcesses(size_t processes);
+
+    /**
+     * @brief Number of worker processes, the pool is off below 2.
+     */
+    static size_t getProcesses();
+
+    /**
+     * @brief Evaluates count rows of width doubles on the worker processes.
+     *
+     * The caller's kernels must be furnished. Nothing is written to out unless
+     * every worker succeeded.
+     *
+     * @param count number of rows, one per epoch
+     * @param width number of doubles in a row
+     * @param out count x width row major buffer the rows are copied into
+     * @param kinds kernel types, as reported by kdata_c ("SPK", "CK", "PCK", "DSK"
+     *        or "EK"), the evaluation reads and the workers reopen
+     * @param evaluate evaluates a shard of rows
+     * @return true if the rows were evaluated; false if the pool is off, there
+     *         are too few rows to split for the kernels to reopen, or a worker
+     *         failed, in which case the caller evaluates them itself
+     */
+    static bool run(size_t count, size_t width, double *out, const std::vector<std::string> &kinds, const Shard &evaluate);
+
+    /**
+     * @brief Returns the pool's counters.
+     *
+     * @return json object with "processes", the "runs" and "rows" evaluated on the pool,
+     *         the "workers" forked, the binary kernels "reopened" by them, the runs
+     *         "skipped" because they had too few rows for the kernels to reopen, and
+     *         the runs that "failed" and were left to the caller
+     */
+    static nlohmann::json stats();
+  };
+}
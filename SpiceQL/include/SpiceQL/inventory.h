@@ -10,6 +10,7 @@
 #include <vector>
 #include <tuple>
 #include <limits>
+#include <cstdint>
 
 #include <nlohmann/json.hpp>
 
@@ -29,6 +30,160 @@ namespace SpiceQL {
 
         void create_database(std::vector<std::string> mlist = {});
 
+        /**
+         * @brief Build a separate database shard for each mission.
+         *
+         * Shards are written to the "shards" directory of the cache directory
+         * and can be built by separate processes or machines. A shard rebuilt
+         * after the served database is read directly by searches for its
+         * mission until the shards are merged again.
+         *
+         * @param mlist missions to build shards for, every mission if empty
+         */
+        void create_database_shards(std::vector<std::string> mlist = {});
+
+        /**
+         * @brief Merge database shards into the served database.
+         *
+         * @param shard_files shard files to merge, every shard in the cache directory if empty
+         * @throws std::runtime_error if a shard was built by a different SpiceQL version
+         *         or a mission appears in more than one shard
+         */
+        void merge_database_shards(std::vector<std::string> shard_files = {});
+
+        /**
+         * @brief Get the generation number of the published database.
+         *
+         * Every create_database run publishes a new generation by atomically
+         * replacing the DB file. Running processes pick up the new generation,
+         * and drop their cached indices, the next time they query the inventory.
+         * Calling this costs a single stat of the DB file.
+         *
+         * @return uint64_t the generation, or 0 if no DB has been published
+         */
+        uint64_t getDbGeneration();
+
+        /**
+         * @brief Check whether a usable database already exists.
+         *
+         * A database is ready when it exists, can be read and was built by this
+         * version of SpiceQL. A rebuild in progress does not affect readiness,
+         * the previous generation keeps being served until the new one is
+         * published.
+         *
+         * @return true if the database can be queried
+         */
+        bool isDbReady();
+
+        /**
+         * @brief Publish the decoded inventory index for other processes.
+         *
+         * Writes the time indices, kernel lists and frame maps of the served
+         * database to a flat file in the cache directory. Worker processes map
+         * it with attachSharedIndex instead of each decoding the database into
+         * their own memory. Republish after create_database, an index built
+         * from an older generation is ignored.
+         */
+        void publishSharedIndex();
+
+        /**
+         * @brief Use the published shared index for searches in this process.
+         *
+         * Setting SPICEQL_SHARED_INDEX in the environment attaches automatically.
+         * Not supported on Windows.
+         *
+         * @return true if the index matches the served database generation
+         */
+        bool attachSharedIndex();
+
+        /**
+         * @brief Stop using the shared index in this process.
+         */
+        void detachSharedIndex();
+
+        /**
+         * @brief Warm up the inventory so the first queries do not pay for loading it.
+         *
+         * Loads the config, alias map and frame caches and the time indices of the
+         * selected missions into the process-wide caches. Missions served by an
+         * attached shared index are skipped, their indices are already mapped.
+         * Optionally pins the time independent kernels of the missions (see
+         * pinMissionKernels), and keeps the most furnished kernels recorded by
+         * the kernel telemetry loaded (see getHotKernels).
+         *
+         * @param missions spiceql mission names, all configured missions if empty
+         * @param furnish_kernels whether to furnish the time independent kernels
+         * @param hot_kernels number of most furnished kernels to keep loaded, 0 for none
+         * @return json report with the time taken and resident memory added by each stage,
+         *         "warm" is false if any stage failed
+         */
+        nlohmann::json preload(std::vector<std::string> missions = {}, bool furnish_kernels = false, int hot_kernels = 0);
+
+        /**
+         * @brief Keep the time independent kernels of missions loaded for the life of the process.
+         *
+         * Searches the lsk, pck, fk, ik, iak and sclk kernels of base and each
+         * mission once and pins their text kernels (see pinKernels). Searches for
+         * those kernel types for base or a pinned mission are then answered from
+         * the pinned results, and KernelSets asking for them reuse the loaded
+         * kernels, so repeated time and SCLK conversions for a pinned mission
+         * furnish nothing. The kernels are searched and pinned again when a new
+         * database generation is published.
+         *
+         * Pinned kernels keep their place in each KernelSet's order and are
+         * unloaded under sets that did not ask for them, so one mission's
+         * queries never see another mission's pinned kernels.
+         *
+         * @param missions spiceql mission names, base is always pinned
+         * @return json object of the pinned kernels of each name
+         */
+        nlohmann::json pinMissionKernels(std::vector<std::string> missions);
+
+        /**
+         * @brief Stop pinning mission kernels, releasing them to the kernel pool.
+         */
+        void unpinMissionKernels();
+
+        /**
+         * @brief Names whose kernels are pinned, base first, empty if none are.
+         */
+        std::vector<std::string> getPinnedMissions();
+
+        /**
+         * @brief Read the kernels of the next time window ahead of chronological searches.
+         *
+         * When successive searches for CKs or SPKs move forward in time, the
+         * kernels of the window after the last one, one step further, are
+         * resolved and read into the page cache on background threads (see
+         * KernelPrefetcher). Also turned on by SPICEQL_PREFETCH_THREADS.
+         *
+         * @param threads number of threads reading kernels, 0 turns prefetching off
+         */
+        void setKernelPrefetch(size_t threads);
+
+        /**
+         * @brief Get the prefetcher's hit rate and counters.
+         *
+         * @return json object described in KernelPrefetcher::stats
+         */
+        nlohmann::json getKernelPrefetchStats();
+
+        /**
+         * @brief Get exact CK record times from the record index stored in the database.
+         *
+         * Uses the type 3 segment record times recorded when the database was
+         * built, so nothing is furnished. When several CKs cover the window the
+         * one loaded last takes priority, as it would in SPICE.
+         *
+         * @param start_time ephemeris time to start at
+         * @param stop_time ephemeris time to stop at
+         * @param frame_code frame code of the instrument, its spacecraft's segments are searched
+         * @param mission spiceql mission name
+         * @param kernels kernel search result containing "ck" and "ck_quality"
+         * @return json array of ephemeris times, or null if a CK is not in the record index
+         */
+        nlohmann::json getIndexedCkTimes(double start_time, double stop_time, int frame_code, std::string mission, nlohmann::json kernels);
+
         /**
          * @brief Get the cached list of frame/config names from the database.
          *
@@ -47,6 +202,13 @@ namespace SpiceQL {
          */
         std::string getFrameNameFromCache(int code);
 
+        /**
+         * @brief Get the whole cached code->name map.
+         *
+         * @return nlohmann::json object of frame/body names keyed on their code as a string
+         */
+        nlohmann::json getFrameNameMapFromCache();
+
         /**
          * @brief Resolve a frame/body name to its code using the cached map.
          *
@@ -54,5 +216,46 @@ namespace SpiceQL {
          * @return the code, or 0 if not in the cache
          */
         int getFrameCodeFromCache(std::string name);
+
+        /**
+         * @brief Get a frame's definition as recorded when the database was built.
+         *
+         * Answers what frinfo_c (and tkfram_ for TK frames) would with the
+         * mission's FKs and IKs furnished, without furnishing them.
+         *
+         * @param code NAIF frame code
+         * @param mission spiceql mission name whose kernels define the frame
+         * @return json with "center", "class" and "class_id", plus "tk_parent" and the
+         *         row major "tk_rotation" for TK frames, or null if the frame was not recorded
+         */
+        nlohmann::json getFrameInfoFromCache(int code, std::string mission);
+
+        /**
+         * @brief Search the text kernel keywords recorded when the database was built.
+         *
+         * Keywords are recorded per kernel set, "mission" for the mission's IAKs, FKs
+         * and IKs and "target" for the mission's and base PCKs. A set is only used if
+         * it was read from the same kernels as the caller's.
+         *
+         * @param keytpl keyword template, "*" and "%" are wildcards as in gnpool_c
+         * @param mission spiceql mission name
+         * @param keywordSet "mission" or "target"
+         * @param kernels kernel set the caller would otherwise furnish
+         * @return json of matching keywords and values formatted like findKeywords, an
+         *         empty object if none match, or null if the set was not recorded
+         */
+        nlohmann::json findKeywordsFromCache(std::string keytpl, std::string mission, std::string keywordSet, nlohmann::json kernels);
+
+        /**
+         * @brief Get a target's body fixed frame as recorded when the database was built.
+         *
+         * Answers what cidfrm_c would with the mission's and base FKs furnished.
+         *
+         * @param targetId NAIF body code
+         * @param mission spiceql mission name
+         * @param kernels kernel set the caller would otherwise furnish
+         * @return json with "frameCode" and "frameName", or null if not recorded
+         */
+        nlohmann::json getTargetFrameFromCache(int targetId, std::string mission, nlohmann::json kernels);
     }
 }
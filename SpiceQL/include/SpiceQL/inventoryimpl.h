@@ -10,6 +10,10 @@
 #include <vector>
 #include <tuple>
 #include <limits>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
 
 // The BTree submodule's disk_fixed_alloc.h only defines the stdpmr namespace
 // alias for clang and GCC. Provide it for MSVC so the BTree headers compile on
@@ -24,6 +28,7 @@ namespace stdpmr = std::pmr;
 #include <nlohmann/json.hpp>
 
 #include <SpiceQL/spice_types.h>
+#include <SpiceQL/config.h>
 
 namespace SpiceQL {
 
@@ -31,7 +36,8 @@ namespace SpiceQL {
   extern std::string DB_START_TIME_KEY;
   extern std::string DB_STOP_TIME_KEY;
   extern std::string DB_TIME_FILES_KEY;
-  extern std::string DB_SS_TIME_INDICES_KEY;
+  extern std::string DB_START_TIME_INDICES_KEY;
+  extern std::string DB_STOP_TIME_INDICES_KEY;
   extern std::string DB_SPICE_ROOT_KEY;
   // Precomputed frame caches (built during create_database) so runtime
   // resolution never needs to furnish slow FKs. Stored under one group.
@@ -39,10 +45,83 @@ namespace SpiceQL {
   extern std::string DB_FRAME_LIST_KEY;
   extern std::string DB_FRAME_CODES_KEY;
   extern std::string DB_FRAME_NAMES_KEY;
+  // Root attribute holding the DB generation, bumped on every publish.
+  extern std::string DB_GENERATION_KEY;
+  // Root attribute listing the missions a DB was built for ("*" for all).
+  extern std::string DB_MISSIONS_KEY;
+  // Advisory lock file in the cache directory serializing DB builds.
+  extern std::string DB_LOCK_FILE;
+  // Directory in the cache directory holding per-mission DB shards.
+  extern std::string DB_SHARD_DIR;
+  // Layout v2: root attribute with the layout version, the compound
+  // (start, stop, path) dataset of each time indexed key, and the per-mission
+  // table of kernel paths those records index into. v1 DBs store the
+  // DB_START_TIME_KEY..DB_TIME_FILES_KEY datasets per key instead.
+  extern std::string DB_LAYOUT_KEY;
+  extern std::string DB_TIME_RECORDS_KEY;
+  extern std::string DB_PATH_TABLE_KEY;
+  extern const int DB_LAYOUT_VERSION;
+  // CK record index of a ck key: the segment table, the delta encoded record
+  // times and the kernels that could not be indexed.
+  extern std::string DB_CK_SEGMENTS_KEY;
+  extern std::string DB_CK_RECORD_TIMES_KEY;
+  extern std::string DB_CK_UNINDEXED_KEY;
+  // Frame definitions of a mission: the frame table and the TK rotations,
+  // one row of 9 per frame.
+  extern std::string DB_FRAME_DEFS_KEY;
+  extern std::string DB_FRAME_ROTATIONS_KEY;
+  // Text kernel keywords of a mission, one JSON document per mission.
+  extern std::string DB_KEYWORDS_KEY;
+  // Consolidated kernels of a time indexed key: the merged files, relative to
+  // the cache directory, and the file each kernel was merged into (-1 if none).
+  extern std::string DB_CONSOLIDATED_FILES_KEY;
+  extern std::string DB_CONSOLIDATED_IDS_KEY;
+  // Directory in the cache directory holding the merged kernels.
+  extern std::string DB_CONSOLIDATED_DIR;
+  // Env vars enabling consolidation and setting the period and size of the merged kernels.
+  extern std::string CONSOLIDATE_ENV_VAR;
+  extern std::string CONSOLIDATE_PERIOD_ENV_VAR;
+  extern std::string CONSOLIDATE_MAX_SIZE_ENV_VAR;
 
   std::string getCacheDir();
   void setCacheDir(std::string cache_dir, bool override=false);
   std::string getHdfFile();
+
+  /**
+   * @brief Returns the generation number of the DB currently published in the cache directory.
+   *
+   * The check is a single stat of the DB file; the generation attribute is only
+   * re-read when the file has been replaced since the last call.
+   *
+   * @return the generation, or 0 if there is no DB or it predates generations
+   */
+  uint64_t getDbGeneration();
+
+  /**
+   * @brief Checks whether a usable DB exists in the cache directory.
+   *
+   * @return true if the DB exists, is readable and was built by this SpiceQL version
+   */
+  bool isDbReady();
+
+  /**
+   * @brief Returns the path of a mission's DB shard in the cache directory.
+   *
+   * @param mission SpiceQL mission name
+   * @return path to <cache dir>/shards/<mission>.hdf
+   */
+  std::string getShardFile(std::string mission);
+
+  /**
+   * @brief Returns the DB file to read a mission's kernels from.
+   *
+   * This is the served DB, unless the mission's shard was rebuilt after the
+   * served DB was last published, in which case the shard is read directly.
+   *
+   * @param mission SpiceQL mission name
+   * @return path to the DB or shard file
+   */
+  std::string getDbFileForMission(std::string mission);
   
   class TimeIndexedKernels { 
     public: 
@@ -52,12 +131,177 @@ namespace SpiceQL {
   };
 
 
+  /**
+   * @brief Load the time index of a DB key from either DB layout.
+   *
+   * Indices are shared by the whole process and re-read only when the DB file
+   * changes.
+   *
+   * @param key "<mission>/<type>/<quality>"
+   * @param hdf_file DB file to read, the served DB if empty
+   * @return the index, or nullptr if the key is not in the DB
+   */
+  std::shared_ptr<TimeIndexedKernels> getTimeIndexedKernels(std::string key, std::string hdf_file = "");
+
+
+  // One type 3 segment in a CK record index
+  struct CkSegment {
+    //! index of the CK in the key's time index
+    uint32_t kernel;
+    int32_t instrument;
+    double start_et;
+    double stop_et;
+    //! first record of the segment in CkRecordIndex::record_ets
+    uint64_t offset;
+    uint64_t count;
+  };
+
+
+  /**
+   * @brief Pointing record times of the type 3 segments of every CK in a DB key.
+   *
+   * Built with the DB so exact CK times can be looked up without furnishing.
+   */
+  class CkRecordIndex {
+    public:
+    //! segments ordered by kernel, then by position in the kernel
+    std::vector<CkSegment> segments;
+    //! record times in ET of all segments, ascending within a segment
+    std::vector<double> record_ets;
+    //! kernels whose records could not be read when the DB was built
+    std::vector<uint32_t> unindexed;
+  };
+
+
+  /**
+   * @brief Kernels of a time indexed DB key merged into fewer files.
+   *
+   * Each merged file holds a run of consecutive kernels of the key, so
+   * furnishing it in place of the run keeps the load priority.
+   */
+  class KernelConsolidation {
+    public:
+    //! merged files, relative to the cache directory
+    std::vector<std::string> files;
+    //! per kernel of the key's time index, the file it was merged into or -1
+    std::vector<int32_t> kernel_files;
+  };
+
+
+  /**
+   * @brief Load the consolidation of a time indexed DB key.
+   *
+   * Cached for the process like time indices.
+   *
+   * @param key "<mission>/<type>/<quality>"
+   * @param hdf_file DB file to read, the served DB if empty
+   * @return the consolidation, or nullptr if the key's kernels were not consolidated
+   */
+  std::shared_ptr<KernelConsolidation> getKernelConsolidation(std::string key, std::string hdf_file = "");
+
+
+  /**
+   * @brief Load the CK record index of a CK DB key.
+   *
+   * Cached for the process like time indices.
+   *
+   * @param key "<mission>/ck/<quality>"
+   * @param hdf_file DB file to read, the served DB if empty
+   * @return the index, or nullptr if the DB has no record index for the key
+   */
+  std::shared_ptr<CkRecordIndex> getCkRecordIndex(std::string key, std::string hdf_file = "");
+
+
+  // Frame definition as frinfo_c and tkfram_ report it with the mission's FKs and IKs furnished
+  struct FrameDefinition {
+    int code;
+    int center;
+    int frame_class;
+    int class_id;
+    //! parent frame of a TK frame, 0 for other classes
+    int tk_parent;
+    //! rotation of a TK frame from tkfram_, row major
+    std::array<double, 9> tk_rotation;
+  };
+
+
+  /**
+   * @brief Load the frame definitions recorded for a mission.
+   *
+   * Cached for the process and reloaded when the DB changes.
+   *
+   * @param mission SpiceQL mission name
+   * @return definitions keyed by frame code, or nullptr if none were recorded
+   */
+  std::shared_ptr<const std::unordered_map<int, FrameDefinition>> getFrameDefinitions(std::string mission);
+
+
+  /**
+   * @brief Load the text kernel keywords recorded for a mission.
+   *
+   * The store holds one entry per kernel set, see InventoryImpl::collectKeywords.
+   * Cached for the process and reloaded when the DB changes.
+   *
+   * @param mission SpiceQL mission name
+   * @return the store, or nullptr if none was recorded
+   */
+  std::shared_ptr<const nlohmann::json> getKeywordStore(std::string mission);
+
+
+  /**
+   * @brief Load every time index of a mission into the process-wide cache.
+   *
+   * @param mission spiceql mission name
+   * @return number of time indexed keys loaded
+   */
+  size_t preloadTimeIndices(std::string mission);
+
+
   class InventoryImpl {
     public:
     InventoryImpl(bool force_regen=false, std::vector<std::string> mlist = {});
-    template<class T> T getKey(std::string key);
+    /**
+     * @brief Read a dataset from a DB file.
+     *
+     * @param key dataset path
+     * @param hdf_file DB file to read, the served DB if empty
+     */
+    template<class T> T getKey(std::string key, std::string hdf_file="");
+
+    /**
+     * @brief Publish the in-memory inventory as the next DB generation.
+     *
+     * Writes to a temporary file in the cache directory and renames it over the
+     * served DB, so concurrent readers never observe a partial file.
+     */
     void write_database();
 
+    /**
+     * @brief Write the in-memory inventory to an HDF file.
+     *
+     * @param hdf_file path of the file to create, truncated if it exists
+     * @param generation generation number stored in the file's root attributes
+     */
+    void write_database(std::string hdf_file, uint64_t generation);
+
+    /**
+     * @brief Build and publish the DB shard for a single mission.
+     *
+     * Only the mission's own kernels are indexed and furnished, so shards can
+     * be rebuilt independently, in separate processes or on separate machines.
+     *
+     * @param mission SpiceQL mission name
+     */
+    static void write_shard(std::string mission);
+
+    /**
+     * @brief Merge DB shards into the served DB and publish it.
+     *
+     * @param shard_files shard files to merge, every shard in the cache directory if empty
+     * @throws runtime_error if a shard was built by another SpiceQL version or two shards hold the same mission
+     */
+    static void merge_shards(std::vector<std::string> shard_files = {});
+
     /**
      * @brief Returns the cached list of frame/config names.
      *
@@ -72,6 +316,11 @@ namespace SpiceQL {
      */
     std::string getFrameName(int code);
 
+    /**
+     * @brief Copy of the whole cached code->name map.
+     */
+    std::unordered_map<int, std::string> getFrameNameMap();
+
     /**
      * @brief Resolve a frame/body name to its code using the cached map.
      * @return the code, or 0 if the name is not in the cache.
@@ -87,6 +336,14 @@ namespace SpiceQL {
 
     std::map<std::string, std::vector<std::string>> m_nontimedep_kerns;
     std::map<std::string, TimeIndexedKernels*> m_timedep_kerns;
+    // CK record indices, keyed like m_timedep_kerns
+    std::map<std::string, CkRecordIndex> m_ck_records;
+    // Frame definitions per mission
+    std::map<std::string, std::vector<FrameDefinition>> m_frame_defs;
+    // Text kernel keyword stores per mission
+    std::map<std::string, nlohmann::json> m_keywords;
+    // Consolidated kernels, keyed like m_timedep_kerns
+    std::map<std::string, KernelConsolidation> m_consolidations;
 
     // Sorted, de-duplicated frame/config names.
     std::vector<std::string> m_frame_list;
@@ -99,12 +356,54 @@ namespace SpiceQL {
     // Kernels that always need to be furnished
     KernelSet m_required_kernels;
 
+    // Missions this inventory was built for, empty for all of them
+    std::vector<std::string> m_missions;
+
     private:
     /**
      * @brief Enumerate frame/body code<->name pairs and the frame list into the
      * member caches. Furnishes each mission's text kernels, reads the
      * NAIF_BODY_CODE/NAIF_BODY_NAME pools, and records the config frame list.
+     *
+     * @param missions only furnish these missions' text kernels, all if empty
+     */
+    void collectFrameInfo(std::vector<std::string> missions = {});
+
+    /**
+     * @brief Record the keywords of each mission's text kernel sets into m_keywords.
+     *
+     * Each set is furnished as the keyword queries would furnish it:
+     *   - "mission": the mission's IAKs, FKs and IKs, for findMissionKeywords
+     *   - "target": the mission's and base PCKs, for findTargetKeywords
+     *   - "frames": the mission's and base FKs, with the cidfrm_c frame of
+     *     every body they or the built-in frames mention, for getTargetFrameInfo
+     * The kernels of each set are stored with it so queries only use the
+     * set when they would furnish the same kernels.
+     *
+     * @param config config to resolve kernels from
+     * @param missions lowercase mission names, all missions if empty
+     */
+    void collectKeywords(Config &config, std::vector<std::string> missions = {});
+
+    /**
+     * @brief Index the latest kernels of the given missions into the time
+     * dependent and time independent kernel maps.
+     *
+     * @param config config to resolve kernels from
+     * @param missions lowercase mission names, all missions if empty
+     */
+    void collectKernels(Config &config, std::vector<std::string> missions);
+
+    /**
+     * @brief Merge runs of small CKs and SPKs into one kernel per period.
+     *
+     * Only runs when SPICEQL_CONSOLIDATE_KERNELS is true. Consecutive kernels
+     * of a time indexed key that are at most SPICEQL_CONSOLIDATE_MAX_MB
+     * (default 16) in size and start in the same SPICEQL_CONSOLIDATE_DAYS
+     * (default 7) period are merged with mergeKernels into the consolidated
+     * directory of the cache directory. Merged files are named after a hash
+     * of their kernels, so rebuilds reuse the ones that did not change.
      */
-    void collectFrameInfo();
+    void consolidateKernels();
   };
 }
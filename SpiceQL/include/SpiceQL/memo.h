@@ -15,6 +15,9 @@
 #include <string>
 #include <chrono>
 #include <iomanip>
+#include <atomic>
+#include <random>
+#include <thread>
 
 #include <ghc/fs_std.hpp>
 #include <SpiceQL/spiceql_logging.h>
@@ -104,8 +107,7 @@ namespace Memo {
             std::string cache_dir;
 
             if (cache_dir_char == NULL) {
-                std::string  tempname = "spiceql-cache-" + gen_random(10);
-                cache_dir = (fs::temp_directory_path() / tempname / "spiceql_cache").string();
+                cache_dir = getDefaultCacheDir();
             }
             else {
                 cache_dir = cache_dir_char;
@@ -126,6 +128,16 @@ namespace Memo {
         return CACHE_DIRECTORY;
     }
 
+    // Suffix unique to this process and call, for temporary files in a shared directory
+    inline std::string unique_suffix() {
+        static std::atomic<uint64_t> counter{0};
+        std::size_t seed = 0;
+        hash_combine(seed, std::random_device{}(), std::this_thread::get_id(),
+                     std::chrono::steady_clock::now().time_since_epoch().count(), counter++);
+        return std::to_string(seed);
+    }
+
+
     class Cache {
        public:
         // if cache is older than this directory, then the cache is reloaded
@@ -174,25 +186,41 @@ namespace Memo {
                     std::time_t cache_write_time = to_time_t(fs::last_write_time(fn));                   
                     if (!has_cache_expired(cache_write_time, m_dependants)) { 
                         SPDLOG_TRACE("Cached access of {}", name);
-                        std::ifstream ifs(fn);
-                        cereal::BinaryInputArchive  ia(ifs);
-                        retval_t ret;
-                        ia >> ret;
-                        return ret;
+                        try {
+                            std::ifstream ifs(fn, std::ios::binary);
+                            cereal::BinaryInputArchive  ia(ifs);
+                            retval_t ret;
+                            ia >> ret;
+                            return ret;
+                        }
+                        catch (cereal::Exception &e) {
+                            SPDLOG_DEBUG("Cache {} is unreadable, recreating it: {}", fn, e.what());
+                        }
                     }
                     else { 
-                        // delete and reload cache
+                        // reload cache, the new entry replaces the expired one below 
                         SPDLOG_TRACE("Cache {} has expired", fn);
-                        fs::remove(fn);
                     }
                 }
                 // if dependant doesn't exist, treat it as a cache miss. Function might naturally fail.
                 
                 SPDLOG_TRACE("Non-cached access, creating cache {}", fn);
                 retval_t ret = f(std::forward<Params>(params)...);
-                std::ofstream ofs(fn);
-                cereal::BinaryOutputArchive oa(ofs);
-                oa << ret;
+
+                // The cache directory is shared between processes, write a private
+                // file and rename it over the entry so readers only ever see a whole archive
+                std::string tmp_fn = fn + "." + unique_suffix() + ".tmp";
+                {
+                    std::ofstream ofs(tmp_fn, std::ios::binary);
+                    cereal::BinaryOutputArchive oa(ofs);
+                    oa << ret;
+                }
+                std::error_code ec;
+                fs::rename(tmp_fn, fn, ec);
+                if (ec) {
+                    SPDLOG_DEBUG("Could not publish cache {}: {}", fn, ec.message());
+                    fs::remove(tmp_fn, ec);
+                }
 
                 return ret;
             }
@@ -0,0 +1,85 @@
+#pragma once
+/**
+ * @file
+ *
+ * Background read-ahead of the kernels time ordered searches will need next
+ *
+ **/
+
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+namespace SpiceQL {
+
+  extern std::string KERNEL_PREFETCH_ENV_VAR;
+
+
+  /**
+   * @brief Reads kernels into the page cache on background threads.
+   *
+   * Bulk jobs search kernels window after window along a mission's time
+   * axis, and each window's CKs and SPKs are cold on network storage. The
+   * prefetcher remembers the last window of each kind of search and, when
+   * the next one moves forward in time, predicts the window after it by the
+   * same step. The kernels of the predicted window are read through, or
+   * copied into the kernel cache when it is on (see setKernelCache), on a
+   * fixed number of threads while the current request is answered, so
+   * furnishing them later does not wait on I/O.
+   *
+   * Kernels read ahead, and kernels already used, are remembered so they are
+   * not read again. At most a bounded number of kernels wait to be read,
+   * newer ones are dropped when the queue is full.
+   *
+   * The prefetcher is off unless turned on with setThreads or by setting
+   * SPICEQL_PREFETCH_THREADS to a number of threads.
+   */
+  class KernelPrefetcher {
+    public:
+    /**
+     * @brief Sets the number of threads reading kernels, 0 turns the prefetcher off.
+     *
+     * Kernels being read are finished first, queued ones are kept.
+     */
+    static void setThreads(size_t threads);
+
+    /**
+     * @brief Number of threads reading kernels, 0 if the prefetcher is off.
+     */
+    static size_t getThreads();
+
+    /**
+     * @brief Records the kernels a search returned and predicts the next window.
+     *
+     * Counts the CKs and SPKs in kernels as hits if they were read ahead,
+     * late if they are still being read, or misses if they were cold.
+     *
+     * @param key identifies the kind of search, e.g. its names, types and qualities
+     * @param start_time start of the searched window
+     * @param stop_time end of the searched window
+     * @param kernels the kernels the search returned
+     * @param next_start set to the start of the predicted next window
+     * @param next_stop set to the end of the predicted next window
+     * @return true if the search moved forward from the last one with the same key
+     *         and the next window was predicted
+     */
+    static bool observe(const std::string &key, double start_time, double stop_time, const nlohmann::json &kernels,
+                        double &next_start, double &next_stop);
+
+    /**
+     * @brief Queues the CKs and SPKs in kernels that are not warm yet to be read.
+     *
+     * @param kernels kernel search result, relative paths are in the data directory
+     */
+    static void prefetch(const nlohmann::json &kernels);
+
+    /**
+     * @brief Returns the prefetcher's counters.
+     *
+     * @return json object with "threads", "queued", the kernels "read" and their "bytes",
+     *         the "hits", "late" and "misses" of searched kernels, their "hit_rate",
+     *         and the kernels "dropped" from a full queue or that "failed" to be read
+     */
+    static nlohmann::json stats();
+  };
+}
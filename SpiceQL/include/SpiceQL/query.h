@@ -39,9 +39,10 @@ namespace SpiceQL {
     * New JSON is returned.
     *
     * @param kernels A Kernel JSON object
+    * @param parallel if true, resolve the kernel groups on multiple threads, ignored in WASM builds
     * @returns A new Kernel JSON object with reduced kernel sets
    **/
-  nlohmann::json getLatestKernels(nlohmann::json kernels);
+  nlohmann::json getLatestKernels(nlohmann::json kernels, bool parallel=false);
 
 
   /**
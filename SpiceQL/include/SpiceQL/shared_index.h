@@ -0,0 +1,167 @@
+#pragma once
+/**
+ * @file
+ *
+ * Read-only inventory index shared between processes through a memory mapped file
+ *
+ **/
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+
+namespace SpiceQL {
+
+  extern std::string SHARED_INDEX_FILE;
+  extern std::string SHARED_INDEX_ENV_VAR;
+
+  // Location of a string in the shared index, relative to the start of the file.
+  struct SharedString {
+    uint64_t offset;
+    uint64_t length;
+  };
+
+  // One entry of a time map; named like a BTreeMap pair so search code can
+  // treat both the same way.
+  struct SharedTimeEntry {
+    double first;
+    uint64_t second;
+  };
+
+
+  /**
+   * @brief Sorted, read-only run of time entries in the shared index.
+   *
+   * Provides the subset of the BTreeMap interface used to search time indices.
+   */
+  class SharedTimeMap {
+    public:
+    SharedTimeMap(const SharedTimeEntry *begin=nullptr, const SharedTimeEntry *end=nullptr) : m_begin(begin), m_end(end) {}
+
+    const SharedTimeEntry *begin() const { return m_begin; }
+    const SharedTimeEntry *end() const { return m_end; }
+    size_t size() const { return m_end - m_begin; }
+
+    const SharedTimeEntry *upper_bound(double time) const {
+      return std::upper_bound(m_begin, m_end, time, [](double t, const SharedTimeEntry &e) { return t < e.first; });
+    }
+
+    const SharedTimeEntry *lower_bound(double time) const {
+      return std::lower_bound(m_begin, m_end, time, [](const SharedTimeEntry &e, double t) { return e.first < t; });
+    }
+
+    private:
+    const SharedTimeEntry *m_begin;
+    const SharedTimeEntry *m_end;
+  };
+
+
+  /**
+   * @brief View of one inventory key in the shared index.
+   *
+   * Time independent keys have empty time maps.
+   */
+  class SharedKernelIndex {
+    public:
+    SharedTimeMap start_times;
+    SharedTimeMap stop_times;
+
+    size_t size() const { return m_size; }
+    std::string file_path(size_t i) const;
+
+    private:
+    friend class SharedIndex;
+    const char *m_base = nullptr;
+    const SharedString *m_paths = nullptr;
+    size_t m_size = 0;
+  };
+
+
+  /**
+   * @brief Decoded inventory indices and frame maps in a memory mapped file.
+   *
+   * One process publishes the index built from the served DB into the cache
+   * directory. Other processes map it read-only, so the pages are shared by
+   * every worker instead of each decoding its own copy. All structures are
+   * offset based and valid at any mapping address.
+   *
+   * The index records the DB generation it was built from and is ignored once
+   * a newer DB is published.
+   */
+  class SharedIndex {
+    public:
+    ~SharedIndex();
+    SharedIndex(const SharedIndex &) = delete;
+    SharedIndex &operator=(const SharedIndex &) = delete;
+
+    /**
+     * @brief Path of the shared index file in the cache directory.
+     */
+    static std::string getFile();
+
+    /**
+     * @brief Build the shared index from the served DB and publish it.
+     *
+     * The file is written under a temporary name and renamed into place.
+     */
+    static void publish();
+
+    /**
+     * @brief Map the published index read-only and use it for searches in this process.
+     *
+     * @return true if the index was attached and matches the served DB generation
+     */
+    static bool attach();
+
+    /**
+     * @brief Stop using the shared index in this process.
+     *
+     * Searches already holding the index keep their mapping until they finish.
+     */
+    static void detach();
+
+    /**
+     * @brief Returns the attached index if it matches the served DB, otherwise nullptr.
+     *
+     * If the index file was republished since it was attached it is remapped.
+     * Processes started with SPICEQL_SHARED_INDEX set attach automatically.
+     */
+    static std::shared_ptr<const SharedIndex> current();
+
+    /**
+     * @brief Generation of the DB the index was built from.
+     */
+    uint64_t generation() const;
+
+    /**
+     * @brief Look up an inventory key, e.g. "lroc/ck/reconstructed" or "lroc/fk".
+     *
+     * @param key inventory key, trailing slashes are ignored
+     * @param index set to a view of the key if found
+     * @return true if the key is in the index
+     */
+    bool findKernels(std::string key, SharedKernelIndex &index) const;
+
+    /**
+     * @brief Resolve a frame/body code to its name.
+     * @return the name, or "" if not in the index
+     */
+    std::string getFrameName(int code) const;
+
+    /**
+     * @brief Resolve a frame/body name to its code.
+     * @return the code, or 0 if not in the index
+     */
+    int getFrameCode(std::string name) const;
+
+    private:
+    SharedIndex(const char *data, size_t size, std::string stamp);
+    static std::shared_ptr<const SharedIndex> map(const std::string &file, const std::string &stamp);
+    std::string str(const SharedString &s) const;
+
+    const char *m_data;
+    size_t m_size;
+    std::string m_stamp;
+  };
+}
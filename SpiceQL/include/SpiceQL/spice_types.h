@@ -5,6 +5,7 @@
   *
  **/
 
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <unordered_map>
@@ -28,7 +29,8 @@ namespace SpiceQL {
    *
    * Reflects every kernel in the pool regardless of type or how it was loaded,
    * including kernels furnished outside of SpiceQL (e.g. by a host application
-   * such as ISIS).
+   * such as ISIS). Kernels furnished from the kernel cache are reported by
+   * their path in the data directory.
    */
   std::vector<std::string> getLoadedKernels();
 
@@ -42,6 +44,222 @@ namespace SpiceQL {
    */
   bool isLskLoaded();
 
+  extern std::string KERNEL_TELEMETRY_FILE;
+  extern std::string KERNEL_TELEMETRY_ENV_VAR;
+
+  /**
+   * @brief Turns recording of kernel furnishes on or off for this process.
+   *
+   * Recording is off unless turned on here or by setting SPICEQL_KERNEL_TELEMETRY
+   * to true. Each Kernel furnished while it is on counts one furnish, the
+   * kernel's size in bytes and the time furnsh_c took, keyed on the kernel's
+   * path relative to the data directory. Counts are merged into
+   * kernel_telemetry.json in the cache directory at most once a minute and
+   * by flushKernelTelemetry().
+   *
+   * @param enabled whether to record furnishes
+   */
+  void setKernelTelemetry(bool enabled);
+
+  /**
+   * @brief Returns true if kernel furnishes are being recorded.
+   */
+  bool isKernelTelemetryEnabled();
+
+  /**
+   * @brief Merges the counts recorded since the last flush into the cache directory.
+   *
+   * Processes sharing a cache directory add to the same file. Writes are not
+   * locked, so two processes flushing at the same moment may drop one
+   * interval of counts.
+   */
+  void flushKernelTelemetry();
+
+  /**
+   * @brief Returns the most furnished kernels and missions.
+   *
+   * Combines the persisted counts with the ones not flushed yet. Missions are
+   * the first directory of the kernel paths under the data directory.
+   *
+   * @param n number of kernels and missions to return
+   * @return json object with "kernels" and "missions" arrays sorted by furnishes,
+   *         each entry holding its "furnishes", "bytes" and load "seconds"
+   */
+  nlohmann::json getHotKernels(int n=10);
+
+  /**
+   * @brief Forgets all recorded counts, including the persisted ones.
+   */
+  void resetKernelTelemetry();
+
+  extern std::string KERNEL_POOL_SIZE_ENV_VAR;
+  extern std::string KERNEL_POOL_MB_ENV_VAR;
+
+  /**
+   * @brief Sets how many binary kernels stay furnished after their KernelSet is gone.
+   *
+   * KernelSets furnish their kernels through a process wide, reference
+   * counted pool. When the pool is on, it keeps released CKs and SPKs
+   * furnished up to max_kernels kernels and max_bytes bytes, unloading the
+   * least recently used first. A KernelSet still sees its own kernels in
+   * its own order above every kernel it did not ask for, except the kernels
+   * of KernelSets still alive around it: released kernels it did not ask for
+   * are unloaded, pinned ones included, and its kernels that are out of
+   * order or below one furnished outside the pool are refurnished, so only
+   * repeated or overlapping requests skip the furnish.
+   *
+   * The pool is off unless turned on here or by SPICEQL_KERNEL_POOL_SIZE
+   * (and optionally SPICEQL_KERNEL_POOL_MB).
+   *
+   * @param max_kernels number of kernels to keep furnished, 0 turns the pool off
+   * @param max_bytes total size of the kernels to keep furnished, 0 for no limit
+   */
+  void setKernelPoolLimits(size_t max_kernels, uint64_t max_bytes=0);
+
+  extern std::string TEXT_SNAPSHOT_ENV_VAR;
+  extern std::string TEXT_SNAPSHOT_DIR;
+
+  /**
+   * @brief Turns replaying text kernels from snapshots on or off for this process.
+   *
+   * When on, the first time a KernelSet furnishes a text kernel its effect
+   * on the kernel pool, each variable's name, type and values, is recorded
+   * into a binary snapshot in the text_snapshots cache directory. Later
+   * KernelSets write the variables straight into the pool with
+   * pdpool_c/pcpool_c instead of parsing the kernel again, and take them back
+   * out by restoring what they overwrote. Snapshots are keyed on the kernel's
+   * path and dropped when its modification time or size change. Kernels the
+   * snapshot parser reads differently from CSPICE, and meta kernels, are
+   * always furnished.
+   *
+   * Replayed kernels are in the pool but not in the list of loaded kernels,
+   * so getLoadedKernels() and ktotal_c don't report them.
+   *
+   * Replaying is off unless turned on here or by setting SPICEQL_TEXT_SNAPSHOTS to true.
+   *
+   * @param enabled whether to replay text kernels from snapshots
+   */
+  void setTextKernelSnapshots(bool enabled);
+
+  /**
+   * @brief Returns true if text kernels are replayed from snapshots.
+   */
+  bool isTextKernelSnapshotsEnabled();
+
+  extern std::string KERNEL_CACHE_DIR_ENV_VAR;
+  extern std::string KERNEL_CACHE_MB_ENV_VAR;
+
+  /**
+   * @brief Sets the local directory kernels are copied to before they are furnished.
+   *
+   * Furnishing kernels from network file systems waits on the first bytes of
+   * each file. With a kernel cache, Kernels and KernelSets furnish a copy of
+   * each kernel under the data directory kept in the cache directory instead.
+   * Copies are kept per modification time of the kernel, checked by size,
+   * and written under a temporary name then renamed, so processes sharing
+   * the directory never furnish a partial copy. Past max_bytes the least
+   * recently used copies are removed, except the ones still furnished,
+   * since CSPICE reopens kernels by name. Furnished copies hold a shared
+   * flock and are only removed under an exclusive one, so processes sharing
+   * the directory never remove each other's furnished copies; a copy removed
+   * before it was furnished is copied again. Without flock, on Windows and
+   * WASM, only this process's furnished copies are kept.
+   *
+   * Search results still hold the kernels' data directory paths, and
+   * getLoadedKernels() reports them too.
+   *
+   * The cache is off unless set here or by SPICEQL_KERNEL_CACHE_DIR (and
+   * optionally SPICEQL_KERNEL_CACHE_MB).
+   *
+   * @param dir local directory for the copies, empty turns the cache off
+   * @param max_bytes total size of the copies, 0 for no limit
+   */
+  void setKernelCache(std::string dir, uint64_t max_bytes=0);
+
+  /**
+   * @brief Returns the kernel cache directory, empty if the cache is off.
+   */
+  std::string getKernelCacheDir();
+
+  /**
+   * @brief Returns the cached copy of a kernel, copying it first if needed.
+   *
+   * @param path full path of the kernel
+   * @return path of the copy, or path itself if the cache is off, the kernel
+   *         is outside the data directory or it could not be copied
+   */
+  std::string cacheKernel(std::string path);
+
+  /**
+   * @brief Returns the data directory path of a cached copy, other paths unchanged.
+   */
+  std::string canonicalKernelPath(std::string path);
+
+  /**
+   * @brief Returns the kernel cache's settings and counters.
+   *
+   * @return json object with "dir", "max_bytes" and the "hits", "copies",
+   *         "copied_bytes", "evictions" and "failures" of this process
+   */
+  nlohmann::json getKernelCacheStats();
+
+  /**
+   * @brief Furnishes text kernels once and keeps them loaded after their KernelSets are gone.
+   *
+   * Pinned kernels are not unloaded when released, so KernelSets asking for
+   * them in the same order reuse them instead of loading them again. They
+   * keep their place in each set's own order, and a KernelSet that did not
+   * ask for a pinned kernel unloads it like any other released kernel, so
+   * pinning never changes what a set's queries see. Only text kernels are
+   * pinned, binary kernels are skipped. Pinning again replaces the pinned
+   * kernels.
+   *
+   * @param kernels json object of kernels, as given to a KernelSet
+   * @return the pinned kernel paths
+   */
+  std::vector<std::string> pinKernels(nlohmann::json kernels);
+
+  /**
+   * @brief Stops pinning kernels, unloading the ones no KernelSet uses.
+   */
+  void unpinKernels();
+
+  /**
+   * @brief Returns the pinned kernel paths.
+   */
+  std::vector<std::string> getPinnedKernels();
+
+  /**
+   * @brief Unloads every pooled kernel no KernelSet is using.
+   */
+  void clearKernelPool();
+
+  /**
+   * @brief Returns the pool's limits, its current contents and its counters.
+   *
+   * @return json object with "max_kernels", "max_bytes", "resident", "in_use", "pinned", "bytes",
+   *         the "furnishes", "replays", "reuses" and "unloads" done by the pool so far,
+   *         and the number of text kernel "snapshots" in memory
+   */
+  nlohmann::json getKernelPoolStats();
+
+
+  /**
+   * @brief Keeps kernels released by KernelSets furnished while it exists.
+   *
+   * Successive KernelSets created in the scope only furnish and unload the
+   * difference from the kernels the previous ones loaded. Kernels no
+   * KernelSet uses are unloaded, down to the kernel pool limits, when the
+   * last open scope ends.
+   */
+  class KernelScope {
+    public:
+    KernelScope();
+    ~KernelScope();
+    KernelScope(const KernelScope &) = delete;
+    KernelScope &operator=(const KernelScope &) = delete;
+  };
+
   /**
    * @brief Base Kernel class
    *
@@ -205,7 +423,13 @@ namespace SpiceQL {
    * 
    * Given a json object, furnish every kernel under a 
    * "kernels" key. The kernels are unloaded as soon as the object 
-   * goes out of scope. 
+   * goes out of scope and no other KernelSet uses them. 
+   *
+   * Only the kernels not already loaded in the requested order are
+   * furnished, so a KernelSet asking for kernels an enclosing KernelSet
+   * loaded, in the same order, furnishes nothing and sees the enclosing
+   * set's other kernels too. Kernels loaded above them by anything else are
+   * furnished again on top.
    *
    * Generally used on results from a kernel query. 
    */
@@ -224,8 +448,8 @@ namespace SpiceQL {
     void load(nlohmann::json kernels);
     void unload();
     
-    //! map of path to kernel pointers
-    std::vector<Kernel*> m_loadedKernels;
+    //! paths of the loaded kernels in load order
+    std::vector<std::string> m_loadedKernels;
     
     //! json used to populate the loadedKernels
     nlohmann::json m_kernels; 
@@ -0,0 +1,163 @@
+#pragma once
+/**
+ * @file
+ *
+ * Thread safe evaluation of geometric states from the furnished SPKs
+ *
+ **/
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace SpiceQL {
+
+  extern std::string NATIVE_SPK_ENV_VAR;
+
+  class DafFile;
+
+
+  /**
+   * @brief Evaluates geometric states from the furnished SPKs without CSPICE.
+   *
+   * CSPICE evaluates one epoch at a time and cannot be called from more than
+   * one thread. For the segment types most SPKs use, Chebyshev types 2 and 3
+   * and Lagrange and Hermite types 9 and 13, this reads the segments straight
+   * from memory mapped SPKs and evaluates them the way CSPICE does, so many
+   * epochs can be evaluated on all cores.
+   *
+   * Segments are chosen as CSPICE chooses them, the last loaded SPK and its last
+   * segment covering an epoch first, and states are composed along the chain
+   * of centers of motion of the target and the observer up to their first
+   * common body. Only geometric states (abcorr "NONE") in inertial frames are
+   * supported.
+   *
+   * Types 2 and 3 repeat CSPICE's arithmetic and give the same results up to
+   * rounding of fused multiply adds on platforms that contract them, types 9
+   * and 13 interpolate the same states with a differently ordered recurrence.
+   * Positions agree with CSPICE to within 1e-12 relative, plus 1e-9 km from
+   * composing chains through large offsets.
+   *
+   * Each SPK's segments are parsed once and kept with the mapped file. A
+   * request only collects the segments of the bodies its chains can reach,
+   * so it is worth building for requests of at least MIN_EPOCHS epochs.
+   *
+   * Evaluation is on by default and turned off with setEnabled or by setting
+   * SPICEQL_NATIVE_SPK to false.
+   */
+  class SpkEvaluator {
+    public:
+    /**
+     * @brief Minimum number of epochs getTargetStatesInto evaluates natively, fewer are left to CSPICE.
+     */
+    static constexpr size_t MIN_EPOCHS = 1024;
+
+    /**
+     * @brief Builds an evaluator over the SPKs furnished in CSPICE.
+     *
+     * Must be called on the thread that furnished the kernels. The evaluator
+     * keeps its own view of the SPKs and can be used from any thread after.
+     *
+     * @param target NAIF ID of the target
+     * @param observer NAIF ID of the observer
+     * @param frame name of the frame states are returned in
+     * @param et an epoch of the request, used to look up the frame's orientation
+     * @return the evaluator, or nullptr if evaluation is off, the frame is not inertial,
+     *         or a furnished SPK cannot be read natively
+     */
+    static std::unique_ptr<SpkEvaluator> create(int target, int observer, std::string frame, double et);
+
+    /**
+     * @brief Evaluates states of the target relative to the observer.
+     *
+     * Thread safe. Epochs are split across all cores when there are enough of them.
+     *
+     * @param ets ephemeris times, best in ascending order
+     * @param count number of ephemeris times
+     * @param states count x 7 row major buffer, each row is x,y,z,vx,vy,vz followed by the light time
+     * @return false if any epoch needs a segment that is missing or not supported, in
+     *         which case the states are incomplete and should be evaluated with CSPICE
+     */
+    bool evaluate(const double *ets, size_t count, double *states) const;
+
+    /**
+     * @brief Turns native evaluation on or off.
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * @brief Whether native evaluation is on.
+     */
+    static bool isEnabled();
+
+    /**
+     * @brief Returns the evaluator's counters.
+     *
+     * @return json object with "enabled", the requests and "states" evaluated natively,
+     *         the requests left to CSPICE because a segment was "unsupported", and the
+     *         SPKs and CKs "mapped"
+     */
+    static nlohmann::json stats();
+
+    ~SpkEvaluator();
+
+    private:
+    struct Segment {
+      int center;
+      int frame;
+      int type;
+      double start;
+      double stop;
+      //! first double of the segment
+      const double *data;
+
+      // types 2 and 3
+      double init;
+      double interval;
+      size_t record_size;
+      size_t coefficients;
+
+      // types 2, 3, 9 and 13, the number of records or states
+      size_t records;
+
+      // types 9 and 13
+      size_t window;
+    };
+
+    // Segments of one SPK, parsed once and kept with the file
+    struct FileSegments {
+      //! segments of each body, highest priority first
+      std::map<int, std::vector<Segment>> bodies;
+      //! false if any segment is not evaluated natively
+      bool supported = true;
+    };
+
+    // Parses the segments of an SPK
+    static FileSegments parseSegments(const DafFile &file);
+
+    SpkEvaluator() = default;
+
+    // Evaluates the epochs on the calling thread
+    bool evaluateRange(const double *ets, size_t count, double *states) const;
+
+    // Highest priority segment of body covering et, nullptr if none
+    const Segment *findSegment(int body, double et) const;
+
+    // State of the segment's target relative to its center in J2000
+    bool segmentState(const Segment &segment, double et, double *state) const;
+
+    int m_target = 0;
+    int m_observer = 0;
+    //! J2000 to the requested frame, nullptr for J2000
+    std::unique_ptr<double[]> m_rotation;
+    //! SPKs the segments point into, kept mapped while the evaluator lives
+    std::vector<std::shared_ptr<const DafFile>> m_files;
+    //! segments of the bodies the chains can reach, highest priority first, owned by m_files
+    std::map<int, std::vector<const Segment *>> m_segments;
+    //! frame of a segment to J2000 rotations, missing if the frame is not inertial
+    std::map<int, std::vector<double>> m_frame_rotations;
+  };
+}
@@ -144,6 +144,45 @@ namespace SpiceQL {
 
   std::pair<double, double> getKernelStartStopTimes(std::string kpath);
 
+
+  /**
+   * @brief Record times of one type 3 CK segment.
+   */
+  struct CkSegmentRecords {
+    //! instrument/structure code of the segment
+    int instrument;
+    double start_et;
+    double stop_et;
+    //! pointing instance times in ET, ascending
+    std::vector<double> record_ets;
+  };
+
+
+  /**
+    * @brief Get the pointing record times of every type 3 segment in a CK.
+    *
+    * The CK does not need to be furnished, but the SCLK kernels of its
+    * instruments and an LSK do.
+    *
+    * @param kpath Path to the CK
+    * @returns segments in file order
+    **/
+  std::vector<CkSegmentRecords> getCkRecordTimes(std::string kpath);
+
+  /**
+   * @brief Copy the segments of several CKs or SPKs into one new kernel
+   *
+   * Segments are copied as they are, kernel by kernel in the given order and
+   * in file order within each kernel, so the new kernel answers exactly as
+   * the given kernels furnished in that order would.
+   *
+   * @param fileName full path of the kernel to create, must not exist
+   * @param type kernel type string, "ck" or "spk"
+   * @param kernels paths of the kernels to copy, lowest priority first
+   * @param comment the comment to add to the new kernel
+   */
+  void mergeKernels(std::string fileName, std::string type, std::vector<std::string> kernels, std::string comment = "");
+
   std::string globKernelStartStopTimes(std::string mission);
 
   /**
@@ -181,6 +220,24 @@ namespace SpiceQL {
     **/
   std::vector<double> getTargetState(double et, std::string target, std::string observer, std::string frame="J2000", std::string abcorr="NONE"); // use j2000 for default reference frame
 
+
+  /**
+    * @brief Gives the positions and velocities for many ephemeris times into a caller's buffer
+    *
+    * Same as getTargetState for each time, but the target and observer names
+    * are resolved to NAIF IDs once and spkez_c is called with the IDs. Nothing
+    * is allocated.
+    *
+    * @param ets ephemeris times at which you want to obtain the target states
+    * @param count number of ephemeris times
+    * @param target NAIF name or ID of the target
+    * @param observer NAIF name or ID of the observer
+    * @param frame The reference frame in which to get the positions in
+    * @param abcorr aberration correction flag, see getTargetState
+    * @param states count x 7 row major buffer, each row is x,y,z,vx,vy,vz followed by the light time
+    **/
+  void getTargetStatesInto(const double *ets, size_t count, std::string target, std::string observer, std::string frame, std::string abcorr, double *states);
+
   /**
     * @brief Gives quaternion and angular velocity for a given frame at a given ephemeris time
     *
@@ -196,11 +253,107 @@ namespace SpiceQL {
   std::vector<double> getTargetOrientation(double et, int toFrame, int refFrame=1); // use j2000 for default reference frame
 
 
+  /**
+    * @brief Gives quaternions and angular velocities for many ephemeris times into a caller's buffer
+    *
+    * Same as getTargetOrientation for each time, with fixed size rows so
+    * nothing is allocated.
+    *
+    * @param ets ephemeris times at which you want to obtain the target orientations
+    * @param count number of ephemeris times
+    * @param toFrame the source frame's NAIF code.
+    * @param refFrame the reference frame's NAIF code
+    * @param orientations count x 8 row major buffer, each row is the quaternion (w,x,y,z), the angular
+    *        velocity, and 1 if the angular velocity was found or 0 if it was not and is left as zeros
+    **/
+  void getTargetOrientationsInto(const double *ets, size_t count, int toFrame, int refFrame, double *orientations);
+
+
+  /**
+    * @brief Sets the number of processes large epoch arrays are evaluated on.
+    *
+    * States, orientations and SCLK ticks for at least twice EvaluationPool::MIN_SHARD_SIZE
+    * epochs are split across forked worker processes once their kernels are
+    * furnished, with the same results as evaluating them in this process.
+    * 0 or 1 turns this off, which is the default unless SPICEQL_EVAL_PROCESSES is set.
+    *
+    * @param processes number of worker processes
+    **/
+  void setEvaluationProcesses(size_t processes);
+
+
+  /**
+    * @brief Returns the counters of the evaluation worker processes.
+    *
+    * @see setEvaluationProcesses
+    *
+    * @return json object with the "processes" setting, the "runs" and "rows" evaluated on workers,
+    *         the "workers" forked, the binary kernels "reopened" by them, the runs "skipped" because
+    *         they had too few epochs for the kernels the workers would reopen, and the runs that
+    *         "failed" and were evaluated in this process instead
+    **/
+  nlohmann::json getEvaluationPoolStats();
+
+
+  /**
+    * @brief Turns evaluating geometric states straight from the SPKs on or off.
+    *
+    * getTargetStates and getTargetStatesArray evaluate states with abcorr "NONE"
+    * in inertial frames from SPK segments of types 2, 3, 9 and 13 without CSPICE,
+    * on all cores. Requests needing any other segment, or of fewer than
+    * SpkEvaluator::MIN_EPOCHS epochs, are evaluated by CSPICE.
+    * On by default unless SPICEQL_NATIVE_SPK is set to false.
+    *
+    * @see SpkEvaluator
+    *
+    * @param enabled whether states are evaluated natively
+    **/
+  void setNativeSpkEvaluation(bool enabled);
+
+
+  /**
+    * @brief Returns the counters of native SPK evaluation.
+    *
+    * @see setNativeSpkEvaluation
+    *
+    * @return json object with "enabled", the "requests" and "states" evaluated natively,
+    *         the requests left to CSPICE as "unsupported", and the SPKs and CKs "mapped"
+    **/
+  nlohmann::json getNativeSpkStats();
+
+
+  /**
+    * @brief Turns evaluating orientations straight from the CKs on or off.
+    *
+    * getTargetOrientations evaluates orientations between frames linked through
+    * inertial, TK and CK frames from CK segments of types 2 and 3 without CSPICE,
+    * on all cores. Requests needing any other frame or segment, or of fewer than
+    * CkEvaluator::MIN_EPOCHS epochs, are evaluated by CSPICE.
+    * On by default unless SPICEQL_NATIVE_CK is set to false.
+    *
+    * @see CkEvaluator
+    *
+    * @param enabled whether orientations are evaluated natively
+    **/
+  void setNativeCkEvaluation(bool enabled);
+
+
+  /**
+    * @brief Returns the counters of native CK evaluation.
+    *
+    * @see setNativeCkEvaluation
+    *
+    * @return json object with "enabled", the "requests" and "orientations" evaluated natively,
+    *         and the requests left to CSPICE as "unsupported"
+    **/
+  nlohmann::json getNativeCkStats();
+
+
   /**
     * @brief finds key:values in kernel pool
     *
     * Given a key template, returns matching key:values from the kernel pool
-    *   by using gnpool, gcpool, gdpool, and gipool
+    *   by using gnpool, gcpool, and gdpool. Numeric values are returned as doubles.
     *
     * @param keytpl input key template to search for
     *
@@ -445,19 +598,52 @@ namespace SpiceQL {
 
 
   /**
-    * @brief Returns std::vector<string> interpretation of a json array.
-    *
-    * Attempts to convert the json array to a C++ array. Also handles
-    * strings in cases where one element arrays are stored as scalars.
-    * Throws exception if the json obj is not an array.
+    * @brief Returns the data directory kernels are stored in.
     *
-    * @param arr input json arr
+    * The first existing directory out of $SPICEROOT, $ALESPICEROOT and $ISISDATA.
+    * The result is remembered until one of these env vars changes or
+    * refreshEnvironment() is called, so repeated calls do not touch the file system.
     *
-    * @returns string vector containing arr data
+    * @returns std::string path to the data directory
     **/
   std::string getDataDirectory();
 
 
+  /**
+    * @brief Returns the full path of a kernel.
+    *
+    * Paths to existing files are returned as they are, other paths are taken
+    * as relative to the data directory. Paths that resolve to an existing file
+    * are remembered with the data directory, so resolving them again does not
+    * touch the file system.
+    *
+    * @param path kernel path, absolute or relative to the data directory
+    *
+    * @returns std::string full path of the kernel
+    **/
+  std::string resolveDataPath(std::string path);
+
+
+  /**
+    * @brief Forgets the resolved data directory and kernel paths.
+    *
+    * Call after moving the data directory or kernels while the env vars stay the same.
+    **/
+  void refreshEnvironment();
+
+
+  /**
+   * @brief Returns the default SpiceQL cache directory.
+   *
+   * Used when SPICEQL_CACHE_DIR is not set. The path is deterministic for a
+   * given SpiceQL version, data directory and user, so every process on a
+   * machine shares one cache, and one DB, instead of each building its own.
+   *
+   * @return std::string directory under the system temp directory
+   **/
+  std::string getDefaultCacheDir();
+
+
   /**
     * @brief Merges the right json to the left json 
     *
@@ -525,6 +711,11 @@ namespace SpiceQL {
    * built-in mappings), trying both the code and its bus code (code / 1000),
    * then mapped via the alias map.
    *
+   * Both are answered from an in-process index built from the alias map, the
+   * frame list and the DB's frame map, rebuilt when any of them or the config
+   * changes. Lookups never wait for a rebuild, and a replaced index is freed
+   * once the lookups still reading it return.
+   *
    * @param nameCandidates Ordered string candidates to resolve.
    * @param codeCandidates Ordered NAIF code candidates to resolve.
    * @return The first SpiceQL config name found, or an empty string.
@@ -532,6 +723,14 @@ namespace SpiceQL {
   std::string inferMission(const std::vector<std::string>& nameCandidates,
                            const std::vector<int>& codeCandidates);
 
+  /**
+   * @brief Get usage statistics of the index behind inferMission.
+   *
+   * @return nlohmann::json object with the "hits" and "misses" of index lookups,
+   *         the number of index "builds", and the "names" and "codes" it holds
+   */
+  nlohmann::json getMissionIndexStats();
+
   /**
    * @brief Format a list of kernel paths into a kernels JSON object organized by type
    *
@@ -49,6 +49,7 @@ namespace SpiceQL {
     }
     
     m_initialized = true;
+    m_generation++;
   }
 
   void AliasMap::load(string path) {
@@ -83,6 +84,7 @@ namespace SpiceQL {
     lock_guard<mutex> lock(m_mutex);
     ensure_init();
     m_lookupTable[toUpper(alias)] = spiceqlName;
+    m_generation++;
   }
 
   nlohmann::json AliasMap::getAliasMap() {
@@ -117,6 +119,7 @@ namespace SpiceQL {
     }
     
     m_initialized = true; 
+    m_generation++;
     SPDLOG_INFO("Alias map manually updated with {} entries.", m_lookupTable.size());
   }
 
@@ -23,6 +23,7 @@
 #include <SpiceQL/utils.h>
 #include <SpiceQL/inventory.h>
 #include <SpiceQL/api.h>
+#include <SpiceQL/evalpool.h>
 #if !defined(_WIN32) && !defined(SPICEQL_WASM)
 // restincurl is the vendored HTTP client used for the remote REST web-service
 // mode. It is POSIX-only (select/pipe/unistd), so it is not compiled on Windows.
@@ -43,6 +44,7 @@ namespace SpiceQL {
     double default_StartTime = -std::numeric_limits<double>::max();
     double default_StopTime = std::numeric_limits<double>::max();
     vector<string> default_KernelQualities = {"smithed", "reconstructed"};
+    string KERNELS_FURNISHED_KEY = "furnished";
     
     std::string getSpiceqlName(const std::string& name) {
         return AliasMap::instance().getSpiceqlName(name);
@@ -189,14 +191,12 @@ namespace SpiceQL {
     }
 
 
-    pair<vector<vector<double>>, json> getTargetStates(vector<double> ets, string target, string observer, string frame, string abcorr, string mission, 
-                                                       vector<string> ckQualities, vector<string> spkQualities, bool useWeb, bool searchKernels, bool fullKernelPath, 
-                                                       int limitCk, int limitSpk, vector<string> kernelList) {
-        SPDLOG_TRACE("Calling getTargetStates with {}, {}, {}, {}, {}, {}, {}, {}, {}, {}", ets.size(), target, observer, frame, abcorr, mission, ckQualities.size(), spkQualities.size(), useWeb, searchKernels, kernelList.size());
-        SPDLOG_TRACE("ets: [{}]", fmt::join(ets, ", "));
-        if (useWeb) {
+    namespace {
+        json targetStatesArgs(const vector<double> &ets, string target, string observer, string frame, string abcorr, string mission,
+                              vector<string> ckQualities, vector<string> spkQualities, bool searchKernels, bool fullKernelPath,
+                              int limitCk, int limitSpk, vector<string> kernelList) {
             // @TODO validity checks
-            json args = json::object({
+            return json::object({
                 {"target", target},
                 {"observer", observer},
                 {"frame", frame},
@@ -211,57 +211,103 @@ namespace SpiceQL {
                 {"limitSpk", limitSpk},
                 {"kernelList", kernelList}
                 });
-            // @TODO check that json exists / contains what we're looking for
+        }
 
-            // Testing on Safari with the Cassini Notebook, 
-            // up to 180 ets could be sent, with a character limit slightly above 4000.
-            // To be safe, setting a more conservative 150 ET limit here.
+
+        // Testing on Safari with the Cassini Notebook, 
+        // up to 180 ets could be sent, with a character limit slightly above 4000.
+        // To be safe, setting a more conservative 150 ET limit here.
+        string targetStatesRequestMethod(const vector<double> &ets) {
             const int numEtsGetLimit = 150;
-            std::string requestMethod = ets.size() <= numEtsGetLimit ? "GET" : "POST";
-            json out = spiceAPIQuery("getTargetStates", args, requestMethod);
-            vector<vector<double>> kvect = json2DFloatArrayTo2DVector(out["body"]["return"]);
-            return make_pair(kvect, out["body"]["kernels"]);
+            return ets.size() <= numEtsGetLimit ? "GET" : "POST";
         }
 
-        if (ets.size() < 1) {
-            throw invalid_argument("No ephemeris times given."); 
-        }
 
-        json ephemKernels = {};
+        // Furnishes the kernels for the states and writes them N×7 row major, returns the kernels
+        json computeTargetStates(const vector<double> &ets, string target, string observer, string frame, string abcorr, string mission,
+                                 vector<string> ckQualities, vector<string> spkQualities, bool searchKernels, bool fullKernelPath,
+                                 int limitCk, int limitSpk, vector<string> kernelList, double *states) {
+            if (ets.size() < 1) {
+                throw invalid_argument("No ephemeris times given."); 
+            }
 
-        if (mission.empty()) mission = inferMission({target, observer, frame}, {});
+            json ephemKernels = {};
 
-        if (searchKernels) {
-            ephemKernels = Inventory::search_for_kernelsets({mission, target, observer, "base"}, {"sclk", "ck", "spk", "pck", "tspk", "lsk", "fk", "iak",  "ik"}, ets.front(), ets.back(), ckQualities, spkQualities, fullKernelPath, limitCk, limitSpk);
-            SPDLOG_DEBUG("{} Kernels : {}", mission, ephemKernels.dump(4));
-        }
+            if (mission.empty()) mission = inferMission({target, observer, frame}, {});
 
-        if (!kernelList.empty()) {
-            json regexk = Inventory::search_for_kernelset_from_regex(kernelList, fullKernelPath);
-            // merge them into the ephem kernels overwriting anything found in the query
-            merge_json(ephemKernels, regexk);
+            if (searchKernels) {
+                ephemKernels = Inventory::search_for_kernelsets({mission, target, observer, "base"}, {"sclk", "ck", "spk", "pck", "tspk", "lsk", "fk", "iak",  "ik"}, ets.front(), ets.back(), ckQualities, spkQualities, fullKernelPath, limitCk, limitSpk);
+                SPDLOG_DEBUG("{} Kernels : {}", mission, ephemKernels.dump(4));
+            }
+
+            if (!kernelList.empty()) {
+                json regexk = Inventory::search_for_kernelset_from_regex(kernelList, fullKernelPath);
+                // merge them into the ephem kernels overwriting anything found in the query
+                merge_json(ephemKernels, regexk);
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            KernelSet ephemSet(ephemKernels);
+
+            auto stop = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+            SPDLOG_TRACE("Time in std::chrono::microseconds to furnish kernel sets: {}", duration.count());
+
+            start = std::chrono::high_resolution_clock::now();
+            getTargetStatesInto(ets.data(), ets.size(), target, observer, frame, abcorr, states);
+
+            stop = std::chrono::high_resolution_clock::now();
+            duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+            SPDLOG_TRACE("Time in std::chrono::microseconds to get data results: {}", duration.count());
+
+            return ephemKernels;
         }
+    }
 
-        auto start = std::chrono::high_resolution_clock::now();
-        KernelSet ephemSet(ephemKernels);
 
-        auto stop = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
-        SPDLOG_TRACE("Time in std::chrono::microseconds to furnish kernel sets: {}", duration.count());
+    pair<vector<vector<double>>, json> getTargetStates(vector<double> ets, string target, string observer, string frame, string abcorr, string mission, 
+                                                       vector<string> ckQualities, vector<string> spkQualities, bool useWeb, bool searchKernels, bool fullKernelPath, 
+                                                       int limitCk, int limitSpk, vector<string> kernelList) {
+        SPDLOG_TRACE("Calling getTargetStates with {}, {}, {}, {}, {}, {}, {}, {}, {}, {}", ets.size(), target, observer, frame, abcorr, mission, ckQualities.size(), spkQualities.size(), useWeb, searchKernels, kernelList.size());
+        SPDLOG_TRACE("ets: [{}]", fmt::join(ets, ", "));
+        if (useWeb) {
+            json args = targetStatesArgs(ets, target, observer, frame, abcorr, mission, ckQualities, spkQualities,
+                                         searchKernels, fullKernelPath, limitCk, limitSpk, kernelList);
+            // @TODO check that json exists / contains what we're looking for
+            json out = spiceAPIQuery("getTargetStates", args, targetStatesRequestMethod(ets));
+            vector<vector<double>> kvect = json2DFloatArrayTo2DVector(out["body"]["return"]);
+            return make_pair(kvect, out["body"]["kernels"]);
+        }
+
+        vector<double> states(ets.size() * 7);
+        json ephemKernels = computeTargetStates(ets, target, observer, frame, abcorr, mission, ckQualities, spkQualities,
+                                                searchKernels, fullKernelPath, limitCk, limitSpk, kernelList, states.data());
 
-        start = std::chrono::high_resolution_clock::now();
         vector<vector<double>> lt_stargs;
-        vector<double> lt_starg;
-        for (auto et: ets) {
-            lt_starg = getTargetState(et, target, observer, frame, abcorr);
-            lt_stargs.push_back(lt_starg);
+        lt_stargs.reserve(ets.size());
+        for (size_t i = 0; i < ets.size(); i++) {
+            lt_stargs.emplace_back(states.begin() + i * 7, states.begin() + (i + 1) * 7);
         }
+        return {lt_stargs, ephemKernels};
+    }
 
-        stop = std::chrono::high_resolution_clock::now();
-        duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
-        SPDLOG_TRACE("Time in std::chrono::microseconds to get data results: {}", duration.count());
 
-        return {lt_stargs, ephemKernels};
+    pair<vector<double>, json> getTargetStatesArray(vector<double> ets, string target, string observer, string frame, string abcorr, string mission, 
+                                                    vector<string> ckQualities, vector<string> spkQualities, bool useWeb, bool searchKernels, bool fullKernelPath, 
+                                                    int limitCk, int limitSpk, vector<string> kernelList) {
+        SPDLOG_TRACE("Calling getTargetStatesArray with {}, {}, {}, {}, {}, {}, {}, {}, {}, {}", ets.size(), target, observer, frame, abcorr, mission, ckQualities.size(), spkQualities.size(), useWeb, searchKernels, kernelList.size());
+        if (useWeb) {
+            json args = targetStatesArgs(ets, target, observer, frame, abcorr, mission, ckQualities, spkQualities,
+                                         searchKernels, fullKernelPath, limitCk, limitSpk, kernelList);
+            json out = spiceAPIQuery("getTargetStatesArray", args, targetStatesRequestMethod(ets));
+            vector<double> states = out["body"]["return"].get<vector<double>>();
+            return make_pair(states, out["body"]["kernels"]);
+        }
+
+        vector<double> states(ets.size() * 7);
+        json ephemKernels = computeTargetStates(ets, target, observer, frame, abcorr, mission, ckQualities, spkQualities,
+                                                searchKernels, fullKernelPath, limitCk, limitSpk, kernelList, states.data());
+        return {states, ephemKernels};
     }
 
     pair<vector<vector<double>>, json> getTargetStatesRanged(double startEt, 
@@ -395,11 +441,15 @@ namespace SpiceQL {
         SPDLOG_TRACE("Time in std::chrono::microseconds to furnish kernel sets: {}", duration.count());
 
         start = std::chrono::high_resolution_clock::now();
-        vector<vector<double>> orientations = {};
-        vector<double> orientation;
-        for (auto et: ets) {
-            orientation = getTargetOrientation(et, toFrame, refFrame);
-            orientations.push_back(orientation);
+        vector<double> rows(ets.size() * 8);
+        getTargetOrientationsInto(ets.data(), ets.size(), toFrame, refFrame, rows.data());
+
+        // the angular velocity follows the quaternion when it was found
+        vector<vector<double>> orientations;
+        orientations.reserve(ets.size());
+        for (size_t i = 0; i < ets.size(); i++) {
+            auto row = rows.begin() + i * 8;
+            orientations.emplace_back(row, row + (row[7] ? 7 : 4));
         }
         stop = std::chrono::high_resolution_clock::now();
         duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
@@ -513,6 +563,9 @@ namespace SpiceQL {
             return make_pair(kvect, out["body"]["kernels"]);
         }
         
+        // both calls search nearly the same kernels, keep them loaded in between
+        KernelScope scope;
+
         // force searchKernels and useWeb to false
         auto [exactCkTimes, kernels1] = extractExactCkTimes(startEt, stopEt, exactCkFrame, mission, ckQualities, false, searchKernels, fullKernelPath, 1, 1, kernelList);
         SPDLOG_DEBUG("Number of exact ck times = {}", exactCkTimes.size());
@@ -821,14 +874,24 @@ namespace SpiceQL {
 
         KernelSet sclkSet(ephemKernels);
 
-        vector<double> ticks;
-        ticks.reserve(ets.size());
-        for (double et : ets) {
-            double tick;
-            checkNaifErrors();
-            sce2c_c(frameCode, et, &tick);
-            checkNaifErrors();
-            ticks.push_back(tick);
+        vector<double> ticks(ets.size());
+        checkNaifErrors();
+        auto evaluate = [&](size_t begin, size_t end, double *rows) {
+            for (size_t i = begin; i < end; i++) {
+                sce2c_c(frameCode, ets[i], rows + (i - begin));
+                if (failed_c()) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        // SCLK kernels are text, so the workers have nothing to reopen
+        if (!EvaluationPool::run(ets.size(), 1, ticks.data(), {}, evaluate)) {
+            for (size_t i = 0; i < ets.size(); i++) {
+                checkNaifErrors();
+                sce2c_c(frameCode, ets[i], &ticks[i]);
+                checkNaifErrors();
+            }
         }
         SPDLOG_DEBUG("doubleEtsToSclkTicks({}, {}) -> {} ticks", frameCode, mission, ticks.size());
 
@@ -836,6 +899,51 @@ namespace SpiceQL {
     }
 
 
+    // Name -> code from the DB's frame map, 0 if it has no entry
+    static int nameToCodeFromCache(const string &name) {
+        int code = Inventory::getFrameCodeFromCache(name);
+        if (code == 0) {
+            return 0;
+        }
+        // Built-in body names win over built-in frames with the same name, as in bodn2c_c then namfrm_c
+        SpiceInt frameCode = 0;
+        namfrm_c(name.c_str(), &frameCode);
+        if (frameCode == code) {
+            SpiceInt bodyCode;
+            SpiceBoolean found = SPICEFALSE;
+            bodn2c_c(name.c_str(), &bodyCode, &found);
+            if (found) {
+                code = bodyCode;
+            }
+        }
+        checkNaifErrors();
+        return code;
+    }
+
+
+    // Code -> name from the DB's frame map, "" if it has no entry
+    static string codeToNameFromCache(int code) {
+        string name = Inventory::getFrameNameFromCache(code);
+        if (name.empty()) {
+            return name;
+        }
+        // Built-in body codes win over built-in frames with the same code, e.g. 1 is
+        // MERCURY BARYCENTER rather than J2000, as in bodc2n_c then frmnam_c
+        SpiceChar frameName[128];
+        frmnam_c(code, 128, frameName);
+        if (name == frameName) {
+            SpiceChar bodyName[128];
+            SpiceBoolean found = SPICEFALSE;
+            bodc2n_c(code, 128, bodyName, &found);
+            if (found) {
+                name = bodyName;
+            }
+        }
+        checkNaifErrors();
+        return name;
+    }
+
+
     pair<int, json> translateNameToCode(string frame, string mission, bool useWeb, bool searchKernels, bool fullKernelPath, int limitCk, int limitSpk, vector<string> kernelList) {    
         
         if (useWeb){
@@ -852,12 +960,33 @@ namespace SpiceQL {
             int result = out["body"]["return"].get<int>();
             return make_pair(result, out["body"]["kernels"]);
         }
-        
-        SpiceInt code;
-        SpiceBoolean found;
+
+        auto [codes, kernelsToLoad] = translateNamesToCodes({frame}, mission, false, searchKernels, fullKernelPath, limitCk, limitSpk, kernelList);
+        return {codes[0], kernelsToLoad};
+    }
+
+
+    pair<vector<int>, json> translateNamesToCodes(vector<string> frames, string mission, bool useWeb, bool searchKernels, bool fullKernelPath, int limitCk, int limitSpk, vector<string> kernelList) {
+
+        if (useWeb){
+            json args = json::object({
+                {"frames", frames},
+                {"mission", mission},
+                {"searchKernels", searchKernels},
+                {"fullKernelPath", fullKernelPath},
+                {"limitCk", limitCk},
+                {"limitSpk", limitSpk},
+                {"kernelList", kernelList}
+            });
+            json out = spiceAPIQuery("translateNamesToCodes", args);
+            vector<int> result = out["body"]["return"].get<vector<int>>();
+            return make_pair(result, out["body"]["kernels"]);
+        }
+
+        vector<int> codes(frames.size(), 0);
         json kernelsToLoad = {};
 
-        if (mission.empty()) mission = inferMission({frame}, {});
+        if (mission.empty()) mission = inferMission(frames, {});
 
         if (mission != "" && searchKernels) {
             kernelsToLoad = Inventory::search_for_kernelset(mission, {"fk", "ik", "iak"}, default_StartTime, default_StopTime, default_KernelQualities, default_KernelQualities, fullKernelPath, limitCk, limitSpk);
@@ -869,22 +998,44 @@ namespace SpiceQL {
             merge_json(kernelsToLoad, regexk);
         }
 
-        KernelSet kset(kernelsToLoad);
+        // Answer from the DB's frame map, the kernels are only furnished for names it lacks
+        vector<size_t> misses;
+        for (size_t i = 0; i < frames.size(); i++) {
+            if (searchKernels && kernelList.empty()) {
+                codes[i] = nameToCodeFromCache(frames[i]);
+            }
+            if (codes[i] == 0) {
+                misses.push_back(i);
+            }
+        }
+        bool furnished = !misses.empty();
+        SPDLOG_DEBUG("translateNamesToCodes: {} of {} names from the frame map, furnished: {}", frames.size() - misses.size(), frames.size(), furnished);
 
-        checkNaifErrors();
-        bodn2c_c(frame.c_str(), &code, &found);
-        checkNaifErrors();
+        if (furnished) {
+            KernelSet kset(kernelsToLoad);
 
-        if (!found) {
-            namfrm_c(frame.c_str(), &code);
-            checkNaifErrors();
-        }
+            for (size_t i : misses) {
+                SpiceInt code = 0;
+                SpiceBoolean found;
 
-        if (code == 0) {
-            throw invalid_argument(fmt::format("Frame code for frame name [{}] not found.", frame));
+                checkNaifErrors();
+                bodn2c_c(frames[i].c_str(), &code, &found);
+                checkNaifErrors();
+
+                if (!found) {
+                    namfrm_c(frames[i].c_str(), &code);
+                    checkNaifErrors();
+                }
+
+                if (code == 0) {
+                    throw invalid_argument(fmt::format("Frame code for frame name [{}] not found.", frames[i]));
+                }
+                codes[i] = code;
+            }
         }
 
-        return {code, kernelsToLoad};
+        kernelsToLoad[KERNELS_FURNISHED_KEY] = furnished;
+        return {codes, kernelsToLoad};
     }
 
 
@@ -905,11 +1056,32 @@ namespace SpiceQL {
             return make_pair(result, out["body"]["kernels"]);
         }
 
-        SpiceChar name[128];
-        SpiceBoolean found;
+        auto [names, kernelsToLoad] = translateCodesToNames({frame}, mission, false, searchKernels, fullKernelPath, limitCk, limitSpk, kernelList);
+        return {names[0], kernelsToLoad};
+    }
+
+
+    pair<vector<string>, json> translateCodesToNames(vector<int> frames, string mission, bool useWeb, bool searchKernels, bool fullKernelPath, int limitCk, int limitSpk, vector<string> kernelList) {
+
+        if (useWeb){
+            json args = json::object({
+                {"frames", frames},
+                {"mission", mission},
+                {"searchKernels", searchKernels},
+                {"fullKernelPath", fullKernelPath},
+                {"limitCk", limitCk},
+                {"limitSpk", limitSpk},
+                {"kernelList", kernelList}
+            });
+            json out = spiceAPIQuery("translateCodesToNames", args);
+            vector<string> result = out["body"]["return"].get<vector<string>>();
+            return make_pair(result, out["body"]["kernels"]);
+        }
+
+        vector<string> names(frames.size());
         json kernelsToLoad = {};
 
-        if (mission.empty()) mission = inferMission({}, {frame});
+        if (mission.empty()) mission = inferMission({}, frames);
 
         if (mission != "" && searchKernels){
             kernelsToLoad = Inventory::search_for_kernelset(mission, {"fk", "ik", "iak"}, default_StartTime, default_StopTime, default_KernelQualities, default_KernelQualities, fullKernelPath, limitCk, limitSpk);
@@ -920,22 +1092,44 @@ namespace SpiceQL {
             merge_json(kernelsToLoad, regexk);
         }
 
-        KernelSet kset(kernelsToLoad);
+        // Answer from the DB's frame map, the kernels are only furnished for codes it lacks
+        vector<size_t> misses;
+        for (size_t i = 0; i < frames.size(); i++) {
+            if (searchKernels && kernelList.empty()) {
+                names[i] = codeToNameFromCache(frames[i]);
+            }
+            if (names[i].empty()) {
+                misses.push_back(i);
+            }
+        }
+        bool furnished = !misses.empty();
+        SPDLOG_DEBUG("translateCodesToNames: {} of {} codes from the frame map, furnished: {}", frames.size() - misses.size(), frames.size(), furnished);
 
-        checkNaifErrors();
-        bodc2n_c(frame, 128, name, &found);
-        checkNaifErrors();
+        if (furnished) {
+            KernelSet kset(kernelsToLoad);
 
-        if(!found) {  
-            frmnam_c(frame, 128, name);
-            checkNaifErrors();
-        }
+            for (size_t i : misses) {
+                SpiceChar name[128];
+                SpiceBoolean found;
 
-        if(strlen(name) == 0) {
-            throw invalid_argument(fmt::format("Frame name for code {} not found.", frame));
+                checkNaifErrors();
+                bodc2n_c(frames[i], 128, name, &found);
+                checkNaifErrors();
+
+                if(!found) {  
+                    frmnam_c(frames[i], 128, name);
+                    checkNaifErrors();
+                }
+
+                if(strlen(name) == 0) {
+                    throw invalid_argument(fmt::format("Frame name for code {} not found.", frames[i]));
+                }
+                names[i] = name;
+            }
         }
 
-        return {string(name), kernelsToLoad};
+        kernelsToLoad[KERNELS_FURNISHED_KEY] = furnished;
+        return {names, kernelsToLoad};
     }
 
 
@@ -974,6 +1168,16 @@ namespace SpiceQL {
             // merge them into the ephem kernels overwriting anything found in the query
             merge_json(kernelsToLoad, regexk);
         }
+
+        // Frames recorded when the DB was built need no kernels
+        if (searchKernels && kernelList.empty() && !mission.empty()) {
+            json cached = Inventory::getFrameInfoFromCache(frame, mission);
+            if (!cached.is_null()) {
+                SPDLOG_TRACE("Frame info for {} from the DB: {}", frame, cached.dump());
+                return {{cached["center"].get<int>(), cached["class"].get<int>(), cached["class_id"].get<int>()}, kernelsToLoad};
+            }
+        }
+
         KernelSet kset(kernelsToLoad);
 
         checkNaifErrors();
@@ -1025,6 +1229,14 @@ namespace SpiceQL {
             merge_json(kernelsToLoad, regexk);
         }
 
+        // Target frames recorded when the DB was built need no kernels
+        if (mission != "" && searchKernels && kernelList.empty()) {
+            json cached = Inventory::getTargetFrameFromCache(targetId, mission, kernelsToLoad);
+            if (!cached.is_null()) {
+                return {cached, kernelsToLoad};
+            }
+        }
+
         KernelSet kSet(kernelsToLoad);
 
         checkNaifErrors();
@@ -1071,6 +1283,14 @@ namespace SpiceQL {
             merge_json(translationKernels, regexk);
         }
 
+        // Keywords recorded when the DB was built need no kernels
+        if (mission != "" && searchKernels && kernelList.empty()) {
+            json cached = Inventory::findKeywordsFromCache(key, mission, "mission", translationKernels);
+            if (!cached.is_null()) {
+                return {cached.empty() ? json() : cached, translationKernels};
+            }
+        }
+
         KernelSet kset(translationKernels);
 
         return {findKeywords(key), translationKernels};
@@ -1106,6 +1326,14 @@ namespace SpiceQL {
             merge_json(kernelsToLoad, regexk);
         }
 
+        // Keywords recorded when the DB was built need no kernels
+        if (mission != "" && searchKernels && kernelList.empty()) {
+            json cached = Inventory::findKeywordsFromCache(key, mission, "target", kernelsToLoad);
+            if (!cached.is_null()) {
+                return {cached.empty() ? json() : cached, kernelsToLoad};
+            }
+        }
+
         KernelSet kSet(kernelsToLoad);
         return {findKeywords(key), kernelsToLoad};
     }
@@ -1144,7 +1372,20 @@ namespace SpiceQL {
             // merge them into the ephem kernels overwriting anything found in the query
             merge_json(ephemKernels, regexk);
         }
-        KernelSet ephemSet(ephemKernels);
+
+        // Links recorded when the DB was built are followed without kernels.
+        // The kernels are only furnished for CK and dynamic links, and for
+        // frames the DB does not know.
+        bool useFrameCache = searchKernels && kernelList.empty() && !mission.empty();
+        unique_ptr<KernelSet> ephemSet;
+        auto furnish = [&]() {
+            if (!ephemSet) {
+                ephemSet = make_unique<KernelSet>(ephemKernels);
+            }
+        };
+        if (!useFrameCache) {
+            furnish();
+        }
 
         checkNaifErrors();
         // The code for this method was extracted from the Naif routine rotget written by N.J. Bachman &
@@ -1156,16 +1397,31 @@ namespace SpiceQL {
         int           frmidx;  // Frame chain index for current frame
         SpiceInt      nextFrame;   // Naif frame code of next frame
         int           J2000Code = 1;
+        json          cachedFrame;
+
+        auto frameInfo = [&](int frameCode) {
+            cachedFrame = useFrameCache ? Inventory::getFrameInfoFromCache(frameCode, mission) : json();
+            if (!cachedFrame.is_null()) {
+                center = cachedFrame["center"].get<int>();
+                type = cachedFrame["class"].get<int>();
+                typid = cachedFrame["class_id"].get<int>();
+                found = SPICETRUE;
+                return;
+            }
+            furnish();
+            frinfo_c((SpiceInt) frameCode,
+                     (SpiceInt *) &center,
+                     (SpiceInt *) &type,
+                     (SpiceInt *) &typid, &found);
+        };
+
         checkNaifErrors();
         vector<int> frameCodes;
         vector<int> frameTypes;
         vector<int> constantFrames;
         vector<int> timeFrames;
         frameCodes.push_back(initialFrame);
-        frinfo_c((SpiceInt)frameCodes[0],
-                    (SpiceInt *)&center,
-                    (SpiceInt *)&type,
-                    (SpiceInt *)&typid, &found);
+        frameInfo(frameCodes[0]);
         frameTypes.push_back(type);
 
         while (frameCodes[frameCodes.size() - 1] != J2000Code) {
@@ -1177,10 +1433,7 @@ namespace SpiceQL {
             // logic for FrameTypes in this method is correct for all types except type 7.  Current pck
             // do not exercise this option.  Should we ever use pck with a target body not referenced to
             // the J2000 frame and epoch, both this method and loadPCFromSpice will need to be modified.
-            frinfo_c((SpiceInt) frameCodes[frmidx],
-                    (SpiceInt *) &center,
-                    (SpiceInt *) &type,
-                    (SpiceInt *) &typid, &found);
+            frameInfo(frameCodes[frmidx]);
 
             if (!found) {
             string msg = "The frame " + to_string(frameCodes[frmidx]) + " is not supported by Naif";
@@ -1196,6 +1449,7 @@ namespace SpiceQL {
             }
             // 3 = CK
             else if (type == 3) {
+            furnish();
             ckfrot_((SpiceInt *) &typid, &et, (double *) matrix, &nextFrame, (logical *) &found);
 
             if (!found) {
@@ -1207,11 +1461,16 @@ namespace SpiceQL {
             }
             // 4 = TK
             else if (type == 4) {
-            tkfram_((SpiceInt *) &typid, (double *) matrix, &nextFrame, (logical *) &found);
-            if (!found) {
-                string msg = "The tk rotation from frame " + to_string(frameCodes[frmidx]) +
-                            " can not be found";
-                throw logic_error(msg);
+            if (!cachedFrame.is_null()) {
+                nextFrame = cachedFrame["tk_parent"].get<int>();
+            }
+            else {
+                tkfram_((SpiceInt *) &typid, (double *) matrix, &nextFrame, (logical *) &found);
+                if (!found) {
+                    string msg = "The tk rotation from frame " + to_string(frameCodes[frmidx]) +
+                                " can not be found";
+                    throw logic_error(msg);
+                }
             }
             }
             // 5 = DYN
@@ -1222,6 +1481,7 @@ namespace SpiceQL {
             //        dynamic frame class ID. ZZDYNROT also requires the center ID
             //        we found via the FRINFO call.
 
+            furnish();
             zzdynrot_((SpiceInt *) &typid, (SpiceInt *) &center, &et, (double *) matrix, &nextFrame);
             }
 
@@ -1301,6 +1561,15 @@ namespace SpiceQL {
             merge_json(ephemKernels, regexk);
         }
 
+        // Answer from the DB's CK record index when it covers every CK found
+        if (searchKernels && kernelList.empty()) {
+            json indexedTimes = Inventory::getIndexedCkTimes(observStart, observEnd, targetFrame, mission, ephemKernels);
+            if (!indexedTimes.is_null()) {
+                SPDLOG_DEBUG("Found {} exact CK times in the CK record index", indexedTimes.size());
+                return {indexedTimes.get<vector<double>>(), ephemKernels};
+            }
+        }
+
         KernelSet ephemSet(ephemKernels);
 
         int count = 0;
@@ -0,0 +1,567 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <SpiceUsr.h>
+#include <SpiceZfc.h>
+
+#include <fmt/format.h>
+
+#include <SpiceQL/spiceql_logging.h>
+#include <SpiceQL/ck_evaluator.h>
+#include <SpiceQL/daf.h>
+#include <SpiceQL/utils.h>
+
+using json = nlohmann::json;
+using namespace std;
+
+namespace SpiceQL {
+
+  string NATIVE_CK_ENV_VAR = "SPICEQL_NATIVE_CK";
+
+
+  namespace {
+    const int J2000_CODE = 1;
+    const int MAX_CHAIN = 20;
+    const size_t MIN_THREAD_EPOCHS = 1024;
+
+    const double IDENTITY[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+
+    std::mutex g_mutex;
+    std::atomic<int> g_enabled{-1};
+    uint64_t g_requests = 0;
+    uint64_t g_orientations = 0;
+    uint64_t g_unsupported = 0;
+
+    // Row major 3x3 products, c = a * b and c = a * b^T
+    void mxm(const double *a, const double *b, double *c) {
+      for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+          c[i * 3 + j] = a[i * 3] * b[j] + a[i * 3 + 1] * b[3 + j] + a[i * 3 + 2] * b[6 + j];
+        }
+      }
+    }
+
+
+    void mxmt(const double *a, const double *b, double *c) {
+      for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+          c[i * 3 + j] = a[i * 3] * b[j * 3] + a[i * 3 + 1] * b[j * 3 + 1] + a[i * 3 + 2] * b[j * 3 + 2];
+        }
+      }
+    }
+
+
+    // v = m * u and v = m^T * u
+    void mxv(const double *m, const double *u, double *v) {
+      for (int i = 0; i < 3; i++) {
+        v[i] = m[i * 3] * u[0] + m[i * 3 + 1] * u[1] + m[i * 3 + 2] * u[2];
+      }
+    }
+
+
+    void mtxv(const double *m, const double *u, double *v) {
+      for (int i = 0; i < 3; i++) {
+        v[i] = m[i] * u[0] + m[3 + i] * u[1] + m[6 + i] * u[2];
+      }
+    }
+
+
+    // SPICE quaternion to rotation matrix, as q2m_c
+    void q2m(const double *q, double *r) {
+      double l2 = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+      if (l2 == 0.0) {
+        memcpy(r, IDENTITY, sizeof(IDENTITY));
+        return;
+      }
+      double s = 2.0 / l2;
+      double q01 = q[0] * q[1], q02 = q[0] * q[2], q03 = q[0] * q[3];
+      double q11 = q[1] * q[1], q12 = q[1] * q[2], q13 = q[1] * q[3];
+      double q22 = q[2] * q[2], q23 = q[2] * q[3], q33 = q[3] * q[3];
+      r[0] = 1.0 - s * (q22 + q33);
+      r[1] = s * (q12 - q03);
+      r[2] = s * (q13 + q02);
+      r[3] = s * (q12 + q03);
+      r[4] = 1.0 - s * (q11 + q33);
+      r[5] = s * (q23 - q01);
+      r[6] = s * (q13 - q02);
+      r[7] = s * (q23 + q01);
+      r[8] = 1.0 - s * (q11 + q22);
+    }
+
+
+    // Rotation matrix to SPICE quaternion with a non-negative scalar part, as m2q_c
+    void m2q(const double *r, double *q) {
+      double trace = r[0] + r[4] + r[8];
+      double mtrace = 1.0 - trace;
+      double cc4 = 1.0 + trace;
+      double s114 = mtrace + 2.0 * r[0];
+      double s224 = mtrace + 2.0 * r[4];
+      double s334 = mtrace + 2.0 * r[8];
+
+      double c, s1, s2, s3, factor;
+      if (cc4 >= 1.0) {
+        c = sqrt(cc4 * 0.25);
+        factor = 1.0 / (c * 4.0);
+        s1 = (r[7] - r[5]) * factor;
+        s2 = (r[2] - r[6]) * factor;
+        s3 = (r[3] - r[1]) * factor;
+      }
+      else if (s114 >= 1.0) {
+        s1 = sqrt(s114 * 0.25);
+        factor = 1.0 / (s1 * 4.0);
+        c = (r[7] - r[5]) * factor;
+        s2 = (r[1] + r[3]) * factor;
+        s3 = (r[2] + r[6]) * factor;
+      }
+      else if (s224 >= 1.0) {
+        s2 = sqrt(s224 * 0.25);
+        factor = 1.0 / (s2 * 4.0);
+        c = (r[2] - r[6]) * factor;
+        s1 = (r[1] + r[3]) * factor;
+        s3 = (r[5] + r[7]) * factor;
+      }
+      else {
+        s3 = sqrt(s334 * 0.25);
+        factor = 1.0 / (s3 * 4.0);
+        c = (r[3] - r[1]) * factor;
+        s1 = (r[2] + r[6]) * factor;
+        s2 = (r[5] + r[7]) * factor;
+      }
+      double sign = c < 0.0 ? -1.0 : 1.0;
+      q[0] = sign * c;
+      q[1] = sign * s1;
+      q[2] = sign * s2;
+      q[3] = sign * s3;
+    }
+
+
+    // Matrix rotating vectors by angle about axis, as axisar_c
+    void axisRotation(const double *axis, double angle, double *r) {
+      double norm = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+      if (norm == 0.0 || angle == 0.0) {
+        memcpy(r, IDENTITY, sizeof(IDENTITY));
+        return;
+      }
+      double s = sin(angle / 2.0) / norm;
+      double q[4] = {cos(angle / 2.0), axis[0] * s, axis[1] * s, axis[2] * s};
+      q2m(q, r);
+    }
+
+
+    // Pointing of a type 2 record at ticks, the record's constant angular velocity
+    // turns its quaternion for the time since the record started
+    void type2Pointing(const double *record, double start, double ticks, double *cmat, double *av) {
+      double seconds = (ticks - start) * record[7];
+      double rate = sqrt(record[4] * record[4] + record[5] * record[5] + record[6] * record[6]);
+      double rotation[9];
+      double base[9];
+      axisRotation(record + 4, seconds * rate, rotation);
+      q2m(record, base);
+      mxmt(base, rotation, cmat);
+      memcpy(av, record + 4, 3 * sizeof(double));
+    }
+
+
+    // Pointing between two type 3 instances, turning the first toward the second
+    // by frac of the angle between them and interpolating the angular velocity linearly
+    void type3Pointing(const double *first, const double *second, bool has_av, double frac, double *cmat, double *av) {
+      double cmat1[9], cmat2[9], rotation[9], q[4];
+      q2m(first, cmat1);
+      q2m(second, cmat2);
+      mxmt(cmat2, cmat1, rotation);
+      m2q(rotation, q);
+
+      double sine = sqrt(q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+      if (sine == 0.0) {
+        memcpy(cmat, cmat1, sizeof(cmat1));
+      }
+      else {
+        double angle = 2.0 * atan2(sine, q[0]);
+        double delta[9];
+        axisRotation(q + 1, frac * angle, delta);
+        mxm(delta, cmat1, cmat);
+      }
+      for (int c = 0; c < 3; c++) {
+        av[c] = has_av ? (1.0 - frac) * first[4 + c] + frac * second[4 + c] : 0.0;
+      }
+    }
+  }
+
+
+  std::unique_ptr<CkEvaluator> CkEvaluator::create(int toFrame, int refFrame, const double *ets, size_t count) {
+    if (!isEnabled() || count == 0) {
+      return nullptr;
+    }
+
+    unique_ptr<CkEvaluator> evaluator(new CkEvaluator());
+    evaluator->m_to = toFrame;
+    evaluator->m_ref = refFrame;
+    evaluator->m_ets.assign(ets, ets + count);
+
+    auto unsupported = [](string reason) {
+      SPDLOG_DEBUG("Leaving orientations to CSPICE: {}", reason);
+      std::lock_guard<std::mutex> lock(g_mutex);
+      g_unsupported++;
+      return nullptr;
+    };
+
+    if (!DafFile::furnished("CK", "DAF/CK", evaluator->m_files)) {
+      return unsupported("a CK cannot be read natively");
+    }
+
+    vector<const FileSegments *> tables;
+    for (auto &file : evaluator->m_files) {
+      tables.push_back(&file->table<FileSegments>(parseSegments));
+    }
+
+    // the frames between the two, with the constant rotations of inertial and TK frames
+    deque<int> pending = {toFrame, refFrame};
+    while (!pending.empty()) {
+      int code = pending.front();
+      pending.pop_front();
+      if (code == J2000_CODE || evaluator->m_frames.contains(code)) {
+        continue;
+      }
+
+      SpiceInt center, frame_class, class_id;
+      SpiceBoolean found = SPICEFALSE;
+      frinfo_c(code, &center, &frame_class, &class_id, &found);
+      checkNaifErrors();
+      if (!found) {
+        return unsupported(fmt::format("frame {} is not defined", code));
+      }
+
+      Frame frame = {};
+      frame.frame_class = frame_class;
+      if (frame_class == 1) {
+        SpiceChar name[33];
+        SpiceDouble matrix[3][3];
+        frmnam_c(code, sizeof(name), name);
+        pxform_c("J2000", name, ets[0], matrix);
+        checkNaifErrors();
+        frame.parent = J2000_CODE;
+        memcpy(frame.rotation, matrix, sizeof(frame.rotation));
+      }
+      else if (frame_class == 4) {
+        // tkfram_ returns the frame to parent rotation in column major order,
+        // which read row major is the parent to frame rotation
+        integer id = class_id;
+        integer parent = 0;
+        logical tk_found = 0;
+        tkfram_(&id, frame.rotation, &parent, &tk_found);
+        checkNaifErrors();
+        if (!tk_found) {
+          return unsupported(fmt::format("TK frame {} has no rotation", code));
+        }
+        frame.parent = parent;
+        pending.push_back(frame.parent);
+      }
+      else if (frame_class == 3) {
+        frame.instrument = class_id;
+        ckmeta_c(class_id, "SCLK", &frame.sclk);
+        checkNaifErrors();
+        // the instrument's segments, CSPICE searches the last loaded CK first
+        if (!evaluator->m_segments.contains(class_id)) {
+          vector<const Segment *> &segments = evaluator->m_segments[class_id];
+          for (auto table = tables.rbegin(); table != tables.rend(); table++) {
+            auto found = (*table)->find(class_id);
+            if (found == (*table)->end()) {
+              continue;
+            }
+            for (const Segment &segment : found->second) {
+              segments.push_back(&segment);
+              pending.push_back(segment.reference);
+            }
+          }
+        }
+
+        // the epochs in the SCLK's ticks, each SCLK once
+        if (!evaluator->m_ticks.contains(frame.sclk)) {
+          vector<double> &ticks = evaluator->m_ticks[frame.sclk];
+          ticks.resize(count);
+          for (size_t i = 0; i < count; i++) {
+            sce2c_c(frame.sclk, ets[i], &ticks[i]);
+          }
+          if (failed_c()) {
+            // an epoch outside the SCLK, CSPICE reports it
+            reset_c();
+            return unsupported(fmt::format("epochs outside SCLK {}", frame.sclk));
+          }
+        }
+      }
+      else {
+        return unsupported(fmt::format("frame {} has class {}", code, frame_class));
+      }
+      evaluator->m_frames[code] = frame;
+    }
+    return evaluator;
+  }
+
+
+  CkEvaluator::FileSegments CkEvaluator::parseSegments(const DafFile &file) {
+    FileSegments table;
+    const vector<DafFile::Segment> &summaries = file.segments();
+    // CSPICE searches the last segment of a file first, and only segments
+    // with angular velocity are used for state transformations
+    for (auto summary = summaries.rbegin(); summary != summaries.rend(); summary++) {
+      Segment segment = {};
+      segment.start = summary->dc[0];
+      segment.stop = summary->dc[1];
+      segment.reference = summary->ic[1];
+      segment.type = summary->ic[2];
+      segment.has_av = summary->ic[3] != 0 || segment.type == 2;
+      segment.data = summary->data;
+      size_t size = summary->size;
+      if (!segment.has_av) {
+        continue;
+      }
+
+      bool supported = false;
+      if (segment.type == 2) {
+        // records of 8, their start and stop ticks, and a directory of every 100th start
+        size_t n = size / 10;
+        while (n > 0 && 10 * n + (n - 1) / 100 > size) {
+          n--;
+        }
+        segment.records = n;
+        supported = n > 0 && 10 * n + (n - 1) / 100 == size;
+      }
+      else if (segment.type == 3 && size >= 2) {
+        // instances of 7, their ticks and directory, the interval starts and
+        // their directory, then the number of intervals and of instances
+        size_t n = (size_t)segment.data[size - 1];
+        size_t intervals = (size_t)segment.data[size - 2];
+        segment.records = n;
+        segment.intervals = intervals;
+        supported = n > 0 && intervals > 0
+                    && 8 * n + (n - 1) / 100 + intervals + (intervals - 1) / 100 + 2 <= size;
+      }
+      if (!supported) {
+        // found later only if an epoch needs it
+        segment.type = 0;
+      }
+      table[summary->ic[0]].push_back(segment);
+    }
+    return table;
+  }
+
+
+  CkEvaluator::~CkEvaluator() = default;
+
+
+  bool CkEvaluator::link(int code, size_t i, int &parent, double *rotation, double *av) const {
+    auto frame = m_frames.find(code);
+    if (frame == m_frames.end()) {
+      return false;
+    }
+    if (frame->second.frame_class != 3) {
+      parent = frame->second.parent;
+      memcpy(rotation, frame->second.rotation, 9 * sizeof(double));
+      av[0] = av[1] = av[2] = 0.0;
+      return true;
+    }
+
+    auto segments = m_segments.find(frame->second.instrument);
+    if (segments == m_segments.end()) {
+      return false;
+    }
+    double ticks = m_ticks.at(frame->second.sclk)[i];
+    for (const Segment *entry : segments->second) {
+      const Segment &segment = *entry;
+      if (ticks < segment.start || ticks > segment.stop) {
+        continue;
+      }
+      parent = segment.reference;
+
+      if (segment.type == 2) {
+        size_t n = segment.records;
+        const double *starts = segment.data + 8 * n;
+        const double *stops = starts + n;
+        size_t record = upper_bound(starts, starts + n, ticks) - starts;
+        if (record == 0 || ticks > stops[record - 1]) {
+          // between records, look in the next segment
+          continue;
+        }
+        record--;
+        type2Pointing(segment.data + 8 * record, starts[record], ticks, rotation, av);
+        return true;
+      }
+      else if (segment.type == 3) {
+        size_t n = segment.records;
+        size_t size = segment.has_av ? 7 : 4;
+        const double *tags = segment.data + size * n;
+        const double *starts = tags + n + (n - 1) / 100;
+        if (ticks < tags[0] || ticks > tags[n - 1]) {
+          continue;
+        }
+        size_t high = lower_bound(tags, tags + n, ticks) - tags;
+        if (tags[high] == ticks) {
+          type3Pointing(segment.data + size * high, segment.data + size * high, segment.has_av, 0.0, rotation, av);
+          return true;
+        }
+        size_t low = high - 1;
+        // instances on either side of a gap between interpolation intervals are not interpolated
+        size_t interval = upper_bound(starts, starts + segment.intervals, ticks) - starts;
+        if (interval < segment.intervals && tags[high] >= starts[interval]) {
+          continue;
+        }
+        double frac = (ticks - tags[low]) / (tags[high] - tags[low]);
+        type3Pointing(segment.data + size * low, segment.data + size * high, segment.has_av, frac, rotation, av);
+        return true;
+      }
+      // a segment this does not evaluate would be used
+      return false;
+    }
+    return false;
+  }
+
+
+  bool CkEvaluator::evaluateRange(size_t begin, size_t end, double *orientations) const {
+    for (size_t i = begin; i < end; i++) {
+      double *row = orientations + (i - begin) * 8;
+
+      // toFrame's chain of parents, with the rotation from each to toFrame and the
+      // angular velocity of toFrame relative to each in that frame's coordinates
+      int frames[MAX_CHAIN];
+      double rotations[MAX_CHAIN][9];
+      double avs[MAX_CHAIN][3];
+      int chain = 1;
+      frames[0] = m_to;
+      memcpy(rotations[0], IDENTITY, sizeof(IDENTITY));
+      fill(avs[0], avs[0] + 3, 0.0);
+      while (chain < MAX_CHAIN && frames[chain - 1] != J2000_CODE && frames[chain - 1] != m_ref) {
+        int parent;
+        double rotation[9], av[3], turned[3];
+        if (!link(frames[chain - 1], i, parent, rotation, av)) {
+          break;
+        }
+        mxm(rotations[chain - 1], rotation, rotations[chain]);
+        mtxv(rotation, avs[chain - 1], turned);
+        for (int c = 0; c < 3; c++) {
+          avs[chain][c] = av[c] + turned[c];
+        }
+        frames[chain] = parent;
+        chain++;
+      }
+
+      // walk refFrame's chain the same way until it meets toFrame's
+      int code = m_ref;
+      double ref_rotation[9];
+      double ref_av[3] = {0, 0, 0};
+      memcpy(ref_rotation, IDENTITY, sizeof(IDENTITY));
+      bool joined = false;
+      for (int step = 0; step < MAX_CHAIN && !joined; step++) {
+        for (int k = 0; k < chain; k++) {
+          if (frames[k] != code) {
+            continue;
+          }
+          // refFrame to the common frame, then on to toFrame
+          double rotation[9], difference[3];
+          mxmt(rotations[k], ref_rotation, rotation);
+          for (int c = 0; c < 3; c++) {
+            difference[c] = avs[k][c] - ref_av[c];
+          }
+          m2q(rotation, row);
+          mxv(ref_rotation, difference, row + 4);
+          row[7] = 1;
+          joined = true;
+          break;
+        }
+        if (joined) {
+          break;
+        }
+
+        int parent;
+        double rotation[9], av[3], turned[3], product[9];
+        if (!link(code, i, parent, rotation, av)) {
+          return false;
+        }
+        mxm(ref_rotation, rotation, product);
+        memcpy(ref_rotation, product, sizeof(product));
+        mtxv(rotation, ref_av, turned);
+        for (int c = 0; c < 3; c++) {
+          ref_av[c] = av[c] + turned[c];
+        }
+        code = parent;
+      }
+      if (!joined) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+
+  bool CkEvaluator::evaluate(double *orientations) const {
+    size_t count = m_ets.size();
+#if defined(SPICEQL_WASM)
+    // the WASM build has no threads
+    size_t threads = 1;
+#else
+    size_t threads = min((size_t)max(thread::hardware_concurrency(), 1u), max(count / MIN_THREAD_EPOCHS, (size_t)1));
+#endif
+    bool ok = true;
+    if (threads < 2) {
+      ok = evaluateRange(0, count, orientations);
+    }
+    else {
+      vector<char> done(threads, 0);
+      vector<thread> workers;
+      for (size_t t = 0; t < threads; t++) {
+        size_t begin = count * t / threads;
+        size_t end = count * (t + 1) / threads;
+        workers.emplace_back([&, t, begin, end]() {
+          done[t] = evaluateRange(begin, end, orientations + begin * 8);
+        });
+      }
+      for (auto &worker : workers) {
+        worker.join();
+      }
+      ok = all_of(done.begin(), done.end(), [](char d) { return d != 0; });
+    }
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (ok) {
+      g_requests++;
+      g_orientations += count;
+    }
+    else {
+      g_unsupported++;
+    }
+    return ok;
+  }
+
+
+  void CkEvaluator::setEnabled(bool enabled) {
+    g_enabled = enabled;
+  }
+
+
+  bool CkEvaluator::isEnabled() {
+    int enabled = g_enabled.load();
+    if (enabled < 0) {
+      const char *env = getenv(NATIVE_CK_ENV_VAR.c_str());
+      enabled = env == NULL || toLower(string(env)) != "false";
+      int unset = -1;
+      g_enabled.compare_exchange_strong(unset, enabled);
+      enabled = g_enabled.load();
+    }
+    return enabled > 0;
+  }
+
+
+  json CkEvaluator::stats() {
+    bool enabled = isEnabled();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return {{"enabled", enabled},
+            {"requests", g_requests},
+            {"orientations", g_orientations},
+            {"unsupported", g_unsupported}};
+  }
+}
@@ -6,6 +6,7 @@
 #include <time.h>
 
 #include <fstream>
+#include <mutex>
 #include <sstream>
 #include <SpiceQL/spiceql_logging.h>
 
@@ -21,19 +22,57 @@ namespace SpiceQL {
   }
 
 
-  Config::Config() {
-    string dbPath = getConfigDirectory(); 
-    vector<string> json_paths = glob(dbPath, ".json");
-
-    for(const fs::path &p : json_paths) {
-      ifstream i(p);
-      json j;
-      i >> j;
-      for (auto it = j.begin(); it != j.end(); ++it) {
-        config[it.key()] = it.value();
+  namespace {
+    // the parsed global config, shared by every Config() in the process
+    std::mutex g_config_mutex;
+    string g_config_stamp;
+    json g_config;
+    uint64_t g_config_generation = 0;
+
+    // Reparses the config files when one was added, removed or modified since
+    // the last parse. Callers must hold g_config_mutex.
+    void refreshConfig() {
+      string dbPath = getConfigDirectory(); 
+      vector<string> json_paths = glob(dbPath, ".json");
+
+      string stamp = dbPath;
+      for(const fs::path &p : json_paths) {
+        std::error_code ec;
+        stamp += "|" + p.string() + "@" + to_string(fs::last_write_time(p, ec).time_since_epoch().count())
+                 + "@" + to_string(fs::file_size(p, ec));
+      }
+      if (stamp == g_config_stamp) {
+        return;
       }
+
+      json config;
+      for(const fs::path &p : json_paths) {
+        ifstream i(p);
+        json j;
+        i >> j;
+        for (auto it = j.begin(); it != j.end(); ++it) {
+          config[it.key()] = it.value();
+        }
+      }
+      resolveConfigDependencies(config, config);
+      g_config = config;
+      g_config_stamp = stamp;
+      g_config_generation++;
     }
-    resolveConfigDependencies(config, config);
+  }
+
+
+  uint64_t configGeneration() {
+    std::lock_guard<std::mutex> lock(g_config_mutex);
+    refreshConfig();
+    return g_config_generation;
+  }
+
+
+  Config::Config() {
+    std::lock_guard<std::mutex> lock(g_config_mutex);
+    refreshConfig();
+    config = g_config;
   }
 
 
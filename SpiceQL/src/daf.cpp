@@ -0,0 +1,243 @@
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+#if !defined(_WIN32) && !defined(SPICEQL_WASM)
+// DAFs are memory mapped read only
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <SpiceUsr.h>
+
+#include <ghc/fs_std.hpp>
+
+#include <SpiceQL/spiceql_logging.h>
+#include <SpiceQL/daf.h>
+
+using namespace std;
+
+namespace SpiceQL {
+
+  namespace {
+    const size_t RECORD_BYTES = 1024;
+    const int SUMMARY_ND = 2;
+    const int SUMMARY_NI = 6;
+    const size_t MAX_FILES = 4096;
+
+    //! what tells a file changed on disk
+    struct FileStamp {
+      int64_t mtime;
+      uintmax_t size;
+      uintmax_t inode;
+      bool operator==(const FileStamp &) const = default;
+    };
+
+    struct CachedFile {
+      FileStamp stamp;
+      //! nullptr if the file cannot be read natively
+      shared_ptr<const DafFile> file;
+    };
+
+    std::mutex g_mutex;
+    map<string, CachedFile> g_files;
+
+    bool hostIsLittleEndian() {
+      const uint16_t one = 1;
+      return *reinterpret_cast<const unsigned char *>(&one) == 1;
+    }
+
+
+    // Stamps the file with a single stat where there is one, every request checks each furnished DAF
+    bool stampFile(const string &path, FileStamp &stamp) {
+#if !defined(_WIN32) && !defined(SPICEQL_WASM)
+      struct stat info;
+      if (::stat(path.c_str(), &info) != 0) {
+        return false;
+      }
+#if defined(__APPLE__)
+      stamp.mtime = (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+      stamp.mtime = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+      stamp.size = info.st_size;
+      stamp.inode = info.st_ino;
+#else
+      std::error_code ec;
+      fs::file_time_type mtime = fs::last_write_time(path, ec);
+      stamp.size = ec ? 0 : fs::file_size(path, ec);
+      if (ec) {
+        return false;
+      }
+      stamp.mtime = mtime.time_since_epoch().count();
+      stamp.inode = 0;
+#endif
+      return true;
+    }
+
+
+    int readInt(const char *p) {
+      int32_t value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+    }
+  }
+
+
+  DafFile::~DafFile() {
+#if !defined(_WIN32) && !defined(SPICEQL_WASM)
+    if (m_mapped) {
+      munmap(const_cast<char *>(m_data), m_size);
+    }
+#endif
+  }
+
+
+  shared_ptr<const DafFile> DafFile::get(const string &path, const string &idword) {
+    FileStamp stamp;
+    if (!stampFile(path, stamp)) {
+      return nullptr;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(g_mutex);
+      auto entry = g_files.find(path);
+      if (entry != g_files.end() && entry->second.stamp == stamp) {
+        const shared_ptr<const DafFile> &file = entry->second.file;
+        return file && file->m_idword == idword ? file : nullptr;
+      }
+    }
+
+    shared_ptr<DafFile> file(new DafFile());
+    file->m_idword = idword;
+    if (!file->load(path, stamp.size) || !file->parse(path, idword)) {
+      file = nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_files.size() >= MAX_FILES) {
+      g_files.clear();
+    }
+    g_files[path] = {stamp, file};
+    return file;
+  }
+
+
+  bool DafFile::furnished(const string &kind, const string &idword, vector<shared_ptr<const DafFile>> &files) {
+    files.clear();
+    SpiceInt count = 0;
+    ktotal_c(kind.c_str(), &count);
+    for (SpiceInt i = 0; i < count; i++) {
+      SpiceChar file[1024];
+      SpiceChar type[32];
+      SpiceChar source[1024];
+      SpiceInt handle;
+      SpiceBoolean found = SPICEFALSE;
+      kdata_c(i, kind.c_str(), sizeof(file), sizeof(type), sizeof(source), file, type, source, &handle, &found);
+      if (!found) {
+        continue;
+      }
+      shared_ptr<const DafFile> daf = get(file, idword);
+      if (!daf) {
+        return false;
+      }
+      files.push_back(daf);
+    }
+    return true;
+  }
+
+
+  size_t DafFile::mapped() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    size_t count = 0;
+    for (auto &[path, entry] : g_files) {
+      count += entry.file != nullptr;
+    }
+    return count;
+  }
+
+
+  bool DafFile::load(const string &path, size_t size) {
+    m_size = size;
+#if !defined(_WIN32) && !defined(SPICEQL_WASM)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      return false;
+    }
+    m_data = static_cast<const char *>(data);
+    m_mapped = true;
+#else
+    ifstream in(path, ios::binary);
+    m_buffer.resize(size / sizeof(double) + 1);
+    if (!in.read(reinterpret_cast<char *>(m_buffer.data()), size)) {
+      return false;
+    }
+    m_data = reinterpret_cast<const char *>(m_buffer.data());
+#endif
+    return true;
+  }
+
+
+  bool DafFile::parse(const string &path, const string &idword) {
+    string padded = idword;
+    padded.resize(8, ' ');
+    if (m_size < RECORD_BYTES || memcmp(m_data, padded.c_str(), 8) != 0) {
+      return false;
+    }
+    // summaries and data are read as stored, so the DAF must be in the host's byte order
+    if (memcmp(m_data + 88, hostIsLittleEndian() ? "LTL-IEEE" : "BIG-IEEE", 8) != 0
+        || readInt(m_data + 8) != SUMMARY_ND || readInt(m_data + 12) != SUMMARY_NI) {
+      SPDLOG_DEBUG("{} is not a native DAF, leaving it to CSPICE", path);
+      return false;
+    }
+
+    const size_t summary_size = SUMMARY_ND + (SUMMARY_NI + 1) / 2;
+    const size_t total = m_size / sizeof(double);
+    const double *doubles = reinterpret_cast<const double *>(m_data);
+
+    int record = readInt(m_data + 76);
+    size_t visited = 0;
+    while (record > 0) {
+      size_t offset = (size_t)(record - 1) * RECORD_BYTES;
+      if (offset + RECORD_BYTES > m_size || ++visited > m_size / RECORD_BYTES) {
+        return false;
+      }
+      const double *summaries = doubles + offset / sizeof(double);
+      int next = (int)summaries[0];
+      int nsum = (int)summaries[2];
+      if (nsum < 0 || 3 + nsum * summary_size > RECORD_BYTES / sizeof(double)) {
+        return false;
+      }
+
+      for (int i = 0; i < nsum; i++) {
+        const double *summary = summaries + 3 + i * summary_size;
+        const char *ic = reinterpret_cast<const char *>(summary + SUMMARY_ND);
+
+        Segment segment;
+        segment.dc[0] = summary[0];
+        segment.dc[1] = summary[1];
+        for (int j = 0; j < SUMMARY_NI; j++) {
+          segment.ic[j] = readInt(ic + 4 * j);
+        }
+        int begin = segment.ic[4];
+        int end = segment.ic[5];
+        if (begin < 1 || end < begin || (size_t)end > total) {
+          return false;
+        }
+        segment.data = doubles + (begin - 1);
+        segment.size = end - begin + 1;
+        m_segments.push_back(segment);
+      }
+      record = next;
+    }
+    return true;
+  }
+}
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(SPICEQL_WASM)
+// Workers are forked processes sharing an anonymous memory map
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <SpiceUsr.h>
+
+#include <SpiceQL/spiceql_logging.h>
+#include <SpiceQL/evalpool.h>
+
+using json = nlohmann::json;
+using namespace std;
+
+namespace SpiceQL {
+
+  string EVALUATION_PROCESSES_ENV_VAR = "SPICEQL_EVAL_PROCESSES";
+
+  namespace {
+    std::mutex g_mutex;
+    bool g_processes_read = false;
+    size_t g_processes = 0;
+
+    uint64_t g_runs = 0;
+    uint64_t g_rows = 0;
+    uint64_t g_workers = 0;
+    uint64_t g_reopened = 0;
+    uint64_t g_skipped = 0;
+    uint64_t g_failed = 0;
+
+
+    // callers must hold g_mutex
+    void readProcesses() {
+      if (g_processes_read) {
+        return;
+      }
+      g_processes_read = true;
+      const char *env = getenv(EVALUATION_PROCESSES_ENV_VAR.c_str());
+      try {
+        g_processes = env ? stoul(env) : 0;
+      }
+      catch (exception &e) {
+        SPDLOG_WARN("Ignoring invalid {}: {}", EVALUATION_PROCESSES_ENV_VAR, e.what());
+        g_processes = 0;
+      }
+    }
+
+
+#if !defined(_WIN32) && !defined(SPICEQL_WASM)
+    const int FILE_LEN = 1024;
+    const int TYPE_LEN = 32;
+
+    // Furnished binary kernels of the given kinds, in load order. Runs in the caller.
+    vector<string> binaryKernels(const vector<string> &kinds) {
+      SpiceInt count = 0;
+      ktotal_c("all", &count);
+
+      vector<string> files;
+      for (SpiceInt i = 0; i < count; i++) {
+        SpiceChar file[FILE_LEN];
+        SpiceChar type[TYPE_LEN];
+        SpiceChar source[FILE_LEN];
+        SpiceInt handle;
+        SpiceBoolean found = SPICEFALSE;
+        kdata_c(i, "all", FILE_LEN, TYPE_LEN, FILE_LEN, file, type, source, &handle, &found);
+        if (found && find(kinds.begin(), kinds.end(), string(type)) != kinds.end()) {
+          files.push_back(file);
+        }
+      }
+      return files;
+    }
+
+
+    // Unloads and furnishes the files again in load order, so a worker reads
+    // them through its own file handles. Runs in the worker.
+    bool reopenBinaryKernels(const vector<string> &files) {
+      for (auto &file : files) {
+        unload_c(file.c_str());
+      }
+      for (auto &file : files) {
+        furnsh_c(file.c_str());
+      }
+      return !failed_c();
+    }
+#endif
+  }
+
+
+  void EvaluationPool::setProcesses(size_t processes) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_processes_read = true;
+    g_processes = processes;
+  }
+
+
+  size_t EvaluationPool::getProcesses() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    readProcesses();
+    return g_processes;
+  }
+
+
+  bool EvaluationPool::run(size_t count, size_t width, double *out, const vector<string> &kinds, const Shard &evaluate) {
+#if defined(_WIN32) || defined(SPICEQL_WASM)
+    return false;
+#else
+    size_t processes = getProcesses();
+    if (processes < 2 || width == 0 || count < 2 * MIN_SHARD_SIZE) {
+      return false;
+    }
+
+    // every worker pays for reopening the kernels, so each needs enough epochs to make up for it
+    vector<string> files = binaryKernels(kinds);
+    size_t shard = max(MIN_SHARD_SIZE, files.size() * MIN_EPOCHS_PER_KERNEL);
+    size_t workers = min(processes, count / shard);
+    if (workers < 2) {
+      SPDLOG_DEBUG("Evaluating {} rows serially, {} binary kernels would be reopened by each worker", count, files.size());
+      std::lock_guard<std::mutex> lock(g_mutex);
+      g_skipped++;
+      return false;
+    }
+
+    // the rows, followed by a status per worker: 0 running, 1 done, 2 failed
+    size_t rows_bytes = count * width * sizeof(double);
+    size_t bytes = rows_bytes + workers;
+    void *shared = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+      SPDLOG_WARN("Could not map {} bytes for {} worker processes: {}", bytes, workers, strerror(errno));
+      std::lock_guard<std::mutex> lock(g_mutex);
+      g_failed++;
+      return false;
+    }
+    double *rows = static_cast<double *>(shared);
+    unsigned char *status = static_cast<unsigned char *>(shared) + rows_bytes;
+
+    SPDLOG_DEBUG("Evaluating {} rows on {} worker processes", count, workers);
+    bool ok = true;
+    vector<pid_t> pids;
+    for (size_t w = 0; w < workers; w++) {
+      size_t begin = count * w / workers;
+      size_t end = count * (w + 1) / workers;
+      pid_t pid = fork();
+      if (pid == 0) {
+        bool done = false;
+        try {
+          done = reopenBinaryKernels(files) && evaluate(begin, end, rows + begin * width);
+        }
+        catch (...) {
+          done = false;
+        }
+        status[w] = done ? 1 : 2;
+        // skip exit handlers and stdio buffers inherited from the caller
+        _exit(done ? 0 : 1);
+      }
+      if (pid < 0) {
+        SPDLOG_WARN("Could not fork a worker process: {}", strerror(errno));
+        ok = false;
+        break;
+      }
+      pids.push_back(pid);
+    }
+
+    for (size_t w = 0; w < pids.size(); w++) {
+      int wstatus = 0;
+      pid_t waited;
+      while ((waited = waitpid(pids[w], &wstatus, 0)) < 0 && errno == EINTR) {}
+      ok = ok && waited == pids[w] && WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0 && status[w] == 1;
+    }
+
+    if (ok) {
+      memcpy(out, rows, rows_bytes);
+    }
+    munmap(shared, bytes);
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_workers += pids.size();
+    g_reopened += pids.size() * files.size();
+    if (ok) {
+      g_runs++;
+      g_rows += count;
+    }
+    else {
+      SPDLOG_DEBUG("Worker processes failed, leaving {} rows to the caller", count);
+      g_failed++;
+    }
+    return ok;
+#endif
+  }
+
+
+  json EvaluationPool::stats() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    readProcesses();
+    return {{"processes", g_processes},
+            {"runs", g_runs},
+            {"rows", g_rows},
+            {"workers", g_workers},
+            {"reopened", g_reopened},
+            {"skipped", g_skipped},
+            {"failed", g_failed}};
+  }
+}
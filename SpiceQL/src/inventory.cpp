@@ -1,42 +1,257 @@
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <regex>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
+#if defined(__linux__)
+#include <fstream>
+#include <unistd.h>
+#endif
+
+#include <fmt/ranges.h>
 #include <nlohmann/json.hpp>
 #include <SpiceQL/spiceql_logging.h>
 #include <ghc/fs_std.hpp>
 #include <highfive/H5Easy.hpp>
 #include <highfive/highfive.hpp>
 
+#include <SpiceUsr.h>
+
+#include <SpiceQL/alias_map.h>
 #include <SpiceQL/inventory.h>
 #include <SpiceQL/inventoryimpl.h>
+#include <SpiceQL/prefetch.h>
+#include <SpiceQL/shared_index.h>
 #include <SpiceQL/spice_types.h>
 #include <SpiceQL/utils.h>
+#include <SpiceQL/config.h>
 
 using json = nlohmann::json;
 using namespace std; 
 
 namespace SpiceQL { 
     namespace Inventory { 
+        namespace {
+            // kernels furnished by preload, kept loaded for the life of the process
+            std::mutex g_preload_mutex;
+            unique_ptr<KernelSet> g_hot_kernels;
+
+            // time independent kernels searched for when pinning
+            // target SPKs are left out, binary kernels are only ordered by the sets using them
+            const vector<string> PINNED_KERNEL_TYPES = {"lsk", "pck", "fk", "ik", "iak", "sclk"};
+
+            // pinned search results by spiceql name, with paths relative to the data directory
+            std::mutex g_pinned_mutex;
+            vector<string> g_pinned_names;
+            map<string, json> g_pinned_kernels;
+            uint64_t g_pinned_generation = 0;
+
+            size_t residentMemoryBytes() {
+#if defined(__linux__)
+                size_t pages = 0, resident = 0;
+                std::ifstream statm("/proc/self/statm");
+                if (statm >> pages >> resident) {
+                    return resident * sysconf(_SC_PAGESIZE);
+                }
+#endif
+                return 0;
+            }
+
+            // Kernel set with the data directory stripped from full kernel paths
+            json relativeKernelSet(json kernels) {
+                string prefix = (fs::path(getDataDirectory()) / "").string();
+                for (auto &el : kernels.items()) {
+                    if (!el.value().is_array()) {
+                        continue;
+                    }
+                    for (auto &path : el.value()) {
+                        string p = path.get<string>();
+                        if (p.starts_with(prefix)) {
+                            path = p.substr(prefix.size());
+                        }
+                    }
+                }
+                return kernels;
+            }
+
+            // The recorded keyword set, if it was read from the given kernels
+            const json *recordedKeywordSet(const json *store, string keywordSet, json kernels) {
+                if (!store || !store->contains(keywordSet)) {
+                    return nullptr;
+                }
+                const json &set = store->at(keywordSet);
+                if (set.at("kernels") != relativeKernelSet(kernels)) {
+                    SPDLOG_TRACE("Recorded {} keywords were read from other kernels", keywordSet);
+                    return nullptr;
+                }
+                return &set;
+            }
+
+            // Searches and pins the time independent kernels of base and the missions.
+            // callers must hold g_pinned_mutex
+            json pinNames(vector<string> names) {
+                uint64_t generation = getDbGeneration();
+                InventoryImpl impl;
+                vector<Kernel::Type> types;
+                for (auto &type : PINNED_KERNEL_TYPES) {
+                    types.push_back(Kernel::translateType(type));
+                }
+
+                map<string, json> pinned_kernels;
+                json kernels;
+                for (auto &name : names) {
+                    json found = impl.search_for_kernelset(name, types, 0, 0, {}, {}, false, -1, -1);
+                    pinned_kernels[name] = found.is_null() ? json::object() : found;
+                    merge_json(kernels, found);
+                }
+
+                pinKernels(kernels);
+                g_pinned_names = names;
+                g_pinned_kernels = pinned_kernels;
+                g_pinned_generation = generation;
+                return json(pinned_kernels);
+            }
+
+            // Takes the types pinned for the name out of types and returns their
+            // kernels, null if the name is not pinned. Pins again when a new DB
+            // generation was published.
+            json takePinnedKernels(string name, vector<string> &types, bool full_kernel_path) {
+                std::lock_guard<std::mutex> lock(g_pinned_mutex);
+                if (g_pinned_names.empty()) {
+                    return nullptr;
+                }
+                if (getDbGeneration() != g_pinned_generation) {
+                    SPDLOG_DEBUG("DB generation changed, pinning kernels again");
+                    try {
+                        pinNames(g_pinned_names);
+                    }
+                    catch (exception &e) {
+                        SPDLOG_WARN("Could not pin kernels again, keeping the old ones: {}", e.what());
+                        g_pinned_generation = getDbGeneration();
+                    }
+                }
+
+                auto it = g_pinned_kernels.find(toLower(name));
+                if (it == g_pinned_kernels.end()) {
+                    return nullptr;
+                }
+                json kernels = json::object();
+                fs::path data_dir = getDataDirectory();
+                erase_if(types, [&](const string &type) {
+                    string key = toLower(type);
+                    if (find(PINNED_KERNEL_TYPES.begin(), PINNED_KERNEL_TYPES.end(), key) == PINNED_KERNEL_TYPES.end()) {
+                        return false;
+                    }
+                    if (it->second.contains(key)) {
+                        kernels[key] = it->second[key];
+                        if (full_kernel_path) {
+                            for (auto &e : kernels[key]) e = (data_dir / e.get<string>()).string();
+                        }
+                    }
+                    return true;
+                });
+                return kernels;
+            }
+
+            json searchKernelset(string instrument, vector<string> types, double start_time, double stop_time,
+                                 vector<string> ckQualities, vector<string> spkQualities, bool full_kernel_path,
+                                 int limit_ck, int limit_spk) {
+                json pinned = takePinnedKernels(instrument, types, full_kernel_path);
+                if (!pinned.is_null() && types.empty()) {
+                    return pinned;
+                }
+
+                InventoryImpl impl;
+
+                vector<Kernel::Quality> enum_ck_qualities = Kernel::translateQualities(ckQualities);
+                vector<Kernel::Quality> enum_spk_qualities = Kernel::translateQualities(spkQualities);
+
+                vector<Kernel::Type> enum_types;
+                for (auto &e:types) {
+                    enum_types.push_back(Kernel::translateType(e));
+                }
+
+                json kernels = impl.search_for_kernelset(instrument, enum_types, start_time, stop_time, enum_ck_qualities, enum_spk_qualities, full_kernel_path, limit_ck, limit_spk);
+                return merge_json(kernels, pinned);
+            }
+
+            // When a search moves forward in time, resolves the CKs and SPKs of the
+            // window after it and has the prefetcher read them. The window is
+            // resolved here rather than on the prefetch threads, from the time
+            // indices the search just cached, as HDF5 is not used concurrently.
+            void prefetchNextWindow(const vector<string> &names, const vector<string> &types, double start_time, double stop_time,
+                                    const vector<string> &ckQualities, const vector<string> &spkQualities,
+                                    int limit_ck, int limit_spk, const json &kernels) {
+                if (start_time == -numeric_limits<double>::max() || stop_time == numeric_limits<double>::max() ||
+                    !KernelPrefetcher::getThreads()) {
+                    return;
+                }
+                vector<Kernel::Type> time_types;
+                for (auto &type : types) {
+                    Kernel::Type t = Kernel::translateType(type);
+                    if (t == Kernel::Type::CK || t == Kernel::Type::SPK) {
+                        time_types.push_back(t);
+                    }
+                }
+                if (time_types.empty()) {
+                    return;
+                }
+
+                string key = fmt::format("{}|{}|{}|{}|{}|{}", fmt::join(names, ","), fmt::join(types, ","),
+                                         fmt::join(ckQualities, ","), fmt::join(spkQualities, ","), limit_ck, limit_spk);
+                double next_start, next_stop;
+                if (!KernelPrefetcher::observe(key, start_time, stop_time, kernels, next_start, next_stop)) {
+                    return;
+                }
+                try {
+                    InventoryImpl impl;
+                    json next = impl.search_for_kernelsets(names, time_types, next_start, next_stop,
+                                                           Kernel::translateQualities(ckQualities), Kernel::translateQualities(spkQualities),
+                                                           true, limit_ck, limit_spk, false);
+                    KernelPrefetcher::prefetch(next);
+                }
+                catch (exception &e) {
+                    SPDLOG_DEBUG("Could not resolve the kernels to prefetch: {}", e.what());
+                }
+            }
+        }
+
+
         json search_for_kernelset(string instrument, vector<string> types, double start_time, double stop_time,  
                                   vector<string> ckQualities, vector<string> spkQualities, bool full_kernel_path, 
                                   int limit_ck, int limit_spk) { 
-            InventoryImpl impl;
-            
-            vector<Kernel::Quality> enum_ck_qualities = Kernel::translateQualities(ckQualities);
-            vector<Kernel::Quality> enum_spk_qualities = Kernel::translateQualities(spkQualities);
-            
-            vector<Kernel::Type> enum_types;
-            for (auto &e:types) { 
-                enum_types.push_back(Kernel::translateType(e));
-            }
-
-            return impl.search_for_kernelset(instrument, enum_types, start_time, stop_time, enum_ck_qualities, enum_spk_qualities, full_kernel_path, limit_ck, limit_spk);
+            json kernels = searchKernelset(instrument, types, start_time, stop_time, ckQualities, spkQualities, full_kernel_path, limit_ck, limit_spk);
+            prefetchNextWindow({instrument}, types, start_time, stop_time, ckQualities, spkQualities, limit_ck, limit_spk, kernels);
+            return kernels;
         }
 
         json search_for_kernelsets(vector<string> spiceql_names, vector<string> types, double start_time, double stop_time, 
                                    vector<string> ckQualities, vector<string> spkQualities, bool full_kernel_path, 
                                    int limit_ck, int limit_spk, bool overwrite) { 
+            bool any_pinned;
+            {
+                std::lock_guard<std::mutex> lock(g_pinned_mutex);
+                any_pinned = !g_pinned_names.empty();
+            }
+            if (any_pinned) {
+                // each name's pinned types are taken from the pinned kernels
+                json kernels;
+                for (auto &name : spiceql_names) {
+                    json subKernels = searchKernelset(name, types, start_time, stop_time, ckQualities, spkQualities, full_kernel_path, limit_ck, limit_spk);
+                    merge_json(kernels, subKernels, overwrite);
+                }
+                prefetchNextWindow(spiceql_names, types, start_time, stop_time, ckQualities, spkQualities, limit_ck, limit_spk, kernels);
+                return kernels;
+            }
+
             InventoryImpl impl;
               
             vector<Kernel::Quality> enum_ck_qualities = Kernel::translateQualities(ckQualities);
@@ -48,6 +263,7 @@ namespace SpiceQL {
             } 
 
             json kernels = impl.search_for_kernelsets(spiceql_names, enum_types, start_time, stop_time, enum_ck_qualities, enum_spk_qualities, full_kernel_path, limit_ck, limit_spk, overwrite);
+            prefetchNextWindow(spiceql_names, types, start_time, stop_time, ckQualities, spkQualities, limit_ck, limit_spk, kernels);
             return kernels; 
         }
 
@@ -63,11 +279,17 @@ namespace SpiceQL {
             string hdf_file = getDbFilePath();
             fs::path data_dir = getDataDirectory();
 
-            if (!fs::exists(hdf_file)) { 
-            throw runtime_error("DB for kernels (" + hdf_file + ") does not exist");
-            }
-            
-            HighFive::File file(hdf_file, HighFive::File::ReadOnly);    
+            // open DB files, the served DB or mission shards, once each
+            map<string, shared_ptr<HighFive::File>> files;
+            auto openDbFile = [&](const string &path) {
+                if (!files.contains(path)) {
+                    if (!fs::exists(path)) { 
+                        throw runtime_error("DB for kernels (" + path + ") does not exist");
+                    }
+                    files[path] = make_shared<HighFive::File>(path, HighFive::File::ReadOnly);
+                }
+                return files[path];
+            };
             
             for(auto &e : list) { 
                 string temp;
@@ -80,12 +302,15 @@ namespace SpiceQL {
                 string key = p.parent_path().string();
                 string quality = "NA";
                 string kernel_type;
+                string mission;
 
                 std::vector<std::string> components;
                 int i = 0;
                 for (const auto& part : p.parent_path()) {
                     i++;
-                    if (i == 3)
+                    if (i == 2)
+                        mission = part.string();
+                    else if (i == 3)
                         kernel_type = part.string();
                     else if (i == 4)
                         quality = part.string();
@@ -93,29 +318,42 @@ namespace SpiceQL {
 
                 string regex = p.filename().string();
 
+                HighFive::File &file = *openDbFile(mission.empty() ? hdf_file : getDbFileForMission(mission));
+
                 string hdfkey = DB_SPICE_ROOT_KEY + key;
-                if (file.exist(hdfkey + "/" + DB_TIME_FILES_KEY)) {
-                    SPDLOG_TRACE("Is time Kernel"); 
-                    hdfkey += "/" + DB_TIME_FILES_KEY; 
-                }
-                
                 vector<string> file_names;
 
-                if (!file.exist(hdfkey)) 
-                    throw runtime_error("Key ["+hdfkey+"] does not exist");
-                try { 
-                    SPDLOG_TRACE("Loading {}", hdfkey);
+                if (file.exist(hdfkey + "/" + DB_TIME_RECORDS_KEY)) {
+                    SPDLOG_TRACE("Is v2 time Kernel"); 
+                    shared_ptr<TimeIndexedKernels> time_indices = getTimeIndexedKernels(key.substr(1), file.getName());
+                    if (!time_indices) {
+                        SPDLOG_ERROR("Exception while reading {}", hdfkey);
+                        continue;
+                    }
+                    file_names = time_indices->file_paths;
+                }
+                else {
+                    if (file.exist(hdfkey + "/" + DB_TIME_FILES_KEY)) {
+                        SPDLOG_TRACE("Is time Kernel"); 
+                        hdfkey += "/" + DB_TIME_FILES_KEY; 
+                    }
+
+                    if (!file.exist(hdfkey)) 
+                        throw runtime_error("Key ["+hdfkey+"] does not exist");
+                    try { 
+                        SPDLOG_TRACE("Loading {}", hdfkey);
 
-                    // get all the files under the key
-                    auto dataset = file.getDataSet(hdfkey);
-                    // allocate data 
-                    file_names = dataset.read<vector<string>>();    
-                    // load data into variable
-                    dataset.read(file_names);
-                } catch (exception &e) {  
-                    // if anything goes wrong, skip 
-                    SPDLOG_ERROR("Exception while reading {}: {}", hdfkey, e.what());
-                    continue;
+                        // get all the files under the key
+                        auto dataset = file.getDataSet(hdfkey);
+                        // allocate data 
+                        file_names = dataset.read<vector<string>>();    
+                        // load data into variable
+                        dataset.read(file_names);
+                    } catch (exception &e) {  
+                        // if anything goes wrong, skip 
+                        SPDLOG_ERROR("Exception while reading {}: {}", hdfkey, e.what());
+                        continue;
+                    }
                 }
 
                 // iterate through files and filter 
@@ -172,6 +410,278 @@ namespace SpiceQL {
             InventoryImpl db(true, mlist);
         }
 
+        void create_database_shards(vector<string> mlist) {
+            if (mlist.empty()) {
+                json globalConf = Config().globalConf();
+                for (auto &el : globalConf.items()) {
+                    mlist.push_back(el.key());
+                }
+            }
+            for (auto &mission : mlist) {
+                InventoryImpl::write_shard(mission);
+            }
+        }
+
+        void merge_database_shards(vector<string> shard_files) {
+            InventoryImpl::merge_shards(shard_files);
+        }
+
+        uint64_t getDbGeneration() {
+            return SpiceQL::getDbGeneration();
+        }
+
+        bool isDbReady() {
+            return SpiceQL::isDbReady();
+        }
+
+        void publishSharedIndex() {
+            SharedIndex::publish();
+        }
+
+        bool attachSharedIndex() {
+            return SharedIndex::attach();
+        }
+
+        void detachSharedIndex() {
+            SharedIndex::detach();
+        }
+
+        json getIndexedCkTimes(double start_time, double stop_time, int frame_code, string mission, json kernels) {
+            if (!kernels.contains("ck") || !kernels.contains("ck_quality") || kernels["ck"].empty()) {
+                return nullptr;
+            }
+            mission = toLower(mission);
+            string key = mission + "/ck/" + kernels["ck_quality"].get<string>();
+            string hdf_file = getDbFileForMission(mission);
+            shared_ptr<TimeIndexedKernels> time_indices = getTimeIndexedKernels(key, hdf_file);
+            shared_ptr<CkRecordIndex> ck_records = getCkRecordIndex(key, hdf_file);
+            if (!time_indices || !ck_records) {
+                SPDLOG_DEBUG("No CK record index for {}", key);
+                return nullptr;
+            }
+
+            unordered_map<string, uint32_t> kernel_ids;
+            for (size_t i = 0; i < time_indices->file_paths.size(); i++) {
+                kernel_ids[time_indices->file_paths[i]] = static_cast<uint32_t>(i);
+            }
+            unordered_set<uint32_t> unindexed(ck_records->unindexed.begin(), ck_records->unindexed.end());
+            fs::path data_dir = fs::absolute(getDataDirectory());
+
+            // Candidate segments in search order: the last loaded CK has the
+            // highest priority, each CK's segments are searched in file order.
+            int sp_code = (frame_code / 1000) * 1000;
+            vector<const CkSegment *> candidates;
+            // consolidated CKs hold their kernels' segments in the same order
+            vector<string> cks;
+            for (string ck : jsonArrayToVector(kernels["ck"])) {
+                if (kernels.contains("consolidated") && kernels["consolidated"].contains("ck") && kernels["consolidated"]["ck"].contains(ck)) {
+                    vector<string> sources = jsonArrayToVector(kernels["consolidated"]["ck"][ck]);
+                    cks.insert(cks.end(), sources.begin(), sources.end());
+                }
+                else {
+                    cks.push_back(ck);
+                }
+            }
+            for (auto ck = cks.rbegin(); ck != cks.rend(); ck++) {
+                string path = *ck;
+                if (fs::path(path).is_absolute()) {
+                    path = fs::relative(path, data_dir).string();
+                }
+                auto id = kernel_ids.find(path);
+                if (id == kernel_ids.end() || unindexed.contains(id->second)) {
+                    SPDLOG_DEBUG("{} is not in the CK record index of {}", *ck, key);
+                    return nullptr;
+                }
+                // segments are ordered by kernel
+                auto segment = lower_bound(ck_records->segments.begin(), ck_records->segments.end(), id->second,
+                                           [](const CkSegment &s, uint32_t kernel) { return s.kernel < kernel; });
+                for (; segment != ck_records->segments.end() && segment->kernel == id->second; segment++) {
+                    if (segment->instrument == sp_code) {
+                        candidates.push_back(&*segment);
+                    }
+                }
+            }
+
+            // Take the records from the segment covering the current time, one
+            // record before it through the first record at or after stop_time,
+            // and continue in the next segment if the window extends past it.
+            vector<double> times;
+            double current_time = start_time;
+            while (true) {
+                const CkSegment *segment = nullptr;
+                for (auto candidate : candidates) {
+                    if (candidate->start_et <= current_time && current_time <= candidate->stop_et
+                        && (times.empty() || candidate->stop_et > current_time)) {
+                        segment = candidate;
+                        break;
+                    }
+                }
+                if (!segment || segment->count == 0) {
+                    break;
+                }
+
+                const double *records = ck_records->record_ets.data() + segment->offset;
+                const double *records_end = records + segment->count;
+                size_t first = std::min<size_t>(lower_bound(records, records_end, current_time) - records, segment->count - 1);
+                if (first > 0) {
+                    first--;
+                }
+                size_t last = std::min<size_t>(lower_bound(records + first, records_end, stop_time) - records, segment->count - 1);
+                for (size_t i = first; i <= last; i++) {
+                    if (times.empty() || records[i] > times.back()) {
+                        times.push_back(records[i]);
+                    }
+                }
+
+                if (stop_time <= segment->stop_et) {
+                    break;
+                }
+                current_time = segment->stop_et;
+            }
+            return times;
+        }
+
+        json preload(vector<string> missions, bool furnish_kernels, int hot_kernels) {
+            json report;
+            report["stages"] = json::array();
+            report["warm"] = true;
+            auto total_start = chrono::steady_clock::now();
+
+            auto stage = [&report](string name, function<json()> load) {
+                json result;
+                size_t rss_before = residentMemoryBytes();
+                auto start = chrono::steady_clock::now();
+                try {
+                    result = load();
+                }
+                catch (exception &e) {
+                    SPDLOG_WARN("Preload stage {} failed: {}", name, e.what());
+                    result["error"] = e.what();
+                    report["warm"] = false;
+                }
+                result["stage"] = name;
+                result["seconds"] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                result["rss_delta_bytes"] = (long long)residentMemoryBytes() - (long long)rss_before;
+                SPDLOG_DEBUG("Preload stage {}: {}", name, result.dump());
+                report["stages"].push_back(result);
+            };
+
+            stage("config", [&missions]() {
+                json globalConf = Config().globalConf();
+                if (missions.empty()) {
+                    for (auto &el : globalConf.items()) {
+                        missions.push_back(el.key());
+                    }
+                }
+                for (auto &mission : missions) {
+                    mission = toLower(mission);
+                    if (!globalConf.contains(mission)) {
+                        throw runtime_error("Mission [" + mission + "] is not an acceptable mission name.");
+                    }
+                }
+                return json({{"entries", globalConf.size()}});
+            });
+            report["missions"] = missions;
+
+            stage("alias_map", []() {
+                return json({{"entries", AliasMap::instance().getAliasMap().size()}});
+            });
+
+            stage("frame_cache", []() {
+                InventoryImpl impl;
+                size_t frames = impl.getFrameList().size();
+                impl.getFrameName(0);
+                return json({{"entries", frames}});
+            });
+
+            stage("time_indices", [&missions]() {
+                shared_ptr<const SharedIndex> shared_index = SharedIndex::current();
+                string db_file = (fs::path(getCacheDir()) / DB_HDF_FILE).string();
+                size_t keys = 0;
+                vector<string> shared;
+                for (auto &mission : missions) {
+                    if (shared_index && getDbFileForMission(mission) == db_file) {
+                        shared.push_back(mission);
+                        continue;
+                    }
+                    keys += preloadTimeIndices(mission);
+                }
+                return json({{"keys", keys}, {"shared_index_missions", shared}});
+            });
+
+            if (furnish_kernels) {
+                stage("furnish", [&missions]() {
+                    pinMissionKernels(missions);
+                    return json({{"kernels", getPinnedKernels().size()}});
+                });
+            }
+
+            if (hot_kernels > 0) {
+                stage("hot_kernels", [hot_kernels]() {
+                    size_t furnished = 0;
+                    std::lock_guard<std::mutex> lock(g_preload_mutex);
+                    g_hot_kernels.reset();
+                    vector<string> paths;
+                    for (auto &entry : getHotKernels(hot_kernels)["kernels"]) {
+                        string path = entry["kernel"];
+                        if (!fs::exists(path) && !fs::exists(fs::path(getDataDirectory()) / path)) {
+                            SPDLOG_DEBUG("Skipping hot kernel {}, it no longer exists", path);
+                            continue;
+                        }
+                        paths.push_back(path);
+                    }
+                    // a KernelSet, so requests for these kernels share them instead of unloading them
+                    g_hot_kernels = make_unique<KernelSet>(json({{"hot", paths}}));
+                    furnished = g_hot_kernels->m_loadedKernels.size();
+                    return json({{"kernels", furnished}});
+                });
+            }
+
+            report["seconds"] = chrono::duration<double>(chrono::steady_clock::now() - total_start).count();
+            report["rss_bytes"] = residentMemoryBytes();
+            SPDLOG_INFO("Preloaded {} missions in {}s, warm: {}", missions.size(), report["seconds"].get<double>(), report["warm"].get<bool>());
+            return report;
+        }
+
+        json pinMissionKernels(vector<string> missions) {
+            json globalConf = Config().globalConf();
+            vector<string> names = {"base"};
+            for (auto &mission : missions) {
+                mission = toLower(mission);
+                if (!globalConf.contains(mission)) {
+                    throw runtime_error("Mission [" + mission + "] is not an acceptable mission name.");
+                }
+                if (find(names.begin(), names.end(), mission) == names.end()) {
+                    names.push_back(mission);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(g_pinned_mutex);
+            json pinned = pinNames(names);
+            SPDLOG_INFO("Pinned {} kernels for {}", getPinnedKernels().size(), fmt::join(names, ", "));
+            return pinned;
+        }
+
+        void unpinMissionKernels() {
+            std::lock_guard<std::mutex> lock(g_pinned_mutex);
+            g_pinned_names.clear();
+            g_pinned_kernels.clear();
+            unpinKernels();
+        }
+
+        vector<string> getPinnedMissions() {
+            std::lock_guard<std::mutex> lock(g_pinned_mutex);
+            return g_pinned_names;
+        }
+
+        void setKernelPrefetch(size_t threads) {
+            KernelPrefetcher::setThreads(threads);
+        }
+
+        json getKernelPrefetchStats() {
+            return KernelPrefetcher::stats();
+        }
+
         vector<string> getFrameList() {
             InventoryImpl impl;
             return impl.getFrameList();
@@ -182,9 +692,64 @@ namespace SpiceQL {
             return impl.getFrameName(code);
         }
 
+        json getFrameNameMapFromCache() {
+            InventoryImpl impl;
+            json frames = json::object();
+            for (auto &[code, name] : impl.getFrameNameMap()) {
+                frames[to_string(code)] = name;
+            }
+            return frames;
+        }
+
         int getFrameCodeFromCache(string name) {
             InventoryImpl impl;
             return impl.getFrameCode(name);
         }
+
+        json getFrameInfoFromCache(int code, string mission) {
+            shared_ptr<const unordered_map<int, FrameDefinition>> frame_defs = getFrameDefinitions(mission);
+            if (!frame_defs || !frame_defs->contains(code)) {
+                return nullptr;
+            }
+            const FrameDefinition &def = frame_defs->at(code);
+            json info = {{"center", def.center}, {"class", def.frame_class}, {"class_id", def.class_id}};
+            if (def.frame_class == 4) {
+                info["tk_parent"] = def.tk_parent;
+                info["tk_rotation"] = def.tk_rotation;
+            }
+            return info;
+        }
+
+        json findKeywordsFromCache(string keytpl, string mission, string keywordSet, json kernels) {
+            shared_ptr<const json> store = getKeywordStore(mission);
+            const json *set = recordedKeywordSet(store.get(), keywordSet, kernels);
+            if (!set) {
+                return nullptr;
+            }
+
+            const json &keywords = set->at("keywords");
+            json found = json::object();
+            if (keytpl.find_first_of("*%") == string::npos) {
+                if (keywords.contains(keytpl)) {
+                    found[keytpl] = keywords.at(keytpl);
+                }
+                return found;
+            }
+            for (auto &[key, value] : keywords.items()) {
+                if (matchw_c(key.c_str(), keytpl.c_str(), '*', '%')) {
+                    found[key] = value;
+                }
+            }
+            return found;
+        }
+
+        json getTargetFrameFromCache(int targetId, string mission, json kernels) {
+            shared_ptr<const json> store = getKeywordStore(mission);
+            const json *set = recordedKeywordSet(store.get(), "frames", kernels);
+            if (!set || !set->at("targets").contains(to_string(targetId))) {
+                return nullptr;
+            }
+            return set->at("targets").at(to_string(targetId));
+        }
     }
 }
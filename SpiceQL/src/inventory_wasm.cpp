@@ -81,6 +81,67 @@ namespace SpiceQL {
                 "create_database is unavailable in the WASM build (no HDF5 inventory).");
         }
 
+        void create_database_shards(vector<string> /*mlist*/) {
+            throw runtime_error(
+                "create_database_shards is unavailable in the WASM build (no HDF5 inventory).");
+        }
+
+        void merge_database_shards(vector<string> /*shard_files*/) {
+            throw runtime_error(
+                "merge_database_shards is unavailable in the WASM build (no HDF5 inventory).");
+        }
+
+        uint64_t getDbGeneration() {
+            // No database is ever published in the WASM build.
+            return 0;
+        }
+
+        bool isDbReady() {
+            return false;
+        }
+
+        void publishSharedIndex() {
+            throw runtime_error(
+                "publishSharedIndex is unavailable in the WASM build (no HDF5 inventory).");
+        }
+
+        bool attachSharedIndex() {
+            return false;
+        }
+
+        void detachSharedIndex() {}
+
+        json getIndexedCkTimes(double /*start_time*/, double /*stop_time*/, int /*frame_code*/,
+                               string /*mission*/, json /*kernels*/) {
+            // No record index; callers read the CKs directly.
+            return nullptr;
+        }
+
+        json preload(vector<string> missions, bool /*furnish_kernels*/, int /*hot_kernels*/) {
+            // Nothing to warm up without an HDF5 inventory.
+            return {{"missions", missions}, {"stages", json::array()}, {"warm", true}, {"seconds", 0.0}, {"rss_bytes", 0}};
+        }
+
+        json pinMissionKernels(vector<string> /*missions*/) {
+            throw runtime_error(kSearchUnavailableMsg);
+        }
+
+        void unpinMissionKernels() {}
+
+        vector<string> getPinnedMissions() {
+            // Nothing can be pinned without an HDF5 inventory.
+            return {};
+        }
+
+        void setKernelPrefetch(size_t /*threads*/) {
+            // Nothing is searched, so there is nothing to read ahead.
+        }
+
+        json getKernelPrefetchStats() {
+            return {{"threads", 0}, {"queued", 0}, {"read", 0}, {"bytes", 0}, {"hits", 0}, {"late", 0},
+                    {"misses", 0}, {"hit_rate", 0.0}, {"dropped", 0}, {"failed", 0}};
+        }
+
         vector<string> getFrameList() {
             // No cached frame list; callers fall back to CSPICE lookups.
             return {};
@@ -91,9 +152,28 @@ namespace SpiceQL {
             return "";
         }
 
+        json getFrameNameMapFromCache() {
+            // No cached map; callers fall back to NAIF lookups.
+            return json::object();
+        }
+
         int getFrameCodeFromCache(string /*name*/) {
             // Zero => not found; caller falls through to NAIF lookups.
             return 0;
         }
+
+        json getFrameInfoFromCache(int /*code*/, string /*mission*/) {
+            // No recorded frames; callers fall back to frinfo_c.
+            return nullptr;
+        }
+
+        json findKeywordsFromCache(string /*keytpl*/, string /*mission*/, string /*keywordSet*/, json /*kernels*/) {
+            // No recorded keywords; callers fall back to the kernel pool.
+            return nullptr;
+        }
+
+        json getTargetFrameFromCache(int /*targetId*/, string /*mission*/, json /*kernels*/) {
+            return nullptr;
+        }
     }
 }
@@ -1,6 +1,11 @@
 #include <iostream>
 #include <regex>
 #include <mutex>
+#include <memory>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <set>
 #include <unordered_map>
 
 // we need to include this to overwrite and other std::fs imports
@@ -30,12 +35,30 @@ namespace stdpmr = std::pmr;
 #include <highfive/highfive.hpp>
 
 #include <SpiceUsr.h>
+#include <SpiceZfc.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>  // LockFileEx
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>  // flock
+#include <unistd.h>
+#endif
 
 #include <SpiceQL/config.h>
 #include <SpiceQL/inventoryimpl.h>
 #include <SpiceQL/utils.h>
 #include <SpiceQL/query.h>
 #include <SpiceQL/memo.h>
+#include <SpiceQL/shared_index.h>
 #include <SpiceQL/spiceql_version.h>
 
 using json = nlohmann::json;
@@ -49,6 +72,52 @@ namespace fc = frozenca;
 #endif 
 
 
+namespace SpiceQL {
+  // One kernel of a layout v2 time index: delta encoded start/stop time bits
+  // and the kernel's index in the mission path table.
+  struct KernelTimeRecord {
+    int64_t start;
+    int64_t stop;
+    uint32_t path;
+  };
+
+  // One row of a mission's frame table, TK rotations are stored alongside.
+  struct FrameRecord {
+    int32_t code;
+    int32_t center;
+    int32_t frame_class;
+    int32_t class_id;
+    int32_t tk_parent;
+  };
+}
+
+static HighFive::CompoundType createKernelTimeRecordType() {
+  return {{"start", HighFive::create_datatype<int64_t>()},
+          {"stop", HighFive::create_datatype<int64_t>()},
+          {"path", HighFive::create_datatype<uint32_t>()}};
+}
+HIGHFIVE_REGISTER_TYPE(SpiceQL::KernelTimeRecord, createKernelTimeRecordType)
+
+static HighFive::CompoundType createCkSegmentType() {
+  return {{"kernel", HighFive::create_datatype<uint32_t>()},
+          {"instrument", HighFive::create_datatype<int32_t>()},
+          {"start_et", HighFive::create_datatype<double>()},
+          {"stop_et", HighFive::create_datatype<double>()},
+          {"offset", HighFive::create_datatype<uint64_t>()},
+          {"count", HighFive::create_datatype<uint64_t>()}};
+}
+HIGHFIVE_REGISTER_TYPE(SpiceQL::CkSegment, createCkSegmentType)
+
+static HighFive::CompoundType createFrameRecordType() {
+  return {{"code", HighFive::create_datatype<int32_t>()},
+          {"center", HighFive::create_datatype<int32_t>()},
+          {"frame_class", HighFive::create_datatype<int32_t>()},
+          {"class_id", HighFive::create_datatype<int32_t>()},
+          {"tk_parent", HighFive::create_datatype<int32_t>()}};
+}
+HIGHFIVE_REGISTER_TYPE(SpiceQL::FrameRecord, createFrameRecordType)
+
+
 namespace SpiceQL { 
 
   string DB_SPICE_ROOT_KEY = "spice";
@@ -62,6 +131,29 @@ namespace SpiceQL {
   string DB_FRAME_LIST_KEY = "spql_cache/frame_list";
   string DB_FRAME_CODES_KEY = "spql_cache/frame_codes";
   string DB_FRAME_NAMES_KEY = "spql_cache/frame_names";
+  string DB_GENERATION_KEY = "SPICEQL_DB_GENERATION";
+  string DB_MISSIONS_KEY = "SPICEQL_DB_MISSIONS";
+  string DB_LOCK_FILE = "spiceqldb.lock";
+  string DB_SHARD_DIR = "shards";
+  string DB_LAYOUT_KEY = "SPICEQL_DB_LAYOUT";
+  string DB_TIME_RECORDS_KEY = "records";
+  string DB_PATH_TABLE_KEY = "spql_paths";
+  const int DB_LAYOUT_VERSION = 2;
+  string DB_CK_SEGMENTS_KEY = "ck_segments";
+  string DB_CK_RECORD_TIMES_KEY = "ck_record_times";
+  string DB_CK_UNINDEXED_KEY = "ck_unindexed";
+  string DB_FRAME_DEFS_KEY = "spql_frames";
+  string DB_FRAME_ROTATIONS_KEY = "spql_frame_rotations";
+  string DB_KEYWORDS_KEY = "spql_keywords";
+  string DB_CONSOLIDATED_FILES_KEY = "consolidated_files";
+  string DB_CONSOLIDATED_IDS_KEY = "consolidated_ids";
+  string DB_CONSOLIDATED_DIR = "consolidated";
+  string CONSOLIDATE_ENV_VAR = "SPICEQL_CONSOLIDATE_KERNELS";
+  string CONSOLIDATE_PERIOD_ENV_VAR = "SPICEQL_CONSOLIDATE_DAYS";
+  string CONSOLIDATE_MAX_SIZE_ENV_VAR = "SPICEQL_CONSOLIDATE_MAX_MB";
+  // records per chunk of a v2 time index, and the deflate level applied to them
+  static const hsize_t DB_RECORD_CHUNK_SIZE = 4096;
+  static const unsigned DB_DEFLATE_LEVEL = 1;
   string CACHE_DIR_ENV_VAR = "SPICEQL_CACHE_DIR";
   static std::string  CACHE_DIRECTORY = "";
 
@@ -84,8 +176,7 @@ namespace SpiceQL {
     }
     else {
       SPDLOG_DEBUG("Cache directory not set and not in environment variable " + CACHE_DIR_ENV_VAR + " and not overridden.");
-      std::string tempname = "spiceql-cache-" + gen_random(10);
-      CACHE_DIRECTORY = (fs::temp_directory_path() / tempname / "spiceql_cache").string();
+      CACHE_DIRECTORY = getDefaultCacheDir();
     }
 
     if (!fs::is_directory(CACHE_DIRECTORY)) {
@@ -114,10 +205,214 @@ namespace SpiceQL {
       static std::string db_path = (fs::path(getCacheDir()) / DB_HDF_FILE).string();
       return db_path;
   }
+
+
+  namespace {
+    std::mutex g_db_state_mutex;
+    std::string g_db_stamp;  // "<path>@<write-time>@<size>" of the last DB seen
+    uint64_t g_db_generation = 0;
+
+    // The DB is only ever replaced by renaming a finished file over it, so a
+    // changed stamp means a new generation has been published.
+    string dbFileStamp(const string &hdf_file) {
+      string stamp = hdf_file;
+      try {
+        if (fs::exists(hdf_file)) {
+          stamp += "@" + std::to_string(
+              static_cast<long long>(fs::last_write_time(hdf_file).time_since_epoch().count()));
+          stamp += "@" + std::to_string(static_cast<unsigned long long>(fs::file_size(hdf_file)));
+        }
+      } catch (...) { /* fall through with path-only stamp */ }
+      return stamp;
+    }
+
+
+    // Read a root attribute of the DB, returning fallback if the DB or the
+    // attribute is missing or unreadable.
+    template<class T>
+    T readDbAttribute(const string &hdf_file, const string &name, T fallback) {
+      try {
+        if (!fs::exists(hdf_file)) {
+          return fallback;
+        }
+        HighFive::File file(hdf_file, HighFive::File::ReadOnly);
+        if (!file.hasAttribute(name)) {
+          return fallback;
+        }
+        T value;
+        file.getAttribute(name).read(value);
+        return value;
+      }
+      catch (exception &e) {
+        SPDLOG_DEBUG("Could not read {} from {}: {}", name, hdf_file, e.what());
+        return fallback;
+      }
+    }
+
+
+    uint64_t readDbGeneration(const string &hdf_file) {
+      return readDbAttribute<uint64_t>(hdf_file, DB_GENERATION_KEY, 0);
+    }
+
+
+    // Missions a DB was built for, as stored in DB_MISSIONS_KEY.
+    string missionsAttribute(const vector<string> &missions) {
+      if (missions.empty()) {
+        return "*";
+      }
+      vector<string> sorted_missions = missions;
+      sort(sorted_missions.begin(), sorted_missions.end());
+      string joined;
+      for (auto &m : sorted_missions) {
+        joined += (joined.empty() ? "" : ",") + m;
+      }
+      return joined;
+    }
+
+
+    // Exclusive advisory lock on a file, held for the lifetime of the object.
+    // Only DB writers take it; readers never need to because the DB is
+    // published by rename.
+    class DbBuildLock {
+      public:
+      DbBuildLock(const fs::path &lock_file) {
+#ifdef _WIN32
+        m_handle = CreateFileW(lock_file.wstring().c_str(), GENERIC_READ | GENERIC_WRITE,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                               OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_handle == INVALID_HANDLE_VALUE) {
+          throw runtime_error("Could not open DB lock file [" + lock_file.string() + "].");
+        }
+        OVERLAPPED overlapped = {};
+        if (!LockFileEx(m_handle, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped)) {
+          CloseHandle(m_handle);
+          throw runtime_error("Could not lock DB lock file [" + lock_file.string() + "].");
+        }
+#else
+        m_fd = open(lock_file.string().c_str(), O_RDWR | O_CREAT, 0666);
+        if (m_fd < 0) {
+          throw runtime_error("Could not open DB lock file [" + lock_file.string() + "]: " + strerror(errno));
+        }
+        int rc;
+        do {
+          rc = flock(m_fd, LOCK_EX);
+        } while (rc != 0 && errno == EINTR);
+        if (rc != 0) {
+          string err = strerror(errno);
+          close(m_fd);
+          throw runtime_error("Could not lock DB lock file [" + lock_file.string() + "]: " + err);
+        }
+#endif
+      }
+
+      ~DbBuildLock() {
+#ifdef _WIN32
+        OVERLAPPED overlapped = {};
+        UnlockFileEx(m_handle, 0, MAXDWORD, MAXDWORD, &overlapped);
+        CloseHandle(m_handle);
+#else
+        flock(m_fd, LOCK_UN);
+        close(m_fd);
+#endif
+      }
+
+      DbBuildLock(const DbBuildLock &) = delete;
+      DbBuildLock &operator=(const DbBuildLock &) = delete;
+
+      private:
+#ifdef _WIN32
+      HANDLE m_handle;
+#else
+      int m_fd;
+#endif
+    };
+
+
+    // Write the next generation of a DB file under a temporary name next to it
+    // and rename it into place once it is complete, so readers only ever see
+    // the old or the new file, never a missing or half-written one.
+    void publishDbFile(const fs::path &hdf_file, const function<void(const string &, uint64_t)> &writer) {
+      uint64_t generation = readDbGeneration(hdf_file.string()) + 1;
+      fs::path tmp_file = hdf_file.parent_path() / (hdf_file.filename().string() + "." + std::to_string(generation) + "-" + gen_random(10) + ".tmp");
+      SPDLOG_DEBUG("Writing DB generation {} to {}", generation, tmp_file.string());
+
+      try {
+        writer(tmp_file.string(), generation);
+        fs::rename(tmp_file, hdf_file);
+      }
+      catch (exception &e) {
+        std::error_code ec;
+        fs::remove(tmp_file, ec);
+        throw runtime_error("Failed to publish DB [" + hdf_file.string() + "]: " + e.what());
+      }
+      SPDLOG_DEBUG("Published DB generation {} at {}", generation, hdf_file.string());
+    }
+
+
+    // Stat the DB and return its stamp, re-reading the generation if it was
+    // republished. In-memory caches remember the stamp they were filled from
+    // and drop themselves when they see a different one.
+    string syncDbState() {
+      string hdf_file = (fs::path(getCacheDir()) / DB_HDF_FILE).string();
+      string stamp = dbFileStamp(hdf_file);
+
+      std::lock_guard<std::mutex> lock(g_db_state_mutex);
+      if (stamp != g_db_stamp) {
+        g_db_generation = readDbGeneration(hdf_file);
+        g_db_stamp = stamp;
+        SPDLOG_DEBUG("DB [{}] is at generation {}", hdf_file, g_db_generation);
+      }
+      return stamp;
+    }
+  }
+
+
+  uint64_t getDbGeneration() {
+    syncDbState();
+    std::lock_guard<std::mutex> lock(g_db_state_mutex);
+    return g_db_generation;
+  }
+
+
+  bool isDbReady() {
+    string hdf_file = (fs::path(getCacheDir()) / DB_HDF_FILE).string();
+    string version = readDbAttribute<string>(hdf_file, "SPICEQL_VERSION", "");
+    if (version.empty()) {
+      SPDLOG_DEBUG("DB [{}] is missing or unreadable", hdf_file);
+      return false;
+    }
+    if (version != SPICEQL_VERSION) {
+      SPDLOG_DEBUG("DB [{}] was built by SpiceQL {}, this is {}", hdf_file, version, SPICEQL_VERSION);
+      return false;
+    }
+    return true;
+  }
+
+
+  string getShardFile(string mission) {
+    return (fs::path(getCacheDir()) / DB_SHARD_DIR / (toLower(mission) + ".hdf")).string();
+  }
+
+
+  string getDbFileForMission(string mission) {
+    string hdf_file = (fs::path(getCacheDir()) / DB_HDF_FILE).string();
+    string shard_file = getShardFile(mission);
+
+    // A shard rebuilt after the last merge is served directly until the next merge.
+    std::error_code ec;
+    if (!fs::exists(shard_file, ec)) {
+      return hdf_file;
+    }
+    if (!fs::exists(hdf_file, ec) || fs::last_write_time(shard_file, ec) > fs::last_write_time(hdf_file, ec)) {
+      SPDLOG_TRACE("Reading {} from shard {}", mission, shard_file);
+      return shard_file;
+    }
+    return hdf_file;
+  }
   
 
   // objs need to be passed in c-style because of a lack of copy contructor in BtreeMap
-  void collectStartStopTimes(string mission, string type, string quality, TimeIndexedKernels *kernel_times) { 
+  void collectStartStopTimes(string mission, string type, string quality, TimeIndexedKernels *kernel_times, CkRecordIndex *ck_records = nullptr) { 
     SPDLOG_TRACE("In globTimeIntervals.");
     Config conf;
     conf = conf[mission];
@@ -158,6 +453,20 @@ namespace SpiceQL {
           fs::path relative_path_kernel = fs::relative(kernel, fs::absolute(getDataDirectory()));
           SPDLOG_TRACE("Relative Kernel: {}", relative_path_kernel.generic_string()); 
           kernel_times->file_paths.push_back(relative_path_kernel.string());
+
+          if (ck_records) {
+            try {
+              for (auto &segment : getCkRecordTimes(kernel)) {
+                ck_records->segments.push_back({static_cast<uint32_t>(index), segment.instrument, segment.start_et, segment.stop_et,
+                                                ck_records->record_ets.size(), segment.record_ets.size()});
+                ck_records->record_ets.insert(ck_records->record_ets.end(), segment.record_ets.begin(), segment.record_ets.end());
+              }
+            }
+            catch (exception &e) {
+              SPDLOG_DEBUG("Could not index the records of {}: {}", std::string(kernel), e.what());
+              ck_records->unindexed.push_back(static_cast<uint32_t>(index));
+            }
+          }
         }
       }
     }
@@ -175,7 +484,7 @@ namespace SpiceQL {
   }
 
 
-  void InventoryImpl::collectFrameInfo() {
+  void InventoryImpl::collectFrameInfo(vector<string> missions) {
     Config config;
 
     // Frame list = the top-level config keys (deps only merge into existing
@@ -193,6 +502,9 @@ namespace SpiceQL {
     // is the slow, one-time work that runtime resolution then avoids.
     for (auto &el : globalConf.items()) {
       string mission = el.key();
+      if (!missions.empty() && find(missions.begin(), missions.end(), mission) == missions.end()) {
+        continue;
+      }
       json textKernels;
       try {
         textKernels = getLatestKernels(config[mission].getRecursive("fk"));
@@ -242,6 +554,7 @@ namespace SpiceQL {
       kplfrm_c(SPICE_FRMTYP_ALL, &idset);
       checkNaifErrors();
       SpiceInt nframes = card_c(&idset);
+      vector<FrameDefinition> &frame_defs = m_frame_defs[mission];
       for (SpiceInt i = 0; i < nframes; i++) {
         SpiceInt fcode = SPICE_CELL_ELEM_I(&idset, i);
         SpiceChar fname[128];
@@ -249,8 +562,30 @@ namespace SpiceQL {
         if (strlen(fname) > 0) {
           insertFramePair((int)fcode, string(fname), m_frame_codes, m_frame_names, seen_codes);
         }
+
+        // Record the frame itself so getFrameInfo and the TK links of
+        // frameTrace need no kernels at runtime.
+        FrameDefinition def = {};
+        SpiceBoolean found = SPICEFALSE;
+        frinfo_c(fcode, (SpiceInt *)&def.center, (SpiceInt *)&def.frame_class, (SpiceInt *)&def.class_id, &found);
+        checkNaifErrors();
+        if (!found) {
+          continue;
+        }
+        def.code = (int)fcode;
+        if (def.frame_class == 4) {
+          logical tk_found = 0;
+          tkfram_((SpiceInt *)&def.class_id, def.tk_rotation.data(), (SpiceInt *)&def.tk_parent, &tk_found);
+          checkNaifErrors();
+          if (!tk_found) {
+            SPDLOG_TRACE("collectFrameInfo: no TK rotation for frame {}", (int)fcode);
+            continue;
+          }
+        }
+        frame_defs.push_back(def);
       }
       checkNaifErrors();
+      SPDLOG_TRACE("collectFrameInfo: {} frame definitions for {}", frame_defs.size(), mission);
     }
 
     SPDLOG_DEBUG("collectFrameInfo: {} frames in list, {} code<->name pairs",
@@ -258,6 +593,337 @@ namespace SpiceQL {
   }
 
 
+  // Relative paths of a time independent kernel type's latest kernels. When
+  // the type has several kernel lists the last one is kept.
+  static vector<string> textKernelPaths(json &kernel_obj) {
+    vector<string> kernel_vec;
+    vector<json::json_pointer> ptrs = findKeyInJson(kernel_obj, "kernels", true); 
+
+    for (auto &ptr : ptrs) { 
+      kernel_vec.clear();
+
+      // Doing it bracketless, there are too many brackets
+      for (auto &subarr: kernel_obj[ptr]) 
+        for (auto &kernel : subarr) { 
+          string k = kernel.get<string>();
+          fs::path relative_path_kernel = fs::relative(k, fs::absolute(getDataDirectory()));
+          SPDLOG_TRACE("Relative Kernel: {}", relative_path_kernel.generic_string()); 
+          kernel_vec.push_back(relative_path_kernel.string());
+        } 
+    }
+    return kernel_vec;
+  }
+
+
+  // Keywords the furnished kernels added to or changed in the pool
+  static json addedKeywords(const json &baseline) {
+    json keywords = json::object();
+    json pool = findKeywords("*");
+    if (pool.is_null()) {
+      return keywords;
+    }
+    for (auto &[key, value] : pool.items()) {
+      if (!baseline.contains(key) || baseline.at(key) != value) {
+        keywords[key] = value;
+      }
+    }
+    return keywords;
+  }
+
+
+  // cidfrm_c frame of every body named by the loaded kernels or by a frame center
+  static json targetFrames() {
+    set<int> bodies;
+
+    json codes = findKeywords("NAIF_BODY_CODE");
+    if (!codes.is_null()) {
+      json values = codes["NAIF_BODY_CODE"];
+      for (auto &code : values.is_array() ? values : json::array({values})) {
+        if (code.is_number()) {
+          bodies.insert(static_cast<int>(code.get<double>()));
+        }
+      }
+    }
+
+    // OBJECT_<id or name>_FRAME overrides
+    json objects = findKeywords("OBJECT_*_FRAME");
+    if (!objects.is_null()) {
+      for (auto &[key, value] : objects.items()) {
+        string body = key.substr(7, key.size() - 13);
+        SpiceInt code;
+        SpiceBoolean found = SPICEFALSE;
+        bods2c_c(body.c_str(), &code, &found);
+        checkNaifErrors();
+        if (found) {
+          bodies.insert(code);
+        }
+      }
+    }
+
+    SPICEINT_CELL(idset, 10000);
+    scard_c(0, &idset);
+    bltfrm_c(SPICE_FRMTYP_ALL, &idset);
+    kplfrm_c(SPICE_FRMTYP_ALL, &idset);
+    checkNaifErrors();
+    for (SpiceInt i = 0; i < card_c(&idset); i++) {
+      SpiceInt center, frame_class, class_id;
+      SpiceBoolean found = SPICEFALSE;
+      frinfo_c(SPICE_CELL_ELEM_I(&idset, i), &center, &frame_class, &class_id, &found);
+      checkNaifErrors();
+      if (found) {
+        bodies.insert(center);
+      }
+    }
+
+    json targets = json::object();
+    for (int body : bodies) {
+      SpiceInt frame_code;
+      SpiceChar frame_name[128];
+      SpiceBoolean found = SPICEFALSE;
+      cidfrm_c(body, 128, &frame_code, frame_name, &found);
+      checkNaifErrors();
+      if (found) {
+        targets[to_string(body)] = {{"frameCode", frame_code}, {"frameName", frame_name}};
+      }
+    }
+    return targets;
+  }
+
+
+  void InventoryImpl::collectKeywords(Config &config, vector<string> missions) {
+    // Time independent kernels keyed like m_nontimedep_kerns, adding the
+    // missions this inventory was not built for (e.g. base for a shard)
+    map<string, vector<string>> text_kernels = m_nontimedep_kerns;
+    set<string> collected;
+    auto textKernels = [&](vector<string> names, vector<string> types) {
+      json kernels;
+      for (auto &name : names) {
+        bool indexed = m_missions.empty() || find(m_missions.begin(), m_missions.end(), name) != m_missions.end();
+        if (!indexed && !collected.contains(name) && config.contains(name)) {
+          collected.insert(name);
+          json latest = getLatestKernels(config.get(vector<string>{name}));
+          if (latest.contains(name)) {
+            for (auto &[kernel_type, kernel_obj] : latest[name].items()) {
+              if (kernel_type == "ck" || kernel_type == "spk") {
+                continue;
+              }
+              text_kernels[name + "/" + kernel_type] = textKernelPaths(kernel_obj);
+            }
+          }
+        }
+
+        // same shape and merge as search_for_kernelsets
+        json subKernels;
+        for (auto &type : types) {
+          auto it = text_kernels.find(name + "/" + type);
+          if (it != text_kernels.end() && !it->second.empty()) {
+            subKernels[type] = it->second;
+          }
+        }
+        merge_json(kernels, subKernels);
+      }
+      return kernels;
+    };
+
+    json globalConf = config.globalConf();
+    for (auto &el : globalConf.items()) {
+      string mission = el.key();
+      if (!missions.empty() && find(missions.begin(), missions.end(), mission) == missions.end()) {
+        continue;
+      }
+
+      json store;
+      try {
+        json baseline = findKeywords("*");
+
+        json kernels = textKernels({mission}, {"iak", "fk", "ik"});
+        if (!kernels.is_null()) {
+          KernelSet ks(kernels);
+          store["mission"] = {{"kernels", kernels}, {"keywords", addedKeywords(baseline)}};
+        }
+
+        kernels = textKernels({mission, "base"}, {"pck"});
+        if (!kernels.is_null()) {
+          KernelSet ks(kernels);
+          store["target"] = {{"kernels", kernels}, {"keywords", addedKeywords(baseline)}};
+        }
+
+        kernels = textKernels({mission, "base"}, {"fk"});
+        if (!kernels.is_null()) {
+          KernelSet ks(kernels);
+          store["frames"] = {{"kernels", kernels}, {"targets", targetFrames()}};
+        }
+      }
+      catch (exception &e) {
+        SPDLOG_TRACE("collectKeywords: couldn't record keywords for {}: {}", mission, e.what());
+        continue;
+      }
+
+      if (!store.is_null()) {
+        m_keywords[mission] = store;
+      }
+    }
+
+    SPDLOG_DEBUG("collectKeywords: recorded keywords for {} missions", m_keywords.size());
+  }
+
+
+  void InventoryImpl::collectKernels(Config &config, vector<string> missions) {
+    json json_kernels = {};
+    if (missions.size() > 0) {
+      // Resolve only specified mission list
+      json_kernels = getLatestKernels(config.get(missions), true);
+    }
+    else {
+      // Resolve everything
+      json_kernels = getLatestKernels(config.get(), true);
+    }
+    
+    // load time kernels for creating the timed kernel DataBase 
+    json lsk_json = getLatestKernels(config["base"].getRecursive("lsk")); 
+
+    SPDLOG_TRACE("InventoryImpl LSKs: {}", lsk_json.dump(4));
+
+    m_required_kernels.load(lsk_json); 
+
+    for (auto &[mission, kernels] : json_kernels.items()) {
+      SPDLOG_TRACE("MISSION: {}", mission);
+
+      json sclk_json = getLatestKernels(config[mission].getRecursive("sclk")); 
+      SPDLOG_TRACE("{} SCLKs: {}", mission, sclk_json.dump(4)); 
+      KernelSet sclks_ks(sclk_json); 
+
+      for(auto &[kernel_type, kernel_obj] : kernels.items()) { 
+        if (kernel_type == "ck" || kernel_type == "spk") { 
+          // we need to log the times
+          for (auto &quality : KERNEL_QUALITIES) {
+            if (kernel_obj.contains(quality)) {
+
+              // make the keys match Config's nested keys
+              string map_key = mission + "/" + kernel_type +"/"+quality;
+              
+              // make sure no path symbols are in the key
+              // replaceAll(map_key, "/", ":");
+              
+              TimeIndexedKernels *tkernels = new TimeIndexedKernels();
+              // btrees cannot be copied, so use pointers
+              collectStartStopTimes(mission, kernel_type, quality, tkernels, kernel_type == "ck" ? &m_ck_records[map_key] : nullptr); 
+              m_timedep_kerns[map_key] = tkernels;
+            }
+          }
+        } 
+        else { // it's a txt kernel or some other non-time dependant kernel 
+          vector<string> kernel_vec = textKernelPaths(kernel_obj);
+          if (!kernel_vec.empty()) {
+            m_nontimedep_kerns[mission + "/" + kernel_type] = kernel_vec; 
+          }
+        }
+      } 
+    }
+  }
+
+
+  void InventoryImpl::consolidateKernels() {
+    const char *enabled = getenv(CONSOLIDATE_ENV_VAR.c_str());
+    if (!enabled || toLower(string(enabled)) != "true") {
+      return;
+    }
+    const char *days = getenv(CONSOLIDATE_PERIOD_ENV_VAR.c_str());
+    const char *max_mb = getenv(CONSOLIDATE_MAX_SIZE_ENV_VAR.c_str());
+    double period = (days ? stod(days) : 7.0) * 86400;
+    uintmax_t max_bytes = static_cast<uintmax_t>((max_mb ? stod(max_mb) : 16.0) * 1024 * 1024);
+    if (period <= 0) {
+      throw invalid_argument(CONSOLIDATE_PERIOD_ENV_VAR + " must be positive.");
+    }
+
+    fs::path data_dir = fs::absolute(getDataDirectory());
+    fs::path cache_dir = getCacheDir();
+
+    for (auto &[key, kernels] : m_timedep_kerns) {
+      size_t nkernels = kernels->file_paths.size();
+      string type = key.substr(key.find('/') + 1);
+      type = type.substr(0, type.find('/'));
+
+      vector<double> start_times(nkernels);
+      for (const auto &[k, v] : kernels->start_times) {
+        start_times.at(v) = k;
+      }
+      vector<uintmax_t> sizes(nkernels);
+      for (size_t i = 0; i < nkernels; i++) {
+        std::error_code ec;
+        sizes[i] = fs::file_size(data_dir / kernels->file_paths[i], ec);
+        if (ec) {
+          sizes[i] = max_bytes + 1;  // never merge a kernel we cannot read
+        }
+      }
+
+      KernelConsolidation consolidation;
+      consolidation.kernel_files.assign(nkernels, -1);
+
+      // Runs of consecutive kernels keep the load order, so merging a run in
+      // order preserves the priority of every segment.
+      size_t first = 0;
+      while (first < nkernels) {
+        double bucket = floor(start_times[first] / period);
+        size_t last = first + 1;
+        while (sizes[first] <= max_bytes && last < nkernels && sizes[last] <= max_bytes
+               && floor(start_times[last] / period) == bucket) {
+          last++;
+        }
+        if (last - first < 2) {
+          first = last;
+          continue;
+        }
+
+        vector<string> run;
+        string fingerprint;
+        for (size_t i = first; i < last; i++) {
+          fs::path kernel = data_dir / kernels->file_paths[i];
+          std::error_code ec;
+          auto mtime = fs::last_write_time(kernel, ec).time_since_epoch().count();
+          fingerprint += kernels->file_paths[i] + "@" + to_string(sizes[i]) + "@" + to_string(mtime) + ";";
+          run.push_back(kernel.string());
+        }
+        fs::path merged = fs::path(DB_CONSOLIDATED_DIR) / key
+                          / fmt::format("{}_{:016x}{}", static_cast<int64_t>(bucket), std::hash<string>{}(fingerprint), Kernel::getExt(type));
+        fs::path merged_file = cache_dir / merged;
+
+        if (!fs::exists(merged_file)) {
+          fs::create_directories(merged_file.parent_path());
+          fs::path tmp_file = merged_file.string() + "." + gen_random(10) + ".tmp";
+          try {
+            string comment = "Consolidated by SpiceQL " + string(SPICEQL_VERSION) + " from:\n";
+            for (size_t i = first; i < last; i++) {
+              comment += kernels->file_paths[i] + "\n";
+            }
+            mergeKernels(tmp_file.string(), type, run, comment);
+            fs::rename(tmp_file, merged_file);
+          }
+          catch (exception &e) {
+            SPDLOG_WARN("Could not consolidate {} kernels of {}: {}", run.size(), key, e.what());
+            std::error_code ec;
+            fs::remove(tmp_file, ec);
+            first = last;
+            continue;
+          }
+        }
+
+        SPDLOG_DEBUG("Consolidated {} kernels of {} into {}", run.size(), key, merged.string());
+        for (size_t i = first; i < last; i++) {
+          consolidation.kernel_files[i] = static_cast<int32_t>(consolidation.files.size());
+        }
+        consolidation.files.push_back(merged.generic_string());
+        first = last;
+      }
+
+      if (!consolidation.files.empty()) {
+        SPDLOG_INFO("Consolidated the {} kernels of {} into {} files", nkernels, key, consolidation.files.size());
+        m_consolidations[key] = std::move(consolidation);
+      }
+    }
+  }
+
+
   InventoryImpl::InventoryImpl(bool force_regen, vector<string> mlist) : m_required_kernels() {
     fs::path db_root = getCacheDir();
     fs::path db_file = db_root / DB_HDF_FILE; 
@@ -286,8 +952,13 @@ namespace SpiceQL {
         throw runtime_error("MESSAGE: " + msg + ", ERROR: " + string(e.what()) + ".");
       }
 
+      // Only one process builds the DB at a time. If another one published a
+      // build of the same missions while we waited for the lock, reuse it.
+      uint64_t seen_generation = readDbGeneration(db_file.string());
+      SPDLOG_DEBUG("Waiting for DB build lock in {}", db_root.string());
+      DbBuildLock build_lock(db_root / DB_LOCK_FILE);
+
       Config config; 
-      json json_kernels = {};
       // Verify mlist has acceptable mission names
       vector<string> lowercase_mlist;
       if (mlist.size() > 0) {
@@ -299,72 +970,26 @@ namespace SpiceQL {
           }
           lowercase_mlist.push_back(m);
         }
-        // Resolve only specified mission list
-        json_kernels = getLatestKernels(config.get(lowercase_mlist));
       }
-      else {
-        // Resolve everything
-        json_kernels = getLatestKernels(config.get()); 
-      }
-      
-      // load time kernels for creating the timed kernel DataBase 
-      json lsk_json = getLatestKernels(config["base"].getRecursive("lsk")); 
-
-      SPDLOG_TRACE("InventoryImpl LSKs: {}", lsk_json.dump(4));
-
-      m_required_kernels.load(lsk_json); 
-
-      for (auto &[mission, kernels] : json_kernels.items()) {
-        SPDLOG_TRACE("MISSION: {}", mission);
+      m_missions = lowercase_mlist;
 
-        json sclk_json = getLatestKernels(config[mission].getRecursive("sclk")); 
-        SPDLOG_TRACE("{} SCLKs: {}", mission, sclk_json.dump(4)); 
-        KernelSet sclks_ks(sclk_json); 
-
-        for(auto &[kernel_type, kernel_obj] : kernels.items()) { 
-          if (kernel_type == "ck" || kernel_type == "spk") { 
-            // we need to log the times
-            for (auto &quality : KERNEL_QUALITIES) {
-              if (kernel_obj.contains(quality)) {
-
-                // make the keys match Config's nested keys
-                string map_key = mission + "/" + kernel_type +"/"+quality;
-                
-                // make sure no path symbols are in the key
-                // replaceAll(map_key, "/", ":");
-                
-                TimeIndexedKernels *tkernels = new TimeIndexedKernels();
-                // btrees cannot be copied, so use pointers
-                collectStartStopTimes(mission, kernel_type, quality, tkernels); 
-                m_timedep_kerns[map_key] = tkernels;
-              }
-            }
-          } 
-          else { // it's a txt kernel or some other non-time dependant kernel 
-            vector<json::json_pointer> ptrs = findKeyInJson(kernel_obj, "kernels", true); 
-            
-            for (auto &ptr : ptrs) { 
-              string btree_key = mission + "/" + kernel_type;
-              vector<string> kernel_vec;
-
-              // Doing it bracketless, there are too many brackets
-              for (auto &subarr: kernel_obj[ptr]) 
-                for (auto &kernel : subarr) { 
-                  string k = kernel.get<string>();
-                  fs::path relative_path_kernel = fs::relative(k, fs::absolute(getDataDirectory()));
-                  SPDLOG_TRACE("Relative Kernel: {}", relative_path_kernel.generic_string()); 
-                  kernel_vec.push_back(relative_path_kernel.string());
-                } 
-              m_nontimedep_kerns[btree_key] = kernel_vec; 
-            } 
-          }
-        } 
+      if (readDbGeneration(db_file.string()) != seen_generation
+          && readDbAttribute<string>(db_file.string(), DB_MISSIONS_KEY, "") == missionsAttribute(m_missions)
+          && isDbReady()) {
+        SPDLOG_DEBUG("DB {} was built while waiting for the lock, reusing it", db_file.string());
+        return;
       }
 
+      collectKernels(config, lowercase_mlist);
+      consolidateKernels();
+
       // Precompute frame caches (frame list + bidirectional code<->name map)
       // so runtime resolution never needs to furnish slow FKs.
       collectFrameInfo();
 
+      // Record text kernel keywords so keyword queries need no kernels
+      collectKeywords(config, lowercase_mlist);
+
       // write everything out
       write_database();
     }
@@ -375,8 +1000,10 @@ namespace SpiceQL {
 
 
   template<class T>
-  T InventoryImpl::getKey(string key) { 
-    string hdf_file = (fs::path(getCacheDir()) / DB_HDF_FILE).string();
+  T InventoryImpl::getKey(string key, string hdf_file) { 
+    if (hdf_file.empty()) {
+      hdf_file = (fs::path(getCacheDir()) / DB_HDF_FILE).string();
+    }
 
     if (!fs::exists(hdf_file)) { 
       throw runtime_error("DB for kernels (" + hdf_file + ") does not exist");
@@ -399,6 +1026,410 @@ namespace SpiceQL {
   }
 
 
+  namespace {
+    struct CachedTimeIndex {
+      std::string stamp;  // stamp of the DB file the index was read from
+      std::shared_ptr<TimeIndexedKernels> time_indices;
+    };
+
+    std::mutex g_time_index_mutex;
+    // Time indices read from DB files, shared across InventoryImpl instances
+    // and keyed on "<file>:<key>". Keys missing from a DB are cached as nullptr.
+    // Searches hold their own reference, so a swap to a new generation never
+    // frees an index mid-query.
+    std::unordered_map<std::string, CachedTimeIndex> g_time_index_cache;
+
+    // Decode a v2 records dataset. Times are stored as deltas of their IEEE-754
+    // bit patterns (start from the previous start, stop from its own start),
+    // which round-trips exactly and compresses well.
+    void decodeTimeRecords(const vector<KernelTimeRecord> &records, const vector<string> &paths, TimeIndexedKernels &time_indices) {
+      time_indices.file_paths.reserve(records.size());
+      uint64_t start_bits = 0;
+      for (size_t i = 0; i < records.size(); i++) {
+        start_bits += static_cast<uint64_t>(records[i].start);
+        uint64_t stop_bits = start_bits + static_cast<uint64_t>(records[i].stop);
+        time_indices.start_times[std::bit_cast<double>(start_bits)] = i;
+        time_indices.stop_times[std::bit_cast<double>(stop_bits)] = i;
+        time_indices.file_paths.push_back(paths.at(records[i].path));
+      }
+    }
+
+
+    shared_ptr<TimeIndexedKernels> readTimeIndexedKernels(const string &key, const string &hdf_file) {
+      if (!fs::exists(hdf_file)) { 
+        throw runtime_error("DB for kernels (" + hdf_file + ") does not exist");
+      }
+      HighFive::File file(hdf_file, HighFive::File::ReadOnly);
+
+      string group = DB_SPICE_ROOT_KEY + "/" + key;
+      while (group.back() == '/') {
+        group.pop_back();
+      }
+      if (!file.exist(group)) {
+        throw runtime_error("Key [" + group + "] does not exist");
+      }
+
+      shared_ptr<TimeIndexedKernels> time_indices = make_shared<TimeIndexedKernels>();
+      if (file.exist(group + "/" + DB_TIME_RECORDS_KEY)) {
+        // layout v2: one compound dataset plus the mission's path table
+        string mission = key.substr(0, key.find('/'));
+        vector<string> paths = file.getDataSet(DB_SPICE_ROOT_KEY + "/" + mission + "/" + DB_PATH_TABLE_KEY).read<vector<string>>();
+        vector<KernelTimeRecord> records = file.getDataSet(group + "/" + DB_TIME_RECORDS_KEY).read<vector<KernelTimeRecord>>();
+        SPDLOG_TRACE("{} v2 records, {} paths", records.size(), paths.size());
+        decodeTimeRecords(records, paths, *time_indices);
+        return time_indices;
+      }
+
+      // layout v1: separate time, index and path datasets
+      vector<double> start_times_v = file.getDataSet(group+"/"+DB_START_TIME_KEY).read<vector<double>>(); 
+      vector<double> stop_times_v = file.getDataSet(group+"/"+DB_STOP_TIME_KEY).read<vector<double>>();
+      vector<size_t> start_file_index_v = file.getDataSet(group+"/"+DB_START_TIME_INDICES_KEY).read<vector<size_t>>(); 
+      vector<size_t> stop_file_index_v = file.getDataSet(group+"/"+DB_STOP_TIME_INDICES_KEY).read<vector<size_t>>(); 
+      time_indices->file_paths = file.getDataSet(group+"/"+DB_TIME_FILES_KEY).read<vector<string>>(); 
+
+      SPDLOG_TRACE("Index, start time, stop time sizes: {}, {}, {}", start_file_index_v.size(), start_times_v.size(), stop_times_v.size());
+      // load start_times 
+      for(size_t i = 0; i < start_times_v.size(); i++) {
+        time_indices->start_times[start_times_v[i]] = start_file_index_v[i];
+      }
+      // load stop_times 
+      for(size_t i = 0; i < stop_times_v.size(); i++) {
+        time_indices->stop_times[stop_times_v[i]] = stop_file_index_v[i];
+      }
+      return time_indices;
+    }
+
+
+    shared_ptr<TimeIndexedKernels> loadTimeIndexedKernels(string key, const string &hdf_file) {
+      while (!key.empty() && key.back() == '/') {
+        key.pop_back();
+      }
+      string stamp = dbFileStamp(hdf_file);
+      string cache_key = hdf_file + ":" + key;
+      {
+        std::lock_guard<std::mutex> lock(g_time_index_mutex);
+        auto it = g_time_index_cache.find(cache_key);
+        if (it != g_time_index_cache.end() && it->second.stamp == stamp) {
+          return it->second.time_indices;
+        }
+      }
+
+      shared_ptr<TimeIndexedKernels> time_indices;
+      try {
+        SPDLOG_TRACE("Starting deserializing the DB");
+        time_indices = readTimeIndexedKernels(key, hdf_file);
+      }
+      catch (exception &e) { 
+        SPDLOG_TRACE("Couldn't find "+DB_SPICE_ROOT_KEY+"/" + key+ ". " + e.what());
+        time_indices = nullptr;
+      }
+
+      std::lock_guard<std::mutex> lock(g_time_index_mutex);
+      g_time_index_cache[cache_key] = {stamp, time_indices};
+      return time_indices;
+    }
+
+
+    struct CachedCkRecordIndex {
+      string stamp;
+      shared_ptr<CkRecordIndex> ck_records;
+    };
+    // guarded by g_time_index_mutex, keyed like g_time_index_cache
+    std::unordered_map<std::string, CachedCkRecordIndex> g_ck_record_cache;
+
+
+    // Record times are stored like time records, as deltas of their bit
+    // patterns from the previous record, so evenly spaced records compress to
+    // almost nothing.
+    void writeCkRecordIndex(H5Easy::File &file, const string &group, const CkRecordIndex &ck_records) {
+      vector<int64_t> deltas(ck_records.record_ets.size());
+      uint64_t prev_bits = 0;
+      for (size_t i = 0; i < deltas.size(); i++) {
+        uint64_t bits = std::bit_cast<uint64_t>(ck_records.record_ets[i]);
+        deltas[i] = static_cast<int64_t>(bits - prev_bits);
+        prev_bits = bits;
+      }
+
+      HighFive::DataSetCreateProps props;
+      if (!deltas.empty()) {
+        props.add(HighFive::Chunking(std::vector<hsize_t>{std::min<hsize_t>(deltas.size(), DB_RECORD_CHUNK_SIZE)}));
+        props.add(HighFive::Shuffle());
+        props.add(HighFive::Deflate(DB_DEFLATE_LEVEL));
+      }
+      SPDLOG_DEBUG("Writing CK record index of {}: {} segments, {} records.", group, ck_records.segments.size(), deltas.size());
+      file.createDataSet(group + "/" + DB_CK_RECORD_TIMES_KEY, HighFive::DataSpace::From(deltas),
+                         HighFive::create_datatype<int64_t>(), props).write(deltas);
+      file.createDataSet(group + "/" + DB_CK_SEGMENTS_KEY, HighFive::DataSpace::From(ck_records.segments),
+                         HighFive::create_datatype<CkSegment>()).write(ck_records.segments);
+      H5Easy::dump(file, group + "/" + DB_CK_UNINDEXED_KEY, ck_records.unindexed, H5Easy::DumpMode::Overwrite);
+    }
+
+
+    shared_ptr<CkRecordIndex> readCkRecordIndex(const string &key, const string &hdf_file) {
+      HighFive::File file(hdf_file, HighFive::File::ReadOnly);
+      string group = DB_SPICE_ROOT_KEY + "/" + key;
+      if (!file.exist(group + "/" + DB_CK_SEGMENTS_KEY)) {
+        return nullptr;
+      }
+
+      shared_ptr<CkRecordIndex> ck_records = make_shared<CkRecordIndex>();
+      ck_records->segments = file.getDataSet(group + "/" + DB_CK_SEGMENTS_KEY).read<vector<CkSegment>>();
+      ck_records->unindexed = file.getDataSet(group + "/" + DB_CK_UNINDEXED_KEY).read<vector<uint32_t>>();
+      vector<int64_t> deltas = file.getDataSet(group + "/" + DB_CK_RECORD_TIMES_KEY).read<vector<int64_t>>();
+      ck_records->record_ets.resize(deltas.size());
+      uint64_t bits = 0;
+      for (size_t i = 0; i < deltas.size(); i++) {
+        bits += static_cast<uint64_t>(deltas[i]);
+        ck_records->record_ets[i] = std::bit_cast<double>(bits);
+      }
+      return ck_records;
+    }
+
+
+    /**
+     * Indices of the kernels covering [start_time, stop_time]: kernels starting
+     * before stop_time and stopping after start_time, sorted so the kernel DB
+     * load priority is kept. Works on BTreeMaps and shared index time maps.
+     */
+    template<class TimeMap>
+    vector<size_t> kernelsInTimeRange(TimeMap &start_times, TimeMap &stop_times, double start_time, double stop_time) {
+      // Get everything starting before the stop_time
+      unordered_set<size_t> start_time_kernels;
+      auto start_upper_bound = start_times.upper_bound(stop_time);
+      for (auto it = start_times.begin(); it != start_upper_bound; it++) {
+        start_time_kernels.insert(it->second);
+      }
+      SPDLOG_TRACE("NUMBER OF KERNELS MATCHING START TIME: {}", start_time_kernels.size());
+
+      // Get everything stopping after the start_time that is also in the start_time set
+      vector<size_t> indices;
+      for (auto it = stop_times.lower_bound(start_time); it != stop_times.end(); it++) {
+        if (start_time_kernels.contains(it->second)) {
+          indices.push_back(it->second);
+        }
+      }
+
+      sort(indices.begin(), indices.end());
+      return indices;
+    }
+  }
+
+
+  shared_ptr<TimeIndexedKernels> getTimeIndexedKernels(string key, string hdf_file) {
+    if (hdf_file.empty()) {
+      hdf_file = (fs::path(getCacheDir()) / DB_HDF_FILE).string();
+    }
+    return loadTimeIndexedKernels(key, hdf_file);
+  }
+
+
+  shared_ptr<CkRecordIndex> getCkRecordIndex(string key, string hdf_file) {
+    if (hdf_file.empty()) {
+      hdf_file = (fs::path(getCacheDir()) / DB_HDF_FILE).string();
+    }
+    while (!key.empty() && key.back() == '/') {
+      key.pop_back();
+    }
+    string stamp = dbFileStamp(hdf_file);
+    string cache_key = hdf_file + ":" + key;
+    {
+      std::lock_guard<std::mutex> lock(g_time_index_mutex);
+      auto it = g_ck_record_cache.find(cache_key);
+      if (it != g_ck_record_cache.end() && it->second.stamp == stamp) {
+        return it->second.ck_records;
+      }
+    }
+
+    shared_ptr<CkRecordIndex> ck_records;
+    try {
+      ck_records = readCkRecordIndex(key, hdf_file);
+    }
+    catch (exception &e) {
+      SPDLOG_TRACE("Couldn't read the CK record index of {}: {}", key, e.what());
+    }
+
+    std::lock_guard<std::mutex> lock(g_time_index_mutex);
+    g_ck_record_cache[cache_key] = {stamp, ck_records};
+    return ck_records;
+  }
+
+
+  namespace {
+    struct CachedConsolidation {
+      string stamp;
+      shared_ptr<KernelConsolidation> consolidation;
+    };
+    // guarded by g_time_index_mutex, keyed like g_time_index_cache
+    std::unordered_map<std::string, CachedConsolidation> g_consolidation_cache;
+  }
+
+
+  shared_ptr<KernelConsolidation> getKernelConsolidation(string key, string hdf_file) {
+    if (hdf_file.empty()) {
+      hdf_file = (fs::path(getCacheDir()) / DB_HDF_FILE).string();
+    }
+    while (!key.empty() && key.back() == '/') {
+      key.pop_back();
+    }
+    string stamp = dbFileStamp(hdf_file);
+    string cache_key = hdf_file + ":" + key;
+    {
+      std::lock_guard<std::mutex> lock(g_time_index_mutex);
+      auto it = g_consolidation_cache.find(cache_key);
+      if (it != g_consolidation_cache.end() && it->second.stamp == stamp) {
+        return it->second.consolidation;
+      }
+    }
+
+    shared_ptr<KernelConsolidation> consolidation;
+    try {
+      HighFive::File file(hdf_file, HighFive::File::ReadOnly);
+      string group = DB_SPICE_ROOT_KEY + "/" + key;
+      if (file.exist(group + "/" + DB_CONSOLIDATED_FILES_KEY)) {
+        consolidation = make_shared<KernelConsolidation>();
+        consolidation->files = file.getDataSet(group + "/" + DB_CONSOLIDATED_FILES_KEY).read<vector<string>>();
+        consolidation->kernel_files = file.getDataSet(group + "/" + DB_CONSOLIDATED_IDS_KEY).read<vector<int32_t>>();
+      }
+    }
+    catch (exception &e) {
+      SPDLOG_TRACE("Couldn't read the consolidation of {}: {}", key, e.what());
+    }
+
+    std::lock_guard<std::mutex> lock(g_time_index_mutex);
+    g_consolidation_cache[cache_key] = {stamp, consolidation};
+    return consolidation;
+  }
+
+
+  namespace {
+    struct CachedFrameDefinitions {
+      string stamp;
+      shared_ptr<const unordered_map<int, FrameDefinition>> frame_defs;
+    };
+    std::mutex g_frame_defs_mutex;
+    // keyed on "<file>:<mission>", like the time index cache
+    std::unordered_map<std::string, CachedFrameDefinitions> g_frame_defs_cache;
+  }
+
+
+  shared_ptr<const unordered_map<int, FrameDefinition>> getFrameDefinitions(string mission) {
+    mission = toLower(mission);
+    string hdf_file = getDbFileForMission(mission);
+    string stamp = dbFileStamp(hdf_file);
+    string cache_key = hdf_file + ":" + mission;
+    {
+      std::lock_guard<std::mutex> lock(g_frame_defs_mutex);
+      auto it = g_frame_defs_cache.find(cache_key);
+      if (it != g_frame_defs_cache.end() && it->second.stamp == stamp) {
+        return it->second.frame_defs;
+      }
+    }
+
+    shared_ptr<unordered_map<int, FrameDefinition>> frame_defs;
+    try {
+      HighFive::File file(hdf_file, HighFive::File::ReadOnly);
+      string group = DB_SPICE_ROOT_KEY + "/" + mission;
+      if (file.exist(group) && file.exist(group + "/" + DB_FRAME_DEFS_KEY)) {
+        vector<FrameRecord> records = file.getDataSet(group + "/" + DB_FRAME_DEFS_KEY).read<vector<FrameRecord>>();
+        vector<vector<double>> rotations = file.getDataSet(group + "/" + DB_FRAME_ROTATIONS_KEY).read<vector<vector<double>>>();
+        frame_defs = make_shared<unordered_map<int, FrameDefinition>>();
+        for (size_t i = 0; i < records.size(); i++) {
+          FrameDefinition def = {records[i].code, records[i].center, records[i].frame_class, records[i].class_id, records[i].tk_parent, {}};
+          if (i < rotations.size() && rotations[i].size() == def.tk_rotation.size()) {
+            std::copy(rotations[i].begin(), rotations[i].end(), def.tk_rotation.begin());
+          }
+          (*frame_defs)[def.code] = def;
+        }
+      }
+    }
+    catch (exception &e) {
+      SPDLOG_TRACE("Couldn't read the frame definitions of {}: {}", mission, e.what());
+      frame_defs = nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(g_frame_defs_mutex);
+    g_frame_defs_cache[cache_key] = {stamp, frame_defs};
+    return frame_defs;
+  }
+
+
+  namespace {
+    struct CachedKeywordStore {
+      string stamp;
+      shared_ptr<const json> store;
+    };
+    std::mutex g_keywords_mutex;
+    // keyed on "<file>:<mission>", like the frame definition cache
+    std::unordered_map<std::string, CachedKeywordStore> g_keywords_cache;
+  }
+
+
+  shared_ptr<const json> getKeywordStore(string mission) {
+    mission = toLower(mission);
+    string hdf_file = getDbFileForMission(mission);
+    string stamp = dbFileStamp(hdf_file);
+    string cache_key = hdf_file + ":" + mission;
+    {
+      std::lock_guard<std::mutex> lock(g_keywords_mutex);
+      auto it = g_keywords_cache.find(cache_key);
+      if (it != g_keywords_cache.end() && it->second.stamp == stamp) {
+        return it->second.store;
+      }
+    }
+
+    shared_ptr<const json> store;
+    try {
+      HighFive::File file(hdf_file, HighFive::File::ReadOnly);
+      string group = DB_SPICE_ROOT_KEY + "/" + mission;
+      if (file.exist(group) && file.exist(group + "/" + DB_KEYWORDS_KEY)) {
+        store = make_shared<const json>(json::parse(file.getDataSet(group + "/" + DB_KEYWORDS_KEY).read<string>()));
+      }
+    }
+    catch (exception &e) {
+      SPDLOG_TRACE("Couldn't read the keyword store of {}: {}", mission, e.what());
+      store = nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(g_keywords_mutex);
+    g_keywords_cache[cache_key] = {stamp, store};
+    return store;
+  }
+
+
+  size_t preloadTimeIndices(string mission) {
+    mission = toLower(mission);
+    string hdf_file = getDbFileForMission(mission);
+
+    // time indexed keys are the spice/<mission>/<type>/<quality> groups
+    vector<string> keys;
+    {
+      HighFive::File file(hdf_file, HighFive::File::ReadOnly);
+      string mission_key = DB_SPICE_ROOT_KEY + "/" + mission;
+      if (!file.exist(mission_key)) {
+        return 0;
+      }
+      HighFive::Group mission_group = file.getGroup(mission_key);
+      for (auto &type : mission_group.listObjectNames()) {
+        if (mission_group.getObjectType(type) != HighFive::ObjectType::Group) {
+          continue;
+        }
+        for (auto &quality : mission_group.getGroup(type).listObjectNames()) {
+          keys.push_back(mission + "/" + type + "/" + quality);
+        }
+      }
+    }
+
+    size_t loaded = 0;
+    for (auto &key : keys) {
+      if (loadTimeIndexedKernels(key, hdf_file)) {
+        loaded++;
+      }
+    }
+    SPDLOG_DEBUG("Preloaded {} time indices for {} from {}", loaded, mission, hdf_file);
+    return loaded;
+  }
+
+
   json InventoryImpl::search_for_kernelsets(vector<string> spiceql_names, vector<Kernel::Type> types, double start_time, double stop_time,
                                   vector<Kernel::Quality> ckQualities, vector<Kernel::Quality> spkQualities, bool full_kernel_path, 
                                   int limit_ck, int limit_spk, bool overwrite) { 
@@ -424,6 +1455,12 @@ namespace SpiceQL {
     spiceql_name = toLower(spiceql_name);
 
     fs::path data_dir = getDataDirectory();
+    string hdf_file = getDbFileForMission(spiceql_name);
+    // the shared index mirrors the main DB only, not newer shards
+    shared_ptr<const SharedIndex> shared_index;
+    if (hdf_file == (fs::path(getCacheDir()) / DB_HDF_FILE).string()) {
+      shared_index = SharedIndex::current();
+    }
 
     if (start_time > stop_time) { 
       throw range_error("start time cannot be greater than stop time.");
@@ -433,6 +1470,8 @@ namespace SpiceQL {
       if (type == Kernel::Type::CK || type == Kernel::Type::SPK) { 
         SPDLOG_DEBUG("Trying to search time dependent kernels");
         TimeIndexedKernels *time_indices = nullptr;
+        // keeps a DB-loaded index alive for the duration of the search
+        shared_ptr<TimeIndexedKernels> db_time_indices;
         bool found = false;        
 
         int limitQuality = limit_spk;
@@ -452,6 +1491,11 @@ namespace SpiceQL {
           string key = spiceql_name+"/"+Kernel::translateType(type)+"/"+Kernel::translateQuality(*quality)+"/";
           SPDLOG_DEBUG("Key: {}", key);
 
+          vector<size_t> indices;
+          SharedKernelIndex shared_kernels;
+          bool from_shared_index = false;
+          time_indices = nullptr;
+
           if (m_timedep_kerns.contains(key)) { 
             SPDLOG_DEBUG("Key {} found", key); 
             
@@ -459,127 +1503,114 @@ namespace SpiceQL {
             time_indices = m_timedep_kerns[key]; 
             found = true;
           }
-          else {
-            // try to load the binary files 
-            time_indices = new TimeIndexedKernels();
-            
-            try {
-              SPDLOG_TRACE("Starting deserializing the DB");
-
-              vector<double> start_times_v = getKey<vector<double>>(DB_SPICE_ROOT_KEY+"/"+key+"/"+DB_START_TIME_KEY); 
-              vector<double> stop_times_v = getKey<vector<double>>(DB_SPICE_ROOT_KEY+"/"+key+"/"+DB_STOP_TIME_KEY);
-              vector<size_t> start_file_index_v = getKey<vector<size_t>>(DB_SPICE_ROOT_KEY+"/"+key+"/"+DB_START_TIME_INDICES_KEY); 
-              vector<size_t> stop_file_index_v = getKey<vector<size_t>>(DB_SPICE_ROOT_KEY+"/"+key+"/"+DB_STOP_TIME_INDICES_KEY); 
-              vector<string> file_paths_v = getKey<vector<string>>(DB_SPICE_ROOT_KEY+"/"+key+"/"+DB_TIME_FILES_KEY); 
-
-              time_indices->file_paths = file_paths_v;
-              SPDLOG_TRACE("Index, start time, stop time sizes: {}, {}, {}", start_file_index_v.size(), start_times_v.size(), stop_times_v.size());
-              // load start_times 
-              for(size_t i = 0; i < start_times_v.size(); i++) {
-                time_indices->start_times[start_times_v[i]] = start_file_index_v[i];
-              }
-              // load stop_times 
-              for(size_t i = 0; i < stop_times_v.size(); i++) {
-                time_indices->stop_times[stop_times_v[i]] = stop_file_index_v[i];
-              }
+          else if (shared_index && shared_index->findKernels(key, shared_kernels)) {
+            SPDLOG_DEBUG("Key {} found in shared index", key);
+            if (!shared_kernels.start_times.size()) {
+              continue;
             }
-            catch (runtime_error &e) { 
-              // should probably replace with a more specific exception 
-              SPDLOG_TRACE("Couldn't find "+DB_SPICE_ROOT_KEY+"/" + key+ ". " + e.what());
+            indices = kernelsInTimeRange(shared_kernels.start_times, shared_kernels.stop_times, start_time, stop_time);
+            from_shared_index = true;
+          }
+          else {
+            // load from the DB, reusing the process-wide copy when it is current
+            db_time_indices = loadTimeIndexedKernels(key, hdf_file);
+            if (!db_time_indices) {
               continue;
             }
+            time_indices = db_time_indices.get();
           }
 
           if (time_indices) { 
             SPDLOG_TRACE("NUMBER OF KERNELS: {}", time_indices->file_paths.size());
             SPDLOG_TRACE("NUMBER OF START TIMES: {}", time_indices->start_times.size());
             SPDLOG_TRACE("NUMBER OF STOP TIMES: {}", time_indices->stop_times.size()); 
-          } else { 
-            // no kernels found 
-            continue;
+            indices = kernelsInTimeRange(time_indices->start_times, time_indices->stop_times, start_time, stop_time);
           }
-  
-          size_t iterations = 0; 
-      
-          // init containers
-          unordered_set<size_t> start_time_kernels;
-          vector<string> final_time_kernels;
-          vector<int> final_time_kernel_indices;
-
-          // Get everything starting before the stop_time; 
-          auto start_upper_bound = time_indices->start_times.upper_bound(stop_time);
-          if(start_upper_bound == time_indices->start_times.begin() && start_upper_bound->first <= start_time)  { 
-             iterations++;
-             start_time_kernels.insert(start_upper_bound->second);  
-          }
-          for(auto it = time_indices->start_times.begin() ;it != start_upper_bound; it++) {
-            iterations++;
-            SPDLOG_TRACE("Inserting {} with the start time {}", time_indices->file_paths.at(it->second), it->first);
-            start_time_kernels.insert(it->second);
-          }
-
-          SPDLOG_TRACE("NUMBER OF KERNELS MATCHING START TIME: {}", start_time_kernels.size()); 
 
-          // Get everything stopping after the start_time; 
-          auto stop_lower_bound = time_indices->stop_times.lower_bound(start_time);
-          if(time_indices->stop_times.end() == stop_lower_bound && stop_lower_bound->first >= stop_time && start_time_kernels.contains(stop_lower_bound->second)) { 
-            SPDLOG_TRACE("Is {} in the array? {}", stop_lower_bound->second, start_time_kernels.contains(stop_lower_bound->second)); 
-            final_time_kernel_indices.push_back(stop_lower_bound->second);
-          }
-          else { 
-            for(auto it = stop_lower_bound;it != time_indices->stop_times.end(); it++) { 
-              // if it's also in the start_time set, add it to the list
-              iterations++;
-              SPDLOG_TRACE("Is {} with stop time {} in the array? {}", time_indices->file_paths.at(it->second), it->first, start_time_kernels.contains(it->second)); 
-              if (start_time_kernels.contains(it->second)) {
-                final_time_kernel_indices.push_back(it->second);
-              }
-            }
-          }
-          
-          // Sort the indices as the kernel dbs enforce load priority
-          sort(final_time_kernel_indices.begin(), final_time_kernel_indices.end());
-          for (auto index : final_time_kernel_indices) {
-            final_time_kernels.push_back(time_indices->file_paths.at(index));
-          }
+          auto kernelPath = [&](size_t index) {
+            string path = from_shared_index ? shared_kernels.file_path(index) : time_indices->file_paths.at(index);
+            return full_kernel_path ? (data_dir / path).string() : path;
+          };
 
-          if (final_time_kernels.size()) { 
+          if (indices.size()) { 
             found = true;
-            if (limitQuality > -1 && limitQuality < final_time_kernels.size()) { 
-              vector<string> limitedKernels;
-              int start_idx = final_time_kernels.size() - 1;
+            vector<size_t> selected;
+            if (limitQuality > -1 && limitQuality < indices.size()) { 
+              int start_idx = indices.size() - 1;
               int stop_idx = start_idx - limitQuality;
               for (auto i = start_idx; i > stop_idx; --i) {
-                if (full_kernel_path) {
-                  limitedKernels.push_back((data_dir / final_time_kernels[i]).string());
-                } else {
-                  limitedKernels.push_back(final_time_kernels[i]);
-                }
+                selected.push_back(indices[i]);
               }
-              kernels[Kernel::translateType(type)] = limitedKernels;
-              kernels[qkey] = Kernel::translateQuality(*quality);   
             }
             else { 
-              vector<string> allKernels;
-              if (full_kernel_path) {
-                for(string &e : final_time_kernels) { 
-                  allKernels.push_back((data_dir / e).string());
+              selected = indices;
+            }
+
+            // Furnish a consolidated file in place of its kernels when every one
+            // of them covering the time range was selected, otherwise a limit
+            // would let the merged file answer with kernels it dropped.
+            string trimmed_key = key.substr(0, key.size() - 1);
+            const KernelConsolidation *consolidation = nullptr;
+            shared_ptr<KernelConsolidation> db_consolidation;
+            if (m_consolidations.contains(trimmed_key)) {
+              consolidation = &m_consolidations[trimmed_key];
+            }
+            else if ((db_consolidation = getKernelConsolidation(trimmed_key, hdf_file))) {
+              consolidation = db_consolidation.get();
+            }
+
+            auto mergedFile = [&](size_t index) {
+              return consolidation && index < consolidation->kernel_files.size() ? consolidation->kernel_files[index] : -1;
+            };
+            unordered_map<int32_t, size_t> covering;
+            unordered_map<int32_t, size_t> chosen;
+            if (consolidation) {
+              for (auto index : indices) {
+                covering[mergedFile(index)]++;
+              }
+              for (auto index : selected) {
+                chosen[mergedFile(index)]++;
+              }
+            }
+
+            vector<string> time_kernels;
+            json sources = json::object();
+            fs::path cache_dir = getCacheDir();
+            for (auto index : selected) {
+              int32_t merged = mergedFile(index);
+              string merged_file;
+              if (merged >= 0 && chosen[merged] == covering[merged]) {
+                merged_file = (cache_dir / consolidation->files.at(merged)).string();
+                if (!sources.contains(merged_file) && !fs::exists(merged_file)) {
+                  SPDLOG_DEBUG("Consolidated kernel {} is missing, using its kernels", merged_file);
+                  merged_file.clear();
+                  covering[merged] = 0;
                 }
-              } else {
-                allKernels = final_time_kernels;
               }
-              kernels[Kernel::translateType(type)] = allKernels;
-              kernels[qkey] = Kernel::translateQuality(*quality);
+              if (merged_file.empty()) {
+                time_kernels.push_back(kernelPath(index));
+                continue;
+              }
+              if (!sources.contains(merged_file)) {
+                time_kernels.push_back(merged_file);
+              }
+              sources[merged_file].push_back(kernelPath(index));
+            }
+
+            kernels[Kernel::translateType(type)] = time_kernels;
+            kernels[qkey] = Kernel::translateQuality(*quality);
+            if (!sources.empty()) {
+              kernels["consolidated"][Kernel::translateType(type)] = sources;
             }
           }
-          SPDLOG_TRACE("NUMBER OF ITERATIONS: {}", iterations);
-          SPDLOG_TRACE("NUMBER OF KERNELS FOUND: {}", final_time_kernels.size());  
+          SPDLOG_TRACE("NUMBER OF KERNELS FOUND: {}", indices.size());  
         }
       }
       else { // text/non time based kernels
         SPDLOG_DEBUG("Trying to search time independent kernels");
         string key = spiceql_name+"/"+Kernel::translateType(type)+"/"; 
         SPDLOG_DEBUG("GETTING {} with key {}", Kernel::translateType(type), key);
+        SharedKernelIndex shared_kernels;
         if (m_nontimedep_kerns.contains(key) && !m_nontimedep_kerns[key].empty()) {  
           vector<string> ks = m_nontimedep_kerns[key];
           if (full_kernel_path) {
@@ -588,10 +1619,17 @@ namespace SpiceQL {
           kernels[Kernel::translateType(type)] = ks;
         
         }
+        else if (shared_index && shared_index->findKernels(key, shared_kernels)) {
+          vector<string> ks;
+          for (size_t i = 0; i < shared_kernels.size(); i++) {
+            ks.push_back(full_kernel_path ? (data_dir / shared_kernels.file_path(i)).string() : shared_kernels.file_path(i));
+          }
+          kernels[Kernel::translateType(type)] = ks;
+        }
         else { 
           // load from DB 
           try { 
-            vector<string> ks = getKey<vector<string>>(DB_SPICE_ROOT_KEY + "/"+key);
+            vector<string> ks = getKey<vector<string>>(DB_SPICE_ROOT_KEY + "/"+key, hdf_file);
             if (full_kernel_path) {
               for(auto &e : ks) e = (data_dir / e).string(); // re-add the data dir
             }
@@ -608,16 +1646,129 @@ namespace SpiceQL {
   
 
   void InventoryImpl::write_database() { 
-    fs::path db_root = getCacheDir(); 
-    string hdf_file = (db_root / DB_HDF_FILE).string();
-    
-    // delete if exists
-    fs::remove(hdf_file);
-    H5Easy::File file(hdf_file, H5Easy::File::Create); 
+    fs::path hdf_file = fs::path(getCacheDir()) / DB_HDF_FILE;
+    publishDbFile(hdf_file, [this](const string &tmp_file, uint64_t generation) {
+      write_database(tmp_file, generation);
+    });
+  }
+
+
+  void InventoryImpl::write_shard(string mission) {
+    mission = toLower(mission);
+    Config config;
+    if (!config.contains(mission)) {
+      throw runtime_error("Mission [" + mission + "] is not an acceptable mission name.");
+    }
+
+    fs::path shard_file = getShardFile(mission);
+    fs::create_directories(shard_file.parent_path());
+    DbBuildLock build_lock(shard_file.string() + ".lock");
+
+    SPDLOG_DEBUG("Building DB shard for {} at {}", mission, shard_file.string());
+    InventoryImpl shard;
+    shard.m_missions = {mission};
+    shard.collectKernels(config, shard.m_missions);
+    shard.consolidateKernels();
+    shard.collectFrameInfo(shard.m_missions);
+    shard.collectKeywords(config, shard.m_missions);
+
+    publishDbFile(shard_file, [&shard](const string &tmp_file, uint64_t generation) {
+      shard.write_database(tmp_file, generation);
+    });
+  }
+
+
+  void InventoryImpl::merge_shards(vector<string> shard_files) {
+    fs::path db_root = getCacheDir();
+    if (shard_files.empty()) {
+      fs::path shard_dir = db_root / DB_SHARD_DIR;
+      if (fs::is_directory(shard_dir)) {
+        for (auto &entry : fs::directory_iterator(shard_dir)) {
+          if (entry.path().extension() == ".hdf") {
+            shard_files.push_back(entry.path().string());
+          }
+        }
+      }
+    }
+    if (shard_files.empty()) {
+      throw runtime_error("No DB shards to merge in [" + (db_root / DB_SHARD_DIR).string() + "].");
+    }
+    // merge in a stable order so the first shard defining a frame code always wins
+    sort(shard_files.begin(), shard_files.end());
+
+    InventoryImpl merged;
+    set<string> frame_list;
+    unordered_set<int> seen_codes;
+    map<string, string> mission_shards;
+
+    for (auto &shard_file : shard_files) {
+      string version = readDbAttribute<string>(shard_file, "SPICEQL_VERSION", "");
+      if (version != SPICEQL_VERSION) {
+        throw runtime_error("DB shard [" + shard_file + "] was built by SpiceQL [" + version + "], expected [" + SPICEQL_VERSION + "].");
+      }
 
-    // Write version
+      string missions = readDbAttribute<string>(shard_file, DB_MISSIONS_KEY, "");
+      if (missions.empty() || missions == "*") {
+        throw runtime_error("[" + shard_file + "] is not a DB shard, it does not list its missions.");
+      }
+      for (auto &mission : split(missions, ',')) {
+        if (mission_shards.contains(mission)) {
+          throw runtime_error("Mission [" + mission + "] is in both [" + mission_shards[mission] + "] and [" + shard_file + "].");
+        }
+        mission_shards[mission] = shard_file;
+        merged.m_missions.push_back(mission);
+      }
+
+      HighFive::File file(shard_file, HighFive::File::ReadOnly);
+      if (file.exist(DB_FRAME_LIST_KEY)) {
+        for (auto &frame : file.getDataSet(DB_FRAME_LIST_KEY).read<vector<string>>()) {
+          frame_list.insert(frame);
+        }
+      }
+      if (file.exist(DB_FRAME_CODES_KEY) && file.exist(DB_FRAME_NAMES_KEY)) {
+        vector<int> codes = file.getDataSet(DB_FRAME_CODES_KEY).read<vector<int>>();
+        vector<string> names = file.getDataSet(DB_FRAME_NAMES_KEY).read<vector<string>>();
+        for (size_t i = 0; i < std::min(codes.size(), names.size()); i++) {
+          insertFramePair(codes[i], names[i], merged.m_frame_codes, merged.m_frame_names, seen_codes);
+        }
+      }
+    }
+    merged.m_frame_list.assign(frame_list.begin(), frame_list.end());
+
+    DbBuildLock build_lock(db_root / DB_LOCK_FILE);
+    publishDbFile(db_root / DB_HDF_FILE, [&](const string &tmp_file, uint64_t generation) {
+      merged.write_database(tmp_file, generation);
+
+      // copy each mission's kernel groups over as they are
+      HighFive::File out(tmp_file, HighFive::File::ReadWrite);
+      if (!out.exist(DB_SPICE_ROOT_KEY)) {
+        out.createGroup(DB_SPICE_ROOT_KEY);
+      }
+      for (auto &[mission, shard_file] : mission_shards) {
+        HighFive::File in(shard_file, HighFive::File::ReadOnly);
+        string group = DB_SPICE_ROOT_KEY + "/" + mission;
+        if (!in.exist(group)) {
+          SPDLOG_DEBUG("No kernels for {} in {}", mission, shard_file);
+          continue;
+        }
+        if (H5Ocopy(in.getId(), group.c_str(), out.getId(), group.c_str(), H5P_DEFAULT, H5P_DEFAULT) < 0) {
+          throw runtime_error("Failed to copy [" + group + "] from [" + shard_file + "].");
+        }
+      }
+    });
+    SPDLOG_DEBUG("Merged {} DB shards covering {} missions", shard_files.size(), mission_shards.size());
+  }
+
+
+  void InventoryImpl::write_database(string hdf_file, uint64_t generation) { 
+    H5Easy::File file(hdf_file, H5Easy::File::Overwrite); 
+
+    // Write version and generation
     HighFive::Group group = file.getGroup("/");
     group.createAttribute<std::string>("SPICEQL_VERSION", SPICEQL_VERSION);
+    group.createAttribute<uint64_t>(DB_GENERATION_KEY, generation);
+    group.createAttribute<std::string>(DB_MISSIONS_KEY, missionsAttribute(m_missions));
+    group.createAttribute<int>(DB_LAYOUT_KEY, DB_LAYOUT_VERSION);
 
     // Write the precomputed frame caches: the frame list and the bidirectional
     // code<->name map (two aligned arrays, no redundant storage).
@@ -629,40 +1780,100 @@ namespace SpiceQL {
       H5Easy::dump(file, "/" + DB_FRAME_NAMES_KEY, m_frame_names, H5Easy::DumpMode::Overwrite);
     }
 
-    for (auto it=m_timedep_kerns.begin(); it!=m_timedep_kerns.end(); ++it) {
-      string kernel_key = it->first; 
-      TimeIndexedKernels *kernels = m_timedep_kerns[kernel_key];       
+    // Time indexed kernels: one compound (start, stop, path) dataset per key.
+    // Paths are dictionary encoded into a table per mission so shards can be
+    // merged by copying mission groups as they are.
+    map<string, vector<string>> path_tables;
+    map<string, unordered_map<string, uint32_t>> path_ids;
 
-      /* Save HDF files */
-      if (kernels->file_paths.size() > 0) {
-        // save index
-        H5Easy::dump(file, DB_SPICE_ROOT_KEY + "/"+kernel_key+"/"+DB_TIME_FILES_KEY, kernels->file_paths, H5Easy::DumpMode::Overwrite);
-
-        // preallocate everything 
-        vector<double> start_times_v;
-        start_times_v.reserve(kernels->start_times.size());
-        vector<double> stop_times_v;
-        stop_times_v.reserve(kernels->stop_times.size());
-        vector<size_t> start_indices_v;
-        start_indices_v.reserve(kernels->start_times.size());
-        vector<size_t> stop_indices_v;
-        stop_indices_v.reserve(kernels->stop_times.size());
+    for (auto &[kernel_key, kernels] : m_timedep_kerns) {
+      size_t nkernels = kernels->file_paths.size();
+      if (nkernels == 0) {
+        continue;
+      }
+      string mission = kernel_key.substr(0, kernel_key.find('/'));
+      vector<string> &table = path_tables[mission];
+      unordered_map<string, uint32_t> &ids = path_ids[mission];
+
+      // every file index appears exactly once in each tree
+      vector<double> start_times_v(nkernels);
+      vector<double> stop_times_v(nkernels);
+      for (const auto &[k, v] : kernels->start_times) { 
+        start_times_v.at(v) = k;
+      }
+      for (const auto &[k, v] : kernels->stop_times) { 
+        stop_times_v.at(v) = k;
+      }
 
-        for (const auto &[k, v] : kernels->start_times) { 
-          start_times_v.push_back(k);
-          start_indices_v.push_back(v);
+      vector<KernelTimeRecord> records(nkernels);
+      uint64_t prev_start_bits = 0;
+      for (size_t i = 0; i < nkernels; i++) {
+        uint64_t start_bits = std::bit_cast<uint64_t>(start_times_v[i]);
+        uint64_t stop_bits = std::bit_cast<uint64_t>(stop_times_v[i]);
+        records[i].start = static_cast<int64_t>(start_bits - prev_start_bits);
+        records[i].stop = static_cast<int64_t>(stop_bits - start_bits);
+        prev_start_bits = start_bits;
+
+        auto [id, inserted] = ids.try_emplace(kernels->file_paths[i], static_cast<uint32_t>(table.size()));
+        if (inserted) {
+          table.push_back(kernels->file_paths[i]);
         }
+        records[i].path = id->second;
+      }
 
-        for (const auto &[k, v] : kernels->stop_times) { 
-          stop_times_v.push_back(k);
-          stop_indices_v.push_back(v);
-        } 
+      HighFive::DataSetCreateProps record_props;
+      record_props.add(HighFive::Chunking(std::vector<hsize_t>{std::min<hsize_t>(nkernels, DB_RECORD_CHUNK_SIZE)}));
+      record_props.add(HighFive::Shuffle());
+      record_props.add(HighFive::Deflate(DB_DEFLATE_LEVEL));
 
-        H5Easy::dump(file, DB_SPICE_ROOT_KEY + "/"+kernel_key+"/"+DB_START_TIME_KEY, start_times_v, H5Easy::DumpMode::Overwrite);
-        H5Easy::dump(file, DB_SPICE_ROOT_KEY + "/"+kernel_key+"/"+DB_STOP_TIME_KEY, stop_times_v, H5Easy::DumpMode::Overwrite);
-        H5Easy::dump(file, DB_SPICE_ROOT_KEY + "/"+kernel_key+"/"+DB_START_TIME_INDICES_KEY, start_indices_v, H5Easy::DumpMode::Overwrite);
-        H5Easy::dump(file, DB_SPICE_ROOT_KEY + "/"+kernel_key+"/"+DB_STOP_TIME_INDICES_KEY, stop_indices_v, H5Easy::DumpMode::Overwrite);
+      string dataset_key = DB_SPICE_ROOT_KEY + "/" + kernel_key + "/" + DB_TIME_RECORDS_KEY;
+      SPDLOG_DEBUG("Writing {} with {} kernels.", dataset_key, nkernels);
+      HighFive::DataSet dataset = file.createDataSet(dataset_key, HighFive::DataSpace::From(records),
+                                                     HighFive::create_datatype<KernelTimeRecord>(), record_props);
+      dataset.write(records);
+
+      auto ck_records = m_ck_records.find(kernel_key);
+      if (ck_records != m_ck_records.end()) {
+        writeCkRecordIndex(file, DB_SPICE_ROOT_KEY + "/" + kernel_key, ck_records->second);
+      }
+
+      auto consolidation = m_consolidations.find(kernel_key);
+      if (consolidation != m_consolidations.end()) {
+        string group = DB_SPICE_ROOT_KEY + "/" + kernel_key;
+        H5Easy::dump(file, group + "/" + DB_CONSOLIDATED_FILES_KEY, consolidation->second.files, H5Easy::DumpMode::Overwrite);
+        H5Easy::dump(file, group + "/" + DB_CONSOLIDATED_IDS_KEY, consolidation->second.kernel_files, H5Easy::DumpMode::Overwrite);
+      }
+    }
+
+    for (auto &[mission, table] : path_tables) {
+      H5Easy::dump(file, DB_SPICE_ROOT_KEY + "/" + mission + "/" + DB_PATH_TABLE_KEY, table, H5Easy::DumpMode::Overwrite);
+    }
+
+    // Frame definitions live in the mission group so shards merge as they are
+    for (auto &[mission, frame_defs] : m_frame_defs) {
+      if (frame_defs.empty()) {
+        continue;
+      }
+      vector<FrameRecord> records;
+      vector<vector<double>> rotations;
+      for (auto &def : frame_defs) {
+        records.push_back({def.code, def.center, def.frame_class, def.class_id, def.tk_parent});
+        rotations.emplace_back(def.tk_rotation.begin(), def.tk_rotation.end());
+      }
+      string group = DB_SPICE_ROOT_KEY + "/" + mission;
+      SPDLOG_DEBUG("Writing {} frame definitions for {}.", records.size(), mission);
+      if (!file.exist(group)) {
+        file.createGroup(group);
       }
+      file.createDataSet(group + "/" + DB_FRAME_DEFS_KEY, HighFive::DataSpace::From(records),
+                         HighFive::create_datatype<FrameRecord>()).write(records);
+      H5Easy::dump(file, group + "/" + DB_FRAME_ROTATIONS_KEY, rotations, H5Easy::DumpMode::Overwrite);
+    }
+
+    // Keyword stores are kept as JSON documents in the mission group
+    for (auto &[mission, store] : m_keywords) {
+      SPDLOG_DEBUG("Writing the keyword store for {}.", mission);
+      H5Easy::dump(file, DB_SPICE_ROOT_KEY + "/" + mission + "/" + DB_KEYWORDS_KEY, store.dump(), H5Easy::DumpMode::Overwrite);
     }
 
     /* Save HDF file */
@@ -680,21 +1891,13 @@ namespace SpiceQL {
 
   namespace {
     std::mutex g_frame_cache_mutex;
-    std::string g_frame_cache_key;  // "<path>@<write-time>" of the loaded DB
+    std::string g_frame_cache_key;  // DB stamp the maps were loaded from
     std::unordered_map<int, std::string> g_code_to_name;
     std::unordered_map<std::string, int> g_name_to_code;  // keyed on UPPER name
 
+    // callers must hold g_frame_cache_mutex
     void loadFrameCache(InventoryImpl *impl) {
-      std::lock_guard<std::mutex> lock(g_frame_cache_mutex);
-
-      string hdf_file = (fs::path(getCacheDir()) / DB_HDF_FILE).string();
-      string key = hdf_file;
-      try {
-        if (fs::exists(hdf_file)) {
-          key += "@" + std::to_string(
-              static_cast<long long>(fs::last_write_time(hdf_file).time_since_epoch().count()));
-        }
-      } catch (...) { /* fall through with path-only key */ }
+      string key = syncDbState();
 
       if (key == g_frame_cache_key) {
         return;  // already loaded for this exact DB state
@@ -740,6 +1943,10 @@ namespace SpiceQL {
 
 
   string InventoryImpl::getFrameName(int code) {
+    if (shared_ptr<const SharedIndex> shared_index = SharedIndex::current()) {
+      return shared_index->getFrameName(code);
+    }
+    std::lock_guard<std::mutex> lock(g_frame_cache_mutex);
     loadFrameCache(this);
     auto it = g_code_to_name.find(code);
     if (it != g_code_to_name.end()) return it->second;
@@ -747,7 +1954,19 @@ namespace SpiceQL {
   }
 
 
+  unordered_map<int, string> InventoryImpl::getFrameNameMap() {
+    // The shared index only answers point lookups, so always read the DB maps
+    std::lock_guard<std::mutex> lock(g_frame_cache_mutex);
+    loadFrameCache(this);
+    return g_code_to_name;
+  }
+
+
   int InventoryImpl::getFrameCode(string name) {
+    if (shared_ptr<const SharedIndex> shared_index = SharedIndex::current()) {
+      return shared_index->getFrameCode(name);
+    }
+    std::lock_guard<std::mutex> lock(g_frame_cache_mutex);
     loadFrameCache(this);
     auto it = g_name_to_code.find(toUpper(name));
     if (it != g_name_to_code.end()) return it->second;
@@ -0,0 +1,304 @@
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <ghc/fs_std.hpp>
+
+#include <SpiceQL/spiceql_logging.h>
+#include <SpiceQL/prefetch.h>
+#include <SpiceQL/spice_types.h>
+#include <SpiceQL/utils.h>
+
+using json = nlohmann::json;
+using namespace std;
+
+namespace SpiceQL {
+
+  string KERNEL_PREFETCH_ENV_VAR = "SPICEQL_PREFETCH_THREADS";
+
+  namespace {
+    const size_t MAX_QUEUED = 64;        // kernels waiting to be read
+    const size_t MAX_WARM = 4096;        // kernels remembered as warm
+    const size_t MAX_WINDOWS = 256;      // kinds of search whose last window is remembered
+    const size_t READ_CHUNK = 1 << 20;
+
+    struct Window {
+      double start;
+      double stop;
+    };
+
+    std::mutex g_mutex;
+    std::condition_variable g_wake;
+    bool g_threads_read = false;
+    size_t g_threads = 0;
+    bool g_stopping = false;
+
+    deque<string> g_queue;
+    unordered_set<string> g_pending;                  // queued or being read
+    unordered_map<string, bool> g_warm;               // true if read ahead and not used since
+    deque<string> g_warm_order;
+    unordered_map<string, Window> g_windows;
+
+    uint64_t g_read = 0;
+    uint64_t g_bytes = 0;
+    uint64_t g_hits = 0;
+    uint64_t g_late = 0;
+    uint64_t g_misses = 0;
+    uint64_t g_dropped = 0;
+    uint64_t g_failed = 0;
+
+
+    // Joins the workers when the process exits, declared after the state they use
+    struct Workers {
+      vector<thread> threads;
+
+      // callers must not hold g_mutex
+      void stop() {
+        {
+          std::lock_guard<std::mutex> lock(g_mutex);
+          g_stopping = true;
+        }
+        g_wake.notify_all();
+        for (auto &t : threads) {
+          t.join();
+        }
+        threads.clear();
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_stopping = false;
+      }
+
+      ~Workers() {
+        stop();
+      }
+    };
+    Workers g_workers;
+    std::mutex g_workers_mutex;
+
+
+    string kernelFile(const string &path) {
+      return resolveDataPath(path);
+    }
+
+
+    vector<string> timeKernelFiles(const json &kernels) {
+      vector<string> files;
+      for (auto type : {"ck", "spk"}) {
+        if (!kernels.is_object() || !kernels.contains(type) || !kernels[type].is_array()) {
+          continue;
+        }
+        for (auto &path : kernels[type]) {
+          files.push_back(kernelFile(path.get<string>()));
+        }
+      }
+      return files;
+    }
+
+
+    // callers must hold g_mutex
+    void markWarm(const string &path, bool prefetched) {
+      if (!g_warm.count(path)) {
+        g_warm_order.push_back(path);
+        if (g_warm_order.size() > MAX_WARM) {
+          g_warm.erase(g_warm_order.front());
+          g_warm_order.pop_front();
+        }
+      }
+      g_warm[path] = prefetched;
+    }
+
+
+    // callers must hold g_mutex
+    void readThreads() {
+      if (g_threads_read) {
+        return;
+      }
+      g_threads_read = true;
+      const char *env = getenv(KERNEL_PREFETCH_ENV_VAR.c_str());
+      try {
+        g_threads = env ? stoul(env) : 0;
+      }
+      catch (exception &e) {
+        SPDLOG_WARN("Ignoring invalid {}: {}", KERNEL_PREFETCH_ENV_VAR, e.what());
+        g_threads = 0;
+      }
+    }
+
+
+    // Copies the file into the kernel cache, or reads it whole so the OS keeps it cached
+    bool warmFile(const string &path, uint64_t &bytes) {
+      if (!getKernelCacheDir().empty()) {
+        std::error_code ec;
+        string local = cacheKernel(path);
+        bytes = fs::file_size(local, ec);
+        return local != path && !ec;
+      }
+
+      ifstream in(path, ios::binary);
+      if (!in) {
+        return false;
+      }
+      vector<char> buffer(READ_CHUNK);
+      bytes = 0;
+      while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0) {
+        bytes += in.gcount();
+      }
+      return in.eof();
+    }
+
+
+    void work() {
+      std::unique_lock<std::mutex> lock(g_mutex);
+      while (true) {
+        g_wake.wait(lock, []() { return g_stopping || !g_queue.empty(); });
+        if (g_stopping) {
+          return;
+        }
+        string path = g_queue.front();
+        g_queue.pop_front();
+
+        lock.unlock();
+        uint64_t bytes = 0;
+        bool read = warmFile(path, bytes);
+        lock.lock();
+
+        g_pending.erase(path);
+        if (read) {
+          SPDLOG_TRACE("Prefetched {} ({} bytes)", path, bytes);
+          markWarm(path, true);
+          g_read++;
+          g_bytes += bytes;
+        }
+        else {
+          SPDLOG_DEBUG("Could not prefetch {}", path);
+          g_failed++;
+        }
+      }
+    }
+
+
+    // Starts the configured number of workers if they are not running
+    void startWorkers() {
+      size_t threads;
+      {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        readThreads();
+        threads = g_threads;
+      }
+      std::lock_guard<std::mutex> lock(g_workers_mutex);
+      while (g_workers.threads.size() < threads) {
+        g_workers.threads.emplace_back(work);
+      }
+    }
+  }
+
+
+  void KernelPrefetcher::setThreads(size_t threads) {
+    std::lock_guard<std::mutex> workers_lock(g_workers_mutex);
+    g_workers.stop();
+    {
+      std::lock_guard<std::mutex> lock(g_mutex);
+      g_threads_read = true;
+      g_threads = threads;
+    }
+    while (g_workers.threads.size() < threads) {
+      g_workers.threads.emplace_back(work);
+    }
+  }
+
+
+  size_t KernelPrefetcher::getThreads() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    readThreads();
+    return g_threads;
+  }
+
+
+  bool KernelPrefetcher::observe(const string &key, double start_time, double stop_time, const json &kernels,
+                                 double &next_start, double &next_stop) {
+    if (!getThreads()) {
+      return false;
+    }
+    vector<string> files = timeKernelFiles(kernels);
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    for (auto &path : files) {
+      auto warm = g_warm.find(path);
+      if (g_pending.count(path)) {
+        g_late++;
+      }
+      else if (warm == g_warm.end()) {
+        g_misses++;
+        markWarm(path, false);
+      }
+      else if (warm->second) {
+        g_hits++;
+        warm->second = false;
+      }
+    }
+
+    auto last = g_windows.find(key);
+    bool predicted = last != g_windows.end() && start_time > last->second.start;
+    if (predicted) {
+      double step = start_time - last->second.start;
+      next_start = start_time + step;
+      next_stop = stop_time + step;
+    }
+    if (last == g_windows.end() && g_windows.size() >= MAX_WINDOWS) {
+      g_windows.clear();
+    }
+    g_windows[key] = {start_time, stop_time};
+    return predicted;
+  }
+
+
+  void KernelPrefetcher::prefetch(const json &kernels) {
+    vector<string> files = timeKernelFiles(kernels);
+    startWorkers();
+
+    size_t queued = 0;
+    {
+      std::lock_guard<std::mutex> lock(g_mutex);
+      if (!g_threads) {
+        return;
+      }
+      for (auto &path : files) {
+        if (g_warm.count(path) || g_pending.count(path)) {
+          continue;
+        }
+        if (g_queue.size() >= MAX_QUEUED) {
+          g_dropped++;
+          continue;
+        }
+        g_queue.push_back(path);
+        g_pending.insert(path);
+        queued++;
+      }
+    }
+    if (queued) {
+      SPDLOG_TRACE("Queued {} kernels to prefetch", queued);
+      g_wake.notify_all();
+    }
+  }
+
+
+  json KernelPrefetcher::stats() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    readThreads();
+    uint64_t searched = g_hits + g_late + g_misses;
+    return {{"threads", g_threads},
+            {"queued", g_queue.size()},
+            {"read", g_read},
+            {"bytes", g_bytes},
+            {"hits", g_hits},
+            {"late", g_late},
+            {"misses", g_misses},
+            {"hit_rate", searched ? double(g_hits) / searched : 0.0},
+            {"dropped", g_dropped},
+            {"failed", g_failed}};
+  }
+}
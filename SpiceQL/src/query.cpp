@@ -6,8 +6,16 @@
   *
  **/
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <exception>
 #include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+#ifndef SPICEQL_WASM
+#include <thread>
+#endif
 
 #include <SpiceUsr.h>
 
@@ -83,76 +91,108 @@ namespace SpiceQL {
     if(kernels.empty()) {
       throw invalid_argument("Can't get latest kernel from empty vector");
     }
-    vector<vector<string>> files = {};
 
     string extension = static_cast<fs::path>(kernels.at(0)).extension().string();
     transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    // Versions of the same file share the file name up to its first digit,
+    // group on that prefix in one pass and keep the groups in first seen order
+    unordered_map<string, size_t> groupIndex;
+    groupIndex.reserve(kernels.size());
+    vector<string> outKernels = {};
+    vector<string> latestNames = {};
+
     // ensure everything is different versions of the same file
-    for(const fs::path &k : kernels) {
+    for(const string &kernel : kernels) {
+      const fs::path k = kernel;
       string currentKernelExt = k.extension().string();
       transform(currentKernelExt.begin(), currentKernelExt.end(), currentKernelExt.begin(), ::tolower);
       if (currentKernelExt != extension) {
         throw invalid_argument("The input extensions (" + k.filename().string() + ") are not different versions of the same file " + kernels.at(0));
       }
-      bool foundList = false;
-      for (int i = 0; i < files.size(); i++) {
-        
-        const fs::path &firstVecElem = files[i][0];
-        string fileName = firstVecElem.filename().string();
-        string kernelName = k.filename().string();
-        SPDLOG_TRACE("filename: {}", fileName); 
-        SPDLOG_TRACE("kernel name: {}", kernelName); 
-
-        int findRes = fileName.find_first_of("0123456789");
-        if (findRes != string::npos) {
-          fileName = fileName.erase(findRes);
-        }
 
-        findRes = kernelName.find_first_of("0123456789");
-        if (findRes != string::npos) {
-          kernelName = kernelName.erase(findRes);
-        }
-        SPDLOG_TRACE("Truncated filename: {}", fileName); 
-        SPDLOG_TRACE("Truncated kernel name: {}", kernelName); 
+      string kernelName = k.filename().string();
+      string prefix = kernelName.substr(0, kernelName.find_first_of("0123456789"));
+      SPDLOG_TRACE("Truncated kernel name: {}", prefix);
 
-        if (fileName == kernelName) {
-          files[i].push_back(k.string());
-          foundList = true;
-        }
+      auto [it, inserted] = groupIndex.try_emplace(prefix, outKernels.size());
+      if (inserted) {
+        outKernels.push_back(kernel);
+        latestNames.push_back(kernelName);
       }
-      if (!foundList) {
-        files.push_back({k.string()});
+      // keep the first of equal names, same as max_element with fileNameComp
+      else if (latestNames[it->second].compare(kernelName) < 0) {
+        outKernels[it->second] = kernel;
+        latestNames[it->second] = kernelName;
       }
-      foundList = false;
-    }
-
-    vector<string> outKernels = {};
-    for (auto kernelList : files) {
-      outKernels.push_back(*(max_element(kernelList.begin(), kernelList.end(), fileNameComp)));
     }
 
     return outKernels;
   }
 
 
-  json getLatestKernels(json kernels) {
+  json getLatestKernels(json kernels, bool parallel) {
     SPDLOG_TRACE("Looking for kernels to get Latest: {}", kernels.dump(2));
     vector<json::json_pointer> kptrs = findKeyInJson(kernels, "kernels", true);
-    vector<vector<string>> lastest;
 
+    vector<vector<vector<string>>> kvects;
+    kvects.reserve(kptrs.size());
     for (json::json_pointer &ptr : kptrs) {
       SPDLOG_TRACE("Getting Latest Kernels from: {}", ptr.to_string());
       SPDLOG_TRACE("JSON: {}", kernels[ptr].dump());
-      vector<vector<string>> kvect = json2DArrayTo2DVector(kernels[ptr]);
-      vector<vector<string>> newLatest;
- 
-      for (auto &vec : kvect) {
-        vector<string> latest = getLatestKernel(vec);
-        SPDLOG_TRACE("Adding Kernels To Latest: {}", fmt::join(latest, ", "));
-        newLatest.push_back(latest);
+      kvects.push_back(json2DArrayTo2DVector(kernels[ptr]));
+    }
+
+    vector<vector<vector<string>>> latest(kptrs.size());
+    auto resolve = [&](size_t i) {
+      for (auto &vec : kvects[i]) {
+        vector<string> newLatest = getLatestKernel(vec);
+        SPDLOG_TRACE("Adding Kernels To Latest: {}", fmt::join(newLatest, ", "));
+        latest[i].push_back(newLatest);
       }
-      
-      kernels[ptr] = newLatest;
+    };
+
+#ifndef SPICEQL_WASM
+    size_t nthreads = min<size_t>(kptrs.size(), max(1u, thread::hardware_concurrency()));
+    if (parallel && nthreads > 1) {
+      // Pointers are independent, workers take the next unresolved one until
+      // all are done. The first error is rethrown once every worker finished.
+      atomic<size_t> next = 0;
+      exception_ptr error;
+      mutex error_mutex;
+      vector<thread> workers;
+      for (size_t t = 0; t < nthreads; t++) {
+        workers.emplace_back([&]() {
+          for (size_t i = next++; i < kptrs.size(); i = next++) {
+            try {
+              resolve(i);
+            }
+            catch (...) {
+              lock_guard<mutex> lock(error_mutex);
+              if (!error) {
+                error = current_exception();
+              }
+            }
+          }
+        });
+      }
+      for (auto &worker : workers) {
+        worker.join();
+      }
+      if (error) {
+        rethrow_exception(error);
+      }
+    }
+    else
+#endif
+    {
+      for (size_t i = 0; i < kptrs.size(); i++) {
+        resolve(i);
+      }
+    }
+
+    for (size_t i = 0; i < kptrs.size(); i++) {
+      kernels[kptrs[i]] = latest[i];
     }
 
     return kernels;
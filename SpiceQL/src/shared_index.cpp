@@ -0,0 +1,440 @@
+#include <cerrno>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <ghc/fs_std.hpp>
+#include <highfive/highfive.hpp>
+
+#include <SpiceQL/spiceql_logging.h>
+#include <SpiceQL/inventoryimpl.h>
+#include <SpiceQL/shared_index.h>
+#include <SpiceQL/utils.h>
+
+using namespace std;
+
+namespace SpiceQL {
+
+  string SHARED_INDEX_FILE = "spiceqldb.idx";
+  string SHARED_INDEX_ENV_VAR = "SPICEQL_SHARED_INDEX";
+
+  namespace {
+    const char SHARED_INDEX_MAGIC[8] = {'S', 'P', 'Q', 'L', 'I', 'D', 'X', '\0'};
+    const uint32_t SHARED_INDEX_VERSION = 1;
+
+    struct SharedIndexHeader {
+      char magic[8];
+      uint32_t version;
+      uint32_t reserved;
+      uint64_t generation;
+      uint64_t file_size;
+      uint64_t nkeys;
+      uint64_t keys_offset;         // SharedKeyEntry[nkeys], sorted by key
+      uint64_t nframe_codes;
+      uint64_t frame_codes_offset;  // SharedFrameEntry[nframe_codes], sorted by code
+      uint64_t nframe_names;
+      uint64_t frame_names_offset;  // SharedFrameEntry[nframe_names], sorted by upper case name
+    };
+
+    struct SharedKeyEntry {
+      SharedString key;
+      uint64_t nkernels;
+      uint64_t paths_offset;  // SharedString[nkernels], in file index order
+      uint64_t ntimes;        // 0 for time independent keys
+      uint64_t start_offset;  // SharedTimeEntry[ntimes], sorted by time
+      uint64_t stop_offset;   // SharedTimeEntry[ntimes], sorted by time
+    };
+
+    struct SharedFrameEntry {
+      int64_t code;
+      SharedString name;
+    };
+
+
+    // Append-only image of the index file. Everything is 8 byte aligned so
+    // the structs can be used in place once mapped.
+    class SharedIndexBuilder {
+      public:
+      SharedIndexBuilder() : m_data(sizeof(SharedIndexHeader), 0) {}
+
+      uint64_t append(const void *data, size_t size) {
+        m_data.resize((m_data.size() + 7) & ~size_t(7), 0);
+        uint64_t offset = m_data.size();
+        m_data.insert(m_data.end(), (const char *)data, (const char *)data + size);
+        return offset;
+      }
+
+      template<class T>
+      uint64_t append(const vector<T> &values) {
+        return append(values.data(), values.size() * sizeof(T));
+      }
+
+      SharedString appendString(const string &s) {
+        return {append(s.data(), s.size()), s.size()};
+      }
+
+      SharedIndexHeader &header() {
+        return *reinterpret_cast<SharedIndexHeader *>(m_data.data());
+      }
+
+      vector<char> &data() {
+        return m_data;
+      }
+
+      private:
+      vector<char> m_data;
+    };
+
+
+    // Change marker for the index file, so remapping is only attempted when it was republished.
+    string indexFileStamp(const string &file) {
+      std::error_code ec;
+      if (!fs::exists(file, ec)) {
+        return "";
+      }
+      return std::to_string(static_cast<long long>(fs::last_write_time(file, ec).time_since_epoch().count()))
+             + "@" + std::to_string(static_cast<unsigned long long>(fs::file_size(file, ec)));
+    }
+
+
+    std::mutex g_shared_index_mutex;
+    std::shared_ptr<const SharedIndex> g_shared_index;
+    bool g_shared_index_enabled = false;
+    string g_shared_index_tried_stamp;
+  }
+
+
+  string SharedKernelIndex::file_path(size_t i) const {
+    const SharedString &s = m_paths[i];
+    return string(m_base + s.offset, s.length);
+  }
+
+
+  SharedIndex::SharedIndex(const char *data, size_t size, string stamp) : m_data(data), m_size(size), m_stamp(stamp) {}
+
+
+  SharedIndex::~SharedIndex() {
+#if !defined(_WIN32)
+    munmap((void *)m_data, m_size);
+#endif
+  }
+
+
+  string SharedIndex::getFile() {
+    return (fs::path(getCacheDir()) / SHARED_INDEX_FILE).string();
+  }
+
+
+  void SharedIndex::publish() {
+    string hdf_file = (fs::path(getCacheDir()) / DB_HDF_FILE).string();
+    if (!fs::exists(hdf_file)) {
+      throw runtime_error("DB for kernels (" + hdf_file + ") does not exist");
+    }
+
+    SharedIndexBuilder builder;
+    vector<pair<string, SharedKeyEntry>> keys;
+
+    auto appendPaths = [&builder](const vector<string> &paths) {
+      vector<SharedString> strings;
+      strings.reserve(paths.size());
+      for (auto &p : paths) {
+        strings.push_back(builder.appendString(p));
+      }
+      return builder.append(strings);
+    };
+
+    HighFive::File file(hdf_file, HighFive::File::ReadOnly);
+    uint64_t generation = 0;
+    if (file.hasAttribute(DB_GENERATION_KEY)) {
+      file.getAttribute(DB_GENERATION_KEY).read(generation);
+    }
+
+    // spice/<mission>/<type> lists time independent kernels,
+    // spice/<mission>/<type>/<quality> groups hold time indices
+    HighFive::Group root = file.getGroup(DB_SPICE_ROOT_KEY);
+    for (auto &mission : root.listObjectNames()) {
+      if (root.getObjectType(mission) != HighFive::ObjectType::Group) {
+        continue;
+      }
+      HighFive::Group mission_group = root.getGroup(mission);
+      for (auto &type : mission_group.listObjectNames()) {
+        // skip the mission's path table and frame definitions
+        if (type.rfind("spql_", 0) == 0) {
+          continue;
+        }
+        string type_key = mission + "/" + type;
+
+        if (mission_group.getObjectType(type) == HighFive::ObjectType::Dataset) {
+          vector<string> paths = mission_group.getDataSet(type).read<vector<string>>();
+          SharedKeyEntry entry = {};
+          entry.nkernels = paths.size();
+          entry.paths_offset = appendPaths(paths);
+          keys.push_back({type_key, entry});
+          continue;
+        }
+
+        for (auto &quality : mission_group.getGroup(type).listObjectNames()) {
+          string key = type_key + "/" + quality;
+          shared_ptr<TimeIndexedKernels> time_indices = getTimeIndexedKernels(key, hdf_file);
+          if (!time_indices) {
+            continue;
+          }
+
+          vector<SharedTimeEntry> start_times;
+          vector<SharedTimeEntry> stop_times;
+          for (const auto &[k, v] : time_indices->start_times) {
+            start_times.push_back({k, v});
+          }
+          for (const auto &[k, v] : time_indices->stop_times) {
+            stop_times.push_back({k, v});
+          }
+
+          SharedKeyEntry entry = {};
+          entry.nkernels = time_indices->file_paths.size();
+          entry.paths_offset = appendPaths(time_indices->file_paths);
+          entry.ntimes = std::min(start_times.size(), stop_times.size());
+          start_times.resize(entry.ntimes);
+          stop_times.resize(entry.ntimes);
+          entry.start_offset = builder.append(start_times);
+          entry.stop_offset = builder.append(stop_times);
+          keys.push_back({key, entry});
+        }
+      }
+    }
+
+    sort(keys.begin(), keys.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+    vector<SharedKeyEntry> key_entries;
+    for (auto &[key, entry] : keys) {
+      entry.key = builder.appendString(key);
+      key_entries.push_back(entry);
+    }
+
+    vector<SharedFrameEntry> frame_codes;
+    vector<SharedFrameEntry> frame_names;
+    if (file.exist(DB_FRAME_CODES_KEY) && file.exist(DB_FRAME_NAMES_KEY)) {
+      vector<int> codes = file.getDataSet(DB_FRAME_CODES_KEY).read<vector<int>>();
+      vector<string> names = file.getDataSet(DB_FRAME_NAMES_KEY).read<vector<string>>();
+      // same resolution as the in-process frame cache, later entries win
+      std::map<int64_t, string> code_to_name;
+      std::map<string, int64_t> name_to_code;
+      for (size_t i = 0; i < std::min(codes.size(), names.size()); i++) {
+        code_to_name[codes[i]] = names[i];
+        name_to_code[toUpper(names[i])] = codes[i];
+      }
+      for (auto &[code, name] : code_to_name) {
+        frame_codes.push_back({code, builder.appendString(name)});
+      }
+      for (auto &[name, code] : name_to_code) {
+        frame_names.push_back({code, builder.appendString(name)});
+      }
+    }
+
+    uint64_t keys_offset = builder.append(key_entries);
+    uint64_t frame_codes_offset = builder.append(frame_codes);
+    uint64_t frame_names_offset = builder.append(frame_names);
+
+    SharedIndexHeader &header = builder.header();
+    memcpy(header.magic, SHARED_INDEX_MAGIC, sizeof(header.magic));
+    header.version = SHARED_INDEX_VERSION;
+    header.generation = generation;
+    header.file_size = builder.data().size();
+    header.nkeys = key_entries.size();
+    header.keys_offset = keys_offset;
+    header.nframe_codes = frame_codes.size();
+    header.frame_codes_offset = frame_codes_offset;
+    header.nframe_names = frame_names.size();
+    header.frame_names_offset = frame_names_offset;
+
+    fs::path index_file = getFile();
+    fs::path tmp_file = index_file.string() + "." + gen_random(10) + ".tmp";
+    try {
+      std::ofstream out(tmp_file.string(), std::ios::binary | std::ios::trunc);
+      out.write(builder.data().data(), builder.data().size());
+      out.close();
+      if (out.fail()) {
+        throw runtime_error("could not write " + tmp_file.string());
+      }
+      fs::rename(tmp_file, index_file);
+    }
+    catch (exception &e) {
+      std::error_code ec;
+      fs::remove(tmp_file, ec);
+      throw runtime_error("Failed to publish shared index [" + index_file.string() + "]: " + e.what());
+    }
+    SPDLOG_DEBUG("Published shared index {} for DB generation {}: {} keys, {} frames, {} bytes",
+                 index_file.string(), generation, key_entries.size(), frame_codes.size(), builder.data().size());
+  }
+
+
+  shared_ptr<const SharedIndex> SharedIndex::map(const string &file, const string &stamp) {
+#if defined(_WIN32)
+    throw runtime_error("The shared inventory index is not supported on Windows.");
+#else
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw runtime_error("Could not open shared index [" + file + "]: " + strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SharedIndexHeader)) {
+      close(fd);
+      throw runtime_error("Shared index [" + file + "] is truncated.");
+    }
+    size_t size = st.st_size;
+    void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      throw runtime_error("Could not map shared index [" + file + "]: " + strerror(errno));
+    }
+
+    shared_ptr<const SharedIndex> index(new SharedIndex((const char *)data, size, stamp));
+    const SharedIndexHeader *header = (const SharedIndexHeader *)data;
+    if (memcmp(header->magic, SHARED_INDEX_MAGIC, sizeof(header->magic)) != 0
+        || header->version != SHARED_INDEX_VERSION
+        || header->file_size != size
+        || header->keys_offset + header->nkeys * sizeof(SharedKeyEntry) > size
+        || header->frame_codes_offset + header->nframe_codes * sizeof(SharedFrameEntry) > size
+        || header->frame_names_offset + header->nframe_names * sizeof(SharedFrameEntry) > size) {
+      throw runtime_error("[" + file + "] is not a valid shared index.");
+    }
+    return index;
+#endif
+  }
+
+
+  bool SharedIndex::attach() {
+    string file = getFile();
+    string stamp = indexFileStamp(file);
+    shared_ptr<const SharedIndex> index = map(file, stamp);
+
+    std::lock_guard<std::mutex> lock(g_shared_index_mutex);
+    g_shared_index = index;
+    g_shared_index_enabled = true;
+    g_shared_index_tried_stamp = stamp;
+    SPDLOG_DEBUG("Attached shared index {} (DB generation {})", file, index->generation());
+    return index->generation() == getDbGeneration();
+  }
+
+
+  void SharedIndex::detach() {
+    std::lock_guard<std::mutex> lock(g_shared_index_mutex);
+    g_shared_index = nullptr;
+    g_shared_index_enabled = false;
+    g_shared_index_tried_stamp = "";
+  }
+
+
+  shared_ptr<const SharedIndex> SharedIndex::current() {
+    uint64_t generation = getDbGeneration();
+
+    std::lock_guard<std::mutex> lock(g_shared_index_mutex);
+    if (g_shared_index && g_shared_index->generation() == generation) {
+      return g_shared_index;
+    }
+
+    static bool env_checked = false;
+    if (!env_checked) {
+      env_checked = true;
+      g_shared_index_enabled = g_shared_index_enabled || getenv(SHARED_INDEX_ENV_VAR.c_str()) != NULL;
+    }
+    if (!g_shared_index_enabled) {
+      return nullptr;
+    }
+
+    // stale or not attached yet; remap only if the file changed since the last try
+    string file = getFile();
+    string stamp = indexFileStamp(file);
+    if (stamp.empty() || stamp == g_shared_index_tried_stamp) {
+      return nullptr;
+    }
+    g_shared_index_tried_stamp = stamp;
+    try {
+      shared_ptr<const SharedIndex> index = map(file, stamp);
+      if (index->generation() == generation) {
+        SPDLOG_DEBUG("Attached shared index {} (DB generation {})", file, generation);
+        g_shared_index = index;
+        return index;
+      }
+      SPDLOG_DEBUG("Shared index {} is for DB generation {}, DB is at {}", file, index->generation(), generation);
+    }
+    catch (exception &e) {
+      SPDLOG_DEBUG("Could not attach shared index: {}", e.what());
+    }
+    return nullptr;
+  }
+
+
+  uint64_t SharedIndex::generation() const {
+    return ((const SharedIndexHeader *)m_data)->generation;
+  }
+
+
+  string SharedIndex::str(const SharedString &s) const {
+    return string(m_data + s.offset, s.length);
+  }
+
+
+  bool SharedIndex::findKernels(string key, SharedKernelIndex &index) const {
+    while (!key.empty() && key.back() == '/') {
+      key.pop_back();
+    }
+
+    const SharedIndexHeader *header = (const SharedIndexHeader *)m_data;
+    const SharedKeyEntry *begin = (const SharedKeyEntry *)(m_data + header->keys_offset);
+    const SharedKeyEntry *end = begin + header->nkeys;
+    const SharedKeyEntry *it = std::lower_bound(begin, end, key, [this](const SharedKeyEntry &e, const string &k) {
+      return str(e.key) < k;
+    });
+    if (it == end || str(it->key) != key) {
+      return false;
+    }
+
+    const SharedTimeEntry *starts = (const SharedTimeEntry *)(m_data + it->start_offset);
+    const SharedTimeEntry *stops = (const SharedTimeEntry *)(m_data + it->stop_offset);
+    index.start_times = it->ntimes ? SharedTimeMap(starts, starts + it->ntimes) : SharedTimeMap();
+    index.stop_times = it->ntimes ? SharedTimeMap(stops, stops + it->ntimes) : SharedTimeMap();
+    index.m_base = m_data;
+    index.m_paths = (const SharedString *)(m_data + it->paths_offset);
+    index.m_size = it->nkernels;
+    return true;
+  }
+
+
+  string SharedIndex::getFrameName(int code) const {
+    const SharedIndexHeader *header = (const SharedIndexHeader *)m_data;
+    const SharedFrameEntry *begin = (const SharedFrameEntry *)(m_data + header->frame_codes_offset);
+    const SharedFrameEntry *end = begin + header->nframe_codes;
+    const SharedFrameEntry *it = std::lower_bound(begin, end, (int64_t)code, [](const SharedFrameEntry &e, int64_t c) {
+      return e.code < c;
+    });
+    if (it == end || it->code != code) {
+      return "";
+    }
+    return str(it->name);
+  }
+
+
+  int SharedIndex::getFrameCode(string name) const {
+    name = toUpper(name);
+    const SharedIndexHeader *header = (const SharedIndexHeader *)m_data;
+    const SharedFrameEntry *begin = (const SharedFrameEntry *)(m_data + header->frame_names_offset);
+    const SharedFrameEntry *end = begin + header->nframe_names;
+    const SharedFrameEntry *it = std::lower_bound(begin, end, name, [this](const SharedFrameEntry &e, const string &n) {
+      return str(e.name) < n;
+    });
+    if (it == end || str(it->name) != name) {
+      return 0;
+    }
+    return (int)it->code;
+  }
+}
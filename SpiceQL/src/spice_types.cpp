@@ -4,6 +4,23 @@
   *
  **/
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_set>
+
+#if !defined(_WIN32) && !defined(SPICEQL_WASM)
+// cached kernel copies are locked while furnished
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <fmt/format.h>
 #include <SpiceUsr.h>
 
@@ -63,6 +80,1694 @@ namespace SpiceQL {
                                                                       {Kernel::Type::PCK,  ".tpc"},
                                                                       {Kernel::Type::SCLK, ".tsc"}};
 
+  string KERNEL_TELEMETRY_FILE = "kernel_telemetry.json";
+  string KERNEL_TELEMETRY_ENV_VAR = "SPICEQL_KERNEL_TELEMETRY";
+
+  namespace {
+    struct KernelUsage {
+      uint64_t furnishes = 0;
+      uint64_t bytes = 0;
+      double seconds = 0;
+
+      void add(const KernelUsage &other) {
+        furnishes += other.furnishes;
+        bytes += other.bytes;
+        seconds += other.seconds;
+      }
+    };
+
+    // Counts are flushed to the cache directory at most this often
+    const chrono::seconds TELEMETRY_FLUSH_INTERVAL(60);
+
+    std::atomic<int> g_telemetry_enabled{-1};  // -1 until the env var is read
+    std::mutex g_telemetry_mutex;
+    unordered_map<string, KernelUsage> g_telemetry_pending;  // since the last flush
+    chrono::steady_clock::time_point g_telemetry_flushed = chrono::steady_clock::now();
+
+
+    string telemetryFile() {
+      // The DB path is empty when there is no cache directory (e.g. WASM)
+      string db_file = Inventory::getDbFilePath();
+      if (db_file.empty()) {
+        return "";
+      }
+      return (fs::path(db_file).parent_path() / KERNEL_TELEMETRY_FILE).string();
+    }
+
+
+    // Persisted counts are stored as {"kernels": {path: [furnishes, bytes, seconds]}}
+    unordered_map<string, KernelUsage> readTelemetry(const string &file) {
+      unordered_map<string, KernelUsage> usage;
+      if (file.empty() || !fs::exists(file)) {
+        return usage;
+      }
+      try {
+        ifstream in(file);
+        json j = json::parse(in);
+        for (auto &[path, counts] : j.at("kernels").items()) {
+          usage[path] = {counts.at(0).get<uint64_t>(), counts.at(1).get<uint64_t>(), counts.at(2).get<double>()};
+        }
+      }
+      catch (exception &e) {
+        SPDLOG_WARN("Ignoring unreadable kernel telemetry [{}]: {}", file, e.what());
+        usage.clear();
+      }
+      return usage;
+    }
+
+
+    // callers must hold g_telemetry_mutex
+    void flushTelemetry() {
+      g_telemetry_flushed = chrono::steady_clock::now();
+      if (g_telemetry_pending.empty()) {
+        return;
+      }
+      string file = telemetryFile();
+      if (file.empty()) {
+        return;
+      }
+
+      unordered_map<string, KernelUsage> usage = readTelemetry(file);
+      for (auto &[path, pending] : g_telemetry_pending) {
+        usage[path].add(pending);
+      }
+
+      json kernels = json::object();
+      for (auto &[path, counts] : usage) {
+        kernels[path] = {counts.furnishes, counts.bytes, counts.seconds};
+      }
+
+      // Write next to the file and rename so readers never see half of it
+      string tmp_file = file + "." + gen_random(10) + ".tmp";
+      try {
+        {
+          ofstream out(tmp_file);
+          out << json({{"kernels", kernels}}).dump();
+        }
+        fs::rename(tmp_file, file);
+        SPDLOG_DEBUG("Flushed telemetry for {} kernels to {}", g_telemetry_pending.size(), file);
+        g_telemetry_pending.clear();
+      }
+      catch (exception &e) {
+        SPDLOG_WARN("Could not write kernel telemetry [{}]: {}", file, e.what());
+      }
+    }
+
+
+    void recordFurnish(const string &path, double seconds) {
+      std::error_code ec;
+      uint64_t bytes = fs::file_size(path, ec);
+      if (ec) {
+        bytes = 0;
+      }
+
+      // Key on the path under the data directory so counts survive a moved data area
+      string key = path;
+      fs::path relative = fs::path(path).lexically_relative(getDataDirectory());
+      if (!relative.empty() && *relative.begin() != "..") {
+        key = relative.string();
+      }
+
+      std::lock_guard<std::mutex> lock(g_telemetry_mutex);
+      g_telemetry_pending[key].add({1, bytes, seconds});
+      if (chrono::steady_clock::now() - g_telemetry_flushed >= TELEMETRY_FLUSH_INTERVAL) {
+        flushTelemetry();
+      }
+    }
+  }
+
+
+  void setKernelTelemetry(bool enabled) {
+    g_telemetry_enabled = enabled;
+  }
+
+
+  bool isKernelTelemetryEnabled() {
+    int enabled = g_telemetry_enabled.load();
+    if (enabled < 0) {
+      const char *env = getenv(KERNEL_TELEMETRY_ENV_VAR.c_str());
+      enabled = env != NULL && toLower(string(env)) == "true";
+      int unset = -1;
+      g_telemetry_enabled.compare_exchange_strong(unset, enabled);
+      enabled = g_telemetry_enabled.load();
+    }
+    return enabled > 0;
+  }
+
+
+  void flushKernelTelemetry() {
+    std::lock_guard<std::mutex> lock(g_telemetry_mutex);
+    flushTelemetry();
+  }
+
+
+  json getHotKernels(int n) {
+    unordered_map<string, KernelUsage> usage;
+    {
+      std::lock_guard<std::mutex> lock(g_telemetry_mutex);
+      usage = readTelemetry(telemetryFile());
+      for (auto &[path, pending] : g_telemetry_pending) {
+        usage[path].add(pending);
+      }
+    }
+
+    unordered_map<string, KernelUsage> missions;
+    for (auto &[path, counts] : usage) {
+      fs::path p(path);
+      if (p.is_relative() && p.begin() != p.end()) {
+        missions[p.begin()->string()].add(counts);
+      }
+    }
+
+    auto top = [n](const unordered_map<string, KernelUsage> &counts, string key) {
+      vector<pair<string, KernelUsage>> sorted(counts.begin(), counts.end());
+      sort(sorted.begin(), sorted.end(), [](auto &a, auto &b) {
+        return a.second.furnishes != b.second.furnishes ? a.second.furnishes > b.second.furnishes : a.first < b.first;
+      });
+      if (n >= 0 && sorted.size() > (size_t)n) {
+        sorted.resize(n);
+      }
+      json entries = json::array();
+      for (auto &[name, c] : sorted) {
+        entries.push_back({{key, name}, {"furnishes", c.furnishes}, {"bytes", c.bytes}, {"seconds", c.seconds}});
+      }
+      return entries;
+    };
+
+    return {{"kernels", top(usage, "kernel")}, {"missions", top(missions, "mission")}};
+  }
+
+
+  void resetKernelTelemetry() {
+    std::lock_guard<std::mutex> lock(g_telemetry_mutex);
+    g_telemetry_pending.clear();
+    string file = telemetryFile();
+    if (!file.empty()) {
+      std::error_code ec;
+      fs::remove(file, ec);
+    }
+  }
+
+
+  string KERNEL_POOL_SIZE_ENV_VAR = "SPICEQL_KERNEL_POOL_SIZE";
+  string KERNEL_POOL_MB_ENV_VAR = "SPICEQL_KERNEL_POOL_MB";
+  string TEXT_SNAPSHOT_ENV_VAR = "SPICEQL_TEXT_SNAPSHOTS";
+  string TEXT_SNAPSHOT_DIR = "text_snapshots";
+  string KERNEL_CACHE_DIR_ENV_VAR = "SPICEQL_KERNEL_CACHE_DIR";
+  string KERNEL_CACHE_MB_ENV_VAR = "SPICEQL_KERNEL_CACHE_MB";
+
+  namespace {
+    std::mutex g_cache_mutex;
+    bool g_cache_read = false;
+    string g_cache_dir;            // empty when the cache is off
+    uint64_t g_cache_max_bytes = 0;
+    uint64_t g_cache_hits = 0;
+    uint64_t g_cache_copies = 0;
+    uint64_t g_cache_copied_bytes = 0;
+    uint64_t g_cache_evictions = 0;
+    uint64_t g_cache_failures = 0;
+
+    // Each copy's last use is the modification time of a marker file next to it
+    const string COPY_USED_SUFFIX = ".used";
+
+    // Files furnished through load() and not unloaded since. CSPICE reopens
+    // them by name, so their copies are never evicted.
+    std::mutex g_furnished_mutex;
+    unordered_set<string> g_furnished;
+    // Where flock is available, a shared lock on each furnished copy tells
+    // the other processes sharing the cache directory it is in use.
+    // callers must hold g_furnished_mutex
+    unordered_map<string, int> g_copy_locks;
+
+
+    // callers must hold g_cache_mutex
+    void readKernelCacheSettings() {
+      if (g_cache_read) {
+        return;
+      }
+      g_cache_read = true;
+      const char *dir = getenv(KERNEL_CACHE_DIR_ENV_VAR.c_str());
+      const char *mb = getenv(KERNEL_CACHE_MB_ENV_VAR.c_str());
+      g_cache_dir = dir ? string(dir) : "";
+      try {
+        g_cache_max_bytes = mb ? stoull(mb) * 1024 * 1024 : 0;
+      }
+      catch (exception &e) {
+        SPDLOG_WARN("Ignoring invalid kernel cache size: {}", e.what());
+        g_cache_max_bytes = 0;
+      }
+    }
+
+
+    // Path of a data directory kernel relative to the data directory, empty if it is outside
+    string dataRelativePath(const string &path) {
+      string prefix = (fs::path(getDataDirectory()) / "").string();
+      if (path.size() <= prefix.size() || !path.starts_with(prefix)) {
+        return "";
+      }
+      return path.substr(prefix.size());
+    }
+
+
+    // Records that a copy was used now
+    void markCopyUsed(const string &local) {
+      string marker = local + COPY_USED_SUFFIX;
+      std::error_code ec;
+      fs::last_write_time(marker, fs::file_time_type::clock::now(), ec);
+      if (ec) {
+        ofstream touch(marker);
+      }
+    }
+
+
+    // Removes the least recently used copies until the cache fits, keeping the
+    // given one and the copies furnished in this process, or in any process
+    // sharing the cache where copies are locked while furnished.
+    void evictKernelCopies(const string &cache_dir, uint64_t max_bytes, const string &keep) {
+      struct Copy {
+        fs::file_time_type used;
+        uint64_t bytes;
+        fs::path path;
+      };
+      vector<Copy> copies;
+      uint64_t total = 0;
+      std::error_code ec;
+      for (auto it = fs::recursive_directory_iterator(cache_dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        string extension = it->path().extension().string();
+        if (!it->is_regular_file(ec) || extension == ".tmp" || extension == COPY_USED_SUFFIX) {
+          continue;
+        }
+        uint64_t bytes = it->file_size(ec);
+        if (ec) {
+          ec.clear();
+          continue;
+        }
+        // copies without a marker were last used when they were made
+        auto used = fs::last_write_time(it->path().string() + COPY_USED_SUFFIX, ec);
+        if (ec) {
+          ec.clear();
+          used = fs::last_write_time(it->path(), ec);
+        }
+        if (!ec) {
+          copies.push_back({used, bytes, it->path()});
+          total += bytes;
+        }
+        ec.clear();
+      }
+      if (total <= max_bytes) {
+        return;
+      }
+
+      unordered_set<string> furnished;
+      {
+        std::lock_guard<std::mutex> lock(g_furnished_mutex);
+        furnished = g_furnished;
+      }
+
+      sort(copies.begin(), copies.end(), [](const Copy &a, const Copy &b) { return a.used < b.used; });
+      for (auto &copy : copies) {
+        if (total <= max_bytes) {
+          break;
+        }
+        if (copy.path.string() == keep || furnished.count(copy.path.string())) {
+          continue;
+        }
+#if !defined(_WIN32) && !defined(SPICEQL_WASM)
+        // removed under an exclusive lock, which fails while any process has it furnished
+        int fd = ::open(copy.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+          continue;
+        }
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+          SPDLOG_TRACE("Not evicting {}, another process has it furnished", copy.path.string());
+          close(fd);
+          continue;
+        }
+#endif
+        bool removed = fs::remove(copy.path, ec);
+#if !defined(_WIN32) && !defined(SPICEQL_WASM)
+        close(fd);
+#endif
+        if (removed) {
+          fs::remove(copy.path.string() + COPY_USED_SUFFIX, ec);
+          // only removed once no other copy shares the version directory
+          fs::remove(copy.path.parent_path(), ec);
+          total -= copy.bytes;
+          std::lock_guard<std::mutex> lock(g_cache_mutex);
+          g_cache_evictions++;
+        }
+      }
+    }
+  }
+
+
+  void setKernelCache(string dir, uint64_t max_bytes) {
+    std::lock_guard<std::mutex> lock(g_cache_mutex);
+    g_cache_read = true;
+    g_cache_dir = dir;
+    g_cache_max_bytes = max_bytes;
+  }
+
+
+  string getKernelCacheDir() {
+    std::lock_guard<std::mutex> lock(g_cache_mutex);
+    readKernelCacheSettings();
+    return g_cache_dir;
+  }
+
+
+  string cacheKernel(string path) {
+    string cache_dir;
+    uint64_t max_bytes;
+    {
+      std::lock_guard<std::mutex> lock(g_cache_mutex);
+      readKernelCacheSettings();
+      cache_dir = g_cache_dir;
+      max_bytes = g_cache_max_bytes;
+    }
+    string relative;
+    if (cache_dir.empty() || (relative = dataRelativePath(path)).empty()) {
+      return path;
+    }
+
+    // copies are kept per modification time, a changed kernel gets a new copy
+    std::error_code ec;
+    auto mtime = fs::last_write_time(path, ec);
+    uint64_t size = ec ? 0 : fs::file_size(path, ec);
+    if (ec) {
+      return path;
+    }
+    fs::path rel(relative);
+    fs::path version = fmt::format("{:x}", (uint64_t)mtime.time_since_epoch().count());
+    string local = (fs::path(cache_dir) / rel.parent_path() / version / rel.filename()).string();
+
+    if (fs::exists(local, ec) && fs::file_size(local, ec) == size && !ec) {
+      markCopyUsed(local);
+      std::lock_guard<std::mutex> lock(g_cache_mutex);
+      g_cache_hits++;
+      return local;
+    }
+
+    // copy next to the final name and rename, so no process sees a partial copy
+    string tmp_file = local + "." + gen_random(10) + ".tmp";
+    try {
+      fs::create_directories(fs::path(local).parent_path());
+      fs::copy_file(path, tmp_file, fs::copy_options::overwrite_existing);
+      if (fs::file_size(tmp_file) != size) {
+        throw runtime_error("kernel changed while it was copied");
+      }
+      fs::rename(tmp_file, local);
+    }
+    catch (exception &e) {
+      SPDLOG_WARN("Could not cache kernel {}, using it in place: {}", path, e.what());
+      fs::remove(tmp_file, ec);
+      std::lock_guard<std::mutex> lock(g_cache_mutex);
+      g_cache_failures++;
+      return path;
+    }
+    SPDLOG_DEBUG("Cached kernel {} as {}", path, local);
+    markCopyUsed(local);
+    {
+      std::lock_guard<std::mutex> lock(g_cache_mutex);
+      g_cache_copies++;
+      g_cache_copied_bytes += size;
+    }
+
+    if (max_bytes) {
+      evictKernelCopies(cache_dir, max_bytes, local);
+    }
+    return local;
+  }
+
+
+  string canonicalKernelPath(string path) {
+    string cache_dir = getKernelCacheDir();
+    if (cache_dir.empty()) {
+      return path;
+    }
+    string prefix = (fs::path(cache_dir) / "").string();
+    if (!path.starts_with(prefix)) {
+      return path;
+    }
+    fs::path rel(path.substr(prefix.size()));
+    return (fs::path(getDataDirectory()) / rel.parent_path().parent_path() / rel.filename()).string();
+  }
+
+
+  json getKernelCacheStats() {
+    std::lock_guard<std::mutex> lock(g_cache_mutex);
+    readKernelCacheSettings();
+    return {{"dir", g_cache_dir},
+            {"max_bytes", g_cache_max_bytes},
+            {"hits", g_cache_hits},
+            {"copies", g_cache_copies},
+            {"copied_bytes", g_cache_copied_bytes},
+            {"evictions", g_cache_evictions},
+            {"failures", g_cache_failures}};
+  }
+
+  namespace {
+    // Bumped whenever a kernel is furnished or unloaded, so the pool can
+    // tell when the loaded order was changed outside of it
+    std::atomic<uint64_t> g_kernel_changes{0};
+
+    // Kernels only take priority over kernels of the same kind: binary
+    // kernels per DAF type, text kernels over each other through the pool
+    string kernelKind(const string &path) {
+      string ext = toLower(fs::path(path).extension().string());
+      if (ext == ".bc" || ext == ".bsp" || ext == ".bpc" || ext == ".bds" || ext == ".bes") {
+        return ext;
+      }
+      return "text";
+    }
+
+
+    // Released CKs and SPKs can stay furnished within the pool limits
+    bool isPoolable(const string &path) {
+      string kind = kernelKind(path);
+      return kind == ".bc" || kind == ".bsp";
+    }
+
+
+    // Full path of a kernel, its local copy when the kernel cache is on
+    string resolveKernelPath(const string &path) {
+      return cacheKernel(resolveDataPath(path));
+    }
+
+
+    // Paths of a KernelSet's kernels in furnish order, IAKs last
+    vector<string> kernelSetPaths(json kernels) {
+      vector<string> iaks = {};
+      if (kernels.contains("iak")) {
+        iaks = jsonArrayToVector(kernels["iak"]);
+        kernels.erase("iak");
+      }
+
+      vector<string> kv = getKernelsAsVector(kernels);
+      kv.insert(kv.end(), iaks.begin(), iaks.end());
+
+      vector<string> paths;
+      for (auto &k : kv) {
+        SPDLOG_TRACE("Initial kernel {}", k);
+        paths.push_back(resolveKernelPath(k));
+      }
+      return paths;
+    }
+
+
+    void furnishKernel(const string &path) {
+      auto start = chrono::steady_clock::now();
+      load(path, true);
+      if (isKernelTelemetryEnabled()) {
+        recordFurnish(canonicalKernelPath(path), chrono::duration<double>(chrono::steady_clock::now() - start).count());
+      }
+    }
+
+
+    // Values of one kernel pool variable
+    struct PoolValues {
+      char type = 'N';              // 'N' numeric or 'C' character
+      vector<double> numbers;
+      vector<string> strings;
+
+      size_t size() const { return type == 'N' ? numbers.size() : strings.size(); }
+      bool operator==(const PoolValues &other) const = default;
+    };
+
+
+    bool readPoolVariable(const string &name, PoolValues &values) {
+      const SpiceInt ROOM = 200;
+      const SpiceInt LENOUT = 1024;
+      SpiceBoolean found = SPICEFALSE;
+      SpiceInt n = 0;
+      SpiceChar type[2];
+      dtpool_c(name.c_str(), &found, &n, type);
+      checkNaifErrors();
+      if (!found) {
+        return false;
+      }
+
+      values = PoolValues();
+      values.type = type[0];
+      if (values.type == 'N') {
+        values.numbers.resize(n);
+        gdpool_c(name.c_str(), 0, n, &n, values.numbers.data(), &found);
+      }
+      else {
+        vector<SpiceChar> cvals(ROOM * LENOUT);
+        SpiceInt nvals = 0;
+        for (SpiceInt start = 0; start < n; start += nvals) {
+          gcpool_c(name.c_str(), start, ROOM, LENOUT, &nvals, cvals.data(), &found);
+          if (!found || nvals == 0) {
+            break;
+          }
+          for (int i = 0; i < nvals; i++) {
+            values.strings.emplace_back(&cvals[i * LENOUT]);
+          }
+        }
+      }
+      checkNaifErrors();
+      return true;
+    }
+
+
+    void writePoolVariable(const string &name, const PoolValues &values) {
+      if (values.type == 'N') {
+        pdpool_c(name.c_str(), values.numbers.size(), values.numbers.data());
+      }
+      else {
+        size_t lenvals = 1;
+        for (auto &s : values.strings) {
+          lenvals = max(lenvals, s.size() + 1);
+        }
+        vector<SpiceChar> cvals(values.strings.size() * lenvals, '\0');
+        for (size_t i = 0; i < values.strings.size(); i++) {
+          copy(values.strings[i].begin(), values.strings[i].end(), cvals.begin() + i * lenvals);
+        }
+        pcpool_c(name.c_str(), values.strings.size(), lenvals, cvals.data());
+      }
+      checkNaifErrors();
+    }
+
+
+    // One assignment of a text kernel's data section
+    struct TextAssignment {
+      string name;
+      bool append;    // "+=" rather than "="
+      char type;
+      size_t count;
+    };
+
+
+    // Reads the assignments of a text kernel, their values are counted but
+    // not converted, the snapshot takes them from the pool after a furnish.
+    bool parseTextKernel(const string &path, vector<TextAssignment> &assignments) {
+      ifstream in(path);
+      if (!in) {
+        return false;
+      }
+
+      // join the data sections, keeping line breaks so strings can't span lines
+      string data;
+      string line;
+      bool in_data = false;
+      while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+          line.pop_back();
+        }
+        string trimmed = line;
+        trimmed.erase(0, trimmed.find_first_not_of(" \t"));
+        trimmed.erase(trimmed.find_last_not_of(" \t") + 1);
+        if (trimmed == "\\begindata") {
+          in_data = true;
+        }
+        else if (trimmed == "\\begintext") {
+          in_data = false;
+        }
+        else if (in_data) {
+          data += line + "\n";
+        }
+      }
+
+      size_t i = 0;
+      auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\n'; };
+      auto skipSpace = [&]() { while (i < data.size() && isSpace(data[i])) i++; };
+
+      // reads one value, returns its type or 0 if malformed
+      auto readValue = [&]() -> char {
+        if (data[i] == '\'') {
+          for (i++; i < data.size(); i++) {
+            if (data[i] == '\n') {
+              return 0;
+            }
+            if (data[i] == '\'') {
+              if (i + 1 < data.size() && data[i + 1] == '\'') {
+                i++;
+                continue;
+              }
+              i++;
+              return 'C';
+            }
+          }
+          return 0;
+        }
+        size_t start = i;
+        while (i < data.size() && !isSpace(data[i]) && data[i] != ',' && data[i] != ')' && data[i] != '(') {
+          i++;
+        }
+        return i > start ? 'N' : 0;
+      };
+
+      while (true) {
+        skipSpace();
+        if (i >= data.size()) {
+          break;
+        }
+
+        TextAssignment assignment;
+        size_t start = i;
+        while (i < data.size() && !isSpace(data[i]) && data[i] != '=' && !(data[i] == '+' && i + 1 < data.size() && data[i + 1] == '=')) {
+          i++;
+        }
+        assignment.name = data.substr(start, i - start);
+        skipSpace();
+        if (assignment.name.empty() || i >= data.size()) {
+          return false;
+        }
+        assignment.append = data[i] == '+';
+        i += assignment.append ? 2 : 1;
+        if (data[i - 1] != '=') {
+          return false;
+        }
+
+        skipSpace();
+        if (i >= data.size()) {
+          return false;
+        }
+        assignment.type = 0;
+        assignment.count = 0;
+        bool list = data[i] == '(';
+        if (list) {
+          i++;
+        }
+        while (i < data.size()) {
+          while (i < data.size() && (isSpace(data[i]) || (list && data[i] == ','))) {
+            i++;
+          }
+          if (i >= data.size()) {
+            return false;
+          }
+          if (list && data[i] == ')') {
+            i++;
+            break;
+          }
+          char type = readValue();
+          if (!type || (assignment.type && type != assignment.type)) {
+            return false;
+          }
+          assignment.type = type;
+          assignment.count++;
+          if (!list) {
+            break;
+          }
+        }
+        if (assignment.count == 0) {
+          return false;
+        }
+        assignments.push_back(assignment);
+      }
+      return true;
+    }
+
+
+    // Net effect of a text kernel on the pool, one entry per variable in the
+    // order the kernel first assigns them
+    struct TextSnapshotVariable {
+      string name;
+      bool append;
+      PoolValues values;
+    };
+
+    struct TextSnapshot {
+      int64_t mtime = 0;
+      uint64_t size = 0;
+      bool valid = false;   // false if the kernel could not be snapshotted
+      vector<TextSnapshotVariable> variables;
+    };
+
+    const char TEXT_SNAPSHOT_MAGIC[8] = {'S', 'Q', 'L', 'T', 'X', 'T', '1', '\0'};
+
+    std::atomic<int> g_snapshots_enabled{-1};  // -1 until the env var is read
+    unordered_map<string, shared_ptr<const TextSnapshot>> g_snapshots;
+
+
+    bool fileStamp(const string &path, int64_t &mtime, uint64_t &size) {
+      std::error_code ec;
+      auto time = fs::last_write_time(path, ec);
+      if (ec) {
+        return false;
+      }
+      size = fs::file_size(path, ec);
+      mtime = time.time_since_epoch().count();
+      return !ec;
+    }
+
+
+    string textSnapshotFile(const string &path) {
+      // The DB path is empty when there is no cache directory (e.g. WASM)
+      string db_file = Inventory::getDbFilePath();
+      if (db_file.empty()) {
+        return "";
+      }
+      string name = fmt::format("{:016x}.snap", std::hash<string>{}(path));
+      return (fs::path(db_file).parent_path() / TEXT_SNAPSHOT_DIR / name).string();
+    }
+
+
+    template <typename T> void writeRaw(ostream &out, const T &value) {
+      out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T> bool readRaw(istream &in, T &value) {
+      return (bool) in.read(reinterpret_cast<char *>(&value), sizeof(T));
+    }
+
+    void writeString(ostream &out, const string &s) {
+      writeRaw<uint32_t>(out, s.size());
+      out.write(s.data(), s.size());
+    }
+
+    bool readString(istream &in, string &s) {
+      uint32_t n;
+      if (!readRaw(in, n)) {
+        return false;
+      }
+      s.resize(n);
+      return (bool) in.read(s.data(), n);
+    }
+
+
+    void saveTextSnapshot(const string &path, const TextSnapshot &snapshot) {
+      string file = textSnapshotFile(path);
+      if (file.empty()) {
+        return;
+      }
+      string tmp_file = file + "." + gen_random(10) + ".tmp";
+      try {
+        fs::create_directories(fs::path(file).parent_path());
+        {
+          ofstream out(tmp_file, ios::binary);
+          out.write(TEXT_SNAPSHOT_MAGIC, sizeof(TEXT_SNAPSHOT_MAGIC));
+          writeString(out, path);
+          writeRaw(out, snapshot.mtime);
+          writeRaw(out, snapshot.size);
+          writeRaw<uint32_t>(out, snapshot.variables.size());
+          for (auto &var : snapshot.variables) {
+            writeString(out, var.name);
+            writeRaw<char>(out, var.append ? '+' : '=');
+            writeRaw<char>(out, var.values.type);
+            writeRaw<uint32_t>(out, var.values.size());
+            if (var.values.type == 'N') {
+              out.write(reinterpret_cast<const char *>(var.values.numbers.data()), var.values.numbers.size() * sizeof(double));
+            }
+            else {
+              for (auto &s : var.values.strings) {
+                writeString(out, s);
+              }
+            }
+          }
+        }
+        fs::rename(tmp_file, file);
+      }
+      catch (exception &e) {
+        SPDLOG_WARN("Could not write text kernel snapshot [{}]: {}", file, e.what());
+        std::error_code ec;
+        fs::remove(tmp_file, ec);
+      }
+    }
+
+
+    // Reads a snapshot written for path, null if missing, stale or unreadable
+    shared_ptr<TextSnapshot> loadTextSnapshot(const string &path, int64_t mtime, uint64_t size) {
+      string file = textSnapshotFile(path);
+      if (file.empty() || !fs::exists(file)) {
+        return nullptr;
+      }
+
+      ifstream in(file, ios::binary);
+      char magic[sizeof(TEXT_SNAPSHOT_MAGIC)];
+      string source;
+      auto snapshot = make_shared<TextSnapshot>();
+      uint32_t nvars;
+      if (!in.read(magic, sizeof(magic)) || !equal(magic, magic + sizeof(magic), TEXT_SNAPSHOT_MAGIC) ||
+          !readString(in, source) || source != path ||
+          !readRaw(in, snapshot->mtime) || !readRaw(in, snapshot->size) ||
+          snapshot->mtime != mtime || snapshot->size != size || !readRaw(in, nvars)) {
+        return nullptr;
+      }
+
+      for (uint32_t v = 0; v < nvars; v++) {
+        TextSnapshotVariable var;
+        char op;
+        uint32_t n;
+        if (!readString(in, var.name) || !readRaw(in, op) || !readRaw(in, var.values.type) || !readRaw(in, n)) {
+          return nullptr;
+        }
+        var.append = op == '+';
+        if (var.values.type == 'N') {
+          var.values.numbers.resize(n);
+          if (!in.read(reinterpret_cast<char *>(var.values.numbers.data()), n * sizeof(double))) {
+            return nullptr;
+          }
+        }
+        else {
+          var.values.strings.resize(n);
+          for (auto &s : var.values.strings) {
+            if (!readString(in, s)) {
+              return nullptr;
+            }
+          }
+        }
+        snapshot->variables.push_back(move(var));
+      }
+      snapshot->valid = true;
+      return snapshot;
+    }
+
+
+    // The usable snapshot of a text kernel, or null if there is none yet.
+    // callers must hold g_pool_mutex
+    shared_ptr<const TextSnapshot> findTextSnapshot(const string &path) {
+      int64_t mtime;
+      uint64_t size;
+      if (!fileStamp(path, mtime, size)) {
+        return nullptr;
+      }
+      auto it = g_snapshots.find(path);
+      if (it != g_snapshots.end() && it->second->mtime == mtime && it->second->size == size) {
+        return it->second;
+      }
+      shared_ptr<const TextSnapshot> snapshot = loadTextSnapshot(path, mtime, size);
+      if (snapshot) {
+        g_snapshots[path] = snapshot;
+      }
+      return snapshot;
+    }
+
+
+    // Furnishes a text kernel and records what it did to the pool. The
+    // parsed assignments are checked against the pool, so a kernel the
+    // parser reads differently from CSPICE is never snapshotted.
+    // callers must hold g_pool_mutex
+    void furnishAndSnapshot(const string &path) {
+      auto snapshot = make_shared<TextSnapshot>();
+      fileStamp(path, snapshot->mtime, snapshot->size);
+
+      vector<TextAssignment> assignments;
+      bool parsed = parseTextKernel(path, assignments);
+
+      // variables in first assignment order with their values before the furnish
+      vector<string> names;
+      unordered_map<string, PoolValues> before;
+      unordered_set<string> existed;
+      if (parsed) {
+        for (auto &a : assignments) {
+          if (before.count(a.name) || existed.count(a.name)) {
+            continue;
+          }
+          names.push_back(a.name);
+          PoolValues values;
+          if (readPoolVariable(a.name, values)) {
+            existed.insert(a.name);
+            before[a.name] = values;
+          }
+          else {
+            before[a.name] = PoolValues();
+          }
+        }
+      }
+
+      furnishKernel(path);
+
+      snapshot->valid = parsed;
+      for (auto &name : names) {
+        // count and type of the values from the last "=" on
+        bool append = true;
+        size_t count = 0;
+        char type = 0;
+        for (auto &a : assignments) {
+          if (a.name != name) {
+            continue;
+          }
+          if (!a.append) {
+            append = false;
+            count = 0;
+          }
+          count += a.count;
+          snapshot->valid &= !type || type == a.type;
+          type = a.type;
+        }
+
+        PoolValues after;
+        if (!readPoolVariable(name, after) || after.type != type) {
+          snapshot->valid = false;
+          break;
+        }
+        TextSnapshotVariable var{name, append, after};
+        if (append && existed.count(name)) {
+          const PoolValues &prior = before[name];
+          size_t n = prior.size();
+          bool prefix = prior.type == after.type && after.size() == n + count &&
+                        (type == 'N' ? equal(prior.numbers.begin(), prior.numbers.end(), after.numbers.begin())
+                                     : equal(prior.strings.begin(), prior.strings.end(), after.strings.begin()));
+          if (!prefix) {
+            snapshot->valid = false;
+            break;
+          }
+          if (type == 'N') {
+            var.values.numbers.erase(var.values.numbers.begin(), var.values.numbers.begin() + n);
+          }
+          else {
+            var.values.strings.erase(var.values.strings.begin(), var.values.strings.begin() + n);
+          }
+        }
+        else if (after.size() != count) {
+          snapshot->valid = false;
+          break;
+        }
+        snapshot->variables.push_back(move(var));
+      }
+
+      // meta kernels load other kernels, which a snapshot can't do
+      for (auto &var : snapshot->variables) {
+        snapshot->valid &= var.name != "KERNELS_TO_LOAD";
+      }
+
+      if (!snapshot->valid) {
+        SPDLOG_DEBUG("Text kernel {} can't be snapshotted, it will be furnished", path);
+        snapshot->variables.clear();
+      }
+      else {
+        saveTextSnapshot(path, *snapshot);
+      }
+      g_snapshots[path] = snapshot;
+    }
+
+
+    // Value of a variable before a snapshot was replayed over it
+    struct PoolUndo {
+      string name;
+      bool existed;
+      PoolValues values;
+    };
+
+
+    // Writes a snapshot's variables into the pool, returns false without
+    // changing anything if an append would mix types.
+    bool replayTextSnapshot(const TextSnapshot &snapshot, vector<PoolUndo> &undo) {
+      undo.clear();
+      for (auto &var : snapshot.variables) {
+        PoolUndo entry{var.name, false, {}};
+        entry.existed = readPoolVariable(var.name, entry.values);
+        if (var.append && entry.existed && entry.values.type != var.values.type) {
+          undo.clear();
+          return false;
+        }
+        undo.push_back(move(entry));
+      }
+
+      for (size_t v = 0; v < snapshot.variables.size(); v++) {
+        const TextSnapshotVariable &var = snapshot.variables[v];
+        if (var.append && undo[v].existed) {
+          PoolValues values = undo[v].values;
+          values.numbers.insert(values.numbers.end(), var.values.numbers.begin(), var.values.numbers.end());
+          values.strings.insert(values.strings.end(), var.values.strings.begin(), var.values.strings.end());
+          writePoolVariable(var.name, values);
+        }
+        else {
+          writePoolVariable(var.name, var.values);
+        }
+      }
+      return true;
+    }
+
+
+    void undoTextSnapshot(const vector<PoolUndo> &undo) {
+      for (auto it = undo.rbegin(); it != undo.rend(); it++) {
+        if (it->existed) {
+          writePoolVariable(it->name, it->values);
+        }
+        else {
+          dvpool_c(it->name.c_str());
+          checkNaifErrors();
+        }
+      }
+    }
+
+
+    struct PooledKernel {
+      uint64_t bytes = 0;
+      int refs = 0;           // KernelSets using the kernel
+      uint64_t last_used = 0;
+      bool replayed = false;  // text kernel written from its snapshot instead of furnished
+      vector<PoolUndo> undo;  // how to take a replayed kernel back out
+      bool ordered = false;   // whether order points at the kernel in g_pool_order
+      list<string>::iterator order;
+    };
+
+    std::mutex g_pool_mutex;
+    bool g_pool_limits_read = false;
+    size_t g_pool_max_kernels = 0;
+    uint64_t g_pool_max_bytes = 0;
+    int g_pool_scopes = 0;         // open KernelScopes
+
+    unordered_map<string, PooledKernel> g_pool;
+    list<string> g_pool_order;     // kernels loaded by KernelSets, lowest priority first
+    unordered_set<string> g_pinned;
+    vector<string> g_pinned_order; // pinned text kernels, kept loaded when released
+    uint64_t g_pool_bytes = 0;
+    uint64_t g_pool_tick = 0;
+    uint64_t g_pool_seen = 0;      // g_kernel_changes after the pool's last change
+    vector<string> g_load_order;   // furnishedFiles() when g_kernel_changes was g_load_order_seen
+    uint64_t g_load_order_seen = 0;
+    bool g_load_order_read = false;
+    uint64_t g_pool_furnishes = 0;
+    uint64_t g_pool_replays = 0;
+    uint64_t g_pool_reuses = 0;
+    uint64_t g_pool_unloads = 0;
+
+
+    // callers must hold g_pool_mutex
+    void readPoolLimits() {
+      if (g_pool_limits_read) {
+        return;
+      }
+      g_pool_limits_read = true;
+      try {
+        const char *size = getenv(KERNEL_POOL_SIZE_ENV_VAR.c_str());
+        const char *mb = getenv(KERNEL_POOL_MB_ENV_VAR.c_str());
+        g_pool_max_kernels = size ? stoul(size) : 0;
+        g_pool_max_bytes = mb ? stoull(mb) * 1024 * 1024 : 0;
+      }
+      catch (exception &e) {
+        SPDLOG_WARN("Ignoring invalid kernel pool limits: {}", e.what());
+        g_pool_max_kernels = 0;
+        g_pool_max_bytes = 0;
+      }
+    }
+
+
+    // callers must hold g_pool_mutex
+    void addPooled(const string &path) {
+      if (g_pool.count(path)) {
+        return;
+      }
+      std::error_code ec;
+      uint64_t bytes = fs::file_size(path, ec);
+      g_pool[path].bytes = ec ? 0 : bytes;
+      g_pool_bytes += g_pool[path].bytes;
+    }
+
+
+    // callers must hold g_pool_mutex
+    void unorderPooled(const string &path) {
+      auto it = g_pool.find(path);
+      if (it != g_pool.end() && it->second.ordered) {
+        g_pool_order.erase(it->second.order);
+        it->second.ordered = false;
+      }
+    }
+
+
+    // Moves a pooled kernel to the top of g_pool_order.
+    // callers must hold g_pool_mutex
+    void orderPooled(const string &path) {
+      unorderPooled(path);
+      PooledKernel &kernel = g_pool[path];
+      kernel.order = g_pool_order.insert(g_pool_order.end(), path);
+      kernel.ordered = true;
+    }
+
+
+    // callers must hold g_pool_mutex
+    void erasePooled(const string &path) {
+      unorderPooled(path);
+      g_pool_bytes -= g_pool[path].bytes;
+      g_pool.erase(path);
+    }
+
+
+    // Replays a text kernel's snapshot, or furnishes it if it has none.
+    // callers must hold g_pool_mutex
+    void loadTextKernel(const string &path) {
+      PooledKernel &kernel = g_pool[path];
+      kernel.replayed = false;
+      kernel.undo.clear();
+
+      if (isTextKernelSnapshotsEnabled()) {
+        shared_ptr<const TextSnapshot> snapshot = findTextSnapshot(path);
+        if (!snapshot) {
+          furnishAndSnapshot(path);
+          g_pool_furnishes++;
+          return;
+        }
+        if (snapshot->valid && replayTextSnapshot(*snapshot, kernel.undo)) {
+          SPDLOG_TRACE("Replayed text kernel {}", path);
+          kernel.replayed = true;
+          g_pool_replays++;
+          return;
+        }
+      }
+      furnishKernel(path);
+      g_pool_furnishes++;
+    }
+
+
+    // Loads the text kernels in the given order, lowest priority first, with
+    // as little work as possible.
+    //
+    // Unloading or refurnishing a furnished text kernel makes CSPICE clear
+    // the pool and reload the other furnished ones, which also drops every
+    // replayed kernel. Without replayed kernels, dropped kernels are unloaded
+    // and the rest loaded on top. Otherwise kernels are taken back out from
+    // the first one that changes, replayed ones by restoring what they
+    // overwrote, and loaded again in order.
+    // callers must hold g_pool_mutex
+    void setTextOrder(const vector<string> &order) {
+      vector<string> current;
+      for (auto &path : g_pool_order) {
+        if (kernelKind(path) == "text") {
+          current.push_back(path);
+        }
+      }
+
+      size_t first = 0;
+      while (first < current.size() && first < order.size() && current[first] == order[first]) {
+        first++;
+      }
+      if (first == current.size() && first == order.size()) {
+        return;
+      }
+
+      unordered_set<string> kept(order.begin(), order.end());
+      auto reload = [&](size_t from) {
+        for (size_t i = from; i < order.size(); i++) {
+          unorderPooled(order[i]);
+        }
+        for (size_t i = from; i < order.size(); i++) {
+          addPooled(order[i]);
+          try {
+            loadTextKernel(order[i]);
+          }
+          catch (...) {
+            // the rest are not loaded, KernelSets using them lose them
+            for (size_t j = i; j < order.size(); j++) {
+              g_pool_bytes -= g_pool[order[j]].bytes;
+              g_pool.erase(order[j]);
+            }
+            throw;
+          }
+          orderPooled(order[i]);
+        }
+      };
+
+      bool any_replayed = any_of(current.begin(), current.end(), [](auto &p) { return g_pool[p].replayed; });
+      if (!any_replayed) {
+        // kernels kept in place are the ones the new order lists before the added ones
+        size_t next = first;
+        for (size_t i = first; i < current.size(); i++) {
+          if (next < order.size() && order[next] == current[i]) {
+            next++;
+          }
+          else {
+            unload(current[i]);
+            if (!kept.count(current[i])) {
+              erasePooled(current[i]);
+              g_pool_unloads++;
+            }
+          }
+        }
+        reload(next);
+        return;
+      }
+
+      bool furnished_above = any_of(current.begin() + first, current.end(), [](auto &p) { return !g_pool[p].replayed; });
+      if (furnished_above) {
+        auto replayed = find_if(current.begin(), current.begin() + first, [](auto &p) { return g_pool[p].replayed; });
+        first = std::distance(current.begin(), replayed);
+      }
+
+      for (size_t i = current.size(); i-- > first;) {
+        PooledKernel &kernel = g_pool[current[i]];
+        if (kernel.replayed) {
+          undoTextSnapshot(kernel.undo);
+          kernel.replayed = false;
+          kernel.undo.clear();
+        }
+        else {
+          unload(current[i]);
+        }
+      }
+      for (size_t i = first; i < current.size(); i++) {
+        if (!kept.count(current[i])) {
+          erasePooled(current[i]);
+          g_pool_unloads++;
+        }
+      }
+      reload(first);
+    }
+
+
+    // callers must hold g_pool_mutex
+    void unloadPooled(const vector<string> &paths) {
+      unordered_set<string> removed(paths.begin(), paths.end());
+      vector<string> text;
+      bool text_changed = false;
+      for (auto &path : g_pool_order) {
+        if (kernelKind(path) == "text") {
+          if (removed.count(path)) {
+            text_changed = true;
+          }
+          else {
+            text.push_back(path);
+          }
+        }
+      }
+
+      for (auto &path : paths) {
+        if (kernelKind(path) != "text") {
+          unload(path);
+          erasePooled(path);
+          g_pool_unloads++;
+        }
+      }
+      if (text_changed) {
+        setTextOrder(text);
+      }
+    }
+
+
+    // Drops kernels unloaded outside of the pool, returns false if the loaded
+    // order may have changed since the pool last touched it.
+    // callers must hold g_pool_mutex
+    bool syncPool() {
+      if (g_kernel_changes.load() == g_pool_seen) {
+        return true;
+      }
+
+      const SpiceInt TYPESIZ = 32;
+      const SpiceInt SOURCESIZ = 256;
+      vector<string> lost_replays;
+      for (auto it = g_pool_order.begin(); it != g_pool_order.end();) {
+        // step past the kernel first, it may be taken out of the order
+        const string path = *it++;
+        PooledKernel &kernel = g_pool[path];
+        SpiceBoolean found = SPICEFALSE;
+        if (kernel.replayed) {
+          // unloading any furnished text kernel clears the pool, check one of the variables
+          SpiceInt n;
+          SpiceChar type[2];
+          found = kernel.undo.empty() ? SPICETRUE : SPICEFALSE;
+          if (!kernel.undo.empty()) {
+            dtpool_c(kernel.undo.front().name.c_str(), &found, &n, type);
+          }
+        }
+        else {
+          SpiceChar filtyp[TYPESIZ];
+          SpiceChar source[SOURCESIZ];
+          SpiceInt handle;
+          kinfo_c(path.c_str(), TYPESIZ, SOURCESIZ, filtyp, source, &handle, &found);
+        }
+        checkNaifErrors();
+
+        if (found) {
+          continue;
+        }
+        if (kernel.replayed) {
+          SPDLOG_DEBUG("Replayed text kernel {} was cleared outside the pool", path);
+          lost_replays.push_back(path);
+          kernel.replayed = false;
+          kernel.undo.clear();
+          unorderPooled(path);
+        }
+        else if (kernel.refs == 0) {
+          SPDLOG_DEBUG("Pooled kernel {} was unloaded outside the pool", path);
+          erasePooled(path);
+        }
+      }
+
+      // replay the lost text kernels KernelSets still use on top
+      for (auto &path : lost_replays) {
+        if (g_pool[path].refs == 0) {
+          g_pool_bytes -= g_pool[path].bytes;
+          g_pool.erase(path);
+          continue;
+        }
+        loadTextKernel(path);
+        orderPooled(path);
+      }
+      return false;
+    }
+
+
+    // Unloads released kernels until the pool fits its limits. Only CKs,
+    // SPKs and pinned kernels are kept, least recently used unloaded first,
+    // and nothing is unloaded while a KernelScope is open.
+    // callers must hold g_pool_mutex
+    void trimPool() {
+      if (g_pool_scopes > 0) {
+        return;
+      }
+      readPoolLimits();
+
+      vector<string> released;
+      size_t resident = 0;
+      for (auto &path : g_pool_order) {
+        if (g_pinned.count(path)) {
+          continue;
+        }
+        if (!isPoolable(path)) {
+          if (g_pool[path].refs == 0) {
+            released.push_back(path);
+          }
+        }
+        else {
+          resident++;
+        }
+      }
+      unloadPooled(released);
+
+      while (resident > g_pool_max_kernels || (g_pool_max_bytes && g_pool_bytes > g_pool_max_bytes)) {
+        auto lru = g_pool.end();
+        for (auto it = g_pool.begin(); it != g_pool.end(); it++) {
+          if (it->second.refs == 0 && !g_pinned.count(it->first)
+              && (lru == g_pool.end() || it->second.last_used < lru->second.last_used)) {
+            lru = it;
+          }
+        }
+        if (lru == g_pool.end()) {
+          break;
+        }
+        unloadPooled({lru->first});
+        resident--;
+      }
+    }
+
+
+    // Files furnished in CSPICE in load order, as they were furnished
+    vector<string> furnishedFiles() {
+      SpiceInt count = 0;
+      ktotal_c("all", &count);
+      checkNaifErrors();
+
+      vector<string> files;
+      files.reserve(count);
+      for (SpiceInt i = 0; i < count; i++) {
+        SpiceChar file[1024];
+        SpiceChar filtyp[32];
+        SpiceChar source[1024];
+        SpiceInt handle;
+        SpiceBoolean found = SPICEFALSE;
+        kdata_c(i, "all", sizeof(file), sizeof(filtyp), sizeof(source), file, filtyp, source, &handle, &found);
+        checkNaifErrors();
+        if (found) {
+          files.push_back(file);
+        }
+      }
+      return files;
+    }
+
+
+    // furnishedFiles(), only enumerated again once a kernel was loaded or
+    // unloaded since, as every furnish and unload goes through load() and unload()
+    // callers must hold g_pool_mutex
+    const vector<string> &loadOrder() {
+      uint64_t changes = g_kernel_changes.load();
+      if (!g_load_order_read || changes != g_load_order_seen) {
+        g_load_order = furnishedFiles();
+        g_load_order_seen = changes;
+        g_load_order_read = true;
+      }
+      return g_load_order;
+    }
+
+
+    // Loads only what is missing for paths to be loaded in the given order
+    // and marks them used. Returns the paths acquired, once each.
+    vector<string> acquirePooled(const vector<string> &paths) {
+      // furnishing a kernel twice only leaves the last one
+      vector<string> wanted;
+      unordered_set<string> seen;
+      for (auto it = paths.rbegin(); it != paths.rend(); it++) {
+        if (seen.insert(*it).second) {
+          wanted.push_back(*it);
+        }
+      }
+      reverse(wanted.begin(), wanted.end());
+
+      std::lock_guard<std::mutex> lock(g_pool_mutex);
+      bool trusted = syncPool();
+
+      // released kernels this set did not ask for would answer its queries,
+      // pinned ones included
+      vector<string> stale;
+      for (auto &path : g_pool_order) {
+        if (g_pool[path].refs == 0 && !seen.count(path) && kernelKind(path) != "text") {
+          stale.push_back(path);
+        }
+      }
+      unloadPooled(stale);
+
+      // Per kind, keep the longest prefix of the wanted kernels that is already
+      // loaded in the wanted order and load the rest on top of it. Binary
+      // kernels are only kept when nothing above the first kept one is a
+      // kernel the set did not ask for, except kernels of the KernelSets
+      // still alive around it. A set asking for a subset of an enclosing
+      // set's kernels in their order loads nothing, while a kernel furnished
+      // outside the pool above them makes it furnish its own again.
+      unordered_map<string, vector<string>> wanted_kinds;
+      for (auto &path : wanted) {
+        wanted_kinds[kernelKind(path)].push_back(path);
+      }
+      vector<string> text;
+      for (auto &path : g_pool_order) {
+        if (kernelKind(path) == "text" && (g_pool[path].refs > 0 || seen.count(path))) {
+          text.push_back(path);
+        }
+      }
+
+      unordered_map<string, size_t> kept;
+      if (trusted && wanted_kinds.count("text")) {
+        const vector<string> &kind_paths = wanted_kinds["text"];
+        size_t &k = kept["text"];
+        for (auto &path : g_pool_order) {
+          if (kernelKind(path) != "text" || (g_pool[path].refs == 0 && !seen.count(path))) {
+            continue;
+          }
+          if (k < kind_paths.size() && kind_paths[k] == path) {
+            k++;
+          }
+        }
+      }
+
+      // binary kernels as CSPICE has them loaded, lowest priority first
+      unordered_map<string, vector<string>> loaded_kinds;
+      for (auto &path : loadOrder()) {
+        string kind = kernelKind(path);
+        if (kind != "text" && wanted_kinds.count(kind)) {
+          loaded_kinds[kind].push_back(path);
+        }
+      }
+      for (auto &[kind, loaded] : loaded_kinds) {
+        const vector<string> &kind_paths = wanted_kinds[kind];
+        unordered_map<string, size_t> position;
+        for (size_t i = 0; i < loaded.size(); i++) {
+          position[loaded[i]] = i;
+        }
+
+        size_t k = 0;
+        for (; k < kind_paths.size(); k++) {
+          // only kernels the pool furnished are counted as kept
+          auto it = position.find(kind_paths[k]);
+          if (it == position.end() || !g_pool.count(kind_paths[k])
+              || (k > 0 && it->second < position[kind_paths[k - 1]])) {
+            break;
+          }
+        }
+        if (k > 0) {
+          for (size_t i = position[kind_paths[0]] + 1; i < loaded.size(); i++) {
+            auto pooled = g_pool.find(loaded[i]);
+            bool enclosing = pooled != g_pool.end() && pooled->second.refs > 0;
+            if (!seen.count(loaded[i]) && !enclosing) {
+              SPDLOG_TRACE("{} is loaded above the kernels of the set, furnishing them again", loaded[i]);
+              k = 0;
+              break;
+            }
+          }
+        }
+        kept[kind] = k;
+      }
+
+      try {
+        for (auto &[kind, kind_paths] : wanted_kinds) {
+          g_pool_reuses += kept[kind];
+          if (kind == "text") {
+            unordered_set<string> moved(kind_paths.begin() + kept[kind], kind_paths.end());
+            erase_if(text, [&moved](const string &p) { return moved.count(p) > 0; });
+            text.insert(text.end(), kind_paths.begin() + kept[kind], kind_paths.end());
+            continue;
+          }
+          for (size_t i = kept[kind]; i < kind_paths.size(); i++) {
+            const string &path = kind_paths[i];
+            furnishKernel(path);
+            g_pool_furnishes++;
+            addPooled(path);
+            orderPooled(path);
+          }
+        }
+        // also drops released text kernels this set did not ask for
+        setTextOrder(text);
+      }
+      catch (...) {
+        trimPool();
+        g_pool_seen = g_kernel_changes.load();
+        throw;
+      }
+
+      for (auto &path : wanted) {
+        g_pool[path].refs++;
+        g_pool[path].last_used = ++g_pool_tick;
+      }
+      g_pool_seen = g_kernel_changes.load();
+      return wanted;
+    }
+
+
+    void releasePooled(const vector<string> &paths) {
+      std::lock_guard<std::mutex> lock(g_pool_mutex);
+      syncPool();
+      for (auto &path : paths) {
+        auto it = g_pool.find(path);
+        if (it != g_pool.end() && it->second.refs > 0) {
+          it->second.refs--;
+          it->second.last_used = ++g_pool_tick;
+        }
+      }
+      trimPool();
+      g_pool_seen = g_kernel_changes.load();
+    }
+  }
+
+
+  void setTextKernelSnapshots(bool enabled) {
+    g_snapshots_enabled = enabled;
+  }
+
+
+  bool isTextKernelSnapshotsEnabled() {
+    int enabled = g_snapshots_enabled.load();
+    if (enabled < 0) {
+      const char *env = getenv(TEXT_SNAPSHOT_ENV_VAR.c_str());
+      enabled = env != NULL && toLower(string(env)) == "true";
+      int unset = -1;
+      g_snapshots_enabled.compare_exchange_strong(unset, enabled);
+      enabled = g_snapshots_enabled.load();
+    }
+    return enabled > 0;
+  }
+
+
+  void setKernelPoolLimits(size_t max_kernels, uint64_t max_bytes) {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    g_pool_limits_read = true;
+    g_pool_max_kernels = max_kernels;
+    g_pool_max_bytes = max_bytes;
+    syncPool();
+    trimPool();
+    g_pool_seen = g_kernel_changes.load();
+  }
+
+
+  void clearKernelPool() {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    syncPool();
+    vector<string> released;
+    for (auto &path : g_pool_order) {
+      if (g_pool[path].refs == 0 && !g_pinned.count(path)) {
+        released.push_back(path);
+      }
+    }
+    unloadPooled(released);
+    g_pool_seen = g_kernel_changes.load();
+  }
+
+
+  json getKernelPoolStats() {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    readPoolLimits();
+    size_t in_use = 0;
+    size_t snapshots = 0;
+    for (auto &[path, kernel] : g_pool) {
+      in_use += kernel.refs > 0;
+    }
+    for (auto &[path, snapshot] : g_snapshots) {
+      snapshots += snapshot->valid;
+    }
+    return {{"max_kernels", g_pool_max_kernels},
+            {"max_bytes", g_pool_max_bytes},
+            {"resident", g_pool_order.size()},
+            {"in_use", in_use},
+            {"pinned", g_pinned_order.size()},
+            {"bytes", g_pool_bytes},
+            {"furnishes", g_pool_furnishes},
+            {"replays", g_pool_replays},
+            {"reuses", g_pool_reuses},
+            {"unloads", g_pool_unloads},
+            {"snapshots", snapshots}};
+  }
+
+
+  vector<string> pinKernels(json kernels) {
+    // binary kernels keep their place in each set's priority order, only text kernels are pinned
+    vector<string> paths = kernelSetPaths(kernels);
+    erase_if(paths, [](const string &path) {
+      if (kernelKind(path) == "text") {
+        return false;
+      }
+      SPDLOG_DEBUG("Not pinning binary kernel {}", path);
+      return true;
+    });
+
+    // loaded once, pinned kernels are then kept loaded when released
+    vector<string> pinned = acquirePooled(paths);
+    {
+      std::lock_guard<std::mutex> lock(g_pool_mutex);
+      g_pinned_order = pinned;
+      g_pinned.clear();
+      g_pinned.insert(pinned.begin(), pinned.end());
+    }
+    releasePooled(pinned);
+    SPDLOG_DEBUG("Pinned {} kernels", pinned.size());
+    return pinned;
+  }
+
+
+  void unpinKernels() {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    g_pinned.clear();
+    g_pinned_order.clear();
+    syncPool();
+    trimPool();
+    g_pool_seen = g_kernel_changes.load();
+  }
+
+
+  vector<string> getPinnedKernels() {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    return g_pinned_order;
+  }
+
+
+  KernelScope::KernelScope() {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    g_pool_scopes++;
+  }
+
+
+  KernelScope::~KernelScope() {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    g_pool_scopes--;
+    try {
+      syncPool();
+      trimPool();
+      g_pool_seen = g_kernel_changes.load();
+    }
+    catch (exception &e) {
+      SPDLOG_WARN("Could not unload kernels released in scope: {}", e.what());
+    }
+  }
+
+
   string Kernel::translateType(Kernel::Type type) {
     return KERNEL_TYPES[static_cast<int>(type)];
   }
@@ -130,15 +1835,8 @@ namespace SpiceQL {
 
 
   Kernel::Kernel(string path) {
-    this->path = path;
-    if (fs::exists(this->path)) {
-      SPDLOG_TRACE("path is valid");
-    } else {
-      SPDLOG_TRACE("appending path to data_dir");
-      this->path = (getDataDirectory() / fs::path(path)).string();
-    }
-
-    load(this->path, true);
+    this->path = resolveKernelPath(path);
+    furnishKernel(this->path);
   }
 
 
@@ -153,17 +1851,76 @@ namespace SpiceQL {
   }
 
 
+  namespace {
+    // Takes a shared lock on a cached copy before it is furnished. A copy
+    // another process evicted after it was resolved is copied again.
+    void lockKernelCopy(const string &path) {
+#if !defined(_WIN32) && !defined(SPICEQL_WASM)
+      string cache_dir = getKernelCacheDir();
+      if (cache_dir.empty() || !path.starts_with((fs::path(cache_dir) / "").string())) {
+        return;
+      }
+      for (int attempt = 0; attempt < 3; attempt++) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+          struct stat info;
+          // evictors unlink under an exclusive lock, a linked copy is safe once locked
+          if (flock(fd, LOCK_SH) == 0 && fstat(fd, &info) == 0 && info.st_nlink > 0) {
+            std::lock_guard<std::mutex> lock(g_furnished_mutex);
+            auto held = g_copy_locks.find(path);
+            if (held != g_copy_locks.end()) {
+              close(held->second);
+            }
+            g_copy_locks[path] = fd;
+            return;
+          }
+          close(fd);
+        }
+        SPDLOG_DEBUG("Cached kernel {} was evicted before it was furnished, copying it again", path);
+        cacheKernel(canonicalKernelPath(path));
+      }
+      SPDLOG_WARN("Could not lock cached kernel {}, other processes may evict it while it is furnished", path);
+#endif
+    }
+
+
+    void unlockKernelCopy(const string &path) {
+#if !defined(_WIN32) && !defined(SPICEQL_WASM)
+      std::lock_guard<std::mutex> lock(g_furnished_mutex);
+      auto held = g_copy_locks.find(path);
+      if (held != g_copy_locks.end()) {
+        close(held->second);
+        g_copy_locks.erase(held);
+      }
+#endif
+    }
+  }
+
+
   void load(string path, bool force_refurnsh) {
     SPDLOG_DEBUG("Furnishing {}, force refurnish? {}.", path, force_refurnsh); 
     checkNaifErrors();
+    lockKernelCopy(path);
     furnsh_c(path.c_str());
+    g_kernel_changes++;
+    if (failed_c()) {
+      unlockKernelCopy(path);
+    }
     checkNaifErrors();
+    std::lock_guard<std::mutex> lock(g_furnished_mutex);
+    g_furnished.insert(path);
   }
 
   void unload(string path) {
     SPDLOG_TRACE("Unloading kernel {}", path);
     checkNaifErrors();
     unload_c(path.c_str());
+    g_kernel_changes++;
+    {
+      std::lock_guard<std::mutex> lock(g_furnished_mutex);
+      g_furnished.erase(path);
+    }
+    unlockKernelCopy(path);
     checkNaifErrors();
   }
 
@@ -191,7 +1948,7 @@ namespace SpiceQL {
       checkNaifErrors();
 
       if (found) {
-        kernels.push_back(string(file));
+        kernels.push_back(canonicalKernelPath(string(file)));
       }
     }
 
@@ -215,43 +1972,23 @@ namespace SpiceQL {
   void KernelSet::load(json kernels) { 
     SPDLOG_TRACE("Creating Kernelset: {}", kernels.dump());
     this->m_kernels.merge_patch(kernels);
-    vector<string> iaks = {};
-
-    // If kernels have "iak" key, pop it and load first
-    if (kernels.contains("iak")) {
-      auto iak_value = kernels["iak"];
-      iaks = jsonArrayToVector(iak_value);
-      // Remove the "iak" key from kernels
-      kernels.erase("iak");
-    }
-
-    vector<string> kv = getKernelsAsVector(kernels);
-    fs::path data_dir = getDataDirectory();
-    
-    if(!iaks.empty()) {
-      // Add any kernels in the json object to the end of kv
-      kv.insert(kv.end(), iaks.begin(), iaks.end());
-    }
 
-    for (auto &k : kv) {
-      SPDLOG_TRACE("Initial kernel {}", k);
-      
-      try { 
-        Kernel *kp = new Kernel(k);
-        m_loadedKernels.emplace_back(kp);
-      } catch (exception &e) { 
-        throw runtime_error("something went wrong: " + string(e.what()));
-      }
+    // The pool furnishes only the kernels not already loaded in this order
+    try { 
+      vector<string> acquired = acquirePooled(kernelSetPaths(kernels));
+      m_loadedKernels.insert(m_loadedKernels.end(), acquired.begin(), acquired.end());
+    } catch (exception &e) { 
+      throw runtime_error("something went wrong: " + string(e.what()));
     }
     SPDLOG_TRACE("Loaded {} kernels", m_loadedKernels.size());
   }
 
 
   void KernelSet::unload() {
-    for(auto p : m_loadedKernels) {
-      delete p;
+    if (!m_loadedKernels.empty()) {
+      releasePooled(m_loadedKernels);
+      m_loadedKernels.clear();
     }
-    m_loadedKernels.clear();
   }
 
   KernelSet::~KernelSet() { 
@@ -0,0 +1,518 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <SpiceUsr.h>
+
+#include <SpiceQL/spiceql_logging.h>
+#include <SpiceQL/daf.h>
+#include <SpiceQL/spk_evaluator.h>
+#include <SpiceQL/utils.h>
+
+using json = nlohmann::json;
+using namespace std;
+
+namespace SpiceQL {
+
+  string NATIVE_SPK_ENV_VAR = "SPICEQL_NATIVE_SPK";
+
+
+  namespace {
+    const size_t MAX_WINDOW = 32;
+    const int MAX_CHAIN = 20;
+    const size_t MIN_THREAD_EPOCHS = 1024;
+    const double CLIGHT = 299792.458;
+
+    std::mutex g_mutex;
+    std::atomic<int> g_enabled{-1};
+    uint64_t g_requests = 0;
+    uint64_t g_states = 0;
+    uint64_t g_unsupported = 0;
+
+    // Rotates the position and velocity of a state by a 3x3 row major rotation
+    void rotateState(const double *rotation, double *state) {
+      double rotated[6];
+      for (int v = 0; v < 6; v += 3) {
+        for (int r = 0; r < 3; r++) {
+          rotated[v + r] = rotation[r * 3] * state[v] + rotation[r * 3 + 1] * state[v + 1] + rotation[r * 3 + 2] * state[v + 2];
+        }
+      }
+      memcpy(state, rotated, sizeof(rotated));
+    }
+
+
+    // Norm scaled by the largest component, as vnorm_c computes it
+    double scaledNorm(const double *v) {
+      double vmax = max(fabs(v[0]), max(fabs(v[1]), fabs(v[2])));
+      if (vmax == 0.0) {
+        return 0.0;
+      }
+      double a = v[0] / vmax, b = v[1] / vmax, c = v[2] / vmax;
+      return vmax * sqrt(a * a + b * b + c * c);
+    }
+
+
+    // Clenshaw recurrences of chbint_ and chbval_ on all NCOMP components of a
+    // record at once, the innermost loops run across components so they vectorize.
+    // values gets the NCOMP values, followed by their derivatives when DERIVATIVES.
+    template <int NCOMP, bool DERIVATIVES>
+    void chebyshev(const double *record, size_t ncoef, double et, double *values) {
+      const double *cp = record + 2;
+      double s = (et - record[0]) / record[1];
+      double s2 = 2.0 * s;
+
+      double w0[NCOMP] = {}, w1[NCOMP] = {}, w2[NCOMP] = {};
+      double dw0[NCOMP] = {}, dw1[NCOMP] = {}, dw2[NCOMP] = {};
+      for (size_t j = ncoef - 1; j > 0; j--) {
+        for (int c = 0; c < NCOMP; c++) {
+          w2[c] = w1[c];
+          w1[c] = w0[c];
+          w0[c] = cp[c * ncoef + j] + (s2 * w1[c] - w2[c]);
+          if (DERIVATIVES) {
+            dw2[c] = dw1[c];
+            dw1[c] = dw0[c];
+            dw0[c] = w1[c] * 2.0 + (s2 * dw1[c] - dw2[c]);
+          }
+        }
+      }
+      for (int c = 0; c < NCOMP; c++) {
+        values[c] = cp[c * ncoef] + (s * w0[c] - w1[c]);
+        if (DERIVATIVES) {
+          values[NCOMP + c] = (w0[c] + (s * dw0[c] - dw1[c])) / record[1];
+        }
+      }
+    }
+
+
+    // First state of the interpolation window around et, as spkr09_ and spkr13_ pick it
+    size_t windowStart(const double *epochs, size_t n, size_t window, double et) {
+      size_t high = lower_bound(epochs, epochs + n, et) - epochs;
+      high = min(max(high, (size_t)1), n - 1);
+      size_t low = high - 1;
+
+      long first;
+      if (window % 2 == 1) {
+        size_t near = (epochs[high] - et < et - epochs[low]) ? high : low;
+        first = (long)near - (long)(window - 1) / 2;
+      }
+      else {
+        first = (long)low - (long)window / 2 + 1;
+      }
+      first = min(max(first, 0L), (long)(n - window));
+      return first;
+    }
+
+
+    // Lagrange interpolation of lgrint_ on all six components at once
+    void lagrange(const double *states, size_t n, size_t window, double et, double *state) {
+      const double *epochs = states + 6 * n;
+      size_t first = windowStart(epochs, n, window, et);
+      const double *x = epochs + first;
+
+      double work[MAX_WINDOW][6];
+      for (size_t i = 0; i < window; i++) {
+        memcpy(work[i], states + (first + i) * 6, sizeof(work[i]));
+      }
+      for (size_t j = 1; j < window; j++) {
+        for (size_t i = 0; i < window - j; i++) {
+          double denom = x[i] - x[i + j];
+          double c1 = et - x[i + j];
+          double c2 = x[i] - et;
+          for (int c = 0; c < 6; c++) {
+            work[i][c] = (c1 * work[i][c] + c2 * work[i + 1][c]) / denom;
+          }
+        }
+      }
+      memcpy(state, work[0], sizeof(work[0]));
+    }
+
+
+    // Hermite interpolation of the positions with the velocities as their
+    // derivatives, on the window's epochs each taken twice, by Neville's
+    // recurrence on the value and derivative of all three axes at once
+    void hermite(const double *states, size_t n, size_t window, double et, double *state) {
+      const double *epochs = states + 6 * n;
+      size_t first = windowStart(epochs, n, window, et);
+      const double *x = epochs + first;
+      size_t nodes = 2 * window;
+
+      double p[2 * MAX_WINDOW][3];
+      double d[2 * MAX_WINDOW][3];
+      for (size_t k = 0; k < nodes; k++) {
+        const double *s = states + (first + k / 2) * 6;
+        double dx = et - x[k / 2];
+        for (int c = 0; c < 3; c++) {
+          // pairs of the same epoch take the line with its velocity
+          p[k][c] = (k % 2 == 0) ? s[c] + s[c + 3] * dx : s[c];
+          d[k][c] = s[c + 3];
+        }
+      }
+      // pairs of consecutive epochs take the line through their positions
+      for (size_t k = 1; k + 1 < nodes; k += 2) {
+        const double *sa = states + (first + k / 2) * 6;
+        const double *sb = sa + 6;
+        double za = x[k / 2], zb = x[k / 2 + 1];
+        double denom = za - zb;
+        double ca = et - zb, cb = et - za;
+        for (int c = 0; c < 3; c++) {
+          p[k][c] = (ca * sa[c] - cb * sb[c]) / denom;
+          d[k][c] = (sa[c] - sb[c]) / denom;
+        }
+      }
+      for (size_t j = 2; j < nodes; j++) {
+        for (size_t k = 0; k < nodes - j; k++) {
+          double za = x[k / 2], zb = x[(k + j) / 2];
+          double denom = za - zb;
+          double ca = et - zb, cb = et - za;
+          for (int c = 0; c < 3; c++) {
+            double value = (ca * p[k][c] - cb * p[k + 1][c]) / denom;
+            d[k][c] = (p[k][c] + ca * d[k][c] - p[k + 1][c] - cb * d[k + 1][c]) / denom;
+            p[k][c] = value;
+          }
+        }
+      }
+      for (int c = 0; c < 3; c++) {
+        state[c] = p[0][c];
+        state[c + 3] = d[0][c];
+      }
+    }
+
+
+    // Rotation from an inertial frame to J2000, false if the frame is not inertial
+    bool inertialRotation(int frame, bool to_j2000, double et, vector<double> &rotation) {
+      SpiceInt center, frame_class, class_id;
+      SpiceBoolean found = SPICEFALSE;
+      frinfo_c(frame, &center, &frame_class, &class_id, &found);
+      checkNaifErrors();
+      if (!found || frame_class != 1) {
+        return false;
+      }
+      SpiceChar name[33];
+      frmnam_c(frame, sizeof(name), name);
+      SpiceDouble matrix[3][3];
+      if (to_j2000) {
+        pxform_c(name, "J2000", et, matrix);
+      }
+      else {
+        pxform_c("J2000", name, et, matrix);
+      }
+      checkNaifErrors();
+      rotation.assign(&matrix[0][0], &matrix[0][0] + 9);
+      return true;
+    }
+  }
+
+
+  std::unique_ptr<SpkEvaluator> SpkEvaluator::create(int target, int observer, string frame, double et) {
+    if (!isEnabled()) {
+      return nullptr;
+    }
+
+    unique_ptr<SpkEvaluator> evaluator(new SpkEvaluator());
+    evaluator->m_target = target;
+    evaluator->m_observer = observer;
+
+    SpiceInt frame_code = 0;
+    namfrm_c(frame.c_str(), &frame_code);
+    checkNaifErrors();
+    if (frame_code == 0) {
+      return nullptr;
+    }
+    if (frame_code != 1) {
+      vector<double> rotation;
+      if (!inertialRotation(frame_code, false, et, rotation)) {
+        return nullptr;
+      }
+      evaluator->m_rotation.reset(new double[9]);
+      copy(rotation.begin(), rotation.end(), evaluator->m_rotation.get());
+    }
+
+    if (!DafFile::furnished("SPK", "DAF/SPK", evaluator->m_files)) {
+      std::lock_guard<std::mutex> lock(g_mutex);
+      g_unsupported++;
+      return nullptr;
+    }
+
+    vector<const FileSegments *> tables;
+    for (auto &file : evaluator->m_files) {
+      const FileSegments &table = file->table<FileSegments>(parseSegments);
+      if (!table.supported) {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_unsupported++;
+        return nullptr;
+      }
+      tables.push_back(&table);
+    }
+
+    // the segments of the bodies reachable from the target and the observer,
+    // CSPICE searches the last loaded SPK first
+    deque<int> pending = {target, observer};
+    while (!pending.empty()) {
+      int body = pending.front();
+      pending.pop_front();
+      if (evaluator->m_segments.contains(body)) {
+        continue;
+      }
+      vector<const Segment *> &segments = evaluator->m_segments[body];
+      for (auto table = tables.rbegin(); table != tables.rend(); table++) {
+        auto found = (*table)->bodies.find(body);
+        if (found == (*table)->bodies.end()) {
+          continue;
+        }
+        for (const Segment &segment : found->second) {
+          segments.push_back(&segment);
+          pending.push_back(segment.center);
+
+          if (segment.frame != 1 && !evaluator->m_frame_rotations.contains(segment.frame)) {
+            vector<double> rotation;
+            if (inertialRotation(segment.frame, true, et, rotation)) {
+              evaluator->m_frame_rotations[segment.frame] = rotation;
+            }
+          }
+        }
+      }
+    }
+    return evaluator;
+  }
+
+
+  SpkEvaluator::FileSegments SpkEvaluator::parseSegments(const DafFile &file) {
+    FileSegments table;
+    const vector<DafFile::Segment> &summaries = file.segments();
+    // CSPICE searches the last segment of a file first
+    for (auto summary = summaries.rbegin(); summary != summaries.rend(); summary++) {
+      Segment segment = {};
+      segment.start = summary->dc[0];
+      segment.stop = summary->dc[1];
+      segment.center = summary->ic[1];
+      segment.frame = summary->ic[2];
+      segment.type = summary->ic[3];
+      segment.data = summary->data;
+      const double *trailer = summary->data + summary->size;
+
+      bool supported = false;
+      if ((segment.type == 2 || segment.type == 3) && summary->size >= 4) {
+        size_t ncomp = segment.type == 2 ? 3 : 6;
+        segment.init = trailer[-4];
+        segment.interval = trailer[-3];
+        segment.record_size = (size_t)trailer[-2];
+        segment.records = (size_t)trailer[-1];
+        segment.coefficients = segment.record_size > 2 ? (segment.record_size - 2) / ncomp : 0;
+        supported = segment.coefficients > 0 && segment.record_size == 2 + ncomp * segment.coefficients
+                    && segment.records > 0 && segment.records * segment.record_size + 4 <= summary->size;
+      }
+      else if ((segment.type == 9 || segment.type == 13) && summary->size >= 2) {
+        segment.records = (size_t)trailer[-1];
+        segment.window = min((size_t)trailer[-2] + 1, segment.records);
+        size_t directory = segment.records > 0 ? (segment.records - 1) / 100 : 0;
+        supported = segment.records >= 2 && segment.window <= MAX_WINDOW
+                    && 7 * segment.records + directory + 2 <= summary->size;
+      }
+      if (!supported) {
+        SPDLOG_DEBUG("SPK segment of type {} for body {} is not evaluated natively", segment.type, summary->ic[0]);
+        table.supported = false;
+        table.bodies.clear();
+        break;
+      }
+      table.bodies[summary->ic[0]].push_back(segment);
+    }
+    return table;
+  }
+
+
+  SpkEvaluator::~SpkEvaluator() = default;
+
+
+  const SpkEvaluator::Segment *SpkEvaluator::findSegment(int body, double et) const {
+    auto segments = m_segments.find(body);
+    if (segments == m_segments.end()) {
+      return nullptr;
+    }
+    for (const Segment *segment : segments->second) {
+      if (segment->start <= et && et <= segment->stop) {
+        return segment;
+      }
+    }
+    return nullptr;
+  }
+
+
+  bool SpkEvaluator::segmentState(const Segment &segment, double et, double *state) const {
+    switch (segment.type) {
+      case 2:
+      case 3: {
+        double offset = (et - segment.init) / segment.interval;
+        size_t record = offset > 0 ? min((size_t)offset, segment.records - 1) : 0;
+        const double *coefficients = segment.data + record * segment.record_size;
+        if (segment.type == 2) {
+          chebyshev<3, true>(coefficients, segment.coefficients, et, state);
+        }
+        else {
+          chebyshev<6, false>(coefficients, segment.coefficients, et, state);
+        }
+        break;
+      }
+      case 9:
+        lagrange(segment.data, segment.records, segment.window, et, state);
+        break;
+      case 13:
+        hermite(segment.data, segment.records, segment.window, et, state);
+        break;
+      default:
+        return false;
+    }
+
+    if (segment.frame != 1) {
+      auto rotation = m_frame_rotations.find(segment.frame);
+      if (rotation == m_frame_rotations.end()) {
+        return false;
+      }
+      rotateState(rotation->second.data(), state);
+    }
+    return true;
+  }
+
+
+  bool SpkEvaluator::evaluate(const double *ets, size_t count, double *states) const {
+#if defined(SPICEQL_WASM)
+    // the WASM build has no threads
+    size_t threads = 1;
+#else
+    size_t threads = min((size_t)max(thread::hardware_concurrency(), 1u), max(count / MIN_THREAD_EPOCHS, (size_t)1));
+#endif
+    bool ok = true;
+    if (threads < 2) {
+      ok = evaluateRange(ets, count, states);
+    }
+    else {
+      vector<char> done(threads, 0);
+      vector<thread> workers;
+      for (size_t t = 0; t < threads; t++) {
+        size_t begin = count * t / threads;
+        size_t end = count * (t + 1) / threads;
+        workers.emplace_back([&, t, begin, end]() {
+          done[t] = evaluateRange(ets + begin, end - begin, states + begin * 7);
+        });
+      }
+      for (auto &worker : workers) {
+        worker.join();
+      }
+      ok = all_of(done.begin(), done.end(), [](char d) { return d != 0; });
+    }
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (ok) {
+      g_requests++;
+      g_states += count;
+    }
+    else {
+      g_unsupported++;
+    }
+    return ok;
+  }
+
+
+  bool SpkEvaluator::evaluateRange(const double *ets, size_t count, double *states) const {
+    for (size_t i = 0; i < count; i++) {
+      double et = ets[i];
+      double *row = states + i * 7;
+      if (m_target == m_observer) {
+        fill(row, row + 7, 0.0);
+        continue;
+      }
+
+      // the target's chain of centers, with its state relative to each
+      int bodies[MAX_CHAIN];
+      double sums[MAX_CHAIN][6];
+      int chain = 1;
+      bodies[0] = m_target;
+      fill(sums[0], sums[0] + 6, 0.0);
+      while (chain < MAX_CHAIN && bodies[chain - 1] != m_observer) {
+        const Segment *segment = findSegment(bodies[chain - 1], et);
+        if (!segment) {
+          break;
+        }
+        double state[6];
+        if (!segmentState(*segment, et, state)) {
+          return false;
+        }
+        for (int c = 0; c < 6; c++) {
+          sums[chain][c] = sums[chain - 1][c] + state[c];
+        }
+        bodies[chain] = segment->center;
+        chain++;
+      }
+
+      // walk the observer's chain until it meets the target's
+      int body = m_observer;
+      double observer_sum[6] = {};
+      bool joined = false;
+      for (int link = 0; link < MAX_CHAIN && !joined; link++) {
+        for (int k = 0; k < chain; k++) {
+          if (bodies[k] == body) {
+            for (int c = 0; c < 6; c++) {
+              row[c] = sums[k][c] - observer_sum[c];
+            }
+            joined = true;
+            break;
+          }
+        }
+        if (joined) {
+          break;
+        }
+        const Segment *segment = findSegment(body, et);
+        double state[6];
+        if (!segment || !segmentState(*segment, et, state)) {
+          return false;
+        }
+        for (int c = 0; c < 6; c++) {
+          observer_sum[c] += state[c];
+        }
+        body = segment->center;
+      }
+      if (!joined) {
+        return false;
+      }
+
+      if (m_rotation) {
+        rotateState(m_rotation.get(), row);
+      }
+      row[6] = scaledNorm(row) / CLIGHT;
+    }
+    return true;
+  }
+
+
+  void SpkEvaluator::setEnabled(bool enabled) {
+    g_enabled = enabled;
+  }
+
+
+  bool SpkEvaluator::isEnabled() {
+    int enabled = g_enabled.load();
+    if (enabled < 0) {
+      const char *env = getenv(NATIVE_SPK_ENV_VAR.c_str());
+      enabled = env == NULL || toLower(string(env)) != "false";
+      int unset = -1;
+      g_enabled.compare_exchange_strong(unset, enabled);
+      enabled = g_enabled.load();
+    }
+    return enabled > 0;
+  }
+
+
+  json SpkEvaluator::stats() {
+    bool enabled = isEnabled();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return {{"enabled", enabled},
+            {"requests", g_requests},
+            {"states", g_states},
+            {"unsupported", g_unsupported},
+            {"mapped", DafFile::mapped()}};
+  }
+}
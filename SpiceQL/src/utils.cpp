@@ -11,6 +11,9 @@
 #include <cmath>
 #include <cstring>
 #include <float.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #ifdef _WIN32
 #include <process.h>  // _getpid
 #define getpid _getpid
@@ -38,8 +41,12 @@
 #include <SpiceQL/query.h>
 #include <SpiceQL/spice_types.h>
 #include <SpiceQL/utils.h>
+#include <SpiceQL/spiceql_version.h>
 #include <SpiceQL/inventory.h>
 #include <SpiceQL/alias_map.h>
+#include <SpiceQL/evalpool.h>
+#include <SpiceQL/spk_evaluator.h>
+#include <SpiceQL/ck_evaluator.h>
 
 using json = nlohmann::json;
 using namespace std;
@@ -235,6 +242,54 @@ namespace SpiceQL {
     return lt_starg;
   }
 
+
+  void getTargetStatesInto(const double *ets, size_t count, string target, string observer, string frame, string abcorr, double *states) {
+    SPDLOG_TRACE("getTargetStatesInto(count={}, target={}, observer={}, frame={}, abcorr={})", count, target, observer, frame, abcorr);
+
+    // resolve the names once instead of on every epoch
+    SpiceInt target_code, observer_code;
+    SpiceBoolean target_found, observer_found;
+    checkNaifErrors();
+    bods2c_c(target.c_str(), &target_code, &target_found);
+    bods2c_c(observer.c_str(), &observer_code, &observer_found);
+    checkNaifErrors();
+
+    // geometric states are evaluated on all cores straight from the SPKs when they can be
+    if (target_found && observer_found && count >= SpkEvaluator::MIN_EPOCHS && toLower(abcorr) == "none") {
+      unique_ptr<SpkEvaluator> native = SpkEvaluator::create(target_code, observer_code, frame, ets[0]);
+      if (native && native->evaluate(ets, count, states)) {
+        return;
+      }
+    }
+
+    auto evaluate = [&](size_t begin, size_t end, double *rows) {
+      for (size_t i = begin; i < end; i++) {
+        double *row = rows + (i - begin) * 7;
+        spkez_c(target_code, ets[i], frame.c_str(), abcorr.c_str(), observer_code, row, row + 6);
+        if (failed_c()) {
+          return false;
+        }
+      }
+      return true;
+    };
+    // frames along the way may be CK or PCK based
+    if (target_found && observer_found && EvaluationPool::run(count, 7, states, {"SPK", "CK", "PCK"}, evaluate)) {
+      return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      double *row = states + i * 7;
+      if (target_found && observer_found) {
+        spkez_c(target_code, ets[i], frame.c_str(), abcorr.c_str(), observer_code, row, row + 6);
+      }
+      else {
+        // let SPICE report the unknown name
+        spkezr_c(target.c_str(), ets[i], frame.c_str(), abcorr.c_str(), observer.c_str(), row, row + 6);
+      }
+      checkNaifErrors();
+    }
+  }
+
   json merge_json(json &j1, json &j2, bool overwrite) { 
     if(overwrite) { 
       SPDLOG_TRACE("Overwriting Kernels");
@@ -264,56 +319,132 @@ namespace SpiceQL {
     return j1;
   }
 
-  vector<double> getTargetOrientation(double et, int toFrame, int refFrame) {
-    // Much of this function is from ISIS SpiceRotation.cpp
-    SpiceDouble stateCJ[6][6];
-    SpiceDouble CJ_spice[3][3];
-    SpiceDouble av_spice[3];
-    SpiceDouble quat_spice[4];
+  namespace {
+    // Fills row with the quaternion, the angular velocity and 1 if the angular
+    // velocity was found, 0 if not. Leaves SPICE errors to the caller and
+    // neither throws nor logs, so it can run in an evaluation worker.
+    bool orientationRow(double et, int toFrame, int refFrame, double *row) {
+      // Much of this function is from ISIS SpiceRotation.cpp
+      SpiceDouble stateCJ[6][6];
+      SpiceDouble CJ_spice[3][3];
+      SpiceDouble av_spice[3] = {0, 0, 0};
+      SpiceDouble quat_spice[4];
+
+      bool has_av = true;
+
+      // First try getting the entire state matrix (6x6), which includes CJ and the angular velocity.
+      // frmchg_ and refchg_ take f2c integer* arguments. The f2c integer type is int on Linux
+      // and macOS but long on Windows, so pass integer-typed copies rather than reinterpreting
+      // the int parameters, whose width would not match on Windows.
+      integer refFrameInt = refFrame, toFrameInt = toFrame;
+      frmchg_(&refFrameInt, &toFrameInt, &et, (doublereal *) stateCJ);
+      SpiceBoolean ckfailure = failed_c();
+      reset_c();                   // Reset Naif error system to allow caller to recover
+
+      if (!ckfailure) {
+        // Transpose and isolate CJ and av
+        xpose6_c(stateCJ, stateCJ);
+        xf2rav_c(stateCJ, CJ_spice, av_spice);
+      }
+      else {  // TODO This case is untested
+        // Recompute CJ_spice ignoring av
+        reset_c(); // reset frmchg_ failure
 
-    vector<double> orientation = {0, 0, 0, 0};
+        refchg_(&refFrameInt, &toFrameInt, &et, (doublereal *) CJ_spice);
+        xpose_c(CJ_spice, CJ_spice);
 
-    bool has_av = true;
-    
-    // First try getting the entire state matrix (6x6), which includes CJ and the angular velocity.
-    // frmchg_ and refchg_ take f2c integer* arguments. The f2c integer type is int on Linux
-    // and macOS but long on Windows, so pass integer-typed copies rather than reinterpreting
-    // the int parameters, whose width would not match on Windows.
-    checkNaifErrors();
-    integer refFrameInt = refFrame, toFrameInt = toFrame;
-    frmchg_(&refFrameInt, &toFrameInt, &et, (doublereal *) stateCJ);
-    SpiceBoolean ckfailure = failed_c();
-    reset_c();                   // Reset Naif error system to allow caller to recover
+        has_av = false;
+      }
 
-    if (!ckfailure) {
-      // Transpose and isolate CJ and av
-      xpose6_c(stateCJ, stateCJ);
-      xf2rav_c(stateCJ, CJ_spice, av_spice);
+      if (failed_c()) {
+        return false;
+      }
+      // Translate matrix to quaternion
+      m2q_c(CJ_spice, quat_spice);
 
-      // Convert to std::array for output
+      for(int i = 0; i < 4; i++) {
+        row[i] = quat_spice[i];
+      }
       for(int i = 0; i < 3; i++) {
-        orientation.push_back(av_spice[i]);
+        row[4 + i] = av_spice[i];
       }
+      row[7] = has_av ? 1 : 0;
+      return true;
     }
-    else {  // TODO This case is untested
-      // Recompute CJ_spice ignoring av
-      reset_c(); // reset frmchg_ failure
+  }
 
-      refchg_(&refFrameInt, &toFrameInt, &et, (doublereal *) CJ_spice);
-      xpose_c(CJ_spice, CJ_spice);
 
-      has_av = false;
-    }
+  vector<double> getTargetOrientation(double et, int toFrame, int refFrame) {
+    double row[8];
+    checkNaifErrors();
+    orientationRow(et, toFrame, refFrame, row);
+    checkNaifErrors();
+
+    // the angular velocity follows the quaternion when it was found
+    vector<double> orientation(row, row + (row[7] ? 7 : 4));
+    return orientation;
+  }
+
 
+  void getTargetOrientationsInto(const double *ets, size_t count, int toFrame, int refFrame, double *orientations) {
+    SPDLOG_TRACE("getTargetOrientationsInto(count={}, toFrame={}, refFrame={})", count, toFrame, refFrame);
     checkNaifErrors();
-    // Translate matrix to std:array quaternion
-    m2q_c(CJ_spice, quat_spice);
 
-    for(int i = 0; i < 4; i++) {
-      orientation[i] = quat_spice[i];
+    // orientations are evaluated on all cores straight from the CKs when they can be
+    if (count >= CkEvaluator::MIN_EPOCHS) {
+      unique_ptr<CkEvaluator> native = CkEvaluator::create(toFrame, refFrame, ets, count);
+      if (native && native->evaluate(orientations)) {
+        return;
+      }
     }
 
-    return orientation;
+    auto evaluate = [&](size_t begin, size_t end, double *rows) {
+      for (size_t i = begin; i < end; i++) {
+        if (!orientationRow(ets[i], toFrame, refFrame, rows + (i - begin) * 8)) {
+          return false;
+        }
+      }
+      return true;
+    };
+    // dynamic frames read SPKs
+    if (EvaluationPool::run(count, 8, orientations, {"CK", "PCK", "SPK"}, evaluate)) {
+      return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      orientationRow(ets[i], toFrame, refFrame, orientations + i * 8);
+      checkNaifErrors();
+    }
+  }
+
+
+  void setEvaluationProcesses(size_t processes) {
+    EvaluationPool::setProcesses(processes);
+  }
+
+
+  json getEvaluationPoolStats() {
+    return EvaluationPool::stats();
+  }
+
+
+  void setNativeSpkEvaluation(bool enabled) {
+    SpkEvaluator::setEnabled(enabled);
+  }
+
+
+  json getNativeSpkStats() {
+    return SpkEvaluator::stats();
+  }
+
+
+  void setNativeCkEvaluation(bool enabled) {
+    CkEvaluator::setEnabled(enabled);
+  }
+
+
+  json getNativeCkStats() {
+    return CkEvaluator::stats();
   }
 
 
@@ -321,21 +452,34 @@ namespace SpiceQL {
   // returns json with up to ROOM=200 matching keynames:values
   // if no keys are found, returns null
   json findKeywords(string keytpl) {
-    // Define gnpool i/o
-    const SpiceInt START = 0;
+    // Define gnpool i/o, names and values are read in pages of ROOM so
+    // large results are not truncated
     const SpiceInt ROOM = 200;
     const SpiceInt LENOUT = 200;
     ConstSpiceChar *cstr = keytpl.c_str();
-    SpiceInt nkeys;
-    SpiceChar kvals [ROOM][LENOUT];
+    SpiceInt nkeys = 0;
+    vector<SpiceChar> kvals(ROOM * LENOUT);
     SpiceBoolean gnfound;
+    vector<string> keys;
 
     // Call gnpool to search for input key template
-    checkNaifErrors();
-    gnpool_c(cstr, START, ROOM, LENOUT, &nkeys, kvals, &gnfound);
-    checkNaifErrors();
+    for (SpiceInt start = 0; ; start += nkeys) {
+      checkNaifErrors();
+      gnpool_c(cstr, start, ROOM, LENOUT, &nkeys, kvals.data(), &gnfound);
+      checkNaifErrors();
 
-    if(!gnfound) {
+      if (!gnfound || nkeys == 0) {
+        break;
+      }
+      for (int i = 0; i < nkeys; i++) {
+        keys.emplace_back(&kvals[i * LENOUT]);
+      }
+      if (nkeys < ROOM) {
+        break;
+      }
+    }
+
+    if(keys.empty()) {
       return nullptr;
     }
 
@@ -343,106 +487,87 @@ namespace SpiceQL {
     // accumulate results to json allResults
 
     // Define gXpool params
-    ConstSpiceChar *fkey;
-    SpiceInt nvals;
-    SpiceChar cvals [ROOM][LENOUT];
-    SpiceDouble dvals[ROOM];
-    SpiceInt ivals[ROOM];
-    SpiceBoolean gcfound = false, gdfound = false, gifound = false;
+    SpiceInt nvals = 0;
+    vector<SpiceChar> cvals(ROOM * LENOUT);
+    vector<SpiceDouble> dvals(ROOM);
+    SpiceBoolean gcfound = false, gdfound = false;
+
+    // if null or boolean, do a conversion
+    auto charValue = [](string str_cval) -> json {
+      string lower = toLower(str_cval);
+      if (lower == "true") {
+        return true;
+      }
+      else if (lower == "false") {
+        return false;
+      }
+      else if (lower == "null") {
+        return nullptr;
+      }
+      return str_cval;
+    };
 
     json allResults;
     
     // iterate over kvals;
-    for(int i = 0; i < nkeys; i++) {
+    for(auto &key : keys) {
       json jresultVal;
+      ConstSpiceChar *fkey = key.c_str();
 
-      fkey = &kvals[i][0];
-
-      checkNaifErrors();
-      gdpool_c(fkey, START, ROOM, &nvals, dvals, &gdfound);
-      checkNaifErrors();
-
-      if (gdfound) {
-        // format output
-        if (nvals == 1) {
-          jresultVal = dvals[0];
-        }
-        else {
-          for(int j=0; j<nvals; j++) {
-            jresultVal.push_back(dvals[j]);
-          }
-        }
-      }
-
-      if (!gdfound) {
-        gipool_c(fkey, START, ROOM, &nvals, ivals, &gifound);
+      // Numeric values are always found by gdpool, integers included
+      vector<double> dresults;
+      for (SpiceInt start = 0; ; start += nvals) {
         checkNaifErrors();
-      }
-
-      if (gifound) {
-        // format output
-        if (nvals == 1) {
-          jresultVal = ivals[0];
+        gdpool_c(fkey, start, ROOM, &nvals, dvals.data(), &gdfound);
+        checkNaifErrors();
+        if (!gdfound || nvals == 0) {
+          break;
         }
-        else {
-          for(int j=0; j<nvals; j++) {
-            jresultVal.push_back(ivals[j]);
-          }
+        dresults.insert(dresults.end(), dvals.begin(), dvals.begin() + nvals);
+        if (nvals < ROOM) {
+          break;
         }
       }
 
-      if (!gifound || !gdfound) {
-        gcpool_c(fkey, START, ROOM, LENOUT, &nvals, cvals, &gcfound);
-        checkNaifErrors();
-      }
-
-      if (gcfound) {
-        // format gcpool output
-        string str_cval;
-        if (nvals == 1) {
-          str_cval.assign(&cvals[0][0]);
-          string lower = toLower(str_cval);
-
-          // if null or boolean, do a conversion
-          if (lower == "true") {
-            jresultVal = true;
+      vector<string> cresults;
+      if (dresults.empty()) {
+        for (SpiceInt start = 0; ; start += nvals) {
+          checkNaifErrors();
+          gcpool_c(fkey, start, ROOM, LENOUT, &nvals, cvals.data(), &gcfound);
+          checkNaifErrors();
+          if (!gcfound || nvals == 0) {
+            break;
           }
-          else if (lower == "false") {
-            jresultVal = false;
+          for (int j = 0; j < nvals; j++) {
+            cresults.emplace_back(&cvals[j * LENOUT]);
           }
-          else if (lower == "null") {
-            jresultVal = nullptr;
-          }
-          else {
-            jresultVal = str_cval;
+          if (nvals < ROOM) {
+            break;
           }
         }
-        else {
-          for(int j=0; j<nvals; j++) {
-            str_cval.assign(&cvals[j][0]);
-            string lower = toLower(str_cval);
+      }
 
-            // if null or boolean, do a conversion
-            if (lower == "true") {
-              jresultVal.push_back(true);
-            }
-            else if (lower == "false") {
-              jresultVal.push_back(false);
-            }
-            else if (lower == "null") {
-              jresultVal.push_back(nullptr);
-            }
-            else {
-              jresultVal.push_back(str_cval);
-            }
-          }
+      // format output
+      if (dresults.size() == 1) {
+        jresultVal = dresults[0];
+      }
+      else if (dresults.size() > 1) {
+        for (double d : dresults) {
+          jresultVal.push_back(d);
+        }
+      }
+      else if (cresults.size() == 1) {
+        jresultVal = charValue(cresults[0]);
+      }
+      else {
+        for (string &c : cresults) {
+          jresultVal.push_back(charValue(c));
         }
       }
 
       // append to allResults:
       //     key:list-of-values
-      string resultKey(fkey);
-      allResults[resultKey] = jresultVal;
+      allResults[key] = jresultVal;
     }
 
     return allResults;
@@ -924,6 +1049,171 @@ namespace SpiceQL {
   }
 
 
+  vector<CkSegmentRecords> getCkRecordTimes(string kpath) {
+    SPDLOG_TRACE("getCkRecordTimes({})", kpath);
+    vector<CkSegmentRecords> segments;
+
+    SpiceInt handle;
+    SpiceBoolean found;
+    checkNaifErrors();
+    dafopr_c(kpath.c_str(), &handle);
+    checkNaifErrors();
+
+    try {
+      dafbfs_c(handle);
+      daffna_c(&found);
+      while (found) {
+        double sum[10]; // daf segment summary
+        double dc[2];   // segment starting and ending times in tics
+        SpiceInt ic[6]; // instrument, reference frame, data type, velocity flag, offset to quat 1, offset to end
+        dafgs_c(sum);
+        dafus_c(sum, (SpiceInt)2, (SpiceInt)6, dc, ic);
+
+        if (ic[2] == 3) {
+          int sclk_id = ic[0] / 1000;
+          CkSegmentRecords segment;
+          segment.instrument = ic[0];
+          sct2e_c(sclk_id, dc[0], &segment.start_et);
+          sct2e_c(sclk_id, dc[1], &segment.stop_et);
+
+          // the segment ends with (number of intervals, number of instances)
+          double val[2];
+          dafgda_c(handle, ic[5] - 1, ic[5], val);
+          int ninstances = (int)val[1];
+          int numvel = ic[3] * 3;
+          int sclkdp1off = ic[4] + (4 + numvel) * ninstances;
+
+          vector<double> sclkdp(ninstances);
+          if (ninstances > 0) {
+            dafgda_c(handle, sclkdp1off, sclkdp1off + ninstances - 1, sclkdp.data());
+          }
+          segment.record_ets.resize(ninstances);
+          for (int i = 0; i < ninstances; i++) {
+            sct2e_c(sclk_id, sclkdp[i], &segment.record_ets[i]);
+          }
+          checkNaifErrors();
+          segments.push_back(std::move(segment));
+        }
+
+        dafcs_c(handle);  // continue search in this daf
+        daffna_c(&found);
+      }
+      checkNaifErrors();
+    }
+    catch (...) {
+      dafcls_c(handle);
+      throw;
+    }
+
+    dafcls_c(handle);
+    checkNaifErrors();
+    return segments;
+  }
+
+
+  void mergeKernels(string fileName, string type, vector<string> kernels, string comment) {
+    // CKs and SPKs are both DAFs with 2 double and 6 integer summary components
+    const SpiceInt ND = 2;
+    const SpiceInt NI = 6;
+    const SpiceInt NAMELEN = 8 * (ND + (NI + 1) / 2) + 1;
+    // doubles copied per read so large segments are not held in memory at once
+    const SpiceInt CHUNK = 1 << 16;
+
+    if (kernels.empty()) {
+      throw invalid_argument("No kernels to merge into " + fileName + ".");
+    }
+    Kernel::Type ktype = Kernel::translateType(type);
+    if (ktype != Kernel::Type::CK && ktype != Kernel::Type::SPK) {
+      throw invalid_argument(fmt::format("Only CKs and SPKs can be merged, not {}.", type));
+    }
+
+    struct Segment {
+      double sum[ND + (NI + 1) / 2];
+      string name;
+      SpiceInt begin;
+      SpiceInt end;
+    };
+
+    SpiceInt out;
+    checkNaifErrors();
+    if (ktype == Kernel::Type::CK) {
+      ckopn_c(fileName.c_str(), "CK", 0, &out);
+    }
+    else {
+      spkopn_c(fileName.c_str(), "SPK", 0, &out);
+    }
+    checkNaifErrors();
+
+    try {
+      for (auto &kernel : kernels) {
+        SpiceInt in;
+        dafopr_c(kernel.c_str(), &in);
+        checkNaifErrors();
+
+        try {
+          // Read every summary before writing so the search is not interleaved with the new arrays
+          vector<Segment> segments;
+          SpiceBoolean found;
+          dafbfs_c(in);
+          daffna_c(&found);
+          while (found) {
+            Segment segment;
+            SpiceChar name[NAMELEN];
+            double dc[ND];
+            SpiceInt ic[NI];
+            dafgs_c(segment.sum);
+            dafgn_c(NAMELEN, name);
+            dafus_c(segment.sum, ND, NI, dc, ic);
+            segment.name = name;
+            segment.begin = ic[NI - 2];
+            segment.end = ic[NI - 1];
+            segments.push_back(segment);
+            daffna_c(&found);
+          }
+          checkNaifErrors();
+
+          vector<double> data;
+          for (auto &segment : segments) {
+            // the new array's addresses are filled in by dafena_
+            integer handle = out;
+            dafbna_(&handle, segment.sum, (char *) segment.name.c_str(), (ftnlen) segment.name.size());
+            for (SpiceInt first = segment.begin; first <= segment.end; first += CHUNK) {
+              SpiceInt last = std::min(segment.end, first + CHUNK - 1);
+              data.resize(last - first + 1);
+              dafgda_c(in, first, last, data.data());
+              integer n = data.size();
+              dafada_(data.data(), &n);
+            }
+            dafena_();
+            checkNaifErrors();
+          }
+          SPDLOG_TRACE("Copied {} segments of {} into {}", segments.size(), kernel, fileName);
+        }
+        catch (...) {
+          dafcls_c(in);
+          throw;
+        }
+        dafcls_c(in);
+      }
+
+      // comment lines must be at least 2 characters long, same as writeComment
+      stringstream lines(comment);
+      string line;
+      while (getline(lines, line)) {
+        while (line.size() < 2) { line.append(" "); }
+        dafac_c(out, 1, line.size() + 1, line.c_str());
+        checkNaifErrors();
+      }
+    }
+    catch (...) {
+      dafcls_c(out);
+      throw;
+    }
+    dafcls_c(out);
+    checkNaifErrors();
+  }
+
+
   string globTimeIntervals(string mission) { 
     SPDLOG_TRACE("In globTimeIntervals.");
     Config conf;
@@ -1000,38 +1290,141 @@ namespace SpiceQL {
   }
 
 
-  string getDataDirectory() {
-      char* isisdata_ptr = getenv("ISISDATA");
-      fs::path isisDataDir = isisdata_ptr == NULL ? "" : isisdata_ptr;
+  namespace {
+    // How many resolved kernel paths are kept before the cache starts over
+    const size_t MAX_RESOLVED_PATHS = 1 << 16;
 
-      char* alespice_ptr = getenv("ALESPICEROOT");
-      fs::path aleDataDir = alespice_ptr == NULL ? "" : alespice_ptr;
-      
-      char* spiceroot_ptr = getenv("SPICEROOT");
-      fs::path spiceDataDir = spiceroot_ptr == NULL ? "" : spiceroot_ptr;
- 
-      if (fs::is_directory(spiceDataDir)) {
-         return spiceDataDir.string();
+    // Data directory env vars in the order they are searched
+    const vector<string> DATA_DIR_ENV_VARS = {"SPICEROOT", "ALESPICEROOT", "ISISDATA"};
+
+    // The data directory and kernel paths resolved from one set of env values
+    struct ResolvedEnvironment {
+      vector<string> env_values;
+      string data_dir;                       // empty until resolved
+      unordered_map<string, string> paths;   // kernel path -> full path of an existing file
+    };
+
+    std::mutex g_env_mutex;
+    ResolvedEnvironment g_env;
+
+
+    vector<string> readDataDirEnv() {
+      vector<string> values;
+      for (auto &name : DATA_DIR_ENV_VARS) {
+        const char *value = getenv(name.c_str());
+        values.push_back(value == NULL ? "" : value);
+      }
+      return values;
+    }
+
+
+    // Starts over when the env vars changed, callers must hold g_env_mutex
+    void checkEnvironment(const vector<string> &env_values) {
+      if (g_env.env_values != env_values) {
+        g_env.env_values = env_values;
+        g_env.data_dir.clear();
+        g_env.paths.clear();
       }
+    }
+  }
 
-      if (fs::is_directory(aleDataDir)) {
-        return aleDataDir.string();
+
+  string getDataDirectory() {
+      vector<string> env_values = readDataDirEnv();
+      std::lock_guard<std::mutex> lock(g_env_mutex);
+      checkEnvironment(env_values);
+      if (!g_env.data_dir.empty()) {
+        return g_env.data_dir;
       }
 
-      if (fs::is_directory(isisDataDir)) {
-        return isisDataDir.string();
+      bool fallback = false;
+      for (auto &value : env_values) {
+        if (fs::is_directory(fs::path(value))) {
+          // a preferred directory that does not exist yet is checked again next time
+          if (!fallback) {
+            g_env.data_dir = fs::path(value).string();
+          }
+          return fs::path(value).string();
+        }
+        fallback = fallback || !value.empty();
       }
 #ifdef SPICEQL_WASM
       // In the WASM build there is no host filesystem and env vars may be
       // unset. Kernels are furnished from the Emscripten virtual FS via
       // explicit paths, so fall back to the FS root instead of throwing.
-      return "/";
+      g_env.data_dir = "/";
+      return g_env.data_dir;
 #else
       throw runtime_error(fmt::format("Please set env var SPICEROOT, ISISDATA or ALESPICEROOT in order to proceed."));
 #endif
   }
 
 
+  string resolveDataPath(string path) {
+    vector<string> env_values = readDataDirEnv();
+    {
+      std::lock_guard<std::mutex> lock(g_env_mutex);
+      checkEnvironment(env_values);
+      auto it = g_env.paths.find(path);
+      if (it != g_env.paths.end()) {
+        return it->second;
+      }
+    }
+
+    string full_path = path;
+    if (!fs::exists(path)) {
+      full_path = (getDataDirectory() / fs::path(path)).string();
+      if (!fs::exists(full_path)) {
+        // missing files are not remembered, they may show up later
+        return full_path;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(g_env_mutex);
+    if (g_env.env_values != env_values) {
+      return full_path;
+    }
+    if (g_env.paths.size() >= MAX_RESOLVED_PATHS) {
+      g_env.paths.clear();
+    }
+    g_env.paths[path] = full_path;
+    return full_path;
+  }
+
+
+  void refreshEnvironment() {
+    std::lock_guard<std::mutex> lock(g_env_mutex);
+    g_env = ResolvedEnvironment();
+  }
+
+
+  string getDefaultCacheDir() {
+    string data_root = "";
+    try {
+      data_root = fs::absolute(getDataDirectory()).generic_string();
+    }
+    catch (exception &e) {
+      SPDLOG_TRACE("No data directory for the default cache key: {}", e.what());
+    }
+
+    const char *user_ptr = getenv("USER");
+    if (user_ptr == NULL) {
+      user_ptr = getenv("USERNAME");
+    }
+    string user = user_ptr == NULL ? "" : user_ptr;
+
+    // FNV-1a, so the key is stable across processes and standard libraries
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : data_root + "|" + user) {
+      hash ^= c;
+      hash *= 1099511628211ULL;
+    }
+
+    string dirname = fmt::format("spiceql-cache-{}-{:016x}", SPICEQL_VERSION, hash);
+    return (fs::temp_directory_path() / dirname / "spiceql_cache").string();
+  }
+
+
   string getConfigDirectory() {
     fs::path debugDbPath = fs::absolute(_SOURCE_PREFIX) / "SpiceQL" / "db";
 
@@ -1381,35 +1774,173 @@ namespace SpiceQL {
   }
 
 
+  namespace {
+    // Immutable snapshot resolving names and codes straight to missions.
+    // Published through an atomic shared_ptr, a snapshot is freed once the
+    // lookups still reading it finish. It is rebuilt when the aliases, the
+    // config, the frame list or the DB change.
+    struct MissionIndex {
+      uint64_t alias_generation = 0;
+      uint64_t config_generation = 0;
+      uint64_t db_generation = 0;
+      size_t frame_list_hash = 0;
+      unordered_map<string, string> names;  // UPPER alias/config key -> mission
+      unordered_map<int, string> codes;     // code -> mission, "" if its name has none
+    };
+
+    // Built-in NAIF body codes outside the DB's frame map are indexed in this range
+    const int MISSION_INDEX_NAIF_RANGE = 1000;
+    // How long a snapshot is trusted before the config, frame list and DB are checked again
+    const int64_t MISSION_INDEX_CHECK_MS = 1000;
+
+    // only accessed through atomic_load and atomic_store
+    shared_ptr<const MissionIndex> g_mission_index;
+    std::atomic<int64_t> g_mission_index_checked{0};  // steady clock ms of the last check
+    std::atomic<uint64_t> g_mission_index_hits{0};
+    std::atomic<uint64_t> g_mission_index_misses{0};
+    std::atomic<uint64_t> g_mission_index_builds{0};
+    std::mutex g_mission_index_mutex;  // serializes rebuilds, never taken by lookups
+
+    int64_t steadyMillis() {
+      return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    size_t hashFrameList(const vector<string> &frames) {
+      size_t seed = frames.size();
+      for (const string &frame : frames) {
+        Memo::hash_combine(seed, frame);
+      }
+      return seed;
+    }
+
+    shared_ptr<const MissionIndex> buildMissionIndex(uint64_t configGeneration, uint64_t dbGeneration, const vector<string> &frameNames) {
+      auto index = make_shared<MissionIndex>();
+      json aliases = AliasMap::instance().getAliasMap();
+      // read after getAliasMap, which may load the default aliases
+      index->alias_generation = AliasMap::instance().generation();
+      index->config_generation = configGeneration;
+      index->db_generation = dbGeneration;
+      index->frame_list_hash = hashFrameList(frameNames);
+
+      for (auto &[mission, list] : aliases.items()) {
+        for (const string &alias : list) {
+          index->names[alias] = mission;
+        }
+      }
+      // Same precedence as AliasMap::getSpiceqlName: aliases win over config keys
+      for (const string &frame : frameNames) {
+        index->names.emplace(toUpper(frame), frame);
+      }
+
+      auto missionForName = [&](const string &name) -> string {
+        auto it = index->names.find(toUpper(name));
+        return it != index->names.end() ? it->second : "";
+      };
+
+      json frames = Inventory::getFrameNameMapFromCache();
+      index->codes.reserve(frames.size() + 2 * MISSION_INDEX_NAIF_RANGE + 1);
+      for (auto &[code, name] : frames.items()) {
+        index->codes[stoi(code)] = missionForName(name.get<string>());
+      }
+      for (int code = -MISSION_INDEX_NAIF_RANGE; code <= MISSION_INDEX_NAIF_RANGE; code++) {
+        if (code == 0 || index->codes.count(code)) continue;
+        SpiceChar buf[128];
+        SpiceBoolean found = SPICEFALSE;
+        bodc2n_c(code, 128, buf, &found);
+        if (found && strlen(buf) > 0) {
+          index->codes[code] = missionForName(string(buf));
+        }
+      }
+
+      SPDLOG_DEBUG("Built mission index with {} names and {} codes", index->names.size(), index->codes.size());
+      return index;
+    }
+
+    shared_ptr<const MissionIndex> currentMissionIndex() {
+      shared_ptr<const MissionIndex> index = atomic_load_explicit(&g_mission_index, memory_order_acquire);
+      int64_t now = steadyMillis();
+      if (index && index->alias_generation == AliasMap::instance().generation()
+          && now - g_mission_index_checked.load(memory_order_relaxed) < MISSION_INDEX_CHECK_MS) {
+        return index;
+      }
+
+      lock_guard<mutex> lock(g_mission_index_mutex);
+      uint64_t configGen = configGeneration();
+      uint64_t dbGeneration = Inventory::getDbGeneration();
+      vector<string> frames = frameList();
+      index = atomic_load_explicit(&g_mission_index, memory_order_acquire);
+      if (!index || index->alias_generation != AliasMap::instance().generation()
+          || index->config_generation != configGen
+          || index->db_generation != dbGeneration
+          || index->frame_list_hash != hashFrameList(frames)) {
+        // the replaced index is freed when the last lookup holding it returns
+        index = buildMissionIndex(configGen, dbGeneration, frames);
+        atomic_store_explicit(&g_mission_index, index, memory_order_release);
+        g_mission_index_builds++;
+      }
+      g_mission_index_checked.store(now, memory_order_relaxed);
+      return index;
+    }
+
+    // Codes outside the index (e.g. kernel defined bodies beyond the indexed
+    // NAIF range) are resolved without furnishing kernels, as before the index.
+    string missionForCode(const MissionIndex &index, int code) {
+      auto it = index.codes.find(code);
+      if (it != index.codes.end()) {
+        g_mission_index_hits++;
+        return it->second;
+      }
+      g_mission_index_misses++;
+      string name = codeToNameNoKernels(code);
+      return name.empty() ? "" : AliasMap::instance().getSpiceqlName(name);
+    }
+  }
+
+
   string inferMission(const vector<string>& nameCandidates,
                       const vector<int>& codeCandidates) {
     SPDLOG_DEBUG("Inferring mission from name candidates: [{}] and code candidates: [{}]",
                  fmt::join(nameCandidates, ", "), fmt::join(codeCandidates, ", "));
+    shared_ptr<const MissionIndex> current = currentMissionIndex();
+    const MissionIndex &index = *current;
     for (const auto& cand : nameCandidates) {
       if (cand.empty()) continue;
-      string m = AliasMap::instance().getSpiceqlName(cand);
-      if (!m.empty()) {
-        SPDLOG_DEBUG("Found mission {} from name candidate {}", m, cand);
-        return m;
+      // The index holds every alias and config key, so a miss is final
+      auto it = index.names.find(toUpper(cand));
+      if (it == index.names.end()) {
+        g_mission_index_misses++;
+        continue;
       }
+      g_mission_index_hits++;
+      SPDLOG_DEBUG("Found mission {} from name candidate {}", it->second, cand);
+      return it->second;
     }
     for (int code : codeCandidates) {
       if (code == 0) continue;
       int bus = (std::abs(code) / 1000 != 0) ? code / 1000 : code;
       for (int c : {code, bus}) {
-        string name = codeToNameNoKernels(c);
-        if (!name.empty()) {
-          string m = AliasMap::instance().getSpiceqlName(name);
-          if (!m.empty()) {
-            SPDLOG_DEBUG("Found mission {} from code candidate {}", m, code);
-            return m;
-          }
+        string m = missionForCode(index, c);
+        if (!m.empty()) {
+          SPDLOG_DEBUG("Found mission {} from code candidate {}", m, code);
+          return m;
         }
       }
     }
     return "";
   }
 
+
+  json getMissionIndexStats() {
+    json stats;
+    stats["hits"] = g_mission_index_hits.load();
+    stats["misses"] = g_mission_index_misses.load();
+    stats["builds"] = g_mission_index_builds.load();
+    shared_ptr<const MissionIndex> index = atomic_load_explicit(&g_mission_index, memory_order_acquire);
+    stats["names"] = index ? index->names.size() : 0;
+    stats["codes"] = index ? index->codes.size() : 0;
+    return stats;
+  }
+
   json formatKernels(vector<string> kernelPaths) {
     SPDLOG_TRACE("formatKernels with {} paths", kernelPaths.size());
 
@@ -7,11 +7,15 @@
 
 #include <SpiceQL/inventory.h>
 #include <SpiceQL/inventoryimpl.h>
+#include <SpiceQL/shared_index.h>
+#include <SpiceQL/prefetch.h>
 #include <SpiceQL/api.h>
 
 #include <fstream>
+#include <thread>
 #include <SpiceQL/spiceql_logging.h>
 #include <highfive/highfive.hpp>
+#include <highfive/H5Easy.hpp>
 
 
 TEST_F(LroKernelSet, TestInventorySmithed) { 
@@ -152,6 +156,328 @@ TEST_F(LroKernelSet, TestInventorySearchSetFromRegex) {
   EXPECT_EQ(fs::path(kernels["pck"][0].get<string>()).filename(), "moon_080317.tf");
 }
 
+TEST_F(LroKernelSet, TestInventoryPublishGeneration) { 
+  uint64_t generation = Inventory::getDbGeneration();
+  EXPECT_GT(generation, 0);
+
+  // warm the in-memory index so the republish has something to swap out
+  nlohmann::json kernels = Inventory::search_for_kernelset("lroc", {"ck"}, 110000000, 140000000, {"reconstructed"});
+  EXPECT_EQ(fs::path(kernels["ck"][0]).filename(), "soc31_1111111_1111111_v21.bc");
+
+  Inventory::create_database();
+  EXPECT_EQ(Inventory::getDbGeneration(), generation + 1);
+
+  // the new DB is renamed into place, nothing is left behind
+  for (auto &entry : fs::directory_iterator(SpiceQL::getCacheDir())) {
+    EXPECT_NE(entry.path().extension(), ".tmp");
+  }
+
+  kernels = Inventory::search_for_kernelset("lroc", {"ck"}, 110000000, 140000000, {"reconstructed"});
+  EXPECT_EQ(fs::path(kernels["ck"][0]).filename(), "soc31_1111111_1111111_v21.bc");
+}
+
+TEST_F(LroKernelSet, TestInventoryConcurrentBuild) { 
+  uint64_t generation = Inventory::getDbGeneration();
+
+  // builds serialize on the lock file; whichever runs second may reuse the first's DB
+  std::thread builder([]() { Inventory::create_database(); });
+  Inventory::create_database();
+  builder.join();
+
+  EXPECT_GE(Inventory::getDbGeneration(), generation + 1);
+  EXPECT_TRUE(Inventory::isDbReady());
+
+  nlohmann::json kernels = Inventory::search_for_kernelset("lroc", {"ck"}, 110000000, 140000000, {"reconstructed"});
+  EXPECT_EQ(fs::path(kernels["ck"][0]).filename(), "soc31_1111111_1111111_v21.bc");
+}
+
+TEST_F(LroKernelSet, TestInventoryShards) { 
+  std::string shard_file = SpiceQL::getShardFile("lroc");
+  Inventory::create_database_shards({"lroc"});
+  ASSERT_TRUE(fs::exists(shard_file));
+
+  Inventory::merge_database_shards({shard_file});
+  EXPECT_TRUE(Inventory::isDbReady());
+  EXPECT_EQ(SpiceQL::getDbFileForMission("lroc"), Inventory::getDbFilePath());
+
+  nlohmann::json kernels = Inventory::search_for_kernelset("lroc", {"fk", "ck"}, 110000000, 140000000, {"reconstructed"});
+  EXPECT_EQ(fs::path(kernels["fk"][0]).filename(), "lro_frames_1111111_v01.tf");
+  EXPECT_EQ(fs::path(kernels["ck"][0]).filename(), "soc31_1111111_1111111_v21.bc");
+
+  // a shard rebuilt after the merge is read directly
+  Inventory::create_database_shards({"lroc"});
+  EXPECT_EQ(SpiceQL::getDbFileForMission("lroc"), shard_file);
+  kernels = Inventory::search_for_kernelset("lroc", {"ck"}, 110000000, 140000000, {"reconstructed"});
+  EXPECT_EQ(fs::path(kernels["ck"][0]).filename(), "soc31_1111111_1111111_v21.bc");
+
+  // the same mission can not come from two shards, the copy is kept out of the
+  // shard directory so later merges of every shard do not pick it up
+  fs::path copy = fs::temp_directory_path() / ("lroc_copy_" + SpiceQL::gen_random(10) + ".hdf");
+  fs::copy_file(shard_file, copy);
+  EXPECT_THROW(Inventory::merge_database_shards({shard_file, copy.string()}), std::runtime_error);
+  fs::remove(copy);
+}
+
+TEST_F(LroKernelSet, TestInventoryLayoutV2) { 
+  Inventory::create_database();
+
+  HighFive::File file(Inventory::getDbFilePath(), HighFive::File::ReadOnly);
+  int layout = 0;
+  file.getAttribute("SPICEQL_DB_LAYOUT").read(layout);
+  EXPECT_EQ(layout, 2);
+  EXPECT_TRUE(file.exist("spice/lroc/ck/reconstructed/records"));
+  EXPECT_TRUE(file.exist("spice/lroc/spql_paths"));
+  EXPECT_FALSE(file.exist("spice/lroc/ck/reconstructed/path_index"));
+
+  std::shared_ptr<SpiceQL::TimeIndexedKernels> time_indices = SpiceQL::getTimeIndexedKernels("lroc/ck/reconstructed");
+  ASSERT_NE(time_indices, nullptr);
+  EXPECT_EQ(time_indices->file_paths.size(), time_indices->start_times.size());
+  EXPECT_EQ(time_indices->file_paths.size(), time_indices->stop_times.size());
+}
+
+TEST_F(LroKernelSet, TestInventorySharedIndex) { 
+  Inventory::create_database();
+  nlohmann::json expected = Inventory::search_for_kernelset("lroc", {"fk", "sclk", "spk", "ck"}, 110000000, 140000000, {"smithed", "reconstructed"}, {"smithed", "reconstructed"}, false);
+  int code = Inventory::getFrameCodeFromCache("LRO_LROCNACL");
+  std::string name = Inventory::getFrameNameFromCache(-85600);
+
+  Inventory::publishSharedIndex();
+  EXPECT_TRUE(fs::exists(SpiceQL::SharedIndex::getFile()));
+  ASSERT_TRUE(Inventory::attachSharedIndex());
+  ASSERT_NE(SpiceQL::SharedIndex::current(), nullptr);
+
+  SpiceQL::SharedKernelIndex index;
+  EXPECT_TRUE(SpiceQL::SharedIndex::current()->findKernels("lroc/ck/reconstructed/", index));
+  EXPECT_GT(index.size(), 0);
+  EXPECT_FALSE(SpiceQL::SharedIndex::current()->findKernels("lroc/ck/predicted", index));
+
+  nlohmann::json kernels = Inventory::search_for_kernelset("lroc", {"fk", "sclk", "spk", "ck"}, 110000000, 140000000, {"smithed", "reconstructed"}, {"smithed", "reconstructed"}, false);
+  EXPECT_EQ(kernels, expected);
+  EXPECT_EQ(Inventory::getFrameCodeFromCache("lro_lrocnacl"), code);
+  EXPECT_EQ(Inventory::getFrameNameFromCache(-85600), name);
+
+  // a new generation makes the published index stale
+  Inventory::create_database();
+  EXPECT_EQ(SpiceQL::SharedIndex::current(), nullptr);
+  EXPECT_EQ(Inventory::search_for_kernelset("lroc", {"fk", "sclk", "spk", "ck"}, 110000000, 140000000, {"smithed", "reconstructed"}, {"smithed", "reconstructed"}, false), expected);
+
+  Inventory::detachSharedIndex();
+  EXPECT_EQ(SpiceQL::SharedIndex::current(), nullptr);
+}
+
+TEST_F(LroKernelSet, TestInventoryPreload) { 
+  Inventory::create_database();
+
+  nlohmann::json report = Inventory::preload({"LROC"});
+  EXPECT_TRUE(report["warm"].get<bool>());
+  EXPECT_EQ(report["missions"], nlohmann::json({"lroc"}));
+
+  std::vector<std::string> stages;
+  for (auto &stage : report["stages"]) {
+    stages.push_back(stage["stage"]);
+    EXPECT_GE(stage["seconds"].get<double>(), 0);
+    EXPECT_FALSE(stage.contains("error"));
+  }
+  EXPECT_EQ(stages, std::vector<std::string>({"config", "alias_map", "frame_cache", "time_indices"}));
+  EXPECT_GT(report["stages"][3]["keys"].get<size_t>(), 0);
+
+  report = Inventory::preload({"not_a_mission"});
+  EXPECT_FALSE(report["warm"].get<bool>());
+  EXPECT_TRUE(report["stages"][0].contains("error"));
+}
+
+TEST_F(LroKernelSet, TestInventoryPinnedKernels) {
+  Inventory::create_database();
+
+  nlohmann::json pinned = Inventory::pinMissionKernels({"LROC"});
+  EXPECT_EQ(Inventory::getPinnedMissions(), std::vector<std::string>({"base", "lroc"}));
+  ASSERT_TRUE(pinned["lroc"].contains("sclk"));
+  EXPECT_FALSE(getPinnedKernels().empty());
+
+  // pinned types are answered from the pinned kernels, the others are searched
+  nlohmann::json kernels = Inventory::search_for_kernelset("lroc", {"sclk", "fk", "ck"}, 110000000, 140000001, {"smithed", "reconstructed"}, {"smithed", "reconstructed"}, false);
+  EXPECT_EQ(kernels["sclk"], pinned["lroc"]["sclk"]);
+  EXPECT_EQ(kernels["ck"].size(), 2);
+
+  nlohmann::json start = getKernelPoolStats();
+  {
+    // the pinned kernels are reused, only the time dependent kernels are loaded
+    KernelSet ks(kernels);
+    size_t pinnedAsked = kernels["sclk"].size() + kernels["fk"].size();
+    EXPECT_EQ(ks.m_loadedKernels.size(), pinnedAsked + 2);
+    EXPECT_EQ(getKernelPoolStats()["furnishes"].get<uint64_t>() - start["furnishes"].get<uint64_t>(), 2);
+    EXPECT_EQ(getKernelPoolStats()["reuses"].get<uint64_t>() - start["reuses"].get<uint64_t>(), pinnedAsked);
+  }
+
+  Inventory::unpinMissionKernels();
+  EXPECT_TRUE(Inventory::getPinnedMissions().empty());
+  EXPECT_TRUE(getPinnedKernels().empty());
+}
+
+TEST_F(LroKernelSet, TestInventoryPrefetch) {
+  KernelPrefetcher::setThreads(1);
+  nlohmann::json start = KernelPrefetcher::stats();
+  auto count = [&start](std::string key) {
+    return KernelPrefetcher::stats()[key].get<uint64_t>() - start[key].get<uint64_t>();
+  };
+
+  // the next window is predicted once searches move forward
+  double next_start, next_stop;
+  nlohmann::json kernels = {{"ck", {ckPath1}}};
+  EXPECT_FALSE(KernelPrefetcher::observe("prefetch test", 100, 110, kernels, next_start, next_stop));
+  EXPECT_TRUE(KernelPrefetcher::observe("prefetch test", 120, 130, kernels, next_start, next_stop));
+  EXPECT_EQ(next_start, 140);
+  EXPECT_EQ(next_stop, 150);
+  EXPECT_FALSE(KernelPrefetcher::observe("prefetch test", 0, 10, kernels, next_start, next_stop));
+
+  KernelPrefetcher::prefetch({{"ck", {ckPath2}}});
+  for (int i = 0; i < 500 && count("read") == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(count("read"), 1);
+  EXPECT_EQ(count("bytes"), fs::file_size(ckPath2));
+
+  // a kernel read ahead is a hit the first time a search returns it
+  KernelPrefetcher::observe("prefetch test", 20, 30, {{"ck", {ckPath2}}}, next_start, next_stop);
+  KernelPrefetcher::observe("prefetch test", 40, 50, {{"ck", {ckPath2}}}, next_start, next_stop);
+  EXPECT_EQ(count("hits"), 1);
+
+  KernelPrefetcher::setThreads(0);
+  EXPECT_EQ(KernelPrefetcher::getThreads(), 0);
+}
+
+TEST_F(LroKernelSet, TestInventoryCkRecordIndex) { 
+  Inventory::create_database();
+  nlohmann::json kernels = Inventory::search_for_kernelset("lroc", {"ck"}, 110000000, 120000000, {"smithed", "reconstructed"});
+  ASSERT_TRUE(kernels.contains("ck"));
+
+  std::shared_ptr<SpiceQL::CkRecordIndex> ck_records = SpiceQL::getCkRecordIndex("lroc/ck/" + kernels["ck_quality"].get<std::string>());
+  ASSERT_NE(ck_records, nullptr);
+  EXPECT_TRUE(ck_records->unindexed.empty());
+  EXPECT_FALSE(ck_records->segments.empty());
+
+  nlohmann::json times = Inventory::getIndexedCkTimes(110000000, 120000000, -85000, "lroc", kernels);
+  ASSERT_TRUE(times.is_array());
+  ASSERT_EQ(times.size(), 2);
+  EXPECT_NEAR(times[0].get<double>(), 110000000, 1e-3);
+  EXPECT_NEAR(times[1].get<double>(), 120000000, 1e-3);
+
+  // CKs missing from the index are left to the caller
+  kernels["ck"] = {"ck/not_indexed.bc"};
+  EXPECT_TRUE(Inventory::getIndexedCkTimes(110000000, 120000000, -85000, "lroc", kernels).is_null());
+}
+
+TEST_F(LroKernelSet, TestInventoryConsolidation) { 
+  // both CKs start in the same 1000 day period
+  setenv("SPICEQL_CONSOLIDATE_KERNELS", "true", true);
+  setenv("SPICEQL_CONSOLIDATE_DAYS", "1000", true);
+  Inventory::create_database();
+  unsetenv("SPICEQL_CONSOLIDATE_KERNELS");
+  unsetenv("SPICEQL_CONSOLIDATE_DAYS");
+
+  nlohmann::json kernels = Inventory::search_for_kernelset("lroc", {"ck"}, 110000000, 140000001, {"smithed", "reconstructed"});
+  ASSERT_EQ(kernels["ck"].size(), 1);
+  std::string merged = kernels["ck"][0];
+  EXPECT_TRUE(fs::exists(merged));
+  nlohmann::json sources = kernels["consolidated"]["ck"][merged];
+  ASSERT_EQ(sources.size(), 2);
+  EXPECT_EQ(fs::path(sources[0].get<std::string>()).filename(), "soc31_1111111_1111111_v21.bc");
+  EXPECT_EQ(fs::path(sources[1].get<std::string>()).filename(), "lrolc_1111111_1111111_v11.bc");
+
+  // the merged CK holds the segments of both CKs in load order
+  Kernel lsk(lskPath);
+  Kernel sclk(sclkPath);
+  std::vector<CkSegmentRecords> expected = getCkRecordTimes(ckPath1);
+  for (auto &segment : getCkRecordTimes(ckPath2)) {
+    expected.push_back(segment);
+  }
+  std::vector<CkSegmentRecords> segments = getCkRecordTimes(merged);
+  ASSERT_EQ(segments.size(), expected.size());
+  for (size_t i = 0; i < segments.size(); i++) {
+    EXPECT_EQ(segments[i].instrument, expected[i].instrument);
+    EXPECT_EQ(segments[i].record_ets, expected[i].record_ets);
+  }
+
+  // record times are still looked up through the original CKs
+  nlohmann::json times = Inventory::getIndexedCkTimes(110000000, 120000000, -85000, "lroc", kernels);
+  ASSERT_TRUE(times.is_array());
+  EXPECT_EQ(times.size(), 2);
+
+  // a limit that drops one of the covering CKs keeps the CKs themselves
+  kernels = Inventory::search_for_kernelset("lroc", {"ck"}, 110000000, 140000001, {"smithed", "reconstructed"}, {"smithed", "reconstructed"}, false, 1);
+  ASSERT_EQ(kernels["ck"].size(), 1);
+  EXPECT_EQ(fs::path(kernels["ck"][0].get<std::string>()).filename(), "lrolc_1111111_1111111_v11.bc");
+  EXPECT_FALSE(kernels.contains("consolidated"));
+}
+
+TEST_F(LroKernelSet, TestInventoryFrameInfoFromCache) { 
+  Inventory::create_database();
+
+  nlohmann::json info = Inventory::getFrameInfoFromCache(-85000, "lroc");
+  ASSERT_FALSE(info.is_null());
+  EXPECT_EQ(info["center"].get<int>(), -85);
+  EXPECT_EQ(info["class"].get<int>(), 3);
+  EXPECT_EQ(info["class_id"].get<int>(), -85000);
+  EXPECT_FALSE(info.contains("tk_parent"));
+
+  // Built-in frames are recorded too
+  info = Inventory::getFrameInfoFromCache(1, "lroc");
+  ASSERT_FALSE(info.is_null());
+  EXPECT_EQ(info["class"].get<int>(), 1);
+
+  EXPECT_TRUE(Inventory::getFrameInfoFromCache(-12345678, "lroc").is_null());
+  EXPECT_TRUE(Inventory::getFrameInfoFromCache(-85000, "not_a_mission").is_null());
+}
+
+TEST_F(LroKernelSet, TestInventoryKeywordStore) { 
+  Inventory::create_database();
+
+  nlohmann::json kernels = Inventory::search_for_kernelset("lro", {"iak", "fk", "ik"});
+  nlohmann::json keywords = Inventory::findKeywordsFromCache("INS-85600_CCD_*", "lro", "mission", kernels);
+  ASSERT_FALSE(keywords.is_null());
+  EXPECT_EQ(keywords["INS-85600_CCD_CENTER"], nlohmann::json({2531.5, 0.5}));
+  EXPECT_TRUE(Inventory::findKeywordsFromCache("NOT_A_KEYWORD", "lro", "mission", kernels).empty());
+
+  // the same kernels with full paths still match
+  nlohmann::json fullKernels = Inventory::search_for_kernelset("lro", {"iak", "fk", "ik"}, -std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), {"smithed", "reconstructed"}, {"smithed", "reconstructed"}, true);
+  EXPECT_FALSE(Inventory::findKeywordsFromCache("INS-85600_CCD_CENTER", "lro", "mission", fullKernels).is_null());
+
+  // recorded keywords are not used for other kernels
+  EXPECT_TRUE(Inventory::findKeywordsFromCache("INS-85600_CCD_CENTER", "lro", "mission", nlohmann::json({{"iak", nlohmann::json::array({"iak/other.ti"})}})).is_null());
+
+  kernels = Inventory::search_for_kernelsets({"lro", "base"}, {"fk"});
+  nlohmann::json frame = Inventory::getTargetFrameFromCache(499, "lro", kernels);
+  ASSERT_FALSE(frame.is_null());
+  EXPECT_EQ(frame["frameCode"], 10014);
+  EXPECT_EQ(frame["frameName"], "IAU_MARS");
+}
+
+TEST_F(TempTestingFiles, TestInventoryLayoutV1Compat) { 
+  fs::path db_file = tempDir / "v1.hdf";
+  {
+    H5Easy::File file(db_file.string(), H5Easy::File::Overwrite);
+    H5Easy::dump(file, "spice/mro/ck/reconstructed/path_index", std::vector<std::string>{"ck/a.bc", "ck/b.bc"});
+    H5Easy::dump(file, "spice/mro/ck/reconstructed/starttime", std::vector<double>{10.0, 20.0});
+    H5Easy::dump(file, "spice/mro/ck/reconstructed/stoptime", std::vector<double>{15.0, 30.0});
+    H5Easy::dump(file, "spice/mro/ck/reconstructed/start_kindex", std::vector<size_t>{0, 1});
+    H5Easy::dump(file, "spice/mro/ck/reconstructed/stop_kindex", std::vector<size_t>{0, 1});
+  }
+
+  std::shared_ptr<SpiceQL::TimeIndexedKernels> time_indices = SpiceQL::getTimeIndexedKernels("mro/ck/reconstructed", db_file.string());
+  ASSERT_NE(time_indices, nullptr);
+  EXPECT_EQ(time_indices->file_paths, std::vector<std::string>({"ck/a.bc", "ck/b.bc"}));
+  EXPECT_TRUE(time_indices->start_times.contains(20.0));
+  EXPECT_TRUE(time_indices->stop_times.contains(30.0));
+
+  EXPECT_EQ(SpiceQL::getTimeIndexedKernels("mro/spk/reconstructed", db_file.string()), nullptr);
+}
+
+TEST_F(TempTestingFiles, TestInventoryDbNotReady) {
+  SpiceQL::setCacheDir((tempDir / "empty_cache").string(), true);
+  EXPECT_FALSE(Inventory::isDbReady());
+  EXPECT_EQ(Inventory::getDbGeneration(), 0);
+}
+
 TEST_F(TempTestingFiles, TestInventorySetCacheDir) {
   SpiceQL::Inventory::setDbFilePath(tempDir.string());
   const char* cache_dir = getenv("SPICEQL_CACHE_DIR");
@@ -186,6 +512,9 @@ TEST(TestInventory, GetCacheDirAutoInitialize) {
   // Verify it contains "spiceql-cache" in the path
   EXPECT_TRUE(cache_dir.find("spiceql-cache") != std::string::npos);
 
+  // Verify it is the shared default location rather than a per-process one
+  EXPECT_EQ(cache_dir, SpiceQL::getDefaultCacheDir());
+
   // Verify the directory was created
   EXPECT_TRUE(fs::exists(cache_dir));
   EXPECT_TRUE(fs::is_directory(cache_dir));
@@ -1,4 +1,10 @@
 #include <algorithm>
+#include <fstream>
+
+#if !defined(_WIN32) && !defined(SPICEQL_WASM)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include <gtest/gtest.h>
 #include <fmt/format.h>
@@ -31,6 +37,42 @@ TEST_F(LroKernelSet, UnitTestTranslateFrame) {
 }
 
 
+TEST_F(LroKernelSet, UnitTestTranslateFramesBatch) {
+  // KernelSets acquire every kernel they load through the pool
+  auto acquired = []() {
+    nlohmann::json stats = getKernelPoolStats();
+    return stats["furnishes"].get<uint64_t>() + stats["replays"].get<uint64_t>() + stats["reuses"].get<uint64_t>();
+  };
+
+  uint64_t before = acquired();
+  auto [codes, kernels1] = translateNamesToCodes({"LRO_LROCWAC", "LRO_SC_BUS"}, "lroc");
+  EXPECT_EQ(codes, std::vector<int>({-85620, -85000}));
+  // both names are in the DB's frame map
+  EXPECT_EQ(acquired(), before);
+  EXPECT_FALSE(kernels1[KERNELS_FURNISHED_KEY].get<bool>());
+
+  auto [names, kernels2] = translateCodesToNames({-85620, -85000}, "lroc");
+  EXPECT_EQ(names, std::vector<std::string>({"LRO_LROCWAC", "LRO_SC_BUS"}));
+  EXPECT_EQ(acquired(), before);
+  EXPECT_FALSE(kernels2[KERNELS_FURNISHED_KEY].get<bool>());
+
+  // built-in body codes still win over built-in frames with the same code
+  auto [name, kernels3] = translateCodeToName(1, "lroc");
+  EXPECT_EQ(name, "MERCURY BARYCENTER");
+
+  // an explicit kernel list is always furnished
+  auto [code, kernels4] = translateNameToCode("LRO_LROCWAC", "lroc", false, true, false, -1, 1, {"/lro/fk/lro_frames_.*"});
+  EXPECT_EQ(code, -85620);
+  EXPECT_GT(acquired(), before);
+  EXPECT_TRUE(kernels4[KERNELS_FURNISHED_KEY].get<bool>());
+  auto [names5, kernels5] = translateCodesToNames({-85620}, "lroc", false, true, false, -1, 1, {"/lro/fk/lro_frames_.*"});
+  EXPECT_EQ(names5, std::vector<std::string>({"LRO_LROCWAC"}));
+  EXPECT_TRUE(kernels5[KERNELS_FURNISHED_KEY].get<bool>());
+
+  EXPECT_THROW(translateNamesToCodes({"LRO_LROCWAC", "NOT_A_FRAME"}, "lroc"), std::invalid_argument);
+}
+
+
 TEST_F(LroKernelSet, UnitTestStackedKernelConstructorDestructor) {
   int nkernels;
 
@@ -48,6 +90,391 @@ TEST_F(LroKernelSet, UnitTestStackedKernelConstructorDestructor) {
 }
 
 
+TEST_F(LroKernelSet, UnitTestKernelTelemetry) {
+  resetKernelTelemetry();
+  setKernelTelemetry(true);
+  {
+    Kernel lsk1(lskPath);
+    Kernel lsk2(lskPath);
+    Kernel fk(fkPath);
+  }
+  setKernelTelemetry(false);
+  {
+    // not recorded
+    Kernel lsk(lskPath);
+  }
+  flushKernelTelemetry();
+
+  nlohmann::json hot = getHotKernels(1);
+  ASSERT_EQ(hot["kernels"].size(), 1);
+  EXPECT_EQ(hot["kernels"][0]["kernel"], "clocks/naif0012.tls");
+  EXPECT_EQ(hot["kernels"][0]["furnishes"].get<uint64_t>(), 2);
+  EXPECT_EQ(hot["kernels"][0]["bytes"].get<uint64_t>(), fs::file_size(lskPath) * 2);
+  EXPECT_GE(hot["kernels"][0]["seconds"].get<double>(), 0);
+  ASSERT_EQ(hot["missions"].size(), 1);
+  EXPECT_EQ(hot["missions"][0]["mission"], "clocks");
+
+  EXPECT_EQ(getHotKernels()["kernels"].size(), 2);
+
+  resetKernelTelemetry();
+  EXPECT_TRUE(getHotKernels()["kernels"].empty());
+}
+
+
+TEST_F(LroKernelSet, UnitTestKernelPool) {
+  int nkernels;
+  setKernelPoolLimits(3);
+  nlohmann::json kernels;
+  kernels["ck"] = nlohmann::json::array({ckPath1, ckPath2});
+  kernels["spk"] = nlohmann::json::array({spkPath1});
+  nlohmann::json reordered;
+  reordered["ck"] = nlohmann::json::array({ckPath2, ckPath1});
+
+  // counters are kept for the whole process
+  nlohmann::json start = getKernelPoolStats();
+  auto count = [&start](string key) {
+    return getKernelPoolStats()[key].get<uint64_t>() - start[key].get<uint64_t>();
+  };
+
+  {
+    KernelSet ks(kernels);
+    ktotal_c("ck", &nkernels);
+    EXPECT_EQ(nkernels, 2);
+  }
+  // released kernels stay furnished
+  ktotal_c("ck", &nkernels);
+  EXPECT_EQ(nkernels, 2);
+  EXPECT_EQ(count("furnishes"), 3);
+
+  {
+    // same kernels in the same order are not furnished again
+    KernelSet ks(kernels);
+    EXPECT_EQ(count("furnishes"), 3);
+    EXPECT_EQ(count("reuses"), 3);
+    EXPECT_EQ(getKernelPoolStats()["in_use"].get<size_t>(), 3);
+  }
+
+  {
+    // kernels the set did not ask for are unloaded and the order is restored
+    KernelSet ks(reordered);
+    vector<string> loaded = getLoadedKernels();
+    ASSERT_EQ(loaded.size(), 2);
+    EXPECT_EQ(loaded[0], ckPath2);
+    EXPECT_EQ(loaded[1], ckPath1);
+    EXPECT_EQ(count("unloads"), 1);
+  }
+
+  // a kernel unloaded outside of the pool is furnished again
+  unload(ckPath1);
+  {
+    KernelSet ks(reordered);
+    ktotal_c("ck", &nkernels);
+    EXPECT_EQ(nkernels, 2);
+  }
+
+  // a kernel furnished outside of the pool above a resident one would answer
+  // the set's queries, the set's kernel is furnished again on top of it
+  clearKernelPool();
+  nlohmann::json single;
+  single["ck"] = nlohmann::json::array({ckPath1});
+  {
+    KernelSet ks(single);
+  }
+  load(ckPath2);
+  uint64_t furnishes = count("furnishes");
+  {
+    KernelSet ks(single);
+    EXPECT_EQ(count("furnishes"), furnishes + 1);
+    vector<string> loaded = getLoadedKernels();
+    ASSERT_EQ(loaded.size(), 2);
+    EXPECT_EQ(loaded[0], ckPath2);
+    EXPECT_EQ(loaded[1], ckPath1);
+  }
+  unload(ckPath2);
+
+  setKernelPoolLimits(1);
+  EXPECT_EQ(getKernelPoolStats()["resident"].get<size_t>(), 1);
+
+  setKernelPoolLimits(0);
+  ktotal_c("all", &nkernels);
+  EXPECT_EQ(nkernels, 0);
+}
+
+
+TEST_F(LroKernelSet, UnitTestPinnedKernels) {
+  // an spk and a tspk with overlapping segments for the same body
+  auto writeSpk = [this](string name, double x) {
+    string path = (tempDir / name).string();
+    fs::remove(path);
+    SpiceInt handle;
+    spkopn_c(path.c_str(), "PIN TEST", 0, &handle);
+    SpiceDouble states[2][6] = {{x, 0, 0, 0, 0, 0}, {x, 0, 0, 0, 0, 0}};
+    SpiceDouble epochs[2] = {0, 1e9};
+    spkw09_c(handle, -9100, 0, "J2000", 0, 1e9, "PIN TEST", 1, 2, states, epochs);
+    spkcls_c(handle);
+    checkNaifErrors();
+    return path;
+  };
+  string spk = writeSpk("pin_mission.bsp", 1);
+  string tspk = writeSpk("pin_target.bsp", 2);
+  string pck = (tempDir / "pin_test.tpc").string();
+  ofstream(pck) << "KPL/PCK\n\n\\begindata\nSPICEQL_PIN_TEST = 1\n\\begintext\n";
+
+  auto positionX = []() {
+    SpiceDouble state[6], lt;
+    spkez_c(-9100, 5e8, "J2000", "NONE", 0, state, &lt);
+    checkNaifErrors();
+    return state[0];
+  };
+  auto defined = []() {
+    SpiceBoolean found = SPICEFALSE;
+    SpiceInt n;
+    SpiceChar type[2];
+    dtpool_c("SPICEQL_PIN_TEST", &found, &n, type);
+    return found == SPICETRUE;
+  };
+
+  nlohmann::json kernels;
+  kernels["spk"] = {spk};
+  kernels["tspk"] = {tspk};
+  double unpinned;
+  {
+    // the tspk is loaded after the spk and answers for the body
+    KernelSet ks(kernels);
+    unpinned = positionX();
+  }
+  EXPECT_EQ(unpinned, 2);
+
+  nlohmann::json pinned;
+  pinned["tspk"] = {tspk};
+  pinned["pck"] = {pck};
+  // only text kernels are pinned
+  EXPECT_EQ(pinKernels(pinned).size(), 1);
+  EXPECT_EQ(getPinnedKernels().size(), 1);
+  EXPECT_TRUE(defined());
+
+  {
+    // pinning changes neither the order of the set's kernels nor what it sees
+    KernelSet ks(kernels);
+    EXPECT_EQ(positionX(), unpinned);
+    EXPECT_FALSE(defined());
+  }
+
+  nlohmann::json withPck = kernels;
+  withPck["pck"] = {pck};
+  {
+    KernelSet ks(withPck);
+    EXPECT_EQ(positionX(), unpinned);
+    EXPECT_TRUE(defined());
+  }
+
+  // the pinned kernel stays loaded when released and is reused
+  EXPECT_TRUE(defined());
+  nlohmann::json start = getKernelPoolStats();
+  {
+    nlohmann::json onlyPck;
+    onlyPck["pck"] = {pck};
+    KernelSet ks(onlyPck);
+    EXPECT_EQ(getKernelPoolStats()["furnishes"].get<uint64_t>() - start["furnishes"].get<uint64_t>(), 0);
+    EXPECT_EQ(getKernelPoolStats()["reuses"].get<uint64_t>() - start["reuses"].get<uint64_t>(), 1);
+  }
+
+  unpinKernels();
+  EXPECT_TRUE(getPinnedKernels().empty());
+  EXPECT_FALSE(defined());
+}
+
+
+TEST_F(LroKernelSet, UnitTestKernelSetDelta) {
+  int nkernels;
+  nlohmann::json outer;
+  outer["lsk"] = nlohmann::json::array({lskPath});
+  outer["ck"] = nlohmann::json::array({ckPath1, ckPath2});
+  nlohmann::json inner;
+  inner["ck"] = nlohmann::json::array({ckPath1, ckPath2});
+
+  nlohmann::json start = getKernelPoolStats();
+  auto count = [&start](string key) {
+    return getKernelPoolStats()[key].get<uint64_t>() - start[key].get<uint64_t>();
+  };
+
+  {
+    KernelSet outerSet(outer);
+    EXPECT_EQ(count("furnishes"), 3);
+    {
+      // a subset of the enclosing set in the same order is already loaded
+      KernelSet innerSet(inner);
+      EXPECT_EQ(count("furnishes"), 3);
+    }
+    // and stays loaded for the enclosing set
+    ktotal_c("all", &nkernels);
+    EXPECT_EQ(nkernels, 3);
+  }
+  ktotal_c("all", &nkernels);
+  EXPECT_EQ(nkernels, 0);
+
+  {
+    KernelScope scope;
+    {
+      KernelSet first(outer);
+    }
+    // released kernels stay loaded in the scope, only the difference is loaded
+    ktotal_c("all", &nkernels);
+    EXPECT_EQ(nkernels, 3);
+    KernelSet second(inner);
+    EXPECT_EQ(count("furnishes"), 6);
+    ktotal_c("all", &nkernels);
+    EXPECT_EQ(nkernels, 2);
+  }
+  ktotal_c("all", &nkernels);
+  EXPECT_EQ(nkernels, 0);
+}
+
+
+TEST_F(LroKernelSet, UnitTestTextKernelSnapshots) {
+  int nkernels;
+  setTextKernelSnapshots(true);
+  nlohmann::json kernels;
+  kernels["lsk"] = nlohmann::json::array({lskPath});
+  kernels["fk"] = nlohmann::json::array({fkPath});
+
+  nlohmann::json start = getKernelPoolStats();
+  auto count = [&start](string key) {
+    return getKernelPoolStats()[key].get<uint64_t>() - start[key].get<uint64_t>();
+  };
+
+  {
+    // the first furnish compiles the snapshots
+    KernelSet ks(kernels);
+    EXPECT_TRUE(isLskLoaded());
+    ktotal_c("text", &nkernels);
+    EXPECT_EQ(nkernels, 2);
+  }
+  EXPECT_FALSE(isLskLoaded());
+
+  {
+    // later loads write the variables straight into the pool
+    KernelSet ks(kernels);
+    EXPECT_EQ(count("replays"), 2);
+    EXPECT_TRUE(isLskLoaded());
+    ktotal_c("text", &nkernels);
+    EXPECT_EQ(nkernels, 0);
+  }
+  EXPECT_FALSE(isLskLoaded());
+
+  setTextKernelSnapshots(false);
+}
+
+
+TEST_F(LroKernelSet, UnitTestKernelCache) {
+  fs::path cacheDir = tempDir.string() + "_kernels";
+  setKernelCache(cacheDir.string());
+  nlohmann::json kernels;
+  kernels["ck"] = nlohmann::json::array({ckPath1});
+
+  nlohmann::json start = getKernelCacheStats();
+  auto count = [&start](string key) {
+    return getKernelCacheStats()[key].get<uint64_t>() - start[key].get<uint64_t>();
+  };
+
+  {
+    // the copy is furnished but reported by its data directory path
+    KernelSet ks(kernels);
+    EXPECT_TRUE(ks.m_loadedKernels.at(0).starts_with(cacheDir.string()));
+    vector<string> loaded = getLoadedKernels();
+    ASSERT_EQ(loaded.size(), 1);
+    EXPECT_EQ(loaded[0], ckPath1);
+    EXPECT_EQ(count("copies"), 1);
+  }
+
+  {
+    KernelSet ks(kernels);
+    EXPECT_EQ(count("copies"), 1);
+    EXPECT_EQ(count("hits"), 1);
+  }
+
+  // past the size limit the least recently used copies are removed, except
+  // the ones still furnished, which CSPICE may reopen by name
+  setKernelCache(cacheDir.string(), 1);
+  {
+    KernelSet ks(kernels);
+    EXPECT_TRUE(fs::exists(cacheKernel(ckPath2)));
+    EXPECT_TRUE(fs::exists(ks.m_loadedKernels.at(0)));
+    EXPECT_EQ(count("evictions"), 0);
+  }
+  string copy = cacheKernel(spkPath1);
+  EXPECT_TRUE(fs::exists(copy));
+  EXPECT_EQ(canonicalKernelPath(copy), spkPath1);
+  EXPECT_EQ(count("evictions"), 2);
+
+  setKernelCache("");
+  EXPECT_EQ(cacheKernel(ckPath2), ckPath2);
+  fs::remove_all(cacheDir);
+}
+
+
+#if !defined(_WIN32) && !defined(SPICEQL_WASM)
+TEST_F(LroKernelSet, UnitTestKernelCacheProcesses) {
+  fs::path cacheDir = tempDir.string() + "_shared_kernels";
+  setKernelCache(cacheDir.string());
+  nlohmann::json kernels;
+  kernels["ck"] = nlohmann::json::array({ckPath1});
+  string copy = cacheKernel(ckPath1);
+  ASSERT_TRUE(copy.starts_with(cacheDir.string()));
+
+  nlohmann::json start = getKernelCacheStats();
+  auto count = [&start](string key) {
+    return getKernelCacheStats()[key].get<uint64_t>() - start[key].get<uint64_t>();
+  };
+
+  // another worker sharing the cache directory furnishes the copy and holds it
+  int ready[2], done[2];
+  ASSERT_EQ(pipe(ready), 0);
+  ASSERT_EQ(pipe(done), 0);
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    int status = 1;
+    try {
+      KernelSet ks(kernels);
+      char byte = 1;
+      if (ks.m_loadedKernels.at(0) == copy && write(ready[1], &byte, 1) == 1 && read(done[0], &byte, 1) == 1) {
+        status = 0;
+      }
+    }
+    catch (...) {
+    }
+    _exit(status);
+  }
+  char byte;
+  ASSERT_EQ(read(ready[0], &byte, 1), 1);
+
+  // this process never furnished it, the other's lock keeps it
+  setKernelCache(cacheDir.string(), 1);
+  EXPECT_TRUE(fs::exists(cacheKernel(ckPath2)));
+  EXPECT_TRUE(fs::exists(copy));
+  EXPECT_EQ(count("evictions"), 0);
+
+  byte = 1;
+  ASSERT_EQ(write(done[1], &byte, 1), 1);
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  for (int fd : {ready[0], ready[1], done[0], done[1]}) {
+    close(fd);
+  }
+
+  // released by the other worker, it is evicted
+  cacheKernel(spkPath1);
+  EXPECT_FALSE(fs::exists(copy));
+  EXPECT_EQ(count("evictions"), 2);
+
+  setKernelCache("");
+  fs::remove_all(cacheDir);
+}
+#endif
+
+
 TEST_F(LroKernelSet, UnitTestStackedKernelCopyConstructor) {
   int nkernels;
 
@@ -331,8 +758,8 @@ TEST_F(TempTestingFiles, UnitTestIAKKernelSetConstructor) {
   EXPECT_EQ(ks.m_loadedKernels.size(), 2);
 
   // iak should be loaded second
-  EXPECT_EQ(ks.m_loadedKernels[0]->path, ikPath.string());
-  EXPECT_EQ(ks.m_loadedKernels[1]->path, iakPath.string());
+  EXPECT_EQ(ks.m_loadedKernels[0], ikPath.string());
+  EXPECT_EQ(ks.m_loadedKernels[1], iakPath.string());
   EXPECT_EQ(findKeywords("IK_KEY")["IK_KEY"][1], 100);
 }
 
@@ -46,6 +46,40 @@ TEST(QueryTests, UnitTestGetLatestKernelDuplicateFileNames) {
 }
 
 
+TEST(QueryTests, UnitTestGetLatestKernelGroupOrder) {
+  vector<string> kernels = {
+                    "/base/kernels/spk/mar097.bsp",
+                    "/base/kernels/spk/de430.bsp",
+                    "/base/kernels/spk/mar080.bsp",
+                    "/base/kernels/spk/de440.bsp",
+                    "/base/kernels/spk/sat441.bsp",
+                    "/tgo/kernels/spk/mar097.bsp"
+                  };
+
+  // one kernel per name prefix in the order the prefix was first seen,
+  // ties keep the first kernel
+  vector<string> expected = {"/base/kernels/spk/mar097.bsp",
+                             "/base/kernels/spk/de440.bsp",
+                             "/base/kernels/spk/sat441.bsp"};
+  EXPECT_EQ(getLatestKernel(kernels), expected);
+}
+
+
+TEST(QueryTests, UnitTestGetLatestKernelsParallel) {
+  nlohmann::json kernels = R"({
+    "a": {"ck": {"reconstructed": {"kernels": [["a_v01.bc", "a_v03.bc", "a_v02.bc"]]}},
+          "spk": {"kernels": [["de430.bsp", "mar080.bsp", "de440.bsp"]]}},
+    "b": {"fk": {"kernels": [["b_v1.tf", "b_v2.tf"], ["c_v9.tf"]]},
+          "ik": {"kernels": [["b_0001.ti", "b_0002.ti"]]}}
+  })"_json;
+
+  nlohmann::json expected = getLatestKernels(kernels);
+  EXPECT_EQ(getLatestKernels(kernels, true), expected);
+  EXPECT_EQ(expected["a"]["ck"]["reconstructed"]["kernels"], nlohmann::json::array({nlohmann::json::array({"a_v03.bc"})}));
+  EXPECT_EQ(expected["a"]["spk"]["kernels"], nlohmann::json::array({nlohmann::json::array({"de440.bsp", "mar080.bsp"})}));
+}
+
+
 TEST(QueryTests, getKernelStringValue){
   unique_ptr<Kernel> k(new Kernel(fs::absolute("data/msgr_mdis_v010.ti")));
   // INS-236810_CCD_CENTER        =  (  511.5, 511.5 )
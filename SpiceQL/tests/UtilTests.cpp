@@ -21,6 +21,9 @@ using namespace std::chrono;
 #include <SpiceQL/inventory.h>
 #include <SpiceQL/io.h>
 #include <SpiceQL/api.h>
+#include <SpiceQL/evalpool.h>
+#include <SpiceQL/spk_evaluator.h>
+#include <SpiceQL/ck_evaluator.h>
 
 #include <SpiceQL/spiceql_logging.h>
 
@@ -37,6 +40,26 @@ TEST(UtilTests, findKeywords) {
 }
 
 
+TEST_F(TempTestingFiles, UtilTestsFindKeywordsLarge) {
+  nlohmann::json keywords;
+  std::vector<double> values;
+  for (int i = 0; i < 450; i++) {
+    keywords["LARGE_KEY_" + std::to_string(i)] = i;
+    values.push_back(i);
+  }
+  keywords["LARGE_VALUES"] = values;
+  fs::path kernelPath = tempDir / "large.ti";
+  writeTextKernel(kernelPath, "ik", keywords);
+  Kernel k(kernelPath.string());
+
+  nlohmann::json res = findKeywords("LARGE_*");
+  EXPECT_EQ(res.size(), 451);
+  EXPECT_EQ(res.at("LARGE_KEY_449"), 449);
+  ASSERT_EQ(res.at("LARGE_VALUES").size(), 450);
+  EXPECT_EQ(res.at("LARGE_VALUES")[449], 449);
+}
+
+
 TEST(UtilTests, findKeyInJson) {
   nlohmann::ordered_json j = R"(
     {
@@ -366,6 +389,476 @@ TEST_F(LroKernelSet, UnitTestGetTargetStates) {
   EXPECT_DOUBLE_EQ(resStates.at(0)[6], 0.0);
 }
 
+TEST_F(LroKernelSet, UnitTestGetTargetStatesArray) {
+  vector<double> ets = {110000000, 110000001};
+  auto [resStates, kernels] = getTargetStates(ets, "LRO", "LRO", "J2000", "NONE", "lroc", {"smithed"}, {"smithed"});
+  auto [states, arrayKernels] = getTargetStatesArray(ets, "LRO", "LRO", "J2000", "NONE", "lroc", {"smithed"}, {"smithed"});
+
+  ASSERT_EQ(states.size(), 14);
+  for (size_t i = 0; i < ets.size(); i++) {
+    for (size_t j = 0; j < 7; j++) {
+      EXPECT_DOUBLE_EQ(states[i * 7 + j], resStates.at(i).at(j));
+    }
+  }
+  EXPECT_EQ(arrayKernels, kernels);
+
+  EXPECT_THROW(getTargetStatesArray({}, "LRO", "LRO", "J2000", "NONE", "lroc"), invalid_argument);
+}
+
+TEST_F(LroKernelSet, UnitTestNativeSpkEvaluation) {
+  Kernel k1(spkPath1);
+  Kernel k3(spkPath3);
+  setNativeSpkEvaluation(true);
+
+  size_t count = 5000;
+  vector<double> ets(count);
+  for (size_t i = 0; i < count; i++) {
+    ets[i] = 110000000 + 10000000.0 * i / (count - 1);
+  }
+
+  nlohmann::json start = getNativeSpkStats();
+  auto counter = [&start](string key) {
+    return getNativeSpkStats()[key].get<uint64_t>() - start[key].get<uint64_t>();
+  };
+
+  // -85 relative to 1 and 0 relative to 301, both type 13
+  for (auto [target, observer] : vector<pair<string, string>>{{"-85", "1"}, {"0", "301"}}) {
+    vector<double> states(count * 7);
+    getTargetStatesInto(ets.data(), count, target, observer, "J2000", "NONE", states.data());
+    for (size_t i = 0; i < count; i++) {
+      SpiceDouble state[6], lt;
+      spkezr_c(target.c_str(), ets[i], "J2000", "NONE", observer.c_str(), state, &lt);
+      for (size_t j = 0; j < 6; j++) {
+        ASSERT_NEAR(states[i * 7 + j], state[j], 1e-9 + 1e-12 * fabs(state[j]));
+      }
+      ASSERT_NEAR(states[i * 7 + 6], lt, 1e-15);
+    }
+  }
+  EXPECT_EQ(counter("requests"), 2);
+  EXPECT_EQ(counter("states"), 2 * count);
+
+  // no chain to the observer, left to CSPICE
+  unique_ptr<SpkEvaluator> evaluator = SpkEvaluator::create(-85, 301, "J2000", ets[0]);
+  ASSERT_NE(evaluator, nullptr);
+  vector<double> unused(7);
+  EXPECT_FALSE(evaluator->evaluate(ets.data(), 1, unused.data()));
+  EXPECT_EQ(counter("unsupported"), 1);
+
+  // not inertial
+  EXPECT_EQ(SpkEvaluator::create(-85, 1, "IAU_MOON", ets[0]), nullptr);
+
+  // too few epochs to be worth building an evaluator, left to CSPICE
+  vector<double> few((SpkEvaluator::MIN_EPOCHS - 1) * 7);
+  getTargetStatesInto(ets.data(), SpkEvaluator::MIN_EPOCHS - 1, "-85", "1", "J2000", "NONE", few.data());
+  EXPECT_EQ(counter("requests"), 2);
+
+  setNativeSpkEvaluation(false);
+  EXPECT_EQ(SpkEvaluator::create(-85, 1, "J2000", ets[0]), nullptr);
+  vector<double> states(7);
+  getTargetStatesInto(ets.data(), 1, "-85", "1", "J2000", "NONE", states.data());
+  EXPECT_EQ(counter("requests"), 2);
+  setNativeSpkEvaluation(true);
+}
+
+TEST_F(LroKernelSet, UnitTestNativeSpkSegmentTypes) {
+  setNativeSpkEvaluation(true);
+
+  const double t0 = 100000000;
+  const double span = 200000;
+  string path = (tempDir / "native_types.bsp").string();
+  fs::remove(path);
+  SpiceInt handle;
+  spkopn_c(path.c_str(), "NATIVE TYPES", 0, &handle);
+
+  // Chebyshev records with coefficients shrinking with their degree
+  auto chebyshevData = [](size_t records, size_t components, size_t degree) {
+    vector<double> data;
+    for (size_t r = 0; r < records; r++) {
+      for (size_t c = 0; c < components; c++) {
+        for (size_t j = 0; j <= degree; j++) {
+          data.push_back(1e6 * cos(7.0 * r + 3.0 * j + c) / ((j + 1) * (j + 1)));
+        }
+      }
+    }
+    return data;
+  };
+
+  // type 2 in ECLIPJ2000 and type 3 relative to it
+  vector<double> type2 = chebyshevData(10, 3, 12);
+  spkw02_c(handle, -9002, 0, "ECLIPJ2000", t0, t0 + span, "TYPE 2", span / 10, 10, 12, type2.data(), t0);
+  vector<double> type3 = chebyshevData(8, 6, 9);
+  spkw03_c(handle, -9003, -9002, "J2000", t0, t0 + span, "TYPE 3", span / 8, 8, 9, type3.data(), t0);
+
+  // unevenly spaced states on an inclined orbit
+  size_t n = 201;
+  vector<double> epochs(n);
+  vector<double> orbit(n * 6);
+  double w = 2 * pi_c() / 50000;
+  for (size_t i = 0; i < n; i++) {
+    epochs[i] = t0 + 1000.0 * i + 300 * sin(double(i));
+    double t = epochs[i] - t0;
+    double r = 7000;
+    double *state = &orbit[i * 6];
+    state[0] = r * cos(w * t);
+    state[1] = r * sin(w * t);
+    state[2] = 0.1 * r * sin(2 * w * t);
+    state[3] = -r * w * sin(w * t);
+    state[4] = r * w * cos(w * t);
+    state[5] = 0.2 * r * w * cos(2 * w * t);
+  }
+  auto states = reinterpret_cast<const SpiceDouble (*)[6]>(orbit.data());
+  double last = epochs[n - 1];
+
+  // windows of 5 and 8 states
+  spkw09_c(handle, -9009, 0, "B1950", t0, last, "TYPE 9 ODD", 4, n, states, epochs.data());
+  spkw09_c(handle, -9019, 0, "J2000", t0, last, "TYPE 9 EVEN", 7, n, states, epochs.data());
+  // windows of 3 and 4 states, the second relative to the first
+  spkw13_c(handle, -9013, 0, "J2000", t0, last, "TYPE 13 ODD", 5, n, states, epochs.data());
+  spkw13_c(handle, -9023, -9013, "ECLIPJ2000", t0, last, "TYPE 13 EVEN", 7, n, states, epochs.data());
+  spkcls_c(handle);
+  checkNaifErrors();
+  Kernel spk(path);
+
+  // enough epochs to be split across threads, none on a record boundary but the first
+  size_t count = 2000;
+  vector<double> ets(count);
+  ets[0] = t0;
+  for (size_t i = 1; i < count; i++) {
+    ets[i] = t0 + 0.5 + (last - t0 - 1) * (i + 0.3) / count;
+  }
+
+  nlohmann::json start = getNativeSpkStats();
+  auto counter = [&start](string key) {
+    return getNativeSpkStats()[key].get<uint64_t>() - start[key].get<uint64_t>();
+  };
+
+  vector<tuple<string, string, string>> requests = {
+    {"-9002", "0", "J2000"}, {"-9003", "0", "J2000"}, {"-9009", "0", "J2000"},
+    {"-9019", "0", "ECLIPJ2000"}, {"-9013", "0", "J2000"}, {"-9023", "0", "J2000"},
+    {"-9003", "-9023", "ECLIPJ2000"}
+  };
+  for (auto &[target, observer, frame] : requests) {
+    vector<double> result(count * 7);
+    getTargetStatesInto(ets.data(), count, target, observer, frame, "NONE", result.data());
+    for (size_t i = 0; i < count; i++) {
+      SpiceDouble state[6], lt;
+      spkezr_c(target.c_str(), ets[i], frame.c_str(), "NONE", observer.c_str(), state, &lt);
+      for (size_t j = 0; j < 6; j++) {
+        ASSERT_NEAR(result[i * 7 + j], state[j], 1e-9 + 1e-12 * fabs(state[j])) << target << " " << observer << " " << frame << " at " << ets[i];
+      }
+      ASSERT_NEAR(result[i * 7 + 6], lt, 1e-15);
+    }
+  }
+  EXPECT_EQ(counter("requests"), requests.size());
+  EXPECT_EQ(counter("states"), requests.size() * count);
+  EXPECT_EQ(counter("unsupported"), 0);
+}
+
+
+TEST_F(LroKernelSet, UnitTestNativeCkEvaluation) {
+  nlohmann::json testKernelJson;
+  testKernelJson["kernels"] = {{ckPath1}, {ckPath2}, {fkPath}, {sclkPath}, {lskPath}};
+  KernelSet testSet(testKernelJson);
+  setNativeCkEvaluation(true);
+
+  size_t count = 3000;
+  vector<double> ets(count);
+  for (size_t i = 0; i < count; i++) {
+    ets[i] = 110000000 + 10000000.0 * i / (count - 1);
+  }
+
+  nlohmann::json start = getNativeCkStats();
+  auto counter = [&start](string key) {
+    return getNativeCkStats()[key].get<uint64_t>() - start[key].get<uint64_t>();
+  };
+
+  // the spacecraft relative to J2000 and J2000 relative to the spacecraft
+  for (auto [toFrame, refFrame] : vector<pair<int, int>>{{-85000, 1}, {1, -85000}}) {
+    vector<double> orientations(count * 8);
+    getTargetOrientationsInto(ets.data(), count, toFrame, refFrame, orientations.data());
+    for (size_t i = 0; i < count; i += 7) {
+      vector<double> expected = getTargetOrientation(ets[i], toFrame, refFrame);
+      ASSERT_EQ(expected.size(), 7);
+      for (size_t j = 0; j < 7; j++) {
+        ASSERT_NEAR(orientations[i * 8 + j], expected[j], 1e-12);
+      }
+      ASSERT_EQ(orientations[i * 8 + 7], 1);
+    }
+  }
+  EXPECT_EQ(counter("requests"), 2);
+  EXPECT_EQ(counter("orientations"), 2 * count);
+
+  // no pointing between the two CKs, left to CSPICE
+  vector<double> gap = {125000000};
+  unique_ptr<CkEvaluator> evaluator = CkEvaluator::create(-85000, 1, gap.data(), 1);
+  ASSERT_NE(evaluator, nullptr);
+  vector<double> unused(8);
+  EXPECT_FALSE(evaluator->evaluate(unused.data()));
+  EXPECT_EQ(counter("unsupported"), 1);
+
+  // too few epochs to be worth building an evaluator, left to CSPICE
+  vector<double> few((CkEvaluator::MIN_EPOCHS - 1) * 8);
+  getTargetOrientationsInto(ets.data(), CkEvaluator::MIN_EPOCHS - 1, -85000, 1, few.data());
+  EXPECT_EQ(counter("requests"), 2);
+
+  setNativeCkEvaluation(false);
+  EXPECT_EQ(CkEvaluator::create(-85000, 1, ets.data(), 1), nullptr);
+  setNativeCkEvaluation(true);
+}
+
+TEST_F(LroKernelSet, UnitTestNativeCkSegmentTypes) {
+  nlohmann::json testKernelJson;
+  testKernelJson["kernels"] = {{sclkPath}, {lskPath}};
+  KernelSet testSet(testKernelJson);
+  setNativeCkEvaluation(true);
+
+  // a type 2 CK frame, a TK offset from it, and a type 3 CK frame relative to the offset
+  string fk = (tempDir / "native_types.tf").string();
+  ofstream(fk) << "KPL/FK\n\n\\begindata\n"
+               << "FRAME_NATIVE_TYPE2 = -85900\n"
+               << "FRAME_-85900_NAME = 'NATIVE_TYPE2'\n"
+               << "FRAME_-85900_CLASS = 3\n"
+               << "FRAME_-85900_CLASS_ID = -85900\n"
+               << "FRAME_-85900_CENTER = -85\n"
+               << "CK_-85900_SCLK = -85\n"
+               << "CK_-85900_SPK = -85\n"
+               << "FRAME_NATIVE_OFFSET = -85901\n"
+               << "FRAME_-85901_NAME = 'NATIVE_OFFSET'\n"
+               << "FRAME_-85901_CLASS = 4\n"
+               << "FRAME_-85901_CLASS_ID = -85901\n"
+               << "FRAME_-85901_CENTER = -85\n"
+               << "TKFRAME_-85901_RELATIVE = 'NATIVE_TYPE2'\n"
+               << "TKFRAME_-85901_SPEC = 'ANGLES'\n"
+               << "TKFRAME_-85901_UNITS = 'DEGREES'\n"
+               << "TKFRAME_-85901_AXES = ( 3, 1, 3 )\n"
+               << "TKFRAME_-85901_ANGLES = ( 10.0, 20.0, 30.0 )\n"
+               << "FRAME_NATIVE_TYPE3 = -85910\n"
+               << "FRAME_-85910_NAME = 'NATIVE_TYPE3'\n"
+               << "FRAME_-85910_CLASS = 3\n"
+               << "FRAME_-85910_CLASS_ID = -85910\n"
+               << "FRAME_-85910_CENTER = -85\n"
+               << "CK_-85910_SCLK = -85\n"
+               << "CK_-85910_SPK = -85\n"
+               << "\\begintext\n";
+  Kernel frames(fk);
+
+  const double t0 = 110000000;
+  const size_t records = 20;
+  const double record_span = 1000;
+  auto ticks = [](double et) {
+    SpiceDouble tick;
+    sce2c_c(-85, et, &tick);
+    return tick;
+  };
+
+  // rotations about a fixed axis, with a wobble telling segments apart
+  double axis[3] = {1 / sqrt(14.0), 2 / sqrt(14.0), 3 / sqrt(14.0)};
+  auto quaternion = [&axis, t0](double et, double wobble, double *q, double *av) {
+    double t = et - t0;
+    double angle = 1e-4 * t + wobble * sin(1e-3 * t);
+    double rate = 1e-4 + wobble * 1e-3 * cos(1e-3 * t);
+    q[0] = cos(angle / 2);
+    for (int c = 0; c < 3; c++) {
+      q[c + 1] = sin(angle / 2) * axis[c];
+      av[c] = rate * axis[c];
+    }
+  };
+
+  string path = (tempDir / "native_types.bc").string();
+  fs::remove(path);
+  SpiceInt handle;
+  ckopn_c(path.c_str(), "NATIVE TYPES", 0, &handle);
+
+  // type 2 records of constant rate, each up to the start of the next
+  vector<double> starts(records), stops(records), rates(records);
+  vector<double> quats2(records * 4), avs2(records * 3);
+  for (size_t r = 0; r < records; r++) {
+    double begin = t0 + r * record_span;
+    starts[r] = ticks(begin);
+    stops[r] = ticks(begin + record_span);
+    rates[r] = record_span / (stops[r] - starts[r]);
+    quaternion(begin, 0, &quats2[r * 4], &avs2[r * 3]);
+  }
+  ckw02_c(handle, starts[0], stops[records - 1], -85900, "J2000", "TYPE 2", records, starts.data(), stops.data(),
+          reinterpret_cast<const SpiceDouble (*)[4]>(quats2.data()), reinterpret_cast<const SpiceDouble (*)[3]>(avs2.data()), rates.data());
+
+  // type 3 instances, a single interval under three intervals with gaps between them
+  auto type3 = [&](size_t n, double wobble, vector<size_t> intervals, string segid) {
+    vector<double> tags(n), quats(n * 4), avs(n * 3), interval_starts;
+    for (size_t i = 0; i < n; i++) {
+      double et = t0 + records * record_span * i / (n - 1);
+      tags[i] = ticks(et);
+      quaternion(et, wobble, &quats[i * 4], &avs[i * 3]);
+    }
+    for (size_t first : intervals) {
+      interval_starts.push_back(tags[first]);
+    }
+    ckw03_c(handle, tags[0], tags[n - 1], -85910, "NATIVE_OFFSET", SPICETRUE, segid.c_str(), n, tags.data(),
+            reinterpret_cast<const SpiceDouble (*)[4]>(quats.data()), reinterpret_cast<const SpiceDouble (*)[3]>(avs.data()),
+            interval_starts.size(), interval_starts.data());
+  };
+  type3(201, 0.2, {0}, "TYPE 3 SINGLE");
+  type3(401, 0.1, {0, 150, 280}, "TYPE 3 INTERVALS");
+  ckcls_c(handle);
+  checkNaifErrors();
+  Kernel ck(path);
+
+  // epochs inside each type 2 record, some in the gaps between type 3 intervals
+  size_t per_record = 60;
+  vector<double> ets;
+  for (size_t r = 0; r < records; r++) {
+    for (size_t j = 0; j < per_record; j++) {
+      ets.push_back(t0 + r * record_span + 1 + (record_span - 2) * (j + 0.5) / per_record);
+    }
+  }
+  size_t count = ets.size();
+  ASSERT_GE(count, CkEvaluator::MIN_EPOCHS);
+
+  nlohmann::json start = getNativeCkStats();
+  auto counter = [&start](string key) {
+    return getNativeCkStats()[key].get<uint64_t>() - start[key].get<uint64_t>();
+  };
+
+  vector<pair<int, int>> requests = {{-85900, 1}, {-85901, 1}, {-85910, 1}, {1, -85910}, {-85910, -85900}};
+  for (auto [toFrame, refFrame] : requests) {
+    vector<double> orientations(count * 8);
+    getTargetOrientationsInto(ets.data(), count, toFrame, refFrame, orientations.data());
+    for (size_t i = 0; i < count; i++) {
+      vector<double> expected = getTargetOrientation(ets[i], toFrame, refFrame);
+      ASSERT_EQ(expected.size(), 7);
+      for (size_t j = 0; j < 7; j++) {
+        ASSERT_NEAR(orientations[i * 8 + j], expected[j], 1e-12) << toFrame << " " << refFrame << " at " << ets[i];
+      }
+      ASSERT_EQ(orientations[i * 8 + 7], 1);
+    }
+  }
+  EXPECT_EQ(counter("requests"), requests.size());
+  EXPECT_EQ(counter("orientations"), requests.size() * count);
+  EXPECT_EQ(counter("unsupported"), 0);
+}
+
+TEST(UtilTests, EvaluationPool) {
+  size_t count = 3 * EvaluationPool::MIN_SHARD_SIZE;
+  vector<double> rows(count * 2, -1);
+  auto evaluate = [](size_t begin, size_t end, double *out) {
+    for (size_t i = begin; i < end; i++) {
+      out[(i - begin) * 2] = i;
+      out[(i - begin) * 2 + 1] = sqrt(double(i));
+    }
+    return true;
+  };
+
+  // off by default
+  setEvaluationProcesses(0);
+  EXPECT_FALSE(EvaluationPool::run(count, 2, rows.data(), {}, evaluate));
+
+  setEvaluationProcesses(4);
+  nlohmann::json start = getEvaluationPoolStats();
+  auto counter = [&start](string key) {
+    return getEvaluationPoolStats()[key].get<uint64_t>() - start[key].get<uint64_t>();
+  };
+
+  // too few rows to split
+  EXPECT_FALSE(EvaluationPool::run(EvaluationPool::MIN_SHARD_SIZE, 2, rows.data(), {}, evaluate));
+
+  ASSERT_TRUE(EvaluationPool::run(count, 2, rows.data(), {}, evaluate));
+  for (size_t i = 0; i < count; i++) {
+    ASSERT_EQ(rows[i * 2], i);
+    ASSERT_EQ(rows[i * 2 + 1], sqrt(double(i)));
+  }
+  EXPECT_EQ(counter("runs"), 1);
+  EXPECT_EQ(counter("rows"), count);
+  EXPECT_EQ(counter("workers"), 3);
+  EXPECT_EQ(counter("reopened"), 0);
+
+  // nothing is written when a worker fails
+  vector<double> untouched(count, -1);
+  auto failing = [](size_t begin, size_t end, double *out) {
+    out[0] = 0;
+    return begin != 0;
+  };
+  EXPECT_FALSE(EvaluationPool::run(count, 1, untouched.data(), {}, failing));
+  EXPECT_EQ(untouched[0], -1);
+  EXPECT_EQ(counter("failed"), 1);
+
+  setEvaluationProcesses(0);
+}
+
+TEST_F(LroKernelSet, UnitTestEvaluationPoolKernels) {
+  nlohmann::json testKernelJson;
+  testKernelJson["kernels"] = {{ckPath1}, {ckPath2}, {spkPath1}, {spkPath3}, {fkPath}, {sclkPath}, {lskPath}};
+  KernelSet testSet(testKernelJson);
+  // CSPICE evaluates every epoch, in the workers after they reopen the kernels
+  setNativeSpkEvaluation(false);
+  setNativeCkEvaluation(false);
+
+  size_t count = 3 * EvaluationPool::MIN_SHARD_SIZE;
+  vector<double> ets(count);
+  for (size_t i = 0; i < count; i++) {
+    ets[i] = 110000000 + 10000000.0 * i / (count - 1);
+  }
+
+  struct Results {
+    vector<double> states;
+    vector<double> orientations;
+    vector<double> ticks;
+  };
+  // time of each kind of request, recorded in the test report to compare the pool with a serial evaluation
+  auto evaluate = [this, &ets, count](string mode) {
+    Results results;
+    auto timed = [this, &mode](string name, auto call) {
+      auto start = steady_clock::now();
+      call();
+      RecordProperty(mode + "_" + name + "_us", to_string(duration_cast<microseconds>(steady_clock::now() - start).count()));
+    };
+    results.states.resize(count * 7);
+    timed("states", [&] { getTargetStatesInto(ets.data(), count, "-85", "1", "J2000", "NONE", results.states.data()); });
+    results.orientations.resize(count * 8);
+    timed("orientations", [&] { getTargetOrientationsInto(ets.data(), count, -85000, 1, results.orientations.data()); });
+    timed("ticks", [&] { results.ticks = doubleEtsToSclkTicks(-85, ets, "lro").first; });
+    return results;
+  };
+
+  setEvaluationProcesses(0);
+  Results serial = evaluate("serial");
+
+  setEvaluationProcesses(4);
+  nlohmann::json start = getEvaluationPoolStats();
+  auto counter = [&start](string key) {
+    return getEvaluationPoolStats()[key].get<uint64_t>() - start[key].get<uint64_t>();
+  };
+  Results pooled = evaluate("pooled");
+  EXPECT_EQ(counter("runs"), 3);
+  EXPECT_EQ(counter("failed"), 0);
+  EXPECT_EQ(counter("skipped"), 0);
+  // three workers for states and for orientations reopen the two CKs and two SPKs, none for ticks
+  EXPECT_EQ(counter("reopened"), 2 * 3 * 4);
+
+  // the workers give the same bits as the calling process
+  EXPECT_EQ(pooled.states, serial.states);
+  EXPECT_EQ(pooled.orientations, serial.orientations);
+  EXPECT_EQ(pooled.ticks, serial.ticks);
+
+  // with enough CKs the workers would spend more time reopening them than evaluating
+  size_t cks = 2 * EvaluationPool::MIN_SHARD_SIZE / EvaluationPool::MIN_EPOCHS_PER_KERNEL;
+  nlohmann::json copiesJson;
+  for (size_t i = 0; i < cks; i++) {
+    fs::path copy = root / "ck" / ("soc31_copy_" + to_string(i) + ".bc");
+    fs::copy_file(ckPath1, copy);
+    copiesJson["kernels"].push_back({copy.string()});
+  }
+  KernelSet copiesSet(copiesJson);
+  vector<double> orientations(count * 8);
+  getTargetOrientationsInto(ets.data(), count, -85000, 1, orientations.data());
+  EXPECT_EQ(counter("runs"), 3);
+  EXPECT_EQ(counter("skipped"), 1);
+  EXPECT_EQ(orientations, serial.orientations);
+
+  setEvaluationProcesses(0);
+  setNativeSpkEvaluation(true);
+  setNativeCkEvaluation(true);
+}
+
 TEST_F(LroKernelSet, UnitTestGetTargetStatesRanged) {
   vector<double> ets = {110000000, 110000001};
   auto [resStates, kernels] = getTargetStatesRanged(ets[0], ets[1], 2, "LRO", "LRO", "J2000", "NONE", "lroc", {"smithed"}, {"smithed"});
@@ -613,3 +1106,56 @@ TEST_F(InferMissionFromCode, NameCandidateTakesPrecedenceOverCode) {
   // String candidates are tried before codes.
   EXPECT_EQ(inferMission({"MRO_CTX"}, {-85}), "ctx");
 }
+
+
+TEST_F(InferMissionFromCode, IndexTracksAliasChanges) {
+  EXPECT_EQ(inferMission({}, {-74021}), "ctx");
+  nlohmann::json before = getMissionIndexStats();
+  EXPECT_GT(before["codes"].get<size_t>(), 0u);
+  EXPECT_GT(before["names"].get<size_t>(), 0u);
+
+  // Codes in the DB's frame map are answered by the index
+  EXPECT_EQ(inferMission({}, {-85600}), "lroc");
+  nlohmann::json after = getMissionIndexStats();
+  EXPECT_GT(after["hits"].get<uint64_t>(), before["hits"].get<uint64_t>());
+  EXPECT_EQ(after["builds"], before["builds"]);
+
+  // Changing the alias map rebuilds the index
+  AliasMap::instance().addAliasKey("SPICEQL_TEST_ALIAS", "lroc");
+  EXPECT_EQ(inferMission({"spiceql_test_alias"}, {}), "lroc");
+  EXPECT_GT(getMissionIndexStats()["builds"].get<uint64_t>(), after["builds"].get<uint64_t>());
+}
+
+
+TEST_F(TempTestingFiles, UnitTestResolveDataPath) {
+  EXPECT_EQ(getDataDirectory(), tempDir.string());
+
+  fs::path kernel = tempDir / "test.tls";
+  EXPECT_EQ(resolveDataPath("test.tls"), kernel.string());
+  ofstream(kernel) << "KPL/LSK" << endl;
+  EXPECT_EQ(resolveDataPath("test.tls"), kernel.string());
+  EXPECT_EQ(resolveDataPath(kernel.string()), kernel.string());
+
+  // changing the env var resolves paths into the new data directory
+  fs::path other = tempDir / "other";
+  fs::create_directory(other);
+  setenv("SPICEROOT", other.c_str(), true);
+  EXPECT_EQ(getDataDirectory(), other.string());
+  EXPECT_EQ(resolveDataPath("test.tls"), (other / "test.tls").string());
+
+  // a preferred directory created later is picked up
+  fs::path later = tempDir / "later";
+  setenv("SPICEROOT", later.c_str(), true);
+  try {
+    getDataDirectory();
+  }
+  catch (runtime_error &e) {
+    // no other data directory is set
+  }
+  fs::create_directory(later);
+  EXPECT_EQ(getDataDirectory(), later.string());
+
+  setenv("SPICEROOT", tempDir.c_str(), true);
+  refreshEnvironment();
+  EXPECT_EQ(getDataDirectory(), tempDir.string());
+}
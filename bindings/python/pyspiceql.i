@@ -8,6 +8,7 @@
 %include "std_map.i"
 %include "carrays.i"
 %include "std_pair.i"
+%include "stdint.i"
 
 // #include <nlohmann/json.hpp>
 
@@ -145,6 +146,24 @@
   PyTuple_SetItem($result, 1,  PyObject_CallMethodObjArgs(module, jsonLoads, pythonJsonString, NULL));
 }
 
+// pair<vector<string>, json>
+%typemap(out) std::pair<std::vector<std::string>, nlohmann::json> {
+  PyObject* vec_list = PyList_New($1.first.size());
+  for (size_t i = 0; i < $1.first.size(); ++i) {
+      PyList_SetItem(vec_list, i, PyUnicode_FromString($1.first[i].c_str()));
+  }
+
+  PyObject* module = PyImport_ImportModule("json");
+  PyObject* jsonLoads = PyUnicode_FromString("loads");
+
+  std::string jsonString = $1.second.dump();
+  PyObject* pythonJsonString = PyUnicode_DecodeUTF8(jsonString.c_str(), jsonString.size(), NULL);
+
+  $result = PyTuple_New(2);
+  PyTuple_SetItem($result, 0, vec_list);
+  PyTuple_SetItem($result, 1,  PyObject_CallMethodObjArgs(module, jsonLoads, pythonJsonString, NULL));
+}
+
 // pair<double, json>
 %typemap(out) std::pair<double, nlohmann::json> {
   PyObject* dblOut = PyFloat_FromDouble($1.first);
@@ -37,7 +37,7 @@ import createSpiceQL from './spiceql_wasm.js';
 const API_FUNCTIONS = [
   'getSpiceqlName', 'addAliasKey', 'getAliasMap', 'setAliasMap', 'urlEncode',
   'spiceAPIQuery',
-  'getTargetStates', 'getTargetStatesRanged',
+  'getTargetStates', 'getTargetStatesArray', 'getTargetStatesRanged',
   'getTargetOrientations', 'getTargetOrientationsRanged',
   'strSclkToEt', 'doubleSclkToEt', 'doubleEtToSclk',
   'utcToEt', 'etToUtc',
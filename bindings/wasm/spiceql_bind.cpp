@@ -210,6 +210,16 @@ val wrapVecPair(const std::pair<V, json> &p) {
   return out;
 }
 
+// Wrap std::pair<vector<double>, json> into { result: Float64Array, kernels },
+// copying the whole buffer at once instead of pushing element by element.
+val wrapFloat64Pair(const std::pair<std::vector<double>, json> &p) {
+  val view = val(emscripten::typed_memory_view(p.first.size(), p.first.data()));
+  val out = val::object();
+  out.set("result", val::global("Float64Array").new_(view));
+  out.set("kernels", jsonToVal(p.second));
+  return out;
+}
+
 // ---- api.h wrappers -----------------------------------------------------------
 // Each wrapper takes the function's required positional args plus a JS options
 // object for the optional trailing params (mission, qualities, useWeb, ...).
@@ -232,6 +242,24 @@ val getTargetStates_w(const val &ets, std::string target, std::string observer,
   });
 }
 
+val getTargetStatesArray_w(const val &ets, std::string target, std::string observer,
+                           std::string frame, std::string abcorr, const val &opts) {
+  return guard([&]() -> val {
+  auto r = SpiceQL::getTargetStatesArray(
+      valToDoubleVec(ets), target, observer, frame, abcorr,
+      optStr(opts, "mission", ""),
+      optStrVec(opts, "ckQualities", kDefaultQualities),
+      optStrVec(opts, "spkQualities", kDefaultQualities),
+      optBool(opts, "useWeb", false),
+      optBool(opts, "searchKernels", true),
+      optBool(opts, "fullKernelPath", false),
+      optInt(opts, "limitCk", -1),
+      optInt(opts, "limitSpk", 1),
+      optStrVec(opts, "kernelList", {}));
+  return wrapFloat64Pair(r);
+  });
+}
+
 val getTargetStatesRanged_w(double startEt, double stopEt, int numRecords,
                             std::string target, std::string observer,
                             std::string frame, std::string abcorr, const val &opts) {
@@ -573,6 +601,7 @@ EMSCRIPTEN_BINDINGS(spiceql) {
   emscripten::function("naifCheckErrors", &naifCheckErrors_w);
 
   emscripten::function("getTargetStates", &getTargetStates_w);
+  emscripten::function("getTargetStatesArray", &getTargetStatesArray_w);
   emscripten::function("getTargetStatesRanged", &getTargetStatesRanged_w);
   emscripten::function("getTargetOrientations", &getTargetOrientations_w);
   emscripten::function("getTargetOrientationsRanged", &getTargetOrientationsRanged_w);
@@ -15,6 +15,32 @@ logger = logging.getLogger(__name__)
 # Create FastAPI instance
 app = FastAPI()
 
+# Report of the startup warm-up, None until it ran
+preload_report = None
+
+@app.on_event("startup")
+async def preload():
+    # SPICEQL_PRELOAD: comma separated missions to warm up before serving, "all" for every mission
+    # SPICEQL_PRELOAD_HOT: number of most furnished kernels from the kernel telemetry to keep loaded
+    global preload_report
+    missions = os.environ.get("SPICEQL_PRELOAD", "").strip()
+    if not missions:
+      return
+    missions = [] if missions.lower() == "all" else [m.strip() for m in missions.split(",") if m.strip()]
+    furnish = os.environ.get("SPICEQL_PRELOAD_FURNISH", "false").lower() in ("1", "true", "yes")
+    try:
+      hot = int(os.environ.get("SPICEQL_PRELOAD_HOT", "0"))
+      preload_report = pyspiceql.preload(missions, furnish, hot)
+      logger.info(f"Preloaded SpiceQL inventory: {preload_report}")
+    except Exception as e:
+      logger.error(f"SpiceQL preload failed: {e}")
+      preload_report = {"warm": False, "error": str(e)}
+
+@app.on_event("shutdown")
+async def flush_telemetry():
+    if pyspiceql.isKernelTelemetryEnabled():
+      pyspiceql.flushKernelTelemetry()
+
 @app.get("/")
 async def message():
     try: 
@@ -31,16 +57,38 @@ async def message():
         logger.error(f"SpiceQL DB not found at : {pyspiceql.getDbFilePath()}")
         raise Exception("SpiceQL DB could not be found.")
         
+      # workers configured to preload are only healthy once warm
+      is_warm = preload_report is None or preload_report.get("warm", False)
       return {"data_content": os.listdir(pyspiceql.getDataDirectory()),
               "data_dir_exists": data_dir_exists, 
               "db_exists": db_exists,
-              "is_healthy": data_dir_exists,
+              "db_ready": pyspiceql.isDbReady(),
+              "is_warm": is_warm,
+              "preload": preload_report,
+              "pinned_missions": pyspiceql.getPinnedMissions(),
+              "prefetch": pyspiceql.getKernelPrefetchStats(),
+              "kernel_cache": pyspiceql.getKernelCacheStats(),
+              "evaluation_pool": pyspiceql.getEvaluationPoolStats(),
+              "native_spk": pyspiceql.getNativeSpkStats(),
+              "native_ck": pyspiceql.getNativeCkStats(),
+              "is_healthy": data_dir_exists and is_warm,
               "spiceql_version" : spiceql_version}
     except Exception as e:
         logger.error(f"ERROR: {e}")
         return {"is_healthy": False}
 
 
+@app.get("/hotKernels")
+async def hotKernels(n: int = 10):
+    try:
+      result = pyspiceql.getHotKernels(n)
+      body = ResultModel(result=result, kernels={})
+      return ResponseModel(statusCode=200, body=body)
+    except Exception as e:
+      body = ErrorModel(error=str(e))
+      return ResponseModel(statusCode=500, body=body)
+
+
 # SpiceQL endpoints
 @app.get("/getTargetStates")
 async def getTargetStates(
@@ -124,6 +172,67 @@ async def getTargetStates(params: Annotated[TargetStatesRequestModel, Body(
     
 
 
+@app.get("/getTargetStatesArray")
+async def getTargetStatesArray(
+    target: Annotated[TargetParam, Depends()],
+    observer: Annotated[ObserverParam, Depends()],
+    frame: Annotated[FrameStrParam, Depends()],
+    abcorr: Annotated[AbcorrParam, Depends()],
+    ets: Annotated[EtsParam, Depends()],
+    mission: Annotated[MissionParam, Depends()],
+    commonParams: Annotated[CommonParams, Depends()],
+    ckQualities: Annotated[CkQualitiesParam, Depends()],
+    spkQualities: Annotated[SpkQualitiesParam, Depends()],
+    ):
+    # returns the states as one flat list, 7 values per ephemeris time
+    try:
+        result, kernels = pyspiceql.getTargetStatesArray(
+            ets.value,
+            target.value,
+            observer.value,
+            frame.value,
+            abcorr.value,
+            mission.value,
+            ckQualities.value,
+            spkQualities.value,
+            False,
+            commonParams.searchKernels,
+            commonParams.fullKernelPath,
+            commonParams.limitCk,
+            commonParams.limitSpk,
+            commonParams.kernelList)
+        body = ResultModel(result=result, kernels=kernels)
+        return ResponseModel(statusCode=200, body=body)
+    except Exception as e:
+        body = ErrorModel(error=str(e))
+        return ResponseModel(statusCode=500, body=body)
+
+
+@app.post("/getTargetStatesArray")
+async def getTargetStatesArray(params: TargetStatesRequestModel):
+    try:
+        result, kernels = pyspiceql.getTargetStatesArray(
+            params.ets,
+            params.target,
+            params.observer,
+            params.frame,
+            params.abcorr,
+            params.mission,
+            params.ckQualities,
+            params.spkQualities,
+            False,
+            params.searchKernels,
+            params.fullKernelPath,
+            params.limitCk,
+            params.limitSpk,
+            params.kernelList)
+        body = ResultModel(result=result, kernels=kernels)
+        return ResponseModel(statusCode=200, body=body)
+    except Exception as e:
+        body = ErrorModel(error=str(e))
+        return ResponseModel(statusCode=500, body=body)
+
+
 @app.get("/getTargetStatesRanged")
 async def getTargetStatesRanged(
     target: Annotated[TargetParam, Depends()],
@@ -438,6 +547,48 @@ async def translateCodeToName(
         body = ErrorModel(error=str(e))
         return ResponseModel(statusCode=500, body=body)
 
+@app.get("/translateNamesToCodes")
+async def translateNamesToCodes(
+    frames: Annotated[FramesStrParam, Depends()],
+    mission: Annotated[MissionParam, Depends()],
+    commonParams: Annotated[CommonParams, Depends()]):
+    try:
+        result, kernels = pyspiceql.translateNamesToCodes(
+            frames.value,
+            mission.value,
+            False,
+            commonParams.searchKernels,
+            commonParams.fullKernelPath,
+            commonParams.limitCk,
+            commonParams.limitSpk,
+            commonParams.kernelList)
+        body = ResultModel(result=result, kernels=kernels)
+        return ResponseModel(statusCode=200, body=body)
+    except Exception as e:
+        body = ErrorModel(error=str(e))
+        return ResponseModel(statusCode=500, body=body)
+
+@app.get("/translateCodesToNames")
+async def translateCodesToNames(
+    frames: Annotated[FramesIntParam, Depends()],
+    mission: Annotated[MissionParam, Depends()],
+    commonParams: Annotated[CommonParams, Depends()]):
+    try:
+        result, kernels = pyspiceql.translateCodesToNames(
+            frames.value,
+            mission.value,
+            False,
+            commonParams.searchKernels,
+            commonParams.fullKernelPath,
+            commonParams.limitCk,
+            commonParams.limitSpk,
+            commonParams.kernelList)
+        body = ResultModel(result=result, kernels=kernels)
+        return ResponseModel(statusCode=200, body=body)
+    except Exception as e:
+        body = ErrorModel(error=str(e))
+        return ResponseModel(statusCode=500, body=body)
+
 @app.get("/getFrameInfo")
 async def getFrameInfo(
     frame: Annotated[FrameIntParam, Depends()],
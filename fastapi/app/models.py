@@ -59,7 +59,7 @@ def validate_params(init_func):
             
             # Check if variable names are possible list type
             if var_name in ['ckQualities', 'spkQualities', 'kernelList', 'spiceqlNames', 'types'] or \
-               any(sub in self.__class__.__name__.lower() for sub in ['ckqualities', 'spkqualities', 'spiceqlnames', 'types']):
+               any(sub in self.__class__.__name__.lower() for sub in ['ckqualities', 'spkqualities', 'spiceqlnames', 'types', 'framesstr']):
                 setattr(self, var_name, to_list(var_value))
             
             # Check if variable name is 'ets'
@@ -488,6 +488,45 @@ class FrameStrParam():
         self.value = frame
 
 
+class FramesIntParam():
+    def __init__(
+            self,
+            frames: Annotated[str, Query(
+                description="List of frame codes.",
+                openapi_examples={
+                    "empty": {
+                        "summary": "Default",
+                        "value": None
+                    },
+                    "lro": {
+                        "summary": "LROC Codes [-85600, -85610]",
+                        "value": "[-85600, -85610]"
+                    }
+                }
+            )]):
+        self.value = convert_strictly_to_numeric_list(frames)
+
+
+class FramesStrParam():
+    @validate_params
+    def __init__(
+            self,
+            frames: Annotated[str, Query(
+                description="List of frame names.",
+                openapi_examples={
+                    "empty": {
+                        "summary": "Default",
+                        "value": None
+                    },
+                    "lro": {
+                        "summary": "LROC Frames [LRO_LROCNACL, LRO_LROCNACR]",
+                        "value": "[LRO_LROCNACL, LRO_LROCNACR]"
+                    }
+                }
+            )]):
+        self.value = frames
+
+
 class InitialFrameParam():
     @validate_params
     def __init__(
@@ -79,6 +79,30 @@ def test_getTargetStates_returns_expected_state_vectors():
     assert response.status_code == 200
     assert response.json()["body"]["return"] == expected_return
 
+# ---------------------------------------------------------------------------
+# getTargetStatesArray
+# ---------------------------------------------------------------------------
+
+def test_getTargetStatesArray_returns_flat_state_vectors():
+    expected_return = [
+        123515791.9195627, 187209003.7067195, 80611152.03610656,
+        13251.543112834495, -8742.597438450646, -6.575020419444353, 794.9856233875888,
+        123694026.59723282, 187091292.98278633, 80611063.57350075,
+        13243.211405493359, -8755.21373709343, -6.575031051390966, 794.985539001637,
+    ]
+    with patch("pyspiceql.getTargetStatesArray", return_value=(expected_return, CK_KERNELS)):
+        response = client.get("/getTargetStatesArray", params={
+            "ets": "[690201375.8323615,690201389.2866975]",
+            "target": "SUN",
+            "observer": "Mars",
+            "frame": "IAU_MARS",
+            "mission": "ctx",
+            "abcorr": "LT+S",
+            "searchKernels": "true",
+        })
+    assert response.status_code == 200
+    assert response.json()["body"]["return"] == expected_return
+
 # ---------------------------------------------------------------------------
 # getTargetStatesRanged
 # ---------------------------------------------------------------------------
@@ -302,7 +326,7 @@ def test_etToUtc_returns_expected_utc_string():
 
 def test_translateNameToCode_returns_expected_code():
     expected_return = -74
-    with patch("pyspiceql.translateNameToCode", return_value=(expected_return, FK_KERNELS)):
+    with patch("pyspiceql.translateNameToCode", return_value=(expected_return, {**FK_KERNELS, "furnished": False})):
         response = client.get("/translateNameToCode", params={
             "frame": "MRO",
             "mission": "ctx",
@@ -310,6 +334,7 @@ def test_translateNameToCode_returns_expected_code():
         })
     assert response.status_code == 200
     assert response.json()["body"]["return"] == expected_return
+    assert response.json()["body"]["kernels"]["furnished"] is False
 
 
 # ---------------------------------------------------------------------------
@@ -318,7 +343,7 @@ def test_translateNameToCode_returns_expected_code():
 
 def test_translateCodeToName_returns_expected_name():
     expected_return = "MRO"
-    with patch("pyspiceql.translateCodeToName", return_value=(expected_return, FK_KERNELS)):
+    with patch("pyspiceql.translateCodeToName", return_value=(expected_return, {**FK_KERNELS, "furnished": True})):
         response = client.get("/translateCodeToName", params={
             "frame": -74,
             "mission": "ctx",
@@ -326,6 +351,39 @@ def test_translateCodeToName_returns_expected_name():
         })
     assert response.status_code == 200
     assert response.json()["body"]["return"] == expected_return
+    assert response.json()["body"]["kernels"]["furnished"] is True
+
+
+# ---------------------------------------------------------------------------
+# translateNamesToCodes / translateCodesToNames
+# ---------------------------------------------------------------------------
+
+def test_translateNamesToCodes_passes_frame_list():
+    expected_return = [-74, -74021]
+    with patch("pyspiceql.translateNamesToCodes", return_value=(expected_return, {**FK_KERNELS, "furnished": False})) as mock:
+        response = client.get("/translateNamesToCodes", params={
+            "frames": "[MRO, MRO_CTX]",
+            "mission": "ctx",
+            "searchKernels": "true",
+        })
+    assert response.status_code == 200
+    assert response.json()["body"]["return"] == expected_return
+    assert response.json()["body"]["kernels"]["furnished"] is False
+    assert mock.call_args[0][0] == ["MRO", "MRO_CTX"]
+
+
+def test_translateCodesToNames_passes_frame_list():
+    expected_return = ["MRO", "MRO_CTX"]
+    with patch("pyspiceql.translateCodesToNames", return_value=(expected_return, {**FK_KERNELS, "furnished": True})) as mock:
+        response = client.get("/translateCodesToNames", params={
+            "frames": "[-74, -74021]",
+            "mission": "ctx",
+            "searchKernels": "true",
+        })
+    assert response.status_code == 200
+    assert response.json()["body"]["return"] == expected_return
+    assert response.json()["body"]["kernels"]["furnished"] is True
+    assert mock.call_args[0][0] == [-74, -74021]
 
 
 # ---------------------------------------------------------------------------
@@ -536,3 +594,19 @@ def test_searchForKernelsets_returns_expected_kernels():
         })
     assert response.status_code == 200
     assert response.json()["body"]["return"] == expected_return
+
+
+# ---------------------------------------------------------------------------
+# hotKernels
+# ---------------------------------------------------------------------------
+
+def test_hotKernels_returns_expected_kernels():
+    expected_return = {
+        "kernels": [{"kernel": "mro/kernels/ck/mro_sc_psp_211109_211115.bc", "furnishes": 12, "bytes": 1024, "seconds": 0.5}],
+        "missions": [{"mission": "mro", "furnishes": 12, "bytes": 1024, "seconds": 0.5}],
+    }
+    with patch("pyspiceql.getHotKernels", return_value=expected_return) as getHotKernels:
+        response = client.get("/hotKernels", params={"n": 1})
+    assert response.status_code == 200
+    assert response.json()["body"]["return"] == expected_return
+    getHotKernels.assert_called_once_with(1)